@@ -0,0 +1,51 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+
+-- libluavars API throughput benchmark
+--
+-- usage: luavars_bench bench/bench_api.lua
+--
+-- BENCH_N sets the number of iterations of each benchmark
+
+local vars = require("libluavars")
+local N = tonumber( os.getenv( "BENCH_N" ) ) or 100000
+
+bench.mkvar( "/bench/api/u16", "uint16", 1 )
+bench.mkvar( "/bench/api/u32", "uint32", 1 )
+bench.mkvar( "/bench/api/f", "float", 1.5 )
+bench.mkvar( "/bench/api/str", "str", "hello" )
+
+local hU32 = vars.find( "/bench/api/u32" )
+
+bench.run( "find", N, function() vars.find( "/bench/api/u32" ) end )
+bench.run( "get uint16", N, function() vars.get( "/bench/api/u16" ) end )
+bench.run( "get uint32", N, function() vars.get( "/bench/api/u32" ) end )
+bench.run( "get float", N, function() vars.get( "/bench/api/f" ) end )
+bench.run( "get str", N, function() vars.get( "/bench/api/str" ) end )
+bench.run( "set uint32 by name", N, function()
+    vars.set( "/bench/api/u32", 5 )
+end )
+bench.run( "set uint32 by handle", N, function() vars.set( hU32, 5 ) end )
+bench.run( "set str by name", N, function()
+    vars.set( "/bench/api/str", "world" )
+end )
@@ -0,0 +1,90 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+
+
+-- libluavars batched get, set, snapshot, restore and diff benchmark
+--
+-- usage: luavars_bench bench/bench_fetch.lua
+--
+-- BENCH_N sets the number of batches fetched by each benchmark,
+-- BENCH_VARS the number of variables in a batch, and VARSTUB_GET_US
+-- an emulated round trip time for each get in microseconds, and
+-- BENCH_SNAPSHOT the snapshot file (default /tmp/bench_fetch.snap).
+
+local vars = require("libluavars")
+local N = tonumber( os.getenv( "BENCH_N" ) ) or 100
+local M = tonumber( os.getenv( "BENCH_VARS" ) ) or 1000
+local path = os.getenv( "BENCH_SNAPSHOT" ) or "/tmp/bench_fetch.snap"
+
+local names = {}
+
+for i = 1, M do
+    names[i] = string.format( "/bench/fetch/%d", i )
+    bench.mkvar( names[i], "uint32", i )
+end
+
+bench.run( string.format( "get x%d", M ), N, function()
+    for i = 1, M do
+        vars.get( names[i] )
+    end
+end )
+
+for _, threads in ipairs{ 1, 2, 4, 8, 16 } do
+    bench.run( string.format( "get_many x%d, %d threads", M, threads ),
+               N,
+               function() vars.get_many( names, threads ) end )
+end
+
+local values = {}
+
+for i = 1, M do
+    values[names[i]] = i + 1
+end
+
+bench.run( string.format( "set x%d", M ), N, function()
+    for i = 1, M do
+        vars.set( names[i], i )
+    end
+end )
+
+bench.run( string.format( "set_many x%d", M ), N, function()
+    vars.set_many( values )
+end )
+
+bench.run( string.format( "snapshot x%d", M ), N, function()
+    vars.snapshot( names, path )
+end )
+
+bench.run( string.format( "restore x%d", M ), N, function()
+    vars.restore( path )
+end )
+
+bench.run( string.format( "diff file x%d", M ), N, function()
+    vars.diff( path, path )
+end )
+
+bench.run( string.format( "diff live x%d", M ), N, function()
+    vars.diff( path )
+end )
+
+os.remove( path )
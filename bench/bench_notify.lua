@@ -0,0 +1,74 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+
+-- libluavars notification dispatch benchmark
+--
+-- A client thread generates notifications which are handled by
+-- a vars.wait() loop, measuring the dispatch rate for each
+-- notification type and the round trip latency seen by the client.
+--
+-- usage: luavars_bench bench/bench_notify.lua
+--
+-- BENCH_N sets the number of notifications of each type
+
+local vars = require("libluavars")
+local N = tonumber( os.getenv( "BENCH_N" ) ) or 20000
+local EOK = 0
+
+local hMod = bench.mkvar( "/bench/notify/modified", "uint32", 0 )
+local hVal = bench.mkvar( "/bench/notify/validate", "uint32", 0 )
+local hCalc = bench.mkvar( "/bench/notify/calc", "uint32", 0 )
+
+vars.notify( hMod, NOTIFY_MODIFIED )
+vars.notify( hVal, NOTIFY_VALIDATE )
+vars.notify( hCalc, NOTIFY_CALC )
+
+-- modified: the client writes the variable, we receive the notification
+local client = bench.client( "set", "/bench/notify/modified", N )
+local t0 = bench.now()
+for i = 1, N do
+    vars.wait()
+end
+bench.report( "modified dispatch", N, bench.now() - t0 )
+client:join()
+
+-- validate: the client write blocks until we accept it
+client = bench.client( "set", "/bench/notify/validate", N )
+t0 = bench.now()
+for i = 1, N do
+    local sig, id = vars.wait()
+    vars.validate_start( id )
+    vars.validate_end( id, EOK )
+end
+bench.report( "validate dispatch", N, bench.now() - t0 )
+client:join()
+
+-- calc: the client read blocks until we write the value
+client = bench.client( "get", "/bench/notify/calc", N )
+t0 = bench.now()
+for i = 1, N do
+    local sig, id = vars.wait()
+    vars.set( id, i )
+end
+bench.report( "calc dispatch", N, bench.now() - t0 )
+client:join()
@@ -0,0 +1,50 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+
+-- libluavars print session benchmark
+--
+-- A client thread prints a variable which is rendered by a
+-- vars.wait() loop, measuring the cost of a print session.
+--
+-- usage: luavars_bench bench/bench_print.lua
+--
+-- BENCH_N sets the number of print sessions
+
+local vars = require("libluavars")
+local N = tonumber( os.getenv( "BENCH_N" ) ) or 20000
+
+local hPrint = bench.mkvar( "/bench/print/c", "str", "" )
+
+vars.notify( hPrint, NOTIFY_PRINT )
+
+local client = bench.client( "print", "/bench/print/c", N )
+local t0 = bench.now()
+for i = 1, N do
+    local sig, id = vars.wait()
+    local ps, hVar = vars.open_print_session( id )
+    ps:write( "Hello from Lua!\n" )
+    ps:write( string.format( "The counter is %d\n", i ) )
+    vars.close_print_session( ps )
+end
+bench.report( "print session", N, bench.now() - t0 )
+client:join()
@@ -0,0 +1,367 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup luavars_bench
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file client.c
+
+    Benchmark client threads
+
+    A client thread opens its own varserver connection and performs
+    a number of get, set or print operations on a variable, recording
+    the round trip latency of each one.  When a Lua script is handling
+    notifications for the variable, the round trip includes the calc,
+    validate or print handler.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <varserver/varserver.h>
+#include "stats.h"
+#include "loadgen.h"
+#include "client.h"
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static void *client_thread( void *arg );
+static int client_op( VARSERVER_HANDLE hVarServer,
+                      BenchClient *pClient,
+                      VAR_HANDLE hVar,
+                      uint64_t i,
+                      VarType type );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! names of the client operations */
+static const char *opNames[BENCH_OP_MAX] = {
+    "get",
+    "set",
+    "print"
+};
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  CLIENT_Start                                                              */
+/*!
+    Start a client thread
+
+    @param[in]
+        pClient
+            pointer to the client, which must remain valid until
+            CLIENT_Join() is called
+
+    @param[in]
+        op
+            the operation to perform
+
+    @param[in]
+        name
+            name of the variable to operate on
+
+    @param[in]
+        count
+            number of operations to perform
+
+    @retval EOK the client thread was started
+    @retval EINVAL invalid arguments
+    @retval other error from pthread_create()
+
+==============================================================================*/
+int CLIENT_Start( BenchClient *pClient,
+                  BenchOp op,
+                  const char *name,
+                  uint64_t count )
+{
+    int result = EINVAL;
+
+    if( ( pClient != NULL ) && ( name != NULL ) && ( op < BENCH_OP_MAX ) )
+    {
+        memset( pClient, 0, sizeof( BenchClient ) );
+        pClient->op = op;
+        pClient->count = count;
+        strncpy( pClient->name, name, MAX_NAME_LEN );
+
+        result = pthread_create( &pClient->thread,
+                                 NULL,
+                                 client_thread,
+                                 pClient );
+        pClient->running = ( result == EOK );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  CLIENT_Join                                                               */
+/*!
+    Wait for a client thread to complete
+
+    @param[in]
+        pClient
+            pointer to the client
+
+==============================================================================*/
+void CLIENT_Join( BenchClient *pClient )
+{
+    if( ( pClient != NULL ) && ( pClient->running == true ) )
+    {
+        pthread_join( pClient->thread, NULL );
+        pClient->running = false;
+    }
+}
+
+/*============================================================================*/
+/*  CLIENT_OpFromName                                                         */
+/*!
+    Convert an operation name to a BenchOp
+
+    @param[in]
+        name
+            "get", "set" or "print"
+
+    @return the operation, or BENCH_OP_MAX if the name is not valid
+
+==============================================================================*/
+BenchOp CLIENT_OpFromName( const char *name )
+{
+    BenchOp op;
+
+    for( op = BENCH_OP_GET; op < BENCH_OP_MAX; op++ )
+    {
+        if( ( name != NULL ) && ( strcmp( name, opNames[op] ) == 0 ) )
+        {
+            break;
+        }
+    }
+
+    return op;
+}
+
+/*============================================================================*/
+/*  CLIENT_OpName                                                             */
+/*!
+    Get the name of an operation
+
+    @param[in]
+        op
+            the operation
+
+    @return the name of the operation
+
+==============================================================================*/
+const char *CLIENT_OpName( BenchOp op )
+{
+    return ( op < BENCH_OP_MAX ) ? opNames[op] : "invalid";
+}
+
+/*============================================================================*/
+/*  CLIENT_BlockSignals                                                       */
+/*!
+    Block the varserver notification signals
+
+    Called before any client thread is created so that only the
+    thread calling vars.wait() will receive notifications.
+
+==============================================================================*/
+void CLIENT_BlockSignals( void )
+{
+    sigset_t mask;
+
+    sigemptyset( &mask );
+    sigaddset( &mask, SIGRTMIN+5 );
+    sigaddset( &mask, SIG_LOADGEN_DONE );
+    sigaddset( &mask, SIG_VAR_MODIFIED );
+    sigaddset( &mask, SIG_VAR_CALC );
+    sigaddset( &mask, SIG_VAR_VALIDATE );
+    sigaddset( &mask, SIG_VAR_PRINT );
+
+    pthread_sigmask( SIG_BLOCK, &mask, NULL );
+}
+
+/*============================================================================*/
+/*  client_thread                                                             */
+/*!
+    Client thread main function
+
+    @param[in]
+        arg
+            pointer to the BenchClient
+
+    @return always returns NULL
+
+==============================================================================*/
+static void *client_thread( void *arg )
+{
+    BenchClient *pClient = (BenchClient *)arg;
+    VARSERVER_HANDLE hVarServer;
+    VAR_HANDLE hVar = VAR_INVALID;
+    VarType type = VARTYPE_INVALID;
+    uint64_t start;
+    uint64_t t0;
+    uint64_t i;
+
+    hVarServer = VARSERVER_Open();
+    if( hVarServer != NULL )
+    {
+        hVar = VAR_FindByName( hVarServer, pClient->name );
+    }
+
+    if( ( hVar == VAR_INVALID ) ||
+        ( VAR_GetType( hVarServer, hVar, &type ) != EOK ) )
+    {
+        pClient->errors = pClient->count;
+    }
+    else
+    {
+        start = STATS_Now();
+
+        for( i = 0; i < pClient->count; i++ )
+        {
+            t0 = STATS_Now();
+            if( client_op( hVarServer, pClient, hVar, i, type ) != EOK )
+            {
+                pClient->errors++;
+            }
+
+            HIST_Record( &pClient->hist, STATS_Now() - t0 );
+        }
+
+        pClient->elapsed = STATS_Now() - start;
+    }
+
+    if( hVarServer != NULL )
+    {
+        (void)VARSERVER_Close( hVarServer );
+    }
+
+    return NULL;
+}
+
+/*============================================================================*/
+/*  client_op                                                                 */
+/*!
+    Perform one client operation
+
+    "set" writes the operation number to the variable, "get" reads it,
+    and "print" prints it to a pipe and reads the output.
+
+    @param[in]
+        hVarServer
+            varserver connection of the client thread
+
+    @param[in]
+        pClient
+            pointer to the client
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        i
+            operation number
+
+    @param[in]
+        type
+            type of the variable
+
+    @retval EOK the operation succeeded
+    @retval other error from the variable server
+
+==============================================================================*/
+static int client_op( VARSERVER_HANDLE hVarServer,
+                      BenchClient *pClient,
+                      VAR_HANDLE hVar,
+                      uint64_t i,
+                      VarType type )
+{
+    int result = EINVAL;
+    VarObject obj;
+    char buf[BUFSIZ];
+    int fds[2];
+
+    switch( pClient->op )
+    {
+        case BENCH_OP_GET:
+            memset( &obj, 0, sizeof( VarObject ) );
+            obj.val.str = buf;
+            obj.len = sizeof( buf );
+            result = VAR_Get( hVarServer, hVar, &obj );
+            break;
+
+        case BENCH_OP_SET:
+            snprintf( buf, sizeof( buf ), "%llu", (unsigned long long)i );
+            result = VAR_SetStr( hVarServer, hVar, type, buf );
+            break;
+
+        case BENCH_OP_PRINT:
+            if( pipe( fds ) == 0 )
+            {
+                result = VAR_Print( hVarServer, hVar, fds[1] );
+                close( fds[1] );
+
+                /* drain the output until the handler closes its end */
+                while( read( fds[0], buf, sizeof( buf ) ) > 0 )
+                {
+                }
+
+                close( fds[0] );
+            }
+            else
+            {
+                result = errno;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of luavars_bench group */
@@ -0,0 +1,92 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef CLIENT_H
+#define CLIENT_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <varserver/varserver.h>
+#include "stats.h"
+
+/*==============================================================================
+        Public types
+==============================================================================*/
+
+/*! client thread operations */
+typedef enum _BenchOp
+{
+    BENCH_OP_GET = 0,
+    BENCH_OP_SET,
+    BENCH_OP_PRINT,
+    BENCH_OP_MAX
+} BenchOp;
+
+/*! client thread */
+typedef struct _BenchClient
+{
+    /*! client thread */
+    pthread_t thread;
+
+    /*! indicates if the thread is running and has not been joined */
+    bool running;
+
+    /*! operation to perform */
+    BenchOp op;
+
+    /*! name of the variable to operate on */
+    char name[MAX_NAME_LEN+1];
+
+    /*! number of operations to perform */
+    uint64_t count;
+
+    /*! number of failed operations */
+    uint64_t errors;
+
+    /*! total elapsed time in nanoseconds */
+    uint64_t elapsed;
+
+    /*! per operation round trip latency */
+    LuaVarsHist hist;
+} BenchClient;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int CLIENT_Start( BenchClient *pClient,
+                  BenchOp op,
+                  const char *name,
+                  uint64_t count );
+void CLIENT_Join( BenchClient *pClient );
+BenchOp CLIENT_OpFromName( const char *name );
+const char *CLIENT_OpName( BenchOp op );
+void CLIENT_BlockSignals( void );
+
+#endif
@@ -0,0 +1,582 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup luavars_bench luavars_bench
+ * @brief libluavars benchmark runner
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file luavars_bench.c
+
+    libluavars benchmark runner
+
+    The luavars_bench program runs Lua benchmark scripts against the
+    libluavars bindings linked with the in-process variable server stub,
+    so benchmarks can be run on any Linux machine without a varserver
+    daemon.
+
+    In addition to the libluavars library, the scripts can use a
+    "bench" library which provides timing, variable creation and
+    client threads which act as other varserver clients:
+
+    bench.now() - monotonic time in nanoseconds
+    bench.mkvar(name, type [, value]) - create a variable
+    bench.run(label, n, fn) - time n calls of fn and report the results
+    bench.report(label, n, ns) - report the throughput of n operations
+    bench.client(op, name, n) - start a client thread which performs n
+                                "get", "set" or "print" operations
+    client:join() - wait for a client thread and get its results
+
+    Usage: luavars_bench script.lua [script.lua ...]
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+#include "stats.h"
+#include "memvars.h"
+#include "client.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! name of the client thread metatable */
+#define BENCH_CLIENT_MT "luavars.bench.client"
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+int luaopen_libluavars( lua_State *L );
+
+static int luaopen_bench( lua_State *L );
+static int bench_now( lua_State *L );
+static int bench_mkvar( lua_State *L );
+static int bench_run( lua_State *L );
+static int bench_report( lua_State *L );
+static int bench_client( lua_State *L );
+static int bench_client_join( lua_State *L );
+static int bench_client_gc( lua_State *L );
+static void push_results( lua_State *L,
+                          const char *label,
+                          uint64_t n,
+                          uint64_t errors,
+                          uint64_t ns,
+                          const LuaVarsHist *pHist );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! bench library functions */
+static const luaL_Reg bench_lib[] = {
+    { "now", bench_now },
+    { "mkvar", bench_mkvar },
+    { "run", bench_run },
+    { "report", bench_report },
+    { "client", bench_client },
+    { NULL, NULL }
+};
+
+/*! client thread methods */
+static const luaL_Reg client_methods[] = {
+    { "join", bench_client_join },
+    { "__gc", bench_client_gc },
+    { NULL, NULL }
+};
+
+/*! stub client used by the bench library */
+static VARSERVER_HANDLE hBench = NULL;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  main                                                                      */
+/*!
+    Main entry point for the luavars_bench program
+
+    @param[in]
+        argc
+            number of arguments on the command line
+
+    @param[in]
+        argv
+            array of null terminated command line arguments
+
+    @return 0 if all scripts ran successfully, 1 otherwise
+
+==============================================================================*/
+int main( int argc, char **argv )
+{
+    lua_State *L;
+    int result = 0;
+    int i;
+
+    if( argc < 2 )
+    {
+        fprintf( stderr, "usage: %s script.lua [script.lua ...]\n", argv[0] );
+        return 1;
+    }
+
+    /* notifications must only be received by vars.wait() */
+    CLIENT_BlockSignals();
+
+    hBench = VARSERVER_Open();
+
+    L = luaL_newstate();
+    if( ( L == NULL ) || ( hBench == NULL ) )
+    {
+        fprintf( stderr, "%s: out of memory\n", argv[0] );
+        return 1;
+    }
+
+    luaL_openlibs( L );
+
+    luaL_requiref( L, "libluavars", luaopen_libluavars, 0 );
+    lua_pop( L, 1 );
+
+    luaL_requiref( L, "bench", luaopen_bench, 1 );
+    lua_pop( L, 1 );
+
+    for( i = 1; ( i < argc ) && ( result == 0 ); i++ )
+    {
+        if( luaL_dofile( L, argv[i] ) != LUA_OK )
+        {
+            fprintf( stderr, "%s: %s\n", argv[i], lua_tostring( L, -1 ) );
+            result = 1;
+        }
+    }
+
+    lua_close( L );
+    (void)VARSERVER_Close( hBench );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  luaopen_bench                                                             */
+/*!
+    Entry point for the bench library
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int luaopen_bench( lua_State *L )
+{
+    luaL_newmetatable( L, BENCH_CLIENT_MT );
+    lua_pushvalue( L, -1 );
+    lua_setfield( L, -2, "__index" );
+    luaL_setfuncs( L, client_methods, 0 );
+    lua_pop( L, 1 );
+
+    lua_newtable( L );
+    luaL_setfuncs( L, bench_lib, 0 );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  bench_now                                                                 */
+/*!
+    bench.now()
+
+    Pushes the monotonic time in nanoseconds onto the Lua stack
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int bench_now( lua_State *L )
+{
+    lua_pushinteger( L, (lua_Integer)STATS_Now() );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  bench_mkvar                                                               */
+/*!
+    bench.mkvar()
+
+    Creates a stub variable.  The variable name, type name (as used
+    by mkvar) and optional initial value are passed in on the lua stack.
+
+    On success the variable handle is pushed onto the Lua stack
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int bench_mkvar( lua_State *L )
+{
+    const char *name;
+    const char *typeName;
+    const char *value;
+    VarType type;
+    int result;
+
+    name = luaL_checkstring( L, 1 );
+    typeName = luaL_checkstring( L, 2 );
+    value = lua_isnoneornil( L, 3 ) ? NULL : luaL_tolstring( L, 3, NULL );
+
+    type = MEMVARS_TypeFromName( typeName );
+    result = MEMVARS_Create( hBench, name, type, value );
+    if( result == EOK )
+    {
+        lua_pushinteger( L, VAR_FindByName( hBench, (char *)name ) );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  bench_run                                                                 */
+/*!
+    bench.run()
+
+    Calls a function a number of times, timing each call.  The label,
+    number of calls and function are passed in on the lua stack.  The
+    throughput and latency percentiles are printed, and returned as
+    a table on the Lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int bench_run( lua_State *L )
+{
+    const char *label;
+    uint64_t n;
+    uint64_t i;
+    uint64_t start;
+    uint64_t t0;
+    LuaVarsHist *pHist;
+
+    label = luaL_checkstring( L, 1 );
+    n = (uint64_t)luaL_checkinteger( L, 2 );
+    luaL_checktype( L, 3, LUA_TFUNCTION );
+
+    pHist = calloc( 1, sizeof( LuaVarsHist ) );
+    if( pHist == NULL )
+    {
+        return luaL_error( L, "out of memory" );
+    }
+
+    start = STATS_Now();
+    for( i = 0; i < n; i++ )
+    {
+        lua_pushvalue( L, 3 );
+        t0 = STATS_Now();
+        lua_call( L, 0, 0 );
+        HIST_Record( pHist, STATS_Now() - t0 );
+    }
+
+    push_results( L, label, n, 0, STATS_Now() - start, pHist );
+    free( pHist );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  bench_report                                                              */
+/*!
+    bench.report()
+
+    Prints the throughput of a number of operations measured by the
+    script.  The label, number of operations and elapsed nanoseconds
+    are passed in on the lua stack.  The results are returned as a
+    table on the Lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int bench_report( lua_State *L )
+{
+    const char *label;
+    uint64_t n;
+    uint64_t ns;
+
+    label = luaL_checkstring( L, 1 );
+    n = (uint64_t)luaL_checkinteger( L, 2 );
+    ns = (uint64_t)luaL_checkinteger( L, 3 );
+
+    push_results( L, label, n, 0, ns, NULL );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  bench_client                                                              */
+/*!
+    bench.client()
+
+    Starts a client thread with its own varserver connection.
+    The operation ("get", "set" or "print"), the variable name and
+    the number of operations are passed in on the lua stack.
+
+    "set" writes the operation number to the variable, raising
+    validate and modified notifications.  "get" reads the variable,
+    raising calc notifications.  "print" prints the variable,
+    raising print notifications.
+
+    The client thread object is pushed onto the Lua stack
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int bench_client( lua_State *L )
+{
+    BenchClient *pClient;
+    const char *name;
+    uint64_t count;
+    BenchOp op;
+
+    op = CLIENT_OpFromName( luaL_checkstring( L, 1 ) );
+    luaL_argcheck( L, op != BENCH_OP_MAX, 1, "expected get, set or print" );
+    name = luaL_checkstring( L, 2 );
+    count = (uint64_t)luaL_checkinteger( L, 3 );
+
+    if( VAR_FindByName( hBench, (char *)name ) == VAR_INVALID )
+    {
+        return luaL_error( L, "%s not found", name );
+    }
+
+    pClient = lua_newuserdata( L, sizeof( BenchClient ) );
+    memset( pClient, 0, sizeof( BenchClient ) );
+    luaL_setmetatable( L, BENCH_CLIENT_MT );
+
+    if( CLIENT_Start( pClient, op, name, count ) != EOK )
+    {
+        return luaL_error( L, "cannot create client thread" );
+    }
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  bench_client_join                                                         */
+/*!
+    client:join()
+
+    Waits for a client thread to complete.  The throughput and latency
+    percentiles are printed, and returned as a table on the Lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int bench_client_join( lua_State *L )
+{
+    BenchClient *pClient;
+    char label[64];
+
+    pClient = luaL_checkudata( L, 1, BENCH_CLIENT_MT );
+    CLIENT_Join( pClient );
+
+    snprintf( label,
+              sizeof( label ),
+              "client %s",
+              CLIENT_OpName( pClient->op ) );
+    push_results( L,
+                  label,
+                  pClient->count,
+                  pClient->errors,
+                  pClient->elapsed,
+                  &pClient->hist );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  bench_client_gc                                                           */
+/*!
+    Client thread garbage collection
+
+    Waits for the client thread if it has not been joined, since the
+    thread writes its results into the userdata.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int bench_client_gc( lua_State *L )
+{
+    BenchClient *pClient;
+
+    pClient = luaL_checkudata( L, 1, BENCH_CLIENT_MT );
+    CLIENT_Join( pClient );
+
+    return 0;
+}
+
+/*============================================================================*/
+/*  push_results                                                              */
+/*!
+    Print benchmark results and push them onto the Lua stack as a table
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        label
+            name of the benchmark
+
+    @param[in]
+        n
+            number of operations
+
+    @param[in]
+        errors
+            number of failed operations
+
+    @param[in]
+        ns
+            elapsed time in nanoseconds
+
+    @param[in]
+        pHist
+            per operation latency histogram, or NULL
+
+==============================================================================*/
+static void push_results( lua_State *L,
+                          const char *label,
+                          uint64_t n,
+                          uint64_t errors,
+                          uint64_t ns,
+                          const LuaVarsHist *pHist )
+{
+    double ops;
+
+    ops = ( ns > 0 ) ? (double)n * 1e9 / (double)ns : 0.0;
+
+    printf( "%-32s %10llu ops %12.0f ops/s",
+            label,
+            (unsigned long long)n,
+            ops );
+
+    if( pHist != NULL )
+    {
+        printf( "  p50 %8llu  p99 %8llu  p999 %8llu  max %8llu ns",
+                (unsigned long long)HIST_Percentile( pHist, 0.5 ),
+                (unsigned long long)HIST_Percentile( pHist, 0.99 ),
+                (unsigned long long)HIST_Percentile( pHist, 0.999 ),
+                (unsigned long long)pHist->max );
+    }
+
+    if( errors != 0 )
+    {
+        printf( "  errors %llu", (unsigned long long)errors );
+    }
+
+    printf( "\n" );
+
+    lua_createtable( L, 0, 8 );
+
+    lua_pushinteger( L, (lua_Integer)n );
+    lua_setfield( L, -2, "count" );
+
+    lua_pushinteger( L, (lua_Integer)errors );
+    lua_setfield( L, -2, "errors" );
+
+    lua_pushinteger( L, (lua_Integer)ns );
+    lua_setfield( L, -2, "elapsed" );
+
+    lua_pushnumber( L, ops );
+    lua_setfield( L, -2, "ops" );
+
+    if( pHist != NULL )
+    {
+        lua_pushinteger( L, (lua_Integer)HIST_Percentile( pHist, 0.5 ) );
+        lua_setfield( L, -2, "p50" );
+
+        lua_pushinteger( L, (lua_Integer)HIST_Percentile( pHist, 0.99 ) );
+        lua_setfield( L, -2, "p99" );
+
+        lua_pushinteger( L, (lua_Integer)HIST_Percentile( pHist, 0.999 ) );
+        lua_setfield( L, -2, "p999" );
+
+        lua_pushinteger( L, (lua_Integer)pHist->max );
+        lua_setfield( L, -2, "max" );
+    }
+}
+
+/*! @}
+ * end of luavars_bench group */
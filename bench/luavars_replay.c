@@ -0,0 +1,787 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup luavars_bench
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file luavars_replay.c
+
+    libluavars event log replay
+
+    The luavars_replay program feeds an event log recorded with
+    LUAVARS_EVENTLOG or vars.eventlog_start() back into a handler script
+    running against the in-memory variable store, to reproduce
+    production event traffic.
+
+    The variables named in the log are created, the handler script is
+    started in its own thread, and each recorded notification is
+    regenerated by a client:
+
+    modified - the variable is set to its current value
+    calc - the variable is read
+    validate - the recorded value is written to the variable
+    print - the variable is printed
+
+    Events are replayed at the recorded rate, scaled by the -s option,
+    or as fast as the handler accepts them with -s 0.  The handler
+    throughput and per notification round trip latency are reported.
+
+    Usage:
+
+    luavars_replay [-s speed] [-w ms] [-v] eventlog handler.lua
+    luavars_replay -d eventlog
+
+    -s replay speed multiplier, 0 for maximum speed (default 1)
+    -w time to wait for the handler to register in ms (default 500)
+    -v print the library statistics after the replay
+    -d print the event log as text
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <varserver/varserver.h>
+#include "stats.h"
+#include "eventlog.h"
+#include "memvars.h"
+#include "client.h"
+#include "script.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! default time to wait for the handler to start in milliseconds */
+#define REPLAY_DEFAULT_WAIT_MS  ( 500 )
+
+/*! time to wait for the handler to drain the replayed events in ms */
+#define REPLAY_DRAIN_MS         ( 5000 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! recorded variable */
+typedef struct _ReplayVar
+{
+    /*! handle of the variable in the replay */
+    VAR_HANDLE hVar;
+
+    /*! type of the variable */
+    VarType type;
+} ReplayVar;
+
+/*! replay state */
+typedef struct _ReplayState
+{
+    /*! replay speed multiplier, or 0 for maximum speed */
+    double speed;
+
+    /*! time to wait for the handler to start in milliseconds */
+    int waitms;
+
+    /*! client connection used to regenerate the events */
+    VARSERVER_HANDLE hVarServer;
+
+    /*! variables indexed by their handle in the recording */
+    ReplayVar *vars;
+
+    /*! number of entries in the vars array */
+    size_t numVars;
+
+    /*! number of events replayed */
+    uint64_t events;
+
+    /*! number of events which could not be replayed */
+    uint64_t skipped;
+
+    /*! number of variable sets recorded from the script */
+    uint64_t sets;
+
+    /*! number of failed client operations */
+    uint64_t errors;
+
+    /*! client round trip latency per notification type */
+    LuaVarsHist hist[STATS_NUM_SIGNALS];
+} ReplayState;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static int dump_log( FILE *fp );
+static int create_vars( ReplayState *pState, FILE *fp );
+static int add_var( ReplayState *pState,
+                    uint32_t hLog,
+                    VarType type,
+                    const char *name );
+static int replay_log( ReplayState *pState, FILE *fp );
+static int replay_event( ReplayState *pState,
+                         const EventLogRecord *pRecord,
+                         const void *payload );
+static void wait_until( uint64_t ns );
+static void drain( uint64_t events );
+static void report( ReplayState *pState, uint64_t elapsed );
+static void usage( const char *name );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! names of the event log record kinds */
+static const char *kindNames[] = {
+    "?",
+    "name",
+    "event",
+    "set"
+};
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  main                                                                      */
+/*!
+    Main entry point for the luavars_replay program
+
+    @param[in]
+        argc
+            number of arguments on the command line
+
+    @param[in]
+        argv
+            array of null terminated command line arguments
+
+    @return 0 if the log was replayed without errors, 1 otherwise
+
+==============================================================================*/
+int main( int argc, char **argv )
+{
+    ReplayState state;
+    BenchScript handler;
+    EventLogHeader header;
+    struct timespec ts;
+    bool dump = false;
+    bool verbose = false;
+    FILE *fp = NULL;
+    int result = 0;
+    int c;
+
+    memset( &state, 0, sizeof( ReplayState ) );
+    state.speed = 1.0;
+    state.waitms = REPLAY_DEFAULT_WAIT_MS;
+
+    while( ( c = getopt( argc, argv, "s:w:vdh" ) ) != -1 )
+    {
+        switch( c )
+        {
+            case 's':
+                state.speed = strtod( optarg, NULL );
+                break;
+
+            case 'w':
+                state.waitms = atoi( optarg );
+                break;
+
+            case 'v':
+                verbose = true;
+                break;
+
+            case 'd':
+                dump = true;
+                break;
+
+            default:
+                result = 1;
+                break;
+        }
+    }
+
+    if( ( result != 0 ) ||
+        ( optind + ( ( dump == true ) ? 1 : 2 ) > argc ) ||
+        ( state.speed < 0.0 ) )
+    {
+        usage( argv[0] );
+        return 1;
+    }
+
+    fp = fopen( argv[optind], "rb" );
+    if( fp == NULL )
+    {
+        fprintf( stderr, "%s: %s: %s\n",
+                 argv[0],
+                 argv[optind],
+                 strerror( errno ) );
+        return 1;
+    }
+
+    if( EVENTLOG_ReadHeader( fp, &header ) != EOK )
+    {
+        fprintf( stderr, "%s: %s: not an event log\n", argv[0], argv[optind] );
+        fclose( fp );
+        return 1;
+    }
+
+    if( dump == true )
+    {
+        result = ( dump_log( fp ) == EOK ) ? 0 : 1;
+        fclose( fp );
+        return result;
+    }
+
+    /* notifications must only be received by the handler's vars.wait() */
+    CLIENT_BlockSignals();
+
+    state.hVarServer = VARSERVER_Open();
+    if( ( state.hVarServer == NULL ) ||
+        ( create_vars( &state, fp ) != EOK ) )
+    {
+        fprintf( stderr, "%s: cannot create the recorded variables\n",
+                 argv[0] );
+        result = 1;
+    }
+    else if( SCRIPT_Start( &handler, argv[optind+1] ) != EOK )
+    {
+        fprintf( stderr, "%s: cannot start %s\n", argv[0], argv[optind+1] );
+        result = 1;
+    }
+    else
+    {
+        /* give the handler time to find its variables and register */
+        ts.tv_sec = state.waitms / 1000;
+        ts.tv_nsec = ( state.waitms % 1000 ) * 1000000L;
+        nanosleep( &ts, NULL );
+
+        if( ( handler.done == true ) ||
+            ( fseek( fp, sizeof( EventLogHeader ), SEEK_SET ) != 0 ) ||
+            ( replay_log( &state, fp ) != EOK ) ||
+            ( state.errors != 0 ) )
+        {
+            result = 1;
+        }
+
+        if( verbose == true )
+        {
+            STATS_Print( stdout );
+        }
+    }
+
+    fclose( fp );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  usage                                                                     */
+/*!
+    Display the program usage
+
+    @param[in]
+        name
+            name of the program
+
+==============================================================================*/
+static void usage( const char *name )
+{
+    fprintf( stderr,
+             "usage: %s [-s speed] [-w ms] [-v] eventlog handler.lua\n"
+             "       %s -d eventlog\n"
+             "  -s replay speed multiplier, 0 for maximum speed\n",
+             name,
+             name );
+}
+
+/*============================================================================*/
+/*  dump_log                                                                  */
+/*!
+    Print the records of an event log as text
+
+    @param[in]
+        fp
+            event log positioned after the header
+
+    @retval EOK the whole log was printed
+    @retval other error from EVENTLOG_Read()
+
+==============================================================================*/
+static int dump_log( FILE *fp )
+{
+    EventLogRecord record;
+    char payload[EVENTLOG_MAX_PAYLOAD + 1];
+    int result;
+
+    while( ( result = EVENTLOG_Read( fp, &record, payload ) ) == EOK )
+    {
+        printf( "%12llu %-5s %6u ",
+                (unsigned long long)record.ts,
+                kindNames[ ( record.kind <= EVENTLOG_SET ) ? record.kind
+                                                           : 0 ],
+                (unsigned int)record.hVar );
+
+        switch( record.kind )
+        {
+            case EVENTLOG_NAME:
+                printf( "type=%d %s\n", record.arg, payload );
+                break;
+
+            case EVENTLOG_EVENT:
+                printf( "%s len=%u\n",
+                        STATS_SignalName( record.arg ),
+                        (unsigned int)record.len );
+                break;
+
+            case EVENTLOG_SET:
+                printf( "%s\n", payload );
+                break;
+
+            default:
+                printf( "\n" );
+                break;
+        }
+    }
+
+    return ( result == ENOENT ) ? EOK : result;
+}
+
+/*============================================================================*/
+/*  create_vars                                                               */
+/*!
+    Create the variables named in an event log
+
+    @param[in]
+        pState
+            pointer to the replay state
+
+    @param[in]
+        fp
+            event log positioned after the header
+
+    @retval EOK the variables were created
+    @retval other error reading the log or creating a variable
+
+==============================================================================*/
+static int create_vars( ReplayState *pState, FILE *fp )
+{
+    EventLogRecord record;
+    char payload[EVENTLOG_MAX_PAYLOAD + 1];
+    int result;
+
+    while( ( result = EVENTLOG_Read( fp, &record, payload ) ) == EOK )
+    {
+        if( record.kind == EVENTLOG_NAME )
+        {
+            result = add_var( pState, record.hVar, record.arg, payload );
+            if( result != EOK )
+            {
+                break;
+            }
+        }
+    }
+
+    return ( result == ENOENT ) ? EOK : result;
+}
+
+/*============================================================================*/
+/*  add_var                                                                   */
+/*!
+    Create a recorded variable and map its recorded handle
+
+    @param[in]
+        pState
+            pointer to the replay state
+
+    @param[in]
+        hLog
+            handle of the variable in the recording
+
+    @param[in]
+        type
+            type of the variable
+
+    @param[in]
+        name
+            name of the variable
+
+    @retval EOK the variable was created
+    @retval ENOMEM out of memory
+    @retval other error from MEMVARS_Create()
+
+==============================================================================*/
+static int add_var( ReplayState *pState,
+                    uint32_t hLog,
+                    VarType type,
+                    const char *name )
+{
+    int result = ENOMEM;
+    ReplayVar *p;
+    size_t n;
+
+    if( hLog >= pState->numVars )
+    {
+        n = ( pState->numVars == 0 ) ? 64 : pState->numVars;
+        while( n <= hLog )
+        {
+            n *= 2;
+        }
+
+        p = realloc( pState->vars, n * sizeof( ReplayVar ) );
+        if( p != NULL )
+        {
+            memset( &p[pState->numVars],
+                    0,
+                    ( n - pState->numVars ) * sizeof( ReplayVar ) );
+            pState->vars = p;
+            pState->numVars = n;
+        }
+    }
+
+    if( hLog < pState->numVars )
+    {
+        /* the variable may be named in the log more than once */
+        result = MEMVARS_Create( pState->hVarServer, name, type, NULL );
+        if( ( result == EOK ) || ( result == EEXIST ) )
+        {
+            pState->vars[hLog].hVar = MEMVARS_FindByName( pState->hVarServer,
+                                                          (char *)name );
+            pState->vars[hLog].type = type;
+            result = ( pState->vars[hLog].hVar != VAR_INVALID ) ? EOK
+                                                                : ENOENT;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  replay_log                                                                */
+/*!
+    Replay the events of an event log
+
+    @param[in]
+        pState
+            pointer to the replay state
+
+    @param[in]
+        fp
+            event log positioned after the header
+
+    @retval EOK the log was replayed
+    @retval other error from EVENTLOG_Read()
+
+==============================================================================*/
+static int replay_log( ReplayState *pState, FILE *fp )
+{
+    EventLogRecord record;
+    char payload[EVENTLOG_MAX_PAYLOAD + 1];
+    uint64_t first = 0;
+    uint64_t start;
+    int result;
+
+    start = STATS_Now();
+
+    while( ( result = EVENTLOG_Read( fp, &record, payload ) ) == EOK )
+    {
+        if( record.kind == EVENTLOG_SET )
+        {
+            pState->sets++;
+        }
+        else if( record.kind == EVENTLOG_EVENT )
+        {
+            if( pState->events + pState->skipped == 0 )
+            {
+                first = record.ts;
+            }
+
+            if( pState->speed > 0.0 )
+            {
+                wait_until( start +
+                            (uint64_t)( (double)( record.ts - first ) /
+                                        pState->speed ) );
+            }
+
+            if( replay_event( pState, &record, payload ) == EOK )
+            {
+                pState->events++;
+            }
+            else
+            {
+                pState->skipped++;
+            }
+        }
+    }
+
+    drain( pState->events );
+    report( pState, STATS_Now() - start );
+
+    return ( result == ENOENT ) ? EOK : result;
+}
+
+/*============================================================================*/
+/*  replay_event                                                              */
+/*!
+    Regenerate one recorded notification
+
+    @param[in]
+        pState
+            pointer to the replay state
+
+    @param[in]
+        pRecord
+            pointer to the EVENT record
+
+    @param[in]
+        payload
+            record payload
+
+    @retval EOK the notification was generated
+    @retval ENOENT the variable is not named in the log
+
+==============================================================================*/
+static int replay_event( ReplayState *pState,
+                         const EventLogRecord *pRecord,
+                         const void *payload )
+{
+    int result = ENOENT;
+    ReplayVar *pVar = NULL;
+    VarObject obj;
+    char buf[BUFSIZ];
+    uint64_t t0;
+    int fds[2];
+    int rc = EINVAL;
+
+    if( ( pRecord->hVar < pState->numVars ) &&
+        ( pState->vars[pRecord->hVar].hVar != VAR_INVALID ) &&
+        ( pRecord->arg < STATS_NUM_SIGNALS ) )
+    {
+        pVar = &pState->vars[pRecord->hVar];
+        result = EOK;
+    }
+
+    if( pVar != NULL )
+    {
+        memset( &obj, 0, sizeof( VarObject ) );
+        obj.val.str = buf;
+        obj.len = sizeof( buf );
+
+        t0 = STATS_Now();
+
+        switch( pRecord->arg )
+        {
+            case 0:
+                /* modified: write back the current value */
+                rc = MEMVARS_Get( pState->hVarServer, pVar->hVar, &obj );
+                if( rc == EOK )
+                {
+                    rc = MEMVARS_Set( pState->hVarServer, pVar->hVar, &obj );
+                }
+                break;
+
+            case 1:
+                /* calc: the read completes when the handler sets it */
+                rc = MEMVARS_Get( pState->hVarServer, pVar->hVar, &obj );
+                break;
+
+            case 2:
+                /* validate: write the recorded value */
+                obj.type = pVar->type;
+                if( pVar->type == VARTYPE_STR )
+                {
+                    strncpy( buf, payload, sizeof( buf ) - 1 );
+                    obj.len = strlen( buf ) + 1;
+                }
+                else if( pRecord->len == sizeof( obj.val ) )
+                {
+                    memcpy( &obj.val, payload, sizeof( obj.val ) );
+                }
+
+                rc = MEMVARS_Set( pState->hVarServer, pVar->hVar, &obj );
+                break;
+
+            case 3:
+                /* print: drain the output until the handler closes it */
+                if( pipe( fds ) == 0 )
+                {
+                    rc = MEMVARS_Print( pState->hVarServer,
+                                        pVar->hVar,
+                                        fds[1] );
+                    close( fds[1] );
+                    while( read( fds[0], buf, sizeof( buf ) ) > 0 )
+                    {
+                    }
+
+                    close( fds[0] );
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        HIST_Record( &pState->hist[pRecord->arg], STATS_Now() - t0 );
+
+        /* a rejected validation is a valid outcome */
+        if( ( rc != EOK ) && ( pRecord->arg != 2 ) )
+        {
+            pState->errors++;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  wait_until                                                                */
+/*!
+    Sleep until a monotonic time
+
+    @param[in]
+        ns
+            monotonic time to sleep until, as returned by STATS_Now()
+
+==============================================================================*/
+static void wait_until( uint64_t ns )
+{
+    struct timespec ts;
+
+    if( ns > STATS_Now() )
+    {
+        ts.tv_sec = ns / 1000000000ULL;
+        ts.tv_nsec = ns % 1000000000ULL;
+        while( clock_nanosleep( CLOCK_MONOTONIC,
+                                TIMER_ABSTIME,
+                                &ts,
+                                NULL ) == EINTR )
+        {
+        }
+    }
+}
+
+/*============================================================================*/
+/*  drain                                                                     */
+/*!
+    Wait for the handler to finish the replayed events
+
+    The handler has finished when it has received every event and
+    called vars.wait() again.  Modified notifications do not block
+    the client, so they may still be queued when the replay ends.
+
+    @param[in]
+        events
+            number of events replayed
+
+==============================================================================*/
+static void drain( uint64_t events )
+{
+    uint64_t deadline = STATS_Now() + REPLAY_DRAIN_MS * 1000000ULL;
+    struct timespec ts = { 0, 100000 };
+
+    while( ( ( STATS_Events() < events ) ||
+             ( STATS_Calls( LUAVARS_CALL_WAIT ) <= STATS_Events() ) ) &&
+           ( STATS_Now() < deadline ) )
+    {
+        nanosleep( &ts, NULL );
+    }
+}
+
+/*============================================================================*/
+/*  report                                                                    */
+/*!
+    Print the replay results
+
+    @param[in]
+        pState
+            pointer to the replay state
+
+    @param[in]
+        elapsed
+            time from the first replayed event until the handler
+            finished, in nanoseconds
+
+==============================================================================*/
+static void report( ReplayState *pState, uint64_t elapsed )
+{
+    LuaVarsHist *pHist;
+    int i;
+
+    printf( "replayed %llu events in %.3f s: %.0f events/s",
+            (unsigned long long)pState->events,
+            (double)elapsed / 1e9,
+            ( elapsed > 0 ) ? (double)pState->events * 1e9 / (double)elapsed
+                            : 0.0 );
+
+    if( pState->skipped != 0 )
+    {
+        printf( ", %llu skipped", (unsigned long long)pState->skipped );
+    }
+
+    if( pState->errors != 0 )
+    {
+        printf( ", %llu errors", (unsigned long long)pState->errors );
+    }
+
+    printf( "\nrecorded sets %llu, handled events %llu\n",
+            (unsigned long long)pState->sets,
+            (unsigned long long)STATS_Events() );
+
+    printf( "%-10s %10s %8s %8s %8s %8s\n",
+            "event",
+            "count",
+            "p50",
+            "p99",
+            "p999",
+            "max(ns)" );
+
+    for( i = 0; i < STATS_NUM_SIGNALS; i++ )
+    {
+        pHist = &pState->hist[i];
+        if( pHist->count != 0 )
+        {
+            printf( "%-10s %10llu %8llu %8llu %8llu %8llu\n",
+                    STATS_SignalName( i ),
+                    (unsigned long long)pHist->count,
+                    (unsigned long long)HIST_Percentile( pHist, 0.5 ),
+                    (unsigned long long)HIST_Percentile( pHist, 0.99 ),
+                    (unsigned long long)HIST_Percentile( pHist, 0.999 ),
+                    (unsigned long long)pHist->max );
+        }
+    }
+}
+
+/*! @}
+ * end of luavars_bench group */
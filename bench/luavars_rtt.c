@@ -0,0 +1,574 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup luavars_bench
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file luavars_rtt.c
+
+    libluavars end-to-end round trip latency harness
+
+    The luavars_rtt program launches a Lua notification handler script
+    and drives it with a number of concurrent client threads which
+    get, set or print variables handled by the script.  Each operation
+    is a full round trip through the variable server and the handler,
+    so the results show the latency seen by other varserver clients
+    for calc (get), validate (set) and print notifications.
+
+    When built with the in-process varserver stub (LUAVARS_RTT_STUB),
+    the handler script runs in its own thread and lua_State, and the
+    variables can be created with the -m option.  Otherwise the handler
+    script is run by a Lua interpreter in a child process against the
+    varserver daemon, and the variables must already exist.
+
+    Usage:
+
+    luavars_rtt [-c clients] [-n count] [-w ms] [-x lua]
+                [-m name:type[:value]] handler.lua op:name [op:name ...]
+
+    -c number of concurrent client threads per operation (default 4)
+    -n number of operations per client thread (default 10000)
+    -w time to wait for the handler to register in ms (default 500)
+    -x Lua interpreter used to run the handler (default lua)
+    -m create a variable in the stub before starting the handler
+
+    Each op:name argument is run in turn, where op is "get", "set"
+    or "print", and reports the aggregate throughput and the
+    p50/p99/p999/max round trip latency across all clients.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <varserver/varserver.h>
+#include "stats.h"
+#include "client.h"
+#ifdef LUAVARS_RTT_STUB
+#include "memvars.h"
+#include "script.h"
+#endif
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! default number of client threads per operation */
+#define RTT_DEFAULT_CLIENTS     ( 4 )
+
+/*! maximum number of client threads per operation */
+#define RTT_MAX_CLIENTS         ( 256 )
+
+/*! default number of operations per client thread */
+#define RTT_DEFAULT_COUNT       ( 10000 )
+
+/*! default time to wait for the handler to start in milliseconds */
+#define RTT_DEFAULT_WAIT_MS     ( 500 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! round trip harness state */
+typedef struct _RttState
+{
+    /*! number of client threads per operation */
+    int clients;
+
+    /*! number of operations per client thread */
+    uint64_t count;
+
+    /*! time to wait for the handler to start in milliseconds */
+    int waitms;
+
+    /*! Lua interpreter used to run an out of process handler */
+    const char *interpreter;
+
+    /*! handler script */
+    const char *script;
+
+#ifdef LUAVARS_RTT_STUB
+    /*! in-process handler */
+    BenchScript handler;
+#endif
+
+    /*! handler process for an out of process handler */
+    pid_t pid;
+} RttState;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static int start_handler( RttState *pState );
+static void stop_handler( RttState *pState );
+static int run_phase( RttState *pState, const char *spec );
+static void usage( const char *name );
+static bool handler_done( RttState *pState );
+#ifdef LUAVARS_RTT_STUB
+static int make_var( VARSERVER_HANDLE hVarServer, char *spec );
+#endif
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! client threads for the current operation */
+static BenchClient clients[RTT_MAX_CLIENTS];
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  main                                                                      */
+/*!
+    Main entry point for the luavars_rtt program
+
+    @param[in]
+        argc
+            number of arguments on the command line
+
+    @param[in]
+        argv
+            array of null terminated command line arguments
+
+    @return 0 if all operations completed without errors, 1 otherwise
+
+==============================================================================*/
+int main( int argc, char **argv )
+{
+    RttState state;
+    VARSERVER_HANDLE hVarServer;
+    struct timespec ts;
+    int result = 0;
+    int c;
+    int i;
+
+    memset( &state, 0, sizeof( RttState ) );
+    state.clients = RTT_DEFAULT_CLIENTS;
+    state.count = RTT_DEFAULT_COUNT;
+    state.waitms = RTT_DEFAULT_WAIT_MS;
+    state.interpreter = "lua";
+
+    /* notifications must only be received by the handler's vars.wait() */
+    CLIENT_BlockSignals();
+
+    hVarServer = VARSERVER_Open();
+    if( hVarServer == NULL )
+    {
+        fprintf( stderr, "%s: cannot open varserver\n", argv[0] );
+        return 1;
+    }
+
+    while( ( c = getopt( argc, argv, "c:n:w:x:m:h" ) ) != -1 )
+    {
+        switch( c )
+        {
+            case 'c':
+                state.clients = atoi( optarg );
+                break;
+
+            case 'n':
+                state.count = strtoull( optarg, NULL, 0 );
+                break;
+
+            case 'w':
+                state.waitms = atoi( optarg );
+                break;
+
+            case 'x':
+                state.interpreter = optarg;
+                break;
+
+            case 'm':
+#ifdef LUAVARS_RTT_STUB
+                if( make_var( hVarServer, optarg ) != EOK )
+                {
+                    fprintf( stderr, "%s: cannot create %s\n",
+                             argv[0],
+                             optarg );
+                    result = 1;
+                }
+#else
+                fprintf( stderr, "%s: -m requires the varserver stub\n",
+                         argv[0] );
+                result = 1;
+#endif
+                break;
+
+            default:
+                usage( argv[0] );
+                result = 1;
+                break;
+        }
+    }
+
+    if( ( state.clients < 1 ) || ( state.clients > RTT_MAX_CLIENTS ) )
+    {
+        fprintf( stderr, "%s: clients must be 1-%d\n",
+                 argv[0],
+                 RTT_MAX_CLIENTS );
+        result = 1;
+    }
+
+    if( ( result == 0 ) && ( optind + 2 > argc ) )
+    {
+        usage( argv[0] );
+        result = 1;
+    }
+
+    if( result == 0 )
+    {
+        state.script = argv[optind];
+        if( start_handler( &state ) != EOK )
+        {
+            fprintf( stderr, "%s: cannot start %s\n", argv[0], state.script );
+            result = 1;
+        }
+    }
+
+    if( result == 0 )
+    {
+        /* give the handler time to find its variables and register */
+        ts.tv_sec = state.waitms / 1000;
+        ts.tv_nsec = ( state.waitms % 1000 ) * 1000000L;
+        nanosleep( &ts, NULL );
+
+        printf( "%-32s %7s %10s %12s %8s %8s %8s %8s\n",
+                "operation",
+                "clients",
+                "ops",
+                "ops/s",
+                "p50",
+                "p99",
+                "p999",
+                "max(ns)" );
+
+        for( i = optind + 1; ( i < argc ) && !handler_done( &state ); i++ )
+        {
+            if( run_phase( &state, argv[i] ) != EOK )
+            {
+                result = 1;
+            }
+        }
+
+        if( handler_done( &state ) == true )
+        {
+            result = 1;
+        }
+
+        stop_handler( &state );
+    }
+
+    (void)VARSERVER_Close( hVarServer );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  usage                                                                     */
+/*!
+    Display the program usage
+
+    @param[in]
+        name
+            name of the program
+
+==============================================================================*/
+static void usage( const char *name )
+{
+    fprintf( stderr,
+             "usage: %s [-c clients] [-n count] [-w ms] [-x lua]\n"
+             "       [-m name:type[:value]] handler.lua op:name "
+             "[op:name ...]\n"
+             "  op is one of get, set or print\n",
+             name );
+}
+
+/*============================================================================*/
+/*  run_phase                                                                 */
+/*!
+    Run one operation against the handler
+
+    Starts the configured number of client threads performing the
+    operation, waits for them to complete, and prints the aggregate
+    throughput and round trip latency percentiles.
+
+    @param[in]
+        pState
+            pointer to the harness state
+
+    @param[in]
+        spec
+            operation specification in the form op:name
+
+    @retval EOK the operation completed without errors
+    @retval EINVAL invalid operation specification
+    @retval EIO one or more operations failed
+
+==============================================================================*/
+static int run_phase( RttState *pState, const char *spec )
+{
+    int result = EINVAL;
+    LuaVarsHist all;
+    char op[16];
+    const char *name;
+    BenchOp benchOp = BENCH_OP_MAX;
+    uint64_t elapsed = 0;
+    uint64_t errors = 0;
+    uint64_t ops;
+    double rate;
+    size_t len;
+    int n = 0;
+    int i;
+
+    name = strchr( spec, ':' );
+    if( name != NULL )
+    {
+        len = (size_t)( name - spec );
+        if( len < sizeof( op ) )
+        {
+            memcpy( op, spec, len );
+            op[len] = '\0';
+            benchOp = CLIENT_OpFromName( op );
+        }
+
+        name++;
+    }
+
+    if( benchOp == BENCH_OP_MAX )
+    {
+        fprintf( stderr, "invalid operation: %s\n", spec );
+        return EINVAL;
+    }
+
+    HIST_Reset( &all );
+
+    for( i = 0; i < pState->clients; i++ )
+    {
+        if( CLIENT_Start( &clients[i], benchOp, name, pState->count ) == EOK )
+        {
+            n++;
+        }
+    }
+
+    for( i = 0; i < n; i++ )
+    {
+        CLIENT_Join( &clients[i] );
+
+        HIST_Merge( &all, &clients[i].hist );
+        errors += clients[i].errors;
+        if( clients[i].elapsed > elapsed )
+        {
+            elapsed = clients[i].elapsed;
+        }
+    }
+
+    ops = (uint64_t)n * pState->count;
+    rate = ( elapsed > 0 ) ? (double)ops * 1e9 / (double)elapsed : 0.0;
+
+    printf( "%-32s %7d %10llu %12.0f %8llu %8llu %8llu %8llu",
+            spec,
+            n,
+            (unsigned long long)ops,
+            rate,
+            (unsigned long long)HIST_Percentile( &all, 0.5 ),
+            (unsigned long long)HIST_Percentile( &all, 0.99 ),
+            (unsigned long long)HIST_Percentile( &all, 0.999 ),
+            (unsigned long long)all.max );
+
+    if( errors != 0 )
+    {
+        printf( "  errors %llu", (unsigned long long)errors );
+    }
+
+    printf( "\n" );
+    fflush( stdout );
+
+    result = ( ( errors == 0 ) && ( n == pState->clients ) ) ? EOK : EIO;
+
+    return result;
+}
+
+/*============================================================================*/
+/*  start_handler                                                             */
+/*!
+    Start the notification handler script
+
+    With the varserver stub the script is run in a thread of this
+    process, since the stub variables only exist here.  Otherwise it
+    is run by a Lua interpreter in a child process.
+
+    @param[in]
+        pState
+            pointer to the harness state
+
+    @retval EOK the handler was started
+    @retval other error from pthread_create() or fork()
+
+==============================================================================*/
+static int start_handler( RttState *pState )
+{
+    int result;
+
+#ifdef LUAVARS_RTT_STUB
+    result = SCRIPT_Start( &pState->handler, pState->script );
+#else
+    pState->pid = fork();
+    if( pState->pid == 0 )
+    {
+        execlp( pState->interpreter,
+                pState->interpreter,
+                pState->script,
+                (char *)NULL );
+        fprintf( stderr, "cannot run %s: %s\n",
+                 pState->interpreter,
+                 strerror( errno ) );
+        _exit( 1 );
+    }
+
+    result = ( pState->pid > 0 ) ? EOK : errno;
+#endif
+
+    return result;
+}
+
+/*============================================================================*/
+/*  stop_handler                                                              */
+/*!
+    Stop the notification handler script
+
+    A handler thread is left blocked in vars.wait() and ends with the
+    process.  A handler process is terminated.
+
+    @param[in]
+        pState
+            pointer to the harness state
+
+==============================================================================*/
+static void stop_handler( RttState *pState )
+{
+    if( pState->pid > 0 )
+    {
+        kill( pState->pid, SIGTERM );
+        waitpid( pState->pid, NULL, 0 );
+        pState->pid = 0;
+    }
+}
+
+/*============================================================================*/
+/*  handler_done                                                              */
+/*!
+    Check if the handler has stopped
+
+    @param[in]
+        pState
+            pointer to the harness state
+
+    @retval true the handler script failed or returned
+    @retval false the handler is still running
+
+==============================================================================*/
+static bool handler_done( RttState *pState )
+{
+    bool done = false;
+
+#ifdef LUAVARS_RTT_STUB
+    done = pState->handler.done;
+#else
+    done = ( waitpid( pState->pid, NULL, WNOHANG ) == pState->pid );
+    if( done == true )
+    {
+        pState->pid = 0;
+    }
+#endif
+
+    return done;
+}
+
+#ifdef LUAVARS_RTT_STUB
+/*============================================================================*/
+/*  make_var                                                                  */
+/*!
+    Create a stub variable from a name:type[:value] specification
+
+    @param[in]
+        hVarServer
+            handle to the stub client
+
+    @param[in]
+        spec
+            variable specification.  This string is modified.
+
+    @retval EOK the variable was created
+    @retval EINVAL invalid specification
+    @retval other error from MEMVARS_Create()
+
+==============================================================================*/
+static int make_var( VARSERVER_HANDLE hVarServer, char *spec )
+{
+    int result = EINVAL;
+    char *type;
+    char *value;
+
+    type = strchr( spec, ':' );
+    if( type != NULL )
+    {
+        *type++ = '\0';
+
+        value = strchr( type, ':' );
+        if( value != NULL )
+        {
+            *value++ = '\0';
+        }
+
+        result = MEMVARS_Create( hVarServer,
+                                 spec,
+                                 MEMVARS_TypeFromName( type ),
+                                 value );
+    }
+
+    return result;
+}
+#endif
+
+/*! @}
+ * end of luavars_bench group */
@@ -0,0 +1,88 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+
+-- libluavars round trip handler
+--
+-- A notification handler used with luavars_rtt.  It computes
+-- /bench/rtt/calc, accepts writes to /bench/rtt/validate, and renders
+-- /bench/rtt/print, so the round trip latency of each notification
+-- type can be measured from the client side.
+--
+-- usage (in-process stub):
+--
+--   luavars_rtt -m /bench/rtt/calc:uint32 -m /bench/rtt/validate:uint32 \
+--       -m /bench/rtt/print:str bench/rtt_handler.lua \
+--       get:/bench/rtt/calc set:/bench/rtt/validate print:/bench/rtt/print
+--
+-- usage (varserver daemon, after creating the variables with mkvar):
+--
+--   luavars_rtt_varserver bench/rtt_handler.lua get:/bench/rtt/calc ...
+--
+-- If /bench/rtt/source exists, the calc handler reads it with a
+-- synchronous var.get() to mix synchronous requests into the event
+-- handling.  Setting RTT_POOL in the environment moves synchronous
+-- requests and replies onto their own connections with
+-- vars.connections() so the two can be compared.
+
+local vars = require("libluavars")
+local EOK = 0
+local count = 0
+
+local hCalc = vars.find( "/bench/rtt/calc" )
+local hValidate = vars.find( "/bench/rtt/validate" )
+local hPrint = vars.find( "/bench/rtt/print" )
+local hSource = vars.find( "/bench/rtt/source" )
+
+if os.getenv( "RTT_POOL" ) ~= nil then
+    vars.connections{ sync = true, reply = true }
+end
+
+if hCalc ~= nil then
+    vars.notify( hCalc, NOTIFY_CALC )
+end
+
+if hValidate ~= nil then
+    vars.notify( hValidate, NOTIFY_VALIDATE )
+end
+
+if hPrint ~= nil then
+    vars.notify( hPrint, NOTIFY_PRINT )
+end
+
+while true do
+    local sig, id = vars.wait()
+    count = count + 1
+    if sig == SIG_VAR_CALC then
+        if hSource ~= nil then
+            vars.get( "/bench/rtt/source" )
+        end
+        vars.set( id, count )
+    elseif sig == SIG_VAR_VALIDATE then
+        vars.validate_start( id )
+        vars.validate_end( id, EOK )
+    elseif sig == SIG_VAR_PRINT then
+        local ps = vars.open_print_session( id )
+        ps:write( string.format( "The counter is %d\n", count ) )
+        vars.close_print_session( ps )
+    end
+end
@@ -0,0 +1,152 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup luavars_bench
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file script.c
+
+    In-process handler scripts
+
+    A handler script runs in its own thread and lua_State with the
+    libluavars library linked into the benchmark program, so that it
+    shares the in-memory variable store with the benchmark's client
+    threads.  The script is expected to loop in vars.wait() until the
+    process exits.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <lua.h>
+#include <lauxlib.h>
+#include <lualib.h>
+#include <varserver/varserver.h>
+#include "script.h"
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+int luaopen_libluavars( lua_State *L );
+
+static void *script_thread( void *arg );
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  SCRIPT_Start                                                              */
+/*!
+    Start a handler script in its own thread
+
+    The varserver notification signals must already be blocked
+    (see CLIENT_BlockSignals()).
+
+    @param[in]
+        pScript
+            pointer to the script state, which must remain valid
+            while the script runs
+
+    @param[in]
+        path
+            path of the handler script
+
+    @retval EOK the handler thread was started
+    @retval EINVAL invalid arguments
+    @retval other error from pthread_create()
+
+==============================================================================*/
+int SCRIPT_Start( BenchScript *pScript, const char *path )
+{
+    int result = EINVAL;
+
+    if( ( pScript != NULL ) && ( path != NULL ) )
+    {
+        pScript->path = path;
+        pScript->done = false;
+
+        result = pthread_create( &pScript->thread,
+                                 NULL,
+                                 script_thread,
+                                 pScript );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  script_thread                                                             */
+/*!
+    Handler script thread
+
+    @param[in]
+        arg
+            pointer to the BenchScript
+
+    @return always returns NULL
+
+==============================================================================*/
+static void *script_thread( void *arg )
+{
+    BenchScript *pScript = (BenchScript *)arg;
+    lua_State *L;
+
+    L = luaL_newstate();
+    if( L != NULL )
+    {
+        luaL_openlibs( L );
+
+        luaL_requiref( L, "libluavars", luaopen_libluavars, 0 );
+        lua_pop( L, 1 );
+
+        if( luaL_dofile( L, pScript->path ) != LUA_OK )
+        {
+            fprintf( stderr, "%s: %s\n",
+                     pScript->path,
+                     lua_tostring( L, -1 ) );
+        }
+
+        lua_close( L );
+    }
+
+    pScript->done = true;
+
+    return NULL;
+}
+
+/*! @}
+ * end of luavars_bench group */
@@ -0,0 +1,347 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup luavars_bench
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file varstub.c
+
+    Variable server stub
+
+    The benchmark programs link the libluavars sources with this stub
+    in place of libvarserver.so, so they can run without a varserver
+    daemon.  Each VARSERVER_* and VAR_* function is implemented by the
+    in-memory store of the "memory" backend (see src/memvars.c), so the
+    default backend, the client threads and the bench library all share
+    one variable store.
+
+    The VARSTUB_GET_US environment variable adds a delay of that many
+    microseconds to each VAR_Get(), outside of the store's lock, to
+    stand in for the round trip to a varserver daemon when measuring
+    how well requests are overlapped.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <varserver/varserver.h>
+#include "memvars.h"
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static void stub_delay( void );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! emulated VAR_Get() round trip time in microseconds, -1 until read */
+static long getDelay = -1;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  VARSERVER_Open                                                            */
+/*!
+    VARSERVER_Open() implemented by MEMVARS_Open()
+
+==============================================================================*/
+VARSERVER_HANDLE VARSERVER_Open( void )
+{
+    return MEMVARS_Open();
+}
+
+/*============================================================================*/
+/*  VARSERVER_Close                                                           */
+/*!
+    VARSERVER_Close() implemented by MEMVARS_Close()
+
+==============================================================================*/
+int VARSERVER_Close( VARSERVER_HANDLE hVarServer )
+{
+    return MEMVARS_Close( hVarServer );
+}
+
+/*============================================================================*/
+/*  VARSERVER_CreateVar                                                       */
+/*!
+    VARSERVER_CreateVar() implemented by MEMVARS_CreateVar()
+
+==============================================================================*/
+int VARSERVER_CreateVar( VARSERVER_HANDLE hVarServer, VarInfo *pVarInfo )
+{
+    return MEMVARS_CreateVar( hVarServer, pVarInfo );
+}
+
+/*============================================================================*/
+/*  VAR_FindByName                                                            */
+/*!
+    VAR_FindByName() implemented by MEMVARS_FindByName()
+
+==============================================================================*/
+VAR_HANDLE VAR_FindByName( VARSERVER_HANDLE hVarServer, char *name )
+{
+    return MEMVARS_FindByName( hVarServer, name );
+}
+
+/*============================================================================*/
+/*  VAR_GetType                                                               */
+/*!
+    VAR_GetType() implemented by MEMVARS_GetType()
+
+==============================================================================*/
+int VAR_GetType( VARSERVER_HANDLE hVarServer,
+                 VAR_HANDLE hVar,
+                 VarType *pVarType )
+{
+    return MEMVARS_GetType( hVarServer, hVar, pVarType );
+}
+
+/*============================================================================*/
+/*  VAR_GetLength                                                             */
+/*!
+    VAR_GetLength() implemented by MEMVARS_GetLength()
+
+==============================================================================*/
+int VAR_GetLength( VARSERVER_HANDLE hVarServer,
+                   VAR_HANDLE hVar,
+                   size_t *len )
+{
+    return MEMVARS_GetLength( hVarServer, hVar, len );
+}
+
+/*============================================================================*/
+/*  VAR_GetName                                                               */
+/*!
+    VAR_GetName() implemented by MEMVARS_GetName()
+
+==============================================================================*/
+int VAR_GetName( VARSERVER_HANDLE hVarServer,
+                 VAR_HANDLE hVar,
+                 char *buf,
+                 size_t len )
+{
+    return MEMVARS_GetName( hVarServer, hVar, buf, len );
+}
+
+/*============================================================================*/
+/*  VAR_Get                                                                   */
+/*!
+    VAR_Get() implemented by MEMVARS_Get()
+
+==============================================================================*/
+int VAR_Get( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar, VarObject *obj )
+{
+    stub_delay();
+
+    return MEMVARS_Get( hVarServer, hVar, obj );
+}
+
+/*============================================================================*/
+/*  VAR_Set                                                                   */
+/*!
+    VAR_Set() implemented by MEMVARS_Set()
+
+==============================================================================*/
+int VAR_Set( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar, VarObject *obj )
+{
+    return MEMVARS_Set( hVarServer, hVar, obj );
+}
+
+/*============================================================================*/
+/*  VAR_SetStr                                                                */
+/*!
+    VAR_SetStr() implemented by MEMVARS_SetStr()
+
+==============================================================================*/
+int VAR_SetStr( VARSERVER_HANDLE hVarServer,
+                VAR_HANDLE hVar,
+                VarType type,
+                char *str )
+{
+    return MEMVARS_SetStr( hVarServer, hVar, type, str );
+}
+
+/*============================================================================*/
+/*  VAR_Notify                                                                */
+/*!
+    VAR_Notify() implemented by MEMVARS_Notify()
+
+==============================================================================*/
+int VAR_Notify( VARSERVER_HANDLE hVarServer,
+                VAR_HANDLE hVar,
+                NotificationType notificationType )
+{
+    return MEMVARS_Notify( hVarServer, hVar, notificationType );
+}
+
+/*============================================================================*/
+/*  VAR_NotifyCancel                                                          */
+/*!
+    VAR_NotifyCancel() implemented by MEMVARS_NotifyCancel()
+
+==============================================================================*/
+int VAR_NotifyCancel( VARSERVER_HANDLE hVarServer,
+                      VAR_HANDLE hVar,
+                      NotificationType notificationType )
+{
+    return MEMVARS_NotifyCancel( hVarServer, hVar, notificationType );
+}
+
+/*============================================================================*/
+/*  VAR_GetValidationRequest                                                  */
+/*!
+    VAR_GetValidationRequest() implemented by MEMVARS_GetValidationRequest()
+
+==============================================================================*/
+int VAR_GetValidationRequest( VARSERVER_HANDLE hVarServer,
+                              uint32_t id,
+                              VAR_HANDLE *hVar,
+                              VarObject *obj )
+{
+    return MEMVARS_GetValidationRequest( hVarServer, id, hVar, obj );
+}
+
+/*============================================================================*/
+/*  VAR_SendValidationResponse                                                */
+/*!
+    VAR_SendValidationResponse() implemented by MEMVARS_SendValidationResponse()
+
+==============================================================================*/
+int VAR_SendValidationResponse( VARSERVER_HANDLE hVarServer,
+                                uint32_t id,
+                                int response )
+{
+    return MEMVARS_SendValidationResponse( hVarServer, id, response );
+}
+
+/*============================================================================*/
+/*  VAR_OpenPrintSession                                                      */
+/*!
+    VAR_OpenPrintSession() implemented by MEMVARS_OpenPrintSession()
+
+==============================================================================*/
+int VAR_OpenPrintSession( VARSERVER_HANDLE hVarServer,
+                          uint32_t id,
+                          VAR_HANDLE *hVar,
+                          int *fd )
+{
+    return MEMVARS_OpenPrintSession( hVarServer, id, hVar, fd );
+}
+
+/*============================================================================*/
+/*  VAR_ClosePrintSession                                                     */
+/*!
+    VAR_ClosePrintSession() implemented by MEMVARS_ClosePrintSession()
+
+==============================================================================*/
+int VAR_ClosePrintSession( VARSERVER_HANDLE hVarServer,
+                           uint32_t id,
+                           int fd )
+{
+    return MEMVARS_ClosePrintSession( hVarServer, id, fd );
+}
+
+/*============================================================================*/
+/*  VAR_GetFirst                                                              */
+/*!
+    VAR_GetFirst() implemented by MEMVARS_GetFirst()
+
+==============================================================================*/
+int VAR_GetFirst( VARSERVER_HANDLE hVarServer,
+                  VarQuery *query,
+                  VarObject *obj )
+{
+    return MEMVARS_GetFirst( hVarServer, query, obj );
+}
+
+/*============================================================================*/
+/*  VAR_GetNext                                                               */
+/*!
+    VAR_GetNext() implemented by MEMVARS_GetNext()
+
+==============================================================================*/
+int VAR_GetNext( VARSERVER_HANDLE hVarServer,
+                 VarQuery *query,
+                 VarObject *obj )
+{
+    return MEMVARS_GetNext( hVarServer, query, obj );
+}
+
+/*============================================================================*/
+/*  VAR_Print                                                                 */
+/*!
+    VAR_Print() implemented by MEMVARS_Print()
+
+==============================================================================*/
+int VAR_Print( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar, int fd )
+{
+    return MEMVARS_Print( hVarServer, hVar, fd );
+}
+
+/*============================================================================*/
+/*  stub_delay                                                                */
+/*!
+    Wait for the emulated round trip time set by VARSTUB_GET_US
+
+==============================================================================*/
+static void stub_delay( void )
+{
+    struct timespec ts;
+    const char *env;
+    long us;
+
+    us = __atomic_load_n( &getDelay, __ATOMIC_RELAXED );
+    if( us < 0 )
+    {
+        env = getenv( "VARSTUB_GET_US" );
+        us = ( env != NULL ) ? strtol( env, NULL, 0 ) : 0;
+        us = ( us > 0 ) ? us : 0;
+        __atomic_store_n( &getDelay, us, __ATOMIC_RELAXED );
+    }
+
+    if( us > 0 )
+    {
+        ts.tv_sec = us / 1000000;
+        ts.tv_nsec = ( us % 1000000 ) * 1000;
+        nanosleep( &ts, NULL );
+    }
+}
+
+/*! @}
+ * end of luavars_bench group */
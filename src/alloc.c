@@ -0,0 +1,801 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file alloc.c
+
+    Lua allocation accounting and pooling
+
+    The alloc module wraps the allocator of the Lua state which loads
+    the library so the number of bytes allocated by Lua code can be
+    attributed to the notification handlers which allocated them.  The
+    allocator is only installed on request, since it stays in the
+    allocation path of the state for as long as the state is open.
+
+    When the state is closed, its remaining blocks are freed after the
+    library has been unloaded.  A finalizer object created when the
+    allocator is installed runs before the library is unloaded and puts
+    the previous allocator back.  Once a pooled block has been handed
+    out that is no longer possible; the library is linked with
+    -z nodelete, so its code stays mapped for the pooled blocks to be
+    freed through it.
+
+    Optionally, blocks of up to ALLOC_MAX_POOLED bytes are served from
+    size-class free lists carved out of ALLOC_SLAB_SIZE slabs, rather
+    than from malloc().  Most of the strings and tables created while
+    handling an event are small and die quickly, so they are recycled
+    by the free lists without a trip through malloc().
+
+    Lua passes the size of a block when it is freed or resized, which
+    gives its size class.  Slabs are aligned to their size so a block
+    can be identified as pooled by looking up its slab base in a hash
+    set.  Pooling can therefore be switched on and off at any time,
+    with blocks freed to wherever they came from.  Slab memory is
+    retained for the life of the process.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+#include <lauxlib.h>
+#include "alloc.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! pooled block size granularity in bytes */
+#define ALLOC_CLASS_SIZE        ( 16 )
+
+/*! number of size classes */
+#define ALLOC_NUM_CLASSES       ( ALLOC_MAX_POOLED / ALLOC_CLASS_SIZE )
+
+/*! initial number of slab hash set slots (must be a power of 2) */
+#define ALLOC_INITIAL_SLOTS     ( 64 )
+
+/*! name of the allocator finalizer metatable */
+#define ALLOC_FINALIZER         "LuaVarsAllocFinalizer"
+
+/*! size class of a block of a given size */
+#define ALLOC_CLASS(size)       ( ( (size) - 1 ) / ALLOC_CLASS_SIZE )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! free block in a size class free list */
+typedef struct _AllocBlock
+{
+    /*! next free block of the same size class */
+    struct _AllocBlock *next;
+} AllocBlock;
+
+/*! allocator state of one Lua state */
+typedef struct _AllocContext
+{
+    /*! allocator which was installed before the library was loaded */
+    lua_Alloc prevAlloc;
+
+    /*! user data of the allocator which was installed before */
+    void *prevUd;
+
+    /*! serve new small blocks from the pools */
+    bool pooling;
+
+    /*! free lists per size class */
+    AllocBlock *freeList[ALLOC_NUM_CLASSES];
+
+    /*! unused part of the current slab */
+    char *bump;
+
+    /*! end of the current slab */
+    char *bumpEnd;
+
+    /*! hash set of slab base addresses */
+    uintptr_t *slabs;
+
+    /*! number of slabs */
+    size_t numSlabs;
+
+    /*! number of slots in the slab hash set */
+    size_t slabSlots;
+} AllocContext;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static void *counting_alloc( void *ud,
+                             void *ptr,
+                             size_t osize,
+                             size_t nsize );
+static void *pool_realloc( AllocContext *pCtx,
+                           void *ptr,
+                           size_t osize,
+                           size_t nsize );
+static void *pool_alloc( AllocContext *pCtx, size_t size );
+static void pool_free( AllocContext *pCtx, void *ptr, size_t size );
+static bool is_pooled( AllocContext *pCtx, void *ptr );
+static int add_slab( AllocContext *pCtx, uintptr_t base );
+static size_t slab_slot( uintptr_t base, size_t slots );
+static int finalizer_gc( lua_State *L );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! total number of bytes allocated */
+static uint64_t allocBytes = 0;
+
+/*! total number of bytes freed */
+static uint64_t freedBytes = 0;
+
+/*! total number of blocks allocated */
+static uint64_t allocCount = 0;
+
+/*! number of blocks allocated from the pools */
+static uint64_t pooledCount = 0;
+
+/*! number of bytes held in slabs */
+static uint64_t slabBytes = 0;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  ALLOC_Install                                                             */
+/*!
+    Install the accounting allocator
+
+    The accounting allocator forwards to the existing allocator, so
+    it can be installed on a Lua state which already holds memory.
+    Pooling is enabled if the LUAVARS_POOL environment variable is set.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @retval EOK the allocator was installed
+    @retval EALREADY the allocator was already installed
+    @retval EINVAL invalid lua state
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+int ALLOC_Install( lua_State *L )
+{
+    int result = EINVAL;
+    AllocContext *pCtx;
+    lua_Alloc f;
+    void *ud;
+
+    if( L != NULL )
+    {
+        f = lua_getallocf( L, &ud );
+        if( f == counting_alloc )
+        {
+            result = EALREADY;
+        }
+        else
+        {
+            /* the context is freed by the finalizer when the state
+               is closed, unless the state still holds pooled blocks */
+            pCtx = calloc( 1, sizeof( AllocContext ) );
+            if( pCtx != NULL )
+            {
+                pCtx->prevAlloc = f;
+                pCtx->prevUd = ud;
+                lua_setallocf( L, counting_alloc, pCtx );
+
+                /* finalized before the library is unloaded by
+                   lua_close(), since it is newer than the loader */
+                if( luaL_newmetatable( L, ALLOC_FINALIZER ) != 0 )
+                {
+                    lua_pushcfunction( L, finalizer_gc );
+                    lua_setfield( L, -2, "__gc" );
+                }
+
+                *(AllocContext **)lua_newuserdatauv( L,
+                                                     sizeof( AllocContext * ),
+                                                     0 ) = pCtx;
+                lua_insert( L, -2 );
+                lua_setmetatable( L, -2 );
+                lua_setfield( L, LUA_REGISTRYINDEX, ALLOC_FINALIZER );
+
+                result = ( getenv( "LUAVARS_POOL" ) != NULL )
+                            ? ALLOC_Pool( L, true )
+                            : EOK;
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ALLOC_Pool                                                                */
+/*!
+    Enable or disable the size-class pools
+
+    The accounting allocator is installed first if it is not installed
+    yet.  Blocks which are already allocated are freed to the pool or
+    to the previous allocator they came from.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        enable
+            true to serve small blocks from the pools
+
+    @retval EOK pooling was changed
+    @retval EINVAL invalid lua state
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+int ALLOC_Pool( lua_State *L, bool enable )
+{
+    int result = EINVAL;
+    void *ud = NULL;
+
+    if( L != NULL )
+    {
+        result = ( lua_getallocf( L, &ud ) == counting_alloc )
+                    ? EOK
+                    : ALLOC_Install( L );
+    }
+
+    if( ( result == EOK ) && ( lua_getallocf( L, &ud ) == counting_alloc ) )
+    {
+        ((AllocContext *)ud)->pooling = enable;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  ALLOC_Bytes                                                               */
+/*!
+    Get the total number of bytes allocated by Lua
+
+    @return the total number of bytes allocated since the allocator
+            was installed
+
+==============================================================================*/
+uint64_t ALLOC_Bytes( void )
+{
+    return allocBytes;
+}
+
+/*============================================================================*/
+/*  ALLOC_Freed                                                               */
+/*!
+    Get the total number of bytes freed by Lua
+
+    Most memory is freed by the garbage collector, so the bytes freed
+    while a handler runs show how much collection work it performed.
+
+    @return the total number of bytes freed since the allocator
+            was installed
+
+==============================================================================*/
+uint64_t ALLOC_Freed( void )
+{
+    return freedBytes;
+}
+
+/*============================================================================*/
+/*  ALLOC_Count                                                               */
+/*!
+    Get the number of blocks allocated by Lua
+
+    @return the total number of new blocks allocated since the
+            allocator was installed
+
+==============================================================================*/
+uint64_t ALLOC_Count( void )
+{
+    return allocCount;
+}
+
+/*============================================================================*/
+/*  ALLOC_PushTable                                                           */
+/*!
+    Push the allocation counters onto the Lua stack as a table
+
+    The table contains the bytes allocated and freed, the number of
+    blocks allocated, the number served from the pools, and the
+    number of bytes held in pool slabs.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+==============================================================================*/
+void ALLOC_PushTable( lua_State *L )
+{
+    lua_newtable( L );
+
+    lua_pushinteger( L, (lua_Integer)allocBytes );
+    lua_setfield( L, -2, "bytes" );
+
+    lua_pushinteger( L, (lua_Integer)freedBytes );
+    lua_setfield( L, -2, "freed" );
+
+    lua_pushinteger( L, (lua_Integer)allocCount );
+    lua_setfield( L, -2, "count" );
+
+    lua_pushinteger( L, (lua_Integer)pooledCount );
+    lua_setfield( L, -2, "pooled" );
+
+    lua_pushinteger( L, (lua_Integer)slabBytes );
+    lua_setfield( L, -2, "pool_bytes" );
+}
+
+/*============================================================================*/
+/*  ALLOC_Print                                                               */
+/*!
+    Render the allocation counters as text
+
+    @param[in]
+        fp
+            output stream
+
+==============================================================================*/
+void ALLOC_Print( FILE *fp )
+{
+    fprintf( fp,
+             "lua alloc: bytes=%llu freed=%llu count=%llu pooled=%llu "
+             "pool_bytes=%llu\n",
+             (unsigned long long)allocBytes,
+             (unsigned long long)freedBytes,
+             (unsigned long long)allocCount,
+             (unsigned long long)pooledCount,
+             (unsigned long long)slabBytes );
+}
+
+/*============================================================================*/
+/*  counting_alloc                                                            */
+/*!
+    Accounting lua_Alloc function
+
+    Counts new allocations and growth of existing blocks, and frees
+    and shrinking of existing blocks, then forwards the request to the
+    pools or to the previous allocator.
+
+    @param[in]
+        ud
+            allocator context of the Lua state
+
+    @param[in]
+        ptr
+            block to reallocate or free, or NULL for a new block
+
+    @param[in]
+        osize
+            original size of the block, or the object type if ptr is NULL
+
+    @param[in]
+        nsize
+            new size of the block, or 0 to free it
+
+    @return pointer to the allocated block, or NULL
+
+==============================================================================*/
+static void *counting_alloc( void *ud,
+                             void *ptr,
+                             size_t osize,
+                             size_t nsize )
+{
+    AllocContext *pCtx = (AllocContext *)ud;
+    size_t old = ( ptr != NULL ) ? osize : 0;
+
+    if( nsize > old )
+    {
+        allocBytes += nsize - old;
+        if( ptr == NULL )
+        {
+            allocCount++;
+        }
+    }
+    else
+    {
+        freedBytes += old - nsize;
+    }
+
+    if( ( pCtx->pooling == false ) && ( pCtx->numSlabs == 0 ) )
+    {
+        return pCtx->prevAlloc( pCtx->prevUd, ptr, osize, nsize );
+    }
+
+    return pool_realloc( pCtx, ptr, old, nsize );
+}
+
+/*============================================================================*/
+/*  pool_realloc                                                              */
+/*!
+    Allocate, resize or free a block using the pools
+
+    @param[in]
+        pCtx
+            allocator context
+
+    @param[in]
+        ptr
+            block to reallocate or free, or NULL for a new block
+
+    @param[in]
+        osize
+            original size of the block, or 0 if ptr is NULL
+
+    @param[in]
+        nsize
+            new size of the block, or 0 to free it
+
+    @return pointer to the allocated block, or NULL
+
+==============================================================================*/
+static void *pool_realloc( AllocContext *pCtx,
+                           void *ptr,
+                           size_t osize,
+                           size_t nsize )
+{
+    bool pooled = ( ptr != NULL ) && ( is_pooled( pCtx, ptr ) == true );
+    void *p = NULL;
+
+    if( nsize == 0 )
+    {
+        if( pooled == true )
+        {
+            pool_free( pCtx, ptr, osize );
+        }
+        else if( ptr != NULL )
+        {
+            (void)pCtx->prevAlloc( pCtx->prevUd, ptr, osize, 0 );
+        }
+    }
+    else if( ( pooled == true ) &&
+             ( nsize <= ALLOC_MAX_POOLED ) &&
+             ( ALLOC_CLASS( nsize ) == ALLOC_CLASS( osize ) ) )
+    {
+        /* the block already fits */
+        p = ptr;
+    }
+    else
+    {
+        if( ( pCtx->pooling == true ) && ( nsize <= ALLOC_MAX_POOLED ) )
+        {
+            p = pool_alloc( pCtx, nsize );
+        }
+
+        if( ( p == NULL ) && ( pooled == false ) )
+        {
+            /* a new or resized block from the previous allocator */
+            return pCtx->prevAlloc( pCtx->prevUd, ptr, osize, nsize );
+        }
+
+        if( p == NULL )
+        {
+            p = pCtx->prevAlloc( pCtx->prevUd, NULL, 0, nsize );
+        }
+
+        /* the block moves between the pools and the previous allocator */
+        if( ( p != NULL ) && ( ptr != NULL ) )
+        {
+            memcpy( p, ptr, ( osize < nsize ) ? osize : nsize );
+            if( pooled == true )
+            {
+                pool_free( pCtx, ptr, osize );
+            }
+            else
+            {
+                (void)pCtx->prevAlloc( pCtx->prevUd, ptr, osize, 0 );
+            }
+        }
+    }
+
+    return p;
+}
+
+/*============================================================================*/
+/*  pool_alloc                                                                */
+/*!
+    Allocate a block from the pools
+
+    @param[in]
+        pCtx
+            allocator context
+
+    @param[in]
+        size
+            size of the block, at most ALLOC_MAX_POOLED bytes
+
+    @return pointer to the block, or NULL if a slab could not be allocated
+
+==============================================================================*/
+static void *pool_alloc( AllocContext *pCtx, size_t size )
+{
+    size_t class = ALLOC_CLASS( size );
+    size_t len = ( class + 1 ) * ALLOC_CLASS_SIZE;
+    AllocBlock *pBlock = pCtx->freeList[class];
+    char *slab;
+
+    if( pBlock != NULL )
+    {
+        pCtx->freeList[class] = pBlock->next;
+    }
+    else
+    {
+        if( (size_t)( pCtx->bumpEnd - pCtx->bump ) < len )
+        {
+            slab = aligned_alloc( ALLOC_SLAB_SIZE, ALLOC_SLAB_SIZE );
+            if( ( slab != NULL ) &&
+                ( add_slab( pCtx, (uintptr_t)slab ) != EOK ) )
+            {
+                free( slab );
+                slab = NULL;
+            }
+
+            if( slab != NULL )
+            {
+                pCtx->bump = slab;
+                pCtx->bumpEnd = slab + ALLOC_SLAB_SIZE;
+                slabBytes += ALLOC_SLAB_SIZE;
+            }
+        }
+
+        if( (size_t)( pCtx->bumpEnd - pCtx->bump ) >= len )
+        {
+            pBlock = (AllocBlock *)pCtx->bump;
+            pCtx->bump += len;
+        }
+    }
+
+    if( pBlock != NULL )
+    {
+        pooledCount++;
+    }
+
+    return pBlock;
+}
+
+/*============================================================================*/
+/*  pool_free                                                                 */
+/*!
+    Return a block to its size class free list
+
+    @param[in]
+        pCtx
+            allocator context
+
+    @param[in]
+        ptr
+            pooled block
+
+    @param[in]
+        size
+            size of the block as passed by Lua
+
+==============================================================================*/
+static void pool_free( AllocContext *pCtx, void *ptr, size_t size )
+{
+    AllocBlock *pBlock = (AllocBlock *)ptr;
+    size_t class = ALLOC_CLASS( size );
+
+    pBlock->next = pCtx->freeList[class];
+    pCtx->freeList[class] = pBlock;
+}
+
+/*============================================================================*/
+/*  is_pooled                                                                 */
+/*!
+    Check if a block was allocated from the pools
+
+    @param[in]
+        pCtx
+            allocator context
+
+    @param[in]
+        ptr
+            block to check
+
+    @retval true the block is in a slab
+    @retval false the block came from the previous allocator
+
+==============================================================================*/
+static bool is_pooled( AllocContext *pCtx, void *ptr )
+{
+    uintptr_t base = (uintptr_t)ptr & ~(uintptr_t)( ALLOC_SLAB_SIZE - 1 );
+    bool result = false;
+    size_t i;
+
+    if( pCtx->numSlabs != 0 )
+    {
+        i = slab_slot( base, pCtx->slabSlots );
+        while( pCtx->slabs[i] != 0 )
+        {
+            if( pCtx->slabs[i] == base )
+            {
+                result = true;
+                break;
+            }
+
+            i = ( i + 1 ) & ( pCtx->slabSlots - 1 );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  add_slab                                                                  */
+/*!
+    Add a slab to the slab hash set
+
+    The hash set is kept at most half full.
+
+    @param[in]
+        pCtx
+            allocator context
+
+    @param[in]
+        base
+            address of the slab
+
+    @retval EOK the slab was added
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+static int add_slab( AllocContext *pCtx, uintptr_t base )
+{
+    int result = EOK;
+    uintptr_t *slabs;
+    size_t slots;
+    size_t i;
+    size_t j;
+
+    if( ( pCtx->numSlabs + 1 ) * 2 > pCtx->slabSlots )
+    {
+        slots = ( pCtx->slabSlots == 0 ) ? ALLOC_INITIAL_SLOTS
+                                         : pCtx->slabSlots * 2;
+        slabs = calloc( slots, sizeof( uintptr_t ) );
+        if( slabs != NULL )
+        {
+            for( i = 0; i < pCtx->slabSlots; i++ )
+            {
+                if( pCtx->slabs[i] != 0 )
+                {
+                    j = slab_slot( pCtx->slabs[i], slots );
+                    while( slabs[j] != 0 )
+                    {
+                        j = ( j + 1 ) & ( slots - 1 );
+                    }
+
+                    slabs[j] = pCtx->slabs[i];
+                }
+            }
+
+            free( pCtx->slabs );
+            pCtx->slabs = slabs;
+            pCtx->slabSlots = slots;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if( result == EOK )
+    {
+        i = slab_slot( base, pCtx->slabSlots );
+        while( pCtx->slabs[i] != 0 )
+        {
+            i = ( i + 1 ) & ( pCtx->slabSlots - 1 );
+        }
+
+        pCtx->slabs[i] = base;
+        pCtx->numSlabs++;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  slab_slot                                                                 */
+/*!
+    Get the home slot of a slab in the slab hash set
+
+    @param[in]
+        base
+            address of the slab
+
+    @param[in]
+        slots
+            number of slots in the hash set (a power of 2)
+
+    @return the index of the home slot
+
+==============================================================================*/
+static size_t slab_slot( uintptr_t base, size_t slots )
+{
+    uint64_t key = (uint64_t)base / ALLOC_SLAB_SIZE;
+
+    return (size_t)( ( key * 0x9E3779B97F4A7C15ULL ) >> 32 ) & ( slots - 1 );
+}
+
+/*============================================================================*/
+/*  finalizer_gc                                                              */
+/*!
+    Put the previous allocator back when the Lua state is closed
+
+    This runs before the library is unloaded.  The accounting allocator
+    stays installed if the state holds pooled blocks, which only it can
+    free, or if another allocator has been installed on top of it.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int finalizer_gc( lua_State *L )
+{
+    AllocContext *pCtx = *(AllocContext **)lua_touserdata( L, 1 );
+    void *ud;
+
+    if( ( lua_getallocf( L, &ud ) == counting_alloc ) &&
+        ( ud == pCtx ) &&
+        ( pCtx->numSlabs == 0 ) )
+    {
+        lua_setallocf( L, pCtx->prevAlloc, pCtx->prevUd );
+        free( pCtx );
+    }
+
+    return 0;
+}
+
+/*! @}
+ * end of libluavars group */
@@ -0,0 +1,59 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef ALLOC_H
+#define ALLOC_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <lua.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! largest block served from the size-class pools */
+#define ALLOC_MAX_POOLED        ( 256 )
+
+/*! size and alignment of the pool slabs */
+#define ALLOC_SLAB_SIZE         ( 64 * 1024 )
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int ALLOC_Install( lua_State *L );
+int ALLOC_Pool( lua_State *L, bool enable );
+uint64_t ALLOC_Bytes( void );
+uint64_t ALLOC_Freed( void );
+uint64_t ALLOC_Count( void );
+void ALLOC_PushTable( lua_State *L );
+void ALLOC_Print( FILE *fp );
+
+#endif
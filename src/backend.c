@@ -0,0 +1,400 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file backend.c
+
+    Variable server backends
+
+    The bindings reach the variable server through a LuaVarsBackend
+    table of operations rather than calling the VAR_* functions
+    directly, so that the variable server can be replaced or wrapped.
+
+    The backend is selected when the library is first required, from
+    the LUAVARS_BACKEND Lua global or the LUAVARS_BACKEND environment
+    variable:
+
+    varserver - the varserver daemon (default)
+    memory - an in-process, in-memory variable store
+    record[:backend] - record every operation to the file named by
+                       LUAVARS_RECORD (or stderr) and forward it to
+                       the named backend (default varserver)
+    reconnect[:backend] - give out virtual handles and reconnect,
+                          re-resolve and re-register notifications
+                          when the named backend (default varserver)
+                          loses its connection
+
+    The wrapping backends may be chained, e.g. record:reconnect:varserver
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <varserver/varserver.h>
+#include "backend.h"
+#include "loadgen.h"
+#include "memvars.h"
+#include "record.h"
+#include "reconnect.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! prefix of the recording backend name */
+#define BACKEND_RECORD          "record"
+
+/*! prefix of the reconnecting backend name */
+#define BACKEND_RECONNECT       "reconnect"
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static const LuaVarsBackend *find_backend( const char *name );
+static const LuaVarsBackend *select_chain( const char *name, int *pResult );
+static const char *wrapper_inner( const char *name, const char *prefix );
+static VARSERVER_HANDLE varserver_open( const LuaVarsBackend *pBackend );
+static VARSERVER_HANDLE memory_open( const LuaVarsBackend *pBackend );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! varserver daemon backend */
+static const LuaVarsBackend varserverBackend = {
+    .name = "varserver",
+    .open = varserver_open,
+    .close = VARSERVER_Close,
+    .create = VARSERVER_CreateVar,
+    .find = VAR_FindByName,
+    .get = VAR_Get,
+    .set = VAR_Set,
+    .setStr = VAR_SetStr,
+    .getType = VAR_GetType,
+    .getLength = VAR_GetLength,
+    .getName = VAR_GetName,
+    .notify = VAR_Notify,
+    .notifyCancel = VAR_NotifyCancel,
+    .getValidationRequest = VAR_GetValidationRequest,
+    .sendValidationResponse = VAR_SendValidationResponse,
+    .openPrintSession = VAR_OpenPrintSession,
+    .closePrintSession = VAR_ClosePrintSession,
+    .getFirst = VAR_GetFirst,
+    .getNext = VAR_GetNext
+};
+
+/*! in-memory backend */
+static const LuaVarsBackend memoryBackend = {
+    .name = "memory",
+    .open = memory_open,
+    .close = MEMVARS_Close,
+    .create = MEMVARS_CreateVar,
+    .find = MEMVARS_FindByName,
+    .get = MEMVARS_Get,
+    .set = MEMVARS_Set,
+    .setStr = MEMVARS_SetStr,
+    .getType = MEMVARS_GetType,
+    .getLength = MEMVARS_GetLength,
+    .getName = MEMVARS_GetName,
+    .notify = MEMVARS_Notify,
+    .notifyCancel = MEMVARS_NotifyCancel,
+    .getValidationRequest = MEMVARS_GetValidationRequest,
+    .sendValidationResponse = MEMVARS_SendValidationResponse,
+    .openPrintSession = MEMVARS_OpenPrintSession,
+    .closePrintSession = MEMVARS_ClosePrintSession,
+    .getFirst = MEMVARS_GetFirst,
+    .getNext = MEMVARS_GetNext
+};
+
+/*! selectable backends other than the recording backend */
+static const LuaVarsBackend *backends[] = {
+    &varserverBackend,
+    &memoryBackend,
+    NULL
+};
+
+/*! currently selected backend */
+static const LuaVarsBackend *current = &varserverBackend;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  BACKEND_Select                                                            */
+/*!
+    Select the variable server backend
+
+    The backend must be selected before the first variable server
+    connection is opened.
+
+    @param[in]
+        name
+            backend name: "varserver", "memory", or a wrapping backend
+            "record[:<backend>]" or "reconnect[:<backend>]".  NULL
+            selects the default backend.
+
+    @retval EOK the backend was selected
+    @retval ENOENT no backend has the specified name
+    @retval other error opening the recording file
+
+==============================================================================*/
+int BACKEND_Select( const char *name )
+{
+    int result = ENOENT;
+    const LuaVarsBackend *pBackend;
+
+    pBackend = select_chain( name, &result );
+    if( pBackend != NULL )
+    {
+        current = pBackend;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  BACKEND_Current                                                           */
+/*!
+    Get the selected variable server backend
+
+    @return pointer to the selected backend
+
+==============================================================================*/
+const LuaVarsBackend *BACKEND_Current( void )
+{
+    return current;
+}
+
+/*============================================================================*/
+/*  BACKEND_BlockSignals                                                      */
+/*!
+    Block the notification signals in the calling thread
+
+    Called before worker threads are created, since they inherit the
+    signal mask of the creating thread.  Only the thread calling
+    var.wait() should receive the timer, notification and load
+    generator completion signals.
+
+    @param[out]
+        pOldMask
+            receives the previous signal mask, to be restored once the
+            worker threads have been created
+
+==============================================================================*/
+void BACKEND_BlockSignals( sigset_t *pOldMask )
+{
+    sigset_t mask;
+
+    sigemptyset( &mask );
+    sigaddset( &mask, SIGRTMIN+5 );
+    sigaddset( &mask, SIG_LOADGEN_DONE );
+    sigaddset( &mask, SIG_VAR_MODIFIED );
+    sigaddset( &mask, SIG_VAR_CALC );
+    sigaddset( &mask, SIG_VAR_VALIDATE );
+    sigaddset( &mask, SIG_VAR_PRINT );
+    pthread_sigmask( SIG_BLOCK, &mask, pOldMask );
+}
+
+/*============================================================================*/
+/*  select_chain                                                              */
+/*!
+    Build a backend from a possibly wrapped backend name
+
+    @param[in]
+        name
+            backend name
+
+    @param[out]
+        pResult
+            receives the error if the backend could not be built
+
+    @return pointer to the backend, or NULL
+
+==============================================================================*/
+static const LuaVarsBackend *select_chain( const char *name, int *pResult )
+{
+    const LuaVarsBackend *pBackend = NULL;
+    const LuaVarsBackend *pInner;
+    const char *innerName;
+
+    if( ( name == NULL ) || ( *name == '\0' ) )
+    {
+        pBackend = &varserverBackend;
+    }
+    else if( ( innerName = wrapper_inner( name, BACKEND_RECORD ) ) != NULL )
+    {
+        pInner = select_chain( innerName, pResult );
+        if( pInner != NULL )
+        {
+            pBackend = RECORD_Backend( pInner, getenv( "LUAVARS_RECORD" ) );
+            if( pBackend == NULL )
+            {
+                *pResult = errno;
+            }
+        }
+    }
+    else if( ( innerName = wrapper_inner( name, BACKEND_RECONNECT ) ) != NULL )
+    {
+        pInner = select_chain( innerName, pResult );
+        if( pInner != NULL )
+        {
+            pBackend = RECONNECT_Backend( pInner );
+            if( pBackend == NULL )
+            {
+                *pResult = errno;
+            }
+        }
+    }
+    else
+    {
+        pBackend = find_backend( name );
+    }
+
+    return pBackend;
+}
+
+/*============================================================================*/
+/*  wrapper_inner                                                             */
+/*!
+    Get the name of the backend wrapped by a wrapping backend
+
+    @param[in]
+        name
+            backend name, e.g. "record:memory"
+
+    @param[in]
+        prefix
+            name of the wrapping backend, e.g. "record"
+
+    @return the wrapped backend name ("" for the default backend),
+            or NULL if the name does not start with the prefix
+
+==============================================================================*/
+static const char *wrapper_inner( const char *name, const char *prefix )
+{
+    const char *innerName = NULL;
+    size_t len = strlen( prefix );
+
+    if( strncmp( name, prefix, len ) == 0 )
+    {
+        if( name[len] == '\0' )
+        {
+            innerName = &name[len];
+        }
+        else if( name[len] == ':' )
+        {
+            innerName = &name[len+1];
+        }
+    }
+
+    return innerName;
+}
+
+/*============================================================================*/
+/*  find_backend                                                              */
+/*!
+    Find a backend by name
+
+    @param[in]
+        name
+            backend name
+
+    @return pointer to the backend, or NULL if it was not found
+
+==============================================================================*/
+static const LuaVarsBackend *find_backend( const char *name )
+{
+    const LuaVarsBackend *pBackend = NULL;
+    int i;
+
+    for( i = 0; backends[i] != NULL; i++ )
+    {
+        if( strcmp( backends[i]->name, name ) == 0 )
+        {
+            pBackend = backends[i];
+            break;
+        }
+    }
+
+    return pBackend;
+}
+
+/*============================================================================*/
+/*  varserver_open                                                            */
+/*!
+    Open a connection to the variable server daemon
+
+    @param[in]
+        pBackend
+            unused
+
+    @return handle to the variable server, or NULL
+
+==============================================================================*/
+static VARSERVER_HANDLE varserver_open( const LuaVarsBackend *pBackend )
+{
+    (void)pBackend;
+
+    return VARSERVER_Open();
+}
+
+/*============================================================================*/
+/*  memory_open                                                               */
+/*!
+    Open a connection to the in-memory variable store
+
+    @param[in]
+        pBackend
+            unused
+
+    @return handle to the memory client, or NULL
+
+==============================================================================*/
+static VARSERVER_HANDLE memory_open( const LuaVarsBackend *pBackend )
+{
+    (void)pBackend;
+
+    return MEMVARS_Open();
+}
+
+/*! @}
+ * end of libluavars group */
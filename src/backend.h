@@ -0,0 +1,153 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef BACKEND_H
+#define BACKEND_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <signal.h>
+#include <varserver/varserver.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! name of the default backend */
+#define BACKEND_DEFAULT     "varserver"
+
+/*==============================================================================
+        Public types
+==============================================================================*/
+
+/*! variable server operations used by the bindings.  Each operation has
+    the same semantics as the varserver library function it replaces.
+    open() and signalHandle() have no connection handle, so they are
+    passed the backend itself to let wrapping backends keep per
+    instance state */
+typedef struct _LuaVarsBackend
+{
+    /*! backend name */
+    const char *name;
+
+    /*! VARSERVER_Open() */
+    VARSERVER_HANDLE (*open)( const struct _LuaVarsBackend *pBackend );
+
+    /*! VARSERVER_Close() */
+    int (*close)( VARSERVER_HANDLE hVarServer );
+
+    /*! VARSERVER_CreateVar() */
+    int (*create)( VARSERVER_HANDLE hVarServer, VarInfo *pVarInfo );
+
+    /*! VAR_FindByName() */
+    VAR_HANDLE (*find)( VARSERVER_HANDLE hVarServer, char *name );
+
+    /*! VAR_Get() */
+    int (*get)( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar, VarObject *obj );
+
+    /*! VAR_Set() */
+    int (*set)( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar, VarObject *obj );
+
+    /*! VAR_SetStr() */
+    int (*setStr)( VARSERVER_HANDLE hVarServer,
+                   VAR_HANDLE hVar,
+                   VarType type,
+                   char *str );
+
+    /*! VAR_GetType() */
+    int (*getType)( VARSERVER_HANDLE hVarServer,
+                    VAR_HANDLE hVar,
+                    VarType *pVarType );
+
+    /*! VAR_GetLength() */
+    int (*getLength)( VARSERVER_HANDLE hVarServer,
+                      VAR_HANDLE hVar,
+                      size_t *len );
+
+    /*! VAR_GetName() */
+    int (*getName)( VARSERVER_HANDLE hVarServer,
+                    VAR_HANDLE hVar,
+                    char *buf,
+                    size_t len );
+
+    /*! VAR_Notify() */
+    int (*notify)( VARSERVER_HANDLE hVarServer,
+                   VAR_HANDLE hVar,
+                   NotificationType notificationType );
+
+    /*! VAR_NotifyCancel() */
+    int (*notifyCancel)( VARSERVER_HANDLE hVarServer,
+                         VAR_HANDLE hVar,
+                         NotificationType notificationType );
+
+    /*! VAR_GetValidationRequest() */
+    int (*getValidationRequest)( VARSERVER_HANDLE hVarServer,
+                                 uint32_t id,
+                                 VAR_HANDLE *hVar,
+                                 VarObject *obj );
+
+    /*! VAR_SendValidationResponse() */
+    int (*sendValidationResponse)( VARSERVER_HANDLE hVarServer,
+                                   uint32_t id,
+                                   int response );
+
+    /*! VAR_OpenPrintSession() */
+    int (*openPrintSession)( VARSERVER_HANDLE hVarServer,
+                             uint32_t id,
+                             VAR_HANDLE *hVar,
+                             int *fd );
+
+    /*! VAR_ClosePrintSession() */
+    int (*closePrintSession)( VARSERVER_HANDLE hVarServer,
+                              uint32_t id,
+                              int fd );
+
+    /*! VAR_GetFirst() */
+    int (*getFirst)( VARSERVER_HANDLE hVarServer,
+                     VarQuery *query,
+                     VarObject *obj );
+
+    /*! VAR_GetNext() */
+    int (*getNext)( VARSERVER_HANDLE hVarServer,
+                    VarQuery *query,
+                    VarObject *obj );
+
+    /*! map a handle received in a notification signal to the handle
+        used with this backend.  NULL if they are the same */
+    VAR_HANDLE (*signalHandle)( const struct _LuaVarsBackend *pBackend,
+                                VAR_HANDLE hVar );
+} LuaVarsBackend;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int BACKEND_Select( const char *name );
+const LuaVarsBackend *BACKEND_Current( void );
+void BACKEND_BlockSignals( sigset_t *pOldMask );
+
+#endif
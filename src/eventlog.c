@@ -0,0 +1,631 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file eventlog.c
+
+    Notification event log
+
+    The event log records the notifications received by var.wait() and
+    the variables set by the script in a compact binary file, so that
+    the event traffic of a production handler can be replayed later
+    against the in-memory backend (see bench/luavars_replay.c).
+
+    The file is an EventLogHeader followed by EventLogRecords, each
+    followed by its payload.  A NAME record is written the first time
+    a variable handle appears in the log, giving its name and type, so
+    the log can be replayed in a process with different handles.
+    Only variables looked up by name while the log is active are named,
+    so logging is normally started when the library is loaded, by
+    setting the LUAVARS_EVENTLOG environment variable.
+
+    Validation and print notifications carry a request identifier
+    rather than a variable handle, so their EVENT record is written
+    when the script opens the request and the handle becomes known.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <varserver/varserver.h>
+#include "eventlog.h"
+#include "stats.h"
+#include "backend.h"
+#include "metacache.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! highest variable handle which can be named in the log */
+#define EVENTLOG_MAX_HANDLES    ( 65536 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! variable name known to the event log */
+typedef struct _EventLogName
+{
+    /*! variable name, or NULL if the handle has not been looked up */
+    char *name;
+
+    /*! indicates if the NAME record has been written to the log */
+    bool written;
+} EventLogName;
+
+/*! notification waiting for its variable handle */
+typedef struct _EventLogPending
+{
+    /*! indicates if there is a pending notification */
+    bool valid;
+
+    /*! signal index of the notification */
+    int sigIdx;
+
+    /*! time the notification was received */
+    uint64_t ts;
+} EventLogPending;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static void write_name( VAR_HANDLE hVar );
+static void write_event( int sigIdx,
+                         VAR_HANDLE hVar,
+                         const VarObject *pValue,
+                         uint64_t ts );
+static void write_record( EventLogKind kind,
+                          int arg,
+                          VAR_HANDLE hVar,
+                          uint64_t ts,
+                          const void *payload,
+                          size_t len );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! event log file, or NULL if logging is not active */
+static FILE *fp = NULL;
+
+/*! variable server connection used to look up variable types */
+static VARSERVER_HANDLE hLogVarServer = NULL;
+
+/*! monotonic time at which the log was started */
+static uint64_t start = 0;
+
+/*! names of the variables indexed by handle */
+static EventLogName *names = NULL;
+
+/*! number of entries in the names array */
+static size_t numNames = 0;
+
+/*! notification waiting for its variable handle */
+static EventLogPending pending;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  EVENTLOG_Start                                                            */
+/*!
+    Start logging notification events
+
+    @param[in]
+        path
+            path of the event log file to create
+
+    @param[in]
+        hVarServer
+            variable server connection used to look up variable types
+
+    @retval EOK logging was started
+    @retval EALREADY logging is already active
+    @retval EINVAL invalid arguments
+    @retval other error from fopen()
+
+==============================================================================*/
+int EVENTLOG_Start( const char *path, VARSERVER_HANDLE hVarServer )
+{
+    int result = EINVAL;
+    EventLogHeader header;
+    struct timespec ts;
+    size_t i;
+
+    if( fp != NULL )
+    {
+        result = EALREADY;
+    }
+    else if( path != NULL )
+    {
+        fp = fopen( path, "wb" );
+        if( fp == NULL )
+        {
+            result = errno;
+        }
+        else
+        {
+            clock_gettime( CLOCK_REALTIME, &ts );
+
+            memset( &header, 0, sizeof( EventLogHeader ) );
+            header.magic = EVENTLOG_MAGIC;
+            header.version = EVENTLOG_VERSION;
+            header.start = (uint64_t)ts.tv_sec * 1000000000ULL +
+                           (uint64_t)ts.tv_nsec;
+
+            (void)fwrite( &header, sizeof( EventLogHeader ), 1, fp );
+
+            /* each log names its variables again */
+            for( i = 0; i < numNames; i++ )
+            {
+                names[i].written = false;
+            }
+
+            hLogVarServer = hVarServer;
+            pending.valid = false;
+            start = STATS_Now();
+
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EVENTLOG_Stop                                                             */
+/*!
+    Stop logging notification events and close the log file
+
+    @retval EOK logging was stopped
+    @retval ENOENT logging is not active
+    @retval other error from fclose()
+
+==============================================================================*/
+int EVENTLOG_Stop( void )
+{
+    int result = ENOENT;
+
+    if( fp != NULL )
+    {
+        result = ( fclose( fp ) == 0 ) ? EOK : errno;
+        fp = NULL;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EVENTLOG_IsActive                                                         */
+/*!
+    Check if notification events are being logged
+
+    @retval true events are being logged
+    @retval false events are not being logged
+
+==============================================================================*/
+bool EVENTLOG_IsActive( void )
+{
+    return ( fp != NULL );
+}
+
+/*============================================================================*/
+/*  EVENTLOG_Name                                                             */
+/*!
+    Remember the name of a variable handle
+
+    Called whenever the script looks up a variable by name.
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        name
+            name of the variable
+
+==============================================================================*/
+void EVENTLOG_Name( VAR_HANDLE hVar, const char *name )
+{
+    EventLogName *p;
+    size_t n;
+
+    if( ( fp != NULL ) &&
+        ( name != NULL ) &&
+        ( hVar != VAR_INVALID ) &&
+        ( hVar < EVENTLOG_MAX_HANDLES ) )
+    {
+        if( hVar >= numNames )
+        {
+            n = ( numNames == 0 ) ? 64 : numNames;
+            while( n <= hVar )
+            {
+                n *= 2;
+            }
+
+            p = realloc( names, n * sizeof( EventLogName ) );
+            if( p != NULL )
+            {
+                memset( &p[numNames],
+                        0,
+                        ( n - numNames ) * sizeof( EventLogName ) );
+                names = p;
+                numNames = n;
+            }
+        }
+
+        if( ( hVar < numNames ) && ( names[hVar].name == NULL ) )
+        {
+            names[hVar].name = strdup( name );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  EVENTLOG_Received                                                         */
+/*!
+    Log a notification received by var.wait()
+
+    Modified and calc notifications are logged immediately.  Validate
+    and print notifications are logged by EVENTLOG_Handle() when the
+    script opens the request.
+
+    @param[in]
+        sig
+            the notification signal
+
+    @param[in]
+        id
+            the notification value: a variable handle, or a validation
+            or print request identifier
+
+==============================================================================*/
+void EVENTLOG_Received( int sig, int id )
+{
+    int sigIdx;
+    uint64_t ts;
+
+    if( fp != NULL )
+    {
+        sigIdx = STATS_SignalIndex( sig );
+        if( sigIdx != STATS_SIGNAL_INVALID )
+        {
+            ts = STATS_Now() - start;
+
+            if( ( sig == SIG_VAR_MODIFIED ) || ( sig == SIG_VAR_CALC ) )
+            {
+                pending.valid = false;
+                write_event( sigIdx, (VAR_HANDLE)id, NULL, ts );
+            }
+            else
+            {
+                /* a request which the script never opened is dropped */
+                pending.valid = true;
+                pending.sigIdx = sigIdx;
+                pending.ts = ts;
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  EVENTLOG_Handle                                                           */
+/*!
+    Log a pending validate or print notification
+
+    @param[in]
+        hVar
+            handle of the variable the request is for
+
+    @param[in]
+        pValue
+            pointer to the value being validated, or NULL
+
+==============================================================================*/
+void EVENTLOG_Handle( VAR_HANDLE hVar, const VarObject *pValue )
+{
+    if( ( fp != NULL ) && ( pending.valid == true ) )
+    {
+        write_event( pending.sigIdx, hVar, pValue, pending.ts );
+        pending.valid = false;
+    }
+}
+
+/*============================================================================*/
+/*  EVENTLOG_Set                                                              */
+/*!
+    Log a variable set by the script
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        type
+            type of the variable
+
+    @param[in]
+        value
+            string value written to the variable
+
+==============================================================================*/
+void EVENTLOG_Set( VAR_HANDLE hVar, VarType type, const char *value )
+{
+    size_t len;
+
+    if( ( fp != NULL ) && ( value != NULL ) )
+    {
+        len = strlen( value );
+        if( len > EVENTLOG_MAX_PAYLOAD )
+        {
+            len = EVENTLOG_MAX_PAYLOAD;
+        }
+
+        write_name( hVar );
+        write_record( EVENTLOG_SET,
+                      (int)type,
+                      hVar,
+                      STATS_Now() - start,
+                      value,
+                      len );
+    }
+}
+
+/*============================================================================*/
+/*  EVENTLOG_ReadHeader                                                       */
+/*!
+    Read and check the header of an event log
+
+    @param[in]
+        fpIn
+            event log file
+
+    @param[out]
+        pHeader
+            pointer to the location to store the header
+
+    @retval EOK the header is valid
+    @retval EINVAL the file is not a supported event log
+    @retval EIO the header could not be read
+
+==============================================================================*/
+int EVENTLOG_ReadHeader( FILE *fpIn, EventLogHeader *pHeader )
+{
+    int result = EIO;
+
+    if( fread( pHeader, sizeof( EventLogHeader ), 1, fpIn ) == 1 )
+    {
+        result = ( ( pHeader->magic == EVENTLOG_MAGIC ) &&
+                   ( pHeader->version == EVENTLOG_VERSION ) ) ? EOK
+                                                               : EINVAL;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  EVENTLOG_Read                                                             */
+/*!
+    Read the next record of an event log
+
+    @param[in]
+        fpIn
+            event log file
+
+    @param[out]
+        pRecord
+            pointer to the location to store the record
+
+    @param[out]
+        payload
+            buffer of at least EVENTLOG_MAX_PAYLOAD + 1 bytes to receive
+            the NUL terminated payload
+
+    @retval EOK a record was read
+    @retval ENOENT end of the log
+    @retval EINVAL the record is corrupt
+    @retval EIO the record is truncated
+
+==============================================================================*/
+int EVENTLOG_Read( FILE *fpIn, EventLogRecord *pRecord, void *payload )
+{
+    int result = ENOENT;
+
+    if( fread( pRecord, sizeof( EventLogRecord ), 1, fpIn ) == 1 )
+    {
+        if( pRecord->len > EVENTLOG_MAX_PAYLOAD )
+        {
+            result = EINVAL;
+        }
+        else if( ( pRecord->len > 0 ) &&
+                 ( fread( payload, pRecord->len, 1, fpIn ) != 1 ) )
+        {
+            result = EIO;
+        }
+        else
+        {
+            ((char *)payload)[pRecord->len] = '\0';
+            result = EOK;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  write_name                                                                */
+/*!
+    Write the NAME record for a variable if it has not been written
+
+    @param[in]
+        hVar
+            handle of the variable
+
+==============================================================================*/
+static void write_name( VAR_HANDLE hVar )
+{
+    VarType type = VARTYPE_INVALID;
+    EventLogName *pName;
+
+    if( ( hVar < numNames ) &&
+        ( names[hVar].name != NULL ) &&
+        ( names[hVar].written == false ) )
+    {
+        pName = &names[hVar];
+        (void)METACACHE_GetType( BACKEND_Current(),
+                                 hLogVarServer,
+                                 hVar,
+                                 &type );
+
+        write_record( EVENTLOG_NAME,
+                      (int)type,
+                      hVar,
+                      STATS_Now() - start,
+                      pName->name,
+                      strlen( pName->name ) );
+
+        pName->written = true;
+    }
+}
+
+/*============================================================================*/
+/*  write_event                                                               */
+/*!
+    Write an EVENT record
+
+    @param[in]
+        sigIdx
+            signal index of the notification
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        pValue
+            pointer to the value of the notification, or NULL
+
+    @param[in]
+        ts
+            time the notification was received
+
+==============================================================================*/
+static void write_event( int sigIdx,
+                         VAR_HANDLE hVar,
+                         const VarObject *pValue,
+                         uint64_t ts )
+{
+    const void *payload = NULL;
+    size_t len = 0;
+
+    write_name( hVar );
+
+    if( pValue != NULL )
+    {
+        if( pValue->type == VARTYPE_STR )
+        {
+            payload = pValue->val.str;
+            len = strnlen( pValue->val.str, EVENTLOG_MAX_PAYLOAD );
+        }
+        else if( pValue->type != VARTYPE_BLOB )
+        {
+            payload = &pValue->val;
+            len = sizeof( pValue->val );
+        }
+    }
+
+    write_record( EVENTLOG_EVENT, sigIdx, hVar, ts, payload, len );
+}
+
+/*============================================================================*/
+/*  write_record                                                              */
+/*!
+    Write a record to the event log
+
+    @param[in]
+        kind
+            record kind
+
+    @param[in]
+        arg
+            kind specific argument
+
+    @param[in]
+        hVar
+            variable handle
+
+    @param[in]
+        ts
+            time since the start of the log
+
+    @param[in]
+        payload
+            record payload, or NULL
+
+    @param[in]
+        len
+            length of the payload
+
+==============================================================================*/
+static void write_record( EventLogKind kind,
+                          int arg,
+                          VAR_HANDLE hVar,
+                          uint64_t ts,
+                          const void *payload,
+                          size_t len )
+{
+    EventLogRecord record;
+
+    record.ts = ts;
+    record.hVar = (uint32_t)hVar;
+    record.len = (uint16_t)len;
+    record.kind = (uint8_t)kind;
+    record.arg = (uint8_t)arg;
+
+    (void)fwrite( &record, sizeof( EventLogRecord ), 1, fp );
+    if( ( payload != NULL ) && ( len > 0 ) )
+    {
+        (void)fwrite( payload, len, 1, fp );
+    }
+}
+
+/*! @}
+ * end of libluavars group */
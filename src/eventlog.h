@@ -0,0 +1,119 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <varserver/varserver.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! event log file magic number ("LVEL") */
+#define EVENTLOG_MAGIC          ( 0x4c45564cUL )
+
+/*! event log format version */
+#define EVENTLOG_VERSION        ( 1 )
+
+/*! maximum record payload length */
+#define EVENTLOG_MAX_PAYLOAD    ( 4096 )
+
+/*==============================================================================
+        Public types
+==============================================================================*/
+
+/*! event log record kinds */
+typedef enum _EventLogKind
+{
+    /*! variable name.  arg is the VarType, payload is the name */
+    EVENTLOG_NAME = 1,
+
+    /*! notification received.  arg is the signal index, payload is the
+        raw VarObject value for validation requests, otherwise empty */
+    EVENTLOG_EVENT,
+
+    /*! variable set by the script.  arg is the VarType, payload is the
+        string value */
+    EVENTLOG_SET
+} EventLogKind;
+
+/*! event log file header */
+typedef struct _EventLogHeader
+{
+    /*! EVENTLOG_MAGIC */
+    uint32_t magic;
+
+    /*! EVENTLOG_VERSION */
+    uint16_t version;
+
+    /*! reserved for future use */
+    uint16_t reserved;
+
+    /*! CLOCK_REALTIME time at which the log was started, in ns */
+    uint64_t start;
+} EventLogHeader;
+
+/*! event log record, followed by len bytes of payload */
+typedef struct _EventLogRecord
+{
+    /*! time since the start of the log in nanoseconds */
+    uint64_t ts;
+
+    /*! variable handle in the recording process */
+    uint32_t hVar;
+
+    /*! length of the payload */
+    uint16_t len;
+
+    /*! EventLogKind */
+    uint8_t kind;
+
+    /*! kind specific argument */
+    uint8_t arg;
+} EventLogRecord;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int EVENTLOG_Start( const char *path, VARSERVER_HANDLE hVarServer );
+int EVENTLOG_Stop( void );
+bool EVENTLOG_IsActive( void );
+void EVENTLOG_Name( VAR_HANDLE hVar, const char *name );
+void EVENTLOG_Received( int sig, int id );
+void EVENTLOG_Handle( VAR_HANDLE hVar, const VarObject *pValue );
+void EVENTLOG_Set( VAR_HANDLE hVar, VarType type, const char *value );
+
+int EVENTLOG_ReadHeader( FILE *fpIn, EventLogHeader *pHeader );
+int EVENTLOG_Read( FILE *fpIn, EventLogRecord *pRecord, void *payload );
+
+#endif
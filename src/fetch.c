@@ -0,0 +1,819 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file fetch.c
+
+    Pipelined variable fetch
+
+    A batch of variable gets or sets is made by a pool of threads
+    which each have their own connection to the selected backend, so
+    that the round trips of the batch overlap rather than being made
+    one after another.  The threads claim the batch a few entries at a time, so
+    a slow variable delays only the thread which claimed it.
+
+    The threads are started once and wait between batches, and block
+    the notification signals so notifications are only received by
+    the script's var.wait().  The calling thread waits for the batch,
+    then handles the variables which must be accessed on its own
+    connection, such as those it services calc or validate requests
+    for, since it cannot service a request while it waits.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <varserver/varserver.h>
+#include "backend.h"
+#include "metacache.h"
+#include "fetch.h"
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! fetch thread */
+typedef struct _FetchWorker
+{
+    /*! fetch thread */
+    pthread_t thread;
+
+    /*! pool the thread belongs to */
+    Fetch *pFetch;
+
+    /*! connection used by the thread */
+    VARSERVER_HANDLE hVarServer;
+
+    /*! string buffer for the variable server */
+    char buf[BUFSIZ];
+} FetchWorker;
+
+/*! pool of fetch threads */
+struct _Fetch
+{
+    /*! backend used by the threads */
+    const LuaVarsBackend *backend;
+
+    /*! protects the batch state below */
+    pthread_mutex_t lock;
+
+    /*! signalled when a batch is started or the pool is stopped */
+    pthread_cond_t start;
+
+    /*! signalled when the last thread finishes a batch */
+    pthread_cond_t done;
+
+    /*! incremented for each batch */
+    uint64_t generation;
+
+    /*! set to stop the threads */
+    bool stop;
+
+    /*! number of threads which have not finished the current batch */
+    int busy;
+
+    /*! entries of the current batch */
+    FetchEntry *entries;
+
+    /*! number of entries in the current batch */
+    size_t n;
+
+    /*! index of the next unclaimed entry */
+    size_t next;
+
+    /*! set if the current batch sets the variables */
+    bool set;
+
+    /*! selects the entries left for the calling thread */
+    FetchLocalFn isLocal;
+
+    /*! number of threads started */
+    int numWorkers;
+
+    /*! fetch threads */
+    FetchWorker *workers;
+};
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static void *fetch_thread( void *arg );
+static int fetch_batch( Fetch *pFetch,
+                        bool set,
+                        VARSERVER_HANDLE hVarServer,
+                        VARSERVER_HANDLE hLocal,
+                        FetchLocalFn isLocal,
+                        FetchEntry *entries,
+                        size_t n );
+static void fetch_one( const LuaVarsBackend *backend,
+                       VARSERVER_HANDLE hVarServer,
+                       FetchLocalFn isLocal,
+                       bool set,
+                       FetchEntry *pEntry,
+                       char *buf );
+static int fetch_get( const LuaVarsBackend *backend,
+                      VARSERVER_HANDLE hVarServer,
+                      FetchEntry *pEntry,
+                      char *buf );
+static int fetch_set( const LuaVarsBackend *backend,
+                      VARSERVER_HANDLE hVarServer,
+                      FetchEntry *pEntry );
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  FETCH_Create                                                              */
+/*!
+    Create a pool of fetch threads
+
+    Each thread opens its own connection to the current backend.  The
+    threads are started with the notification signals blocked.
+
+    @param[in]
+        workers
+            number of threads
+
+    @param[out]
+        ppFetch
+            the new pool is returned here, to be released with
+            FETCH_Free()
+
+    @retval EOK the pool was created
+    @retval EINVAL invalid number of threads
+    @retval ENOMEM out of memory
+    @retval ENOTCONN a connection could not be opened
+    @retval other error from pthread_create()
+
+==============================================================================*/
+int FETCH_Create( int workers, Fetch **ppFetch )
+{
+    int result = EINVAL;
+    Fetch *pFetch = NULL;
+    FetchWorker *pWorker;
+    sigset_t oldmask;
+    int i;
+
+    if( ( ppFetch != NULL ) &&
+        ( workers > 0 ) &&
+        ( workers <= FETCH_MAX_WORKERS ) )
+    {
+        result = ENOMEM;
+        pFetch = calloc( 1, sizeof( Fetch ) );
+    }
+
+    if( pFetch != NULL )
+    {
+        pFetch->backend = BACKEND_Current();
+        pthread_mutex_init( &pFetch->lock, NULL );
+        pthread_cond_init( &pFetch->start, NULL );
+        pthread_cond_init( &pFetch->done, NULL );
+
+        pFetch->workers = calloc( workers, sizeof( FetchWorker ) );
+        if( pFetch->workers != NULL )
+        {
+            result = EOK;
+        }
+    }
+
+    if( result == EOK )
+    {
+        BACKEND_BlockSignals( &oldmask );
+
+        for( i = 0; i < workers; i++ )
+        {
+            pWorker = &pFetch->workers[i];
+            pWorker->pFetch = pFetch;
+            pWorker->hVarServer = pFetch->backend->open( pFetch->backend );
+            if( pWorker->hVarServer == NULL )
+            {
+                result = ENOTCONN;
+                break;
+            }
+
+            result = pthread_create( &pWorker->thread,
+                                     NULL,
+                                     fetch_thread,
+                                     pWorker );
+            if( result != EOK )
+            {
+                (void)pFetch->backend->close( pWorker->hVarServer );
+                break;
+            }
+
+            pFetch->numWorkers++;
+        }
+
+        pthread_sigmask( SIG_SETMASK, &oldmask, NULL );
+    }
+
+    if( result == EOK )
+    {
+        *ppFetch = pFetch;
+    }
+    else
+    {
+        FETCH_Free( pFetch );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  FETCH_Workers                                                             */
+/*!
+    Get the number of threads in a fetch pool
+
+    @param[in]
+        pFetch
+            pointer to the pool, or NULL
+
+    @return the number of threads, 0 if there is no pool
+
+==============================================================================*/
+int FETCH_Workers( Fetch *pFetch )
+{
+    return ( pFetch != NULL ) ? pFetch->numWorkers : 0;
+}
+
+/*============================================================================*/
+/*  FETCH_Get                                                                 */
+/*!
+    Fetch a batch of variables
+
+    Entries without a handle are resolved by name.  Without a pool,
+    the batch is fetched by the calling thread on hVarServer, otherwise
+    by the pool threads.  The entries selected by isLocal are fetched
+    afterwards by the calling thread on hLocal.
+
+    The result of each entry is set.  String and blob values are
+    allocated, and are released with FETCH_Release().
+
+    @param[in]
+        pFetch
+            pointer to the pool, or NULL to fetch in the calling thread
+
+    @param[in]
+        hVarServer
+            connection of the calling thread
+
+    @param[in]
+        hLocal
+            connection for the entries selected by isLocal
+
+    @param[in]
+        isLocal
+            selects the entries to fetch on hLocal, or NULL
+
+    @param[in,out]
+        entries
+            the batch of variables to fetch
+
+    @param[in]
+        n
+            number of entries in the batch
+
+    @retval EOK the batch was fetched
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int FETCH_Get( Fetch *pFetch,
+               VARSERVER_HANDLE hVarServer,
+               VARSERVER_HANDLE hLocal,
+               FetchLocalFn isLocal,
+               FetchEntry *entries,
+               size_t n )
+{
+    return fetch_batch( pFetch,
+                        false,
+                        hVarServer,
+                        hLocal,
+                        isLocal,
+                        entries,
+                        n );
+}
+
+/*============================================================================*/
+/*  FETCH_Set                                                                 */
+/*!
+    Set a batch of variables
+
+    Entries without a handle are resolved by name.  Each entry with a
+    string value is converted to the type of its variable, otherwise
+    its typed value is set as it is.  The batch is divided between the
+    calling thread and the pool as for FETCH_Get().
+
+    The result of each entry is set.
+
+    @param[in]
+        pFetch
+            pointer to the pool, or NULL to set in the calling thread
+
+    @param[in]
+        hVarServer
+            connection of the calling thread
+
+    @param[in]
+        hLocal
+            connection for the entries selected by isLocal
+
+    @param[in]
+        isLocal
+            selects the entries to set on hLocal, or NULL
+
+    @param[in,out]
+        entries
+            the batch of variables to set
+
+    @param[in]
+        n
+            number of entries in the batch
+
+    @retval EOK the batch was set
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int FETCH_Set( Fetch *pFetch,
+               VARSERVER_HANDLE hVarServer,
+               VARSERVER_HANDLE hLocal,
+               FetchLocalFn isLocal,
+               FetchEntry *entries,
+               size_t n )
+{
+    return fetch_batch( pFetch,
+                        true,
+                        hVarServer,
+                        hLocal,
+                        isLocal,
+                        entries,
+                        n );
+}
+
+/*============================================================================*/
+/*  FETCH_Release                                                             */
+/*!
+    Release the string values of a batch fetched with FETCH_Get()
+
+    @param[in]
+        entries
+            the batch of variables passed to FETCH_Get()
+
+    @param[in]
+        n
+            number of entries in the batch
+
+==============================================================================*/
+void FETCH_Release( FetchEntry *entries, size_t n )
+{
+    size_t i;
+
+    for( i = 0; ( entries != NULL ) && ( i < n ); i++ )
+    {
+        if( ( entries[i].result == EOK ) &&
+            ( ( entries[i].obj.type == VARTYPE_STR ) ||
+              ( entries[i].obj.type == VARTYPE_BLOB ) ) )
+        {
+            free( entries[i].obj.val.str );
+            entries[i].obj.val.str = NULL;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  FETCH_Free                                                                */
+/*!
+    Stop and release a pool of fetch threads
+
+    @param[in]
+        pFetch
+            pointer to the pool
+
+==============================================================================*/
+void FETCH_Free( Fetch *pFetch )
+{
+    int i;
+
+    if( pFetch != NULL )
+    {
+        pthread_mutex_lock( &pFetch->lock );
+        pFetch->stop = true;
+        pthread_cond_broadcast( &pFetch->start );
+        pthread_mutex_unlock( &pFetch->lock );
+
+        for( i = 0; i < pFetch->numWorkers; i++ )
+        {
+            pthread_join( pFetch->workers[i].thread, NULL );
+            (void)pFetch->backend->close( pFetch->workers[i].hVarServer );
+        }
+
+        pthread_cond_destroy( &pFetch->done );
+        pthread_cond_destroy( &pFetch->start );
+        pthread_mutex_destroy( &pFetch->lock );
+        free( pFetch->workers );
+        free( pFetch );
+    }
+}
+
+/*============================================================================*/
+/*  fetch_batch                                                               */
+/*!
+    Get or set a batch of variables for FETCH_Get() and FETCH_Set()
+
+    @param[in]
+        pFetch
+            pointer to the pool, or NULL to use the calling thread
+
+    @param[in]
+        set
+            true to set the variables, false to get them
+
+    @param[in]
+        hVarServer
+            connection of the calling thread
+
+    @param[in]
+        hLocal
+            connection for the entries selected by isLocal
+
+    @param[in]
+        isLocal
+            selects the entries to handle on hLocal, or NULL
+
+    @param[in,out]
+        entries
+            the batch of variables
+
+    @param[in]
+        n
+            number of entries in the batch
+
+    @retval EOK the batch was completed
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+static int fetch_batch( Fetch *pFetch,
+                        bool set,
+                        VARSERVER_HANDLE hVarServer,
+                        VARSERVER_HANDLE hLocal,
+                        FetchLocalFn isLocal,
+                        FetchEntry *entries,
+                        size_t n )
+{
+    const LuaVarsBackend *backend = BACKEND_Current();
+    int result = EINVAL;
+    char buf[BUFSIZ];
+    size_t i;
+
+    if( ( entries != NULL ) || ( n == 0 ) )
+    {
+        result = EOK;
+    }
+
+    for( i = 0; ( result == EOK ) && ( i < n ); i++ )
+    {
+        entries[i].result = EINPROGRESS;
+        entries[i].local = false;
+    }
+
+    if( ( result == EOK ) && ( pFetch == NULL ) )
+    {
+        for( i = 0; i < n; i++ )
+        {
+            fetch_one( backend, hVarServer, isLocal, set, &entries[i], buf );
+        }
+    }
+    else if( ( result == EOK ) && ( n > 0 ) )
+    {
+        pthread_mutex_lock( &pFetch->lock );
+
+        pFetch->entries = entries;
+        pFetch->n = n;
+        pFetch->next = 0;
+        pFetch->isLocal = isLocal;
+        pFetch->set = set;
+        pFetch->busy = pFetch->numWorkers;
+        pFetch->generation++;
+        pthread_cond_broadcast( &pFetch->start );
+
+        while( pFetch->busy > 0 )
+        {
+            pthread_cond_wait( &pFetch->done, &pFetch->lock );
+        }
+
+        pFetch->entries = NULL;
+        pFetch->n = 0;
+
+        pthread_mutex_unlock( &pFetch->lock );
+    }
+
+    for( i = 0; ( result == EOK ) && ( i < n ); i++ )
+    {
+        if( entries[i].local == true )
+        {
+            fetch_one( backend, hLocal, NULL, set, &entries[i], buf );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  fetch_thread                                                              */
+/*!
+    Fetch thread main function
+
+    @param[in]
+        arg
+            pointer to the FetchWorker
+
+    @return always returns NULL
+
+==============================================================================*/
+static void *fetch_thread( void *arg )
+{
+    FetchWorker *pWorker = (FetchWorker *)arg;
+    Fetch *pFetch = pWorker->pFetch;
+    uint64_t generation = 0;
+    size_t first;
+    size_t last;
+    size_t i;
+
+    pthread_mutex_lock( &pFetch->lock );
+
+    while( pFetch->stop == false )
+    {
+        if( pFetch->generation == generation )
+        {
+            pthread_cond_wait( &pFetch->start, &pFetch->lock );
+            continue;
+        }
+
+        generation = pFetch->generation;
+        pthread_mutex_unlock( &pFetch->lock );
+
+        while( ( first = __atomic_fetch_add( &pFetch->next,
+                                             FETCH_CHUNK,
+                                             __ATOMIC_RELAXED ) ) < pFetch->n )
+        {
+            last = first + FETCH_CHUNK;
+            if( last > pFetch->n )
+            {
+                last = pFetch->n;
+            }
+
+            for( i = first; i < last; i++ )
+            {
+                fetch_one( pFetch->backend,
+                           pWorker->hVarServer,
+                           pFetch->isLocal,
+                           pFetch->set,
+                           &pFetch->entries[i],
+                           pWorker->buf );
+            }
+        }
+
+        pthread_mutex_lock( &pFetch->lock );
+        if( --pFetch->busy == 0 )
+        {
+            pthread_cond_signal( &pFetch->done );
+        }
+    }
+
+    pthread_mutex_unlock( &pFetch->lock );
+
+    return NULL;
+}
+
+/*============================================================================*/
+/*  fetch_one                                                                 */
+/*!
+    Get or set one variable of a batch
+
+    @param[in]
+        backend
+            variable server backend
+
+    @param[in]
+        hVarServer
+            connection of the calling thread
+
+    @param[in]
+        isLocal
+            selects entries to leave for the calling thread, or NULL
+
+    @param[in]
+        set
+            true to set the variable, false to get it
+
+    @param[in,out]
+        pEntry
+            the entry to get or set
+
+    @param[in]
+        buf
+            BUFSIZ string buffer for the variable server
+
+==============================================================================*/
+static void fetch_one( const LuaVarsBackend *backend,
+                       VARSERVER_HANDLE hVarServer,
+                       FetchLocalFn isLocal,
+                       bool set,
+                       FetchEntry *pEntry,
+                       char *buf )
+{
+    if( ( pEntry->hVar == VAR_INVALID ) && ( pEntry->name != NULL ) )
+    {
+        pEntry->hVar = backend->find( hVarServer, (char *)pEntry->name );
+    }
+
+    if( pEntry->hVar == VAR_INVALID )
+    {
+        pEntry->result = ENOENT;
+    }
+    else if( ( isLocal != NULL ) && ( isLocal( pEntry->hVar ) == true ) )
+    {
+        pEntry->local = true;
+    }
+    else if( set == true )
+    {
+        pEntry->result = fetch_set( backend, hVarServer, pEntry );
+    }
+    else
+    {
+        pEntry->result = fetch_get( backend, hVarServer, pEntry, buf );
+    }
+}
+
+/*============================================================================*/
+/*  fetch_get                                                                 */
+/*!
+    Get one variable of a batch
+
+    @param[in]
+        backend
+            variable server backend
+
+    @param[in]
+        hVarServer
+            connection of the calling thread
+
+    @param[in,out]
+        pEntry
+            the entry to get, with its handle resolved
+
+    @param[in]
+        buf
+            BUFSIZ string buffer for the variable server
+
+    @retval EOK the value was fetched
+    @retval ENOMEM out of memory for a string or blob value
+    @retval other error from the variable server
+
+==============================================================================*/
+static int fetch_get( const LuaVarsBackend *backend,
+                      VARSERVER_HANDLE hVarServer,
+                      FetchEntry *pEntry,
+                      char *buf )
+{
+    int result;
+    size_t len = 0;
+    char *p;
+
+    memset( &pEntry->obj, 0, sizeof( VarObject ) );
+    pEntry->obj.val.str = buf;
+    pEntry->obj.len = BUFSIZ;
+
+    result = backend->get( hVarServer, pEntry->hVar, &pEntry->obj );
+    if( result == E2BIG )
+    {
+        /* values larger than BUFSIZ are read into their own buffer */
+        result = backend->getLength( hVarServer, pEntry->hVar, &len );
+        p = ( result == EOK ) ? malloc( len + 1 ) : NULL;
+        if( p != NULL )
+        {
+            pEntry->obj.val.str = p;
+            pEntry->obj.len = len + 1;
+            result = backend->get( hVarServer, pEntry->hVar, &pEntry->obj );
+            if( result != EOK )
+            {
+                free( p );
+            }
+        }
+        else if( result == EOK )
+        {
+            result = ENOMEM;
+        }
+    }
+    else if( ( result == EOK ) && ( pEntry->obj.type == VARTYPE_STR ) )
+    {
+        pEntry->obj.val.str = strdup( buf );
+        result = ( pEntry->obj.val.str != NULL ) ? EOK : ENOMEM;
+    }
+    else if( ( result == EOK ) && ( pEntry->obj.type == VARTYPE_BLOB ) )
+    {
+        p = malloc( pEntry->obj.len + 1 );
+        if( p != NULL )
+        {
+            memcpy( p, buf, pEntry->obj.len );
+        }
+
+        pEntry->obj.val.blob = p;
+        result = ( p != NULL ) ? EOK : ENOMEM;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  fetch_set                                                                 */
+/*!
+    Set one variable of a batch
+
+    @param[in]
+        backend
+            variable server backend
+
+    @param[in]
+        hVarServer
+            connection of the calling thread
+
+    @param[in,out]
+        pEntry
+            the entry to set, with its handle resolved.  The type of
+            the variable is stored with a string value.
+
+    @retval EOK the value was set
+    @retval other error from the variable server
+
+==============================================================================*/
+static int fetch_set( const LuaVarsBackend *backend,
+                      VARSERVER_HANDLE hVarServer,
+                      FetchEntry *pEntry )
+{
+    VarType type;
+    int result;
+
+    if( pEntry->value != NULL )
+    {
+        /* string values are converted by the variable server */
+        result = METACACHE_GetType( backend,
+                                    hVarServer,
+                                    pEntry->hVar,
+                                    &type );
+        if( result == EOK )
+        {
+            pEntry->obj.type = type;
+            result = backend->setStr( hVarServer,
+                                      pEntry->hVar,
+                                      type,
+                                      (char *)pEntry->value );
+        }
+    }
+    else
+    {
+        result = backend->set( hVarServer, pEntry->hVar, &pEntry->obj );
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of libluavars group */
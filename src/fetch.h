@@ -0,0 +1,101 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef FETCH_H
+#define FETCH_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <varserver/varserver.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! maximum number of fetch threads */
+#define FETCH_MAX_WORKERS       ( 64 )
+
+/*! number of entries claimed by a fetch thread at a time */
+#define FETCH_CHUNK             ( 8 )
+
+/*==============================================================================
+        Public types
+==============================================================================*/
+
+/*! one variable of a batched fetch */
+typedef struct _FetchEntry
+{
+    /*! name of the variable, or NULL if the handle is given */
+    const char *name;
+
+    /*! handle of the variable, resolved from the name if not given */
+    VAR_HANDLE hVar;
+
+    /*! result of the fetch, EOK on success */
+    int result;
+
+    /*! set if the variable must be fetched on the caller's connection */
+    bool local;
+
+    /*! value of the variable, strings and blobs are allocated by a get */
+    VarObject obj;
+
+    /*! string value to set, converted to the variable's type, or
+        NULL to set obj */
+    const char *value;
+} FetchEntry;
+
+/*! returns true for variables which must be accessed on the caller's
+    connection, such as those this process services calc requests for */
+typedef bool (*FetchLocalFn)( VAR_HANDLE hVar );
+
+/*! pool of fetch threads */
+typedef struct _Fetch Fetch;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int FETCH_Create( int workers, Fetch **ppFetch );
+int FETCH_Workers( Fetch *pFetch );
+int FETCH_Get( Fetch *pFetch,
+               VARSERVER_HANDLE hVarServer,
+               VARSERVER_HANDLE hLocal,
+               FetchLocalFn isLocal,
+               FetchEntry *entries,
+               size_t n );
+int FETCH_Set( Fetch *pFetch,
+               VARSERVER_HANDLE hVarServer,
+               VARSERVER_HANDLE hLocal,
+               FetchLocalFn isLocal,
+               FetchEntry *entries,
+               size_t n );
+void FETCH_Release( FetchEntry *entries, size_t n );
+void FETCH_Free( Fetch *pFetch );
+
+#endif
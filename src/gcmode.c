@@ -0,0 +1,489 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file gcmode.c
+
+    Garbage collection dispatch control
+
+    In the default (auto) mode the Lua collector runs whenever Lua
+    allocates memory, which may be inside a validate or calc handler
+    while a client is blocked waiting for it.
+
+    In the idle mode the collector is stopped, and var.wait() performs
+    collection steps before it blocks, for as long as no notification
+    is pending.  A collection cycle is started once the heap has grown
+    by the pause percentage since the last one completed.  If events
+    arrive so quickly that the heap reaches twice that size, one step
+    is taken at every var.wait() even if an event is pending, so the
+    heap stays bounded.  Either way the collector does not run inside
+    handlers.
+
+    The bytes freed and the collection cycles completed inside and
+    outside of handlers are counted in both modes so the effect of
+    the idle mode can be compared.  Cycles are counted with a sentinel
+    object whose finalizer runs once per cycle and creates its own
+    replacement.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+#include <lauxlib.h>
+#include "stats.h"
+#include "alloc.h"
+#include "gcmode.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! name of the cycle sentinel metatable */
+#define GCMODE_SENTINEL         "LuaVarsGcSentinel"
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! garbage collection accounting */
+typedef struct _GcModeStats
+{
+    /*! bytes freed while handlers were running */
+    uint64_t handlerFreed;
+
+    /*! bytes freed by idle collection steps */
+    uint64_t idleFreed;
+
+    /*! collection cycles completed while handlers were running */
+    uint64_t handlerCycles;
+
+    /*! collection cycles completed inside var.wait() */
+    uint64_t idleCycles;
+
+    /*! number of idle collection steps */
+    uint64_t idleSteps;
+
+    /*! number of steps taken while an event was pending */
+    uint64_t forcedSteps;
+
+    /*! time spent in idle collection steps in nanoseconds */
+    uint64_t idleNs;
+} GcModeStats;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static void new_sentinel( lua_State *L );
+static int sentinel_gc( lua_State *L );
+static void idle_collect( lua_State *L, const sigset_t *mask );
+static bool event_pending( const sigset_t *mask );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! current configuration */
+static GcModeConfig config = { GCMODE_AUTO, false, GCMODE_DEFAULT_PAUSE, 0 };
+
+/*! garbage collection accounting */
+static GcModeStats stats;
+
+/*! set while a handler is running, i.e. outside of var.wait() */
+static bool inHandler = true;
+
+/*! freed byte counter at the last transition in or out of var.wait() */
+static uint64_t freedMark;
+
+/*! set while an idle collection cycle is in progress */
+static bool inCycle = false;
+
+/*! heap size in KB when the last idle collection completed */
+static int baseKB;
+
+/*! names of the dispatch modes */
+static const char *modeNames[] = {
+    "auto",
+    "idle"
+};
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  GCMODE_Install                                                            */
+/*!
+    Start counting collection cycles in a Lua state
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @retval EOK cycle counting was started
+    @retval EALREADY cycles are already counted in this state
+    @retval EINVAL invalid lua state
+
+==============================================================================*/
+int GCMODE_Install( lua_State *L )
+{
+    int result = EINVAL;
+
+    if( L != NULL )
+    {
+        if( luaL_newmetatable( L, GCMODE_SENTINEL ) != 0 )
+        {
+            lua_pushcfunction( L, sentinel_gc );
+            lua_setfield( L, -2, "__gc" );
+            lua_pop( L, 1 );
+
+            freedMark = ALLOC_Freed();
+            new_sentinel( L );
+            result = EOK;
+        }
+        else
+        {
+            lua_pop( L, 1 );
+            result = EALREADY;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GCMODE_Set                                                                */
+/*!
+    Select the garbage collection dispatch mode
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        pConfig
+            pointer to the new configuration
+
+    @retval EOK the mode was selected
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int GCMODE_Set( lua_State *L, const GcModeConfig *pConfig )
+{
+    int result = EINVAL;
+
+    if( ( L != NULL ) &&
+        ( pConfig != NULL ) &&
+        ( ( pConfig->mode == GCMODE_AUTO ) ||
+          ( pConfig->mode == GCMODE_IDLE ) ) &&
+        ( pConfig->pause > 0 ) &&
+        ( pConfig->stepKB >= 0 ) )
+    {
+        config = *pConfig;
+
+        if( config.generational == true )
+        {
+            (void)lua_gc( L, LUA_GCGEN, 0, 0 );
+        }
+        else
+        {
+            (void)lua_gc( L, LUA_GCINC, 0, 0, 0 );
+        }
+
+        if( config.mode == GCMODE_IDLE )
+        {
+            lua_gc( L, LUA_GCSTOP );
+            baseKB = lua_gc( L, LUA_GCCOUNT );
+            inCycle = false;
+        }
+        else
+        {
+            lua_gc( L, LUA_GCRESTART );
+        }
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  GCMODE_Wait                                                               */
+/*!
+    Mark the end of a handler and collect garbage while idle
+
+    Called by var.wait() before it blocks.  The bytes freed since
+    var.wait() last returned are attributed to the handler, then in
+    the idle mode collection steps are taken until the cycle completes
+    or a notification is pending.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        mask
+            the notification signals waited for by var.wait()
+
+==============================================================================*/
+void GCMODE_Wait( lua_State *L, const sigset_t *mask )
+{
+    uint64_t freed;
+
+    freed = ALLOC_Freed();
+    stats.handlerFreed += freed - freedMark;
+    inHandler = false;
+
+    if( config.mode == GCMODE_IDLE )
+    {
+        idle_collect( L, mask );
+    }
+
+    freedMark = ALLOC_Freed();
+    stats.idleFreed += freedMark - freed;
+    inHandler = true;
+}
+
+/*============================================================================*/
+/*  GCMODE_Print                                                              */
+/*!
+    Render the garbage collection accounting as text
+
+    @param[in]
+        fp
+            output stream
+
+==============================================================================*/
+void GCMODE_Print( FILE *fp )
+{
+    fprintf( fp, "gc (%s%s):\n",
+             modeNames[config.mode],
+             ( config.generational == true ) ? ", generational" : "" );
+    fprintf( fp, "  %-20s freed=%llu cycles=%llu\n",
+             "handlers",
+             (unsigned long long)stats.handlerFreed,
+             (unsigned long long)stats.handlerCycles );
+    fprintf( fp, "  %-20s freed=%llu cycles=%llu steps=%llu forced=%llu "
+                 "time=%llu\n",
+             "idle",
+             (unsigned long long)stats.idleFreed,
+             (unsigned long long)stats.idleCycles,
+             (unsigned long long)stats.idleSteps,
+             (unsigned long long)stats.forcedSteps,
+             (unsigned long long)stats.idleNs );
+}
+
+/*============================================================================*/
+/*  GCMODE_PushTable                                                          */
+/*!
+    Push the garbage collection accounting onto the Lua stack
+
+    The table contains the mode, and handler and idle tables with the
+    bytes freed and cycles completed.  The idle table also contains
+    the number of steps, the number of forced steps and the time spent
+    collecting in nanoseconds.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+==============================================================================*/
+void GCMODE_PushTable( lua_State *L )
+{
+    lua_newtable( L );
+
+    lua_pushstring( L, modeNames[config.mode] );
+    lua_setfield( L, -2, "mode" );
+
+    lua_pushboolean( L, config.generational );
+    lua_setfield( L, -2, "generational" );
+
+    lua_newtable( L );
+    lua_pushinteger( L, (lua_Integer)stats.handlerFreed );
+    lua_setfield( L, -2, "freed" );
+    lua_pushinteger( L, (lua_Integer)stats.handlerCycles );
+    lua_setfield( L, -2, "cycles" );
+    lua_setfield( L, -2, "handlers" );
+
+    lua_newtable( L );
+    lua_pushinteger( L, (lua_Integer)stats.idleFreed );
+    lua_setfield( L, -2, "freed" );
+    lua_pushinteger( L, (lua_Integer)stats.idleCycles );
+    lua_setfield( L, -2, "cycles" );
+    lua_pushinteger( L, (lua_Integer)stats.idleSteps );
+    lua_setfield( L, -2, "steps" );
+    lua_pushinteger( L, (lua_Integer)stats.forcedSteps );
+    lua_setfield( L, -2, "forced" );
+    lua_pushinteger( L, (lua_Integer)stats.idleNs );
+    lua_setfield( L, -2, "time" );
+    lua_setfield( L, -2, "idle" );
+}
+
+/*============================================================================*/
+/*  idle_collect                                                              */
+/*!
+    Take collection steps until the cycle completes or an event arrives
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        mask
+            the notification signals waited for by var.wait()
+
+==============================================================================*/
+static void idle_collect( lua_State *L, const sigset_t *mask )
+{
+    int kb;
+    int threshold;
+    bool force;
+    bool done;
+    uint64_t t0;
+
+    kb = lua_gc( L, LUA_GCCOUNT );
+    threshold = (int)( (int64_t)baseKB * config.pause / 100 );
+    force = ( kb >= 2 * threshold );
+
+    if( kb >= threshold )
+    {
+        inCycle = true;
+    }
+
+    while( ( inCycle == true ) &&
+           ( ( force == true ) || ( event_pending( mask ) == false ) ) )
+    {
+        if( force == true )
+        {
+            stats.forcedSteps++;
+            force = false;
+        }
+
+        t0 = STATS_Now();
+        done = ( lua_gc( L, LUA_GCSTEP, config.stepKB ) != 0 );
+        stats.idleNs += STATS_Now() - t0;
+        stats.idleSteps++;
+
+        /* a generational step is a complete young collection */
+        if( ( done == true ) || ( config.generational == true ) )
+        {
+            inCycle = false;
+            baseKB = lua_gc( L, LUA_GCCOUNT );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  event_pending                                                             */
+/*!
+    Check if a notification is pending
+
+    @param[in]
+        mask
+            the notification signals waited for by var.wait()
+
+    @retval true a notification is pending
+    @retval false no notification is pending
+
+==============================================================================*/
+static bool event_pending( const sigset_t *mask )
+{
+    sigset_t pending;
+    bool result = false;
+    int sig;
+
+    if( sigpending( &pending ) == 0 )
+    {
+        for( sig = SIGRTMIN; ( sig <= SIGRTMAX ) && ( result == false ); sig++ )
+        {
+            result = ( sigismember( mask, sig ) == 1 ) &&
+                     ( sigismember( &pending, sig ) == 1 );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  new_sentinel                                                              */
+/*!
+    Create an unreferenced object which is finalized by the next cycle
+
+    @param[in]
+        L
+            pointer to the lua state
+
+==============================================================================*/
+static void new_sentinel( lua_State *L )
+{
+    (void)lua_newuserdata( L, 1 );
+    luaL_setmetatable( L, GCMODE_SENTINEL );
+    lua_pop( L, 1 );
+}
+
+/*============================================================================*/
+/*  sentinel_gc                                                               */
+/*!
+    Count a completed collection cycle
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int sentinel_gc( lua_State *L )
+{
+    if( inHandler == true )
+    {
+        stats.handlerCycles++;
+    }
+    else
+    {
+        stats.idleCycles++;
+    }
+
+    new_sentinel( L );
+
+    return 0;
+}
+
+/*! @}
+ * end of libluavars group */
@@ -0,0 +1,85 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef GCMODE_H
+#define GCMODE_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <lua.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! default heap growth in percent which starts an idle collection */
+#define GCMODE_DEFAULT_PAUSE    ( 200 )
+
+/*==============================================================================
+        Public types
+==============================================================================*/
+
+/*! garbage collection dispatch modes */
+typedef enum _GcMode
+{
+    /*! the collector runs whenever Lua allocates */
+    GCMODE_AUTO = 0,
+
+    /*! the collector only runs between handlers */
+    GCMODE_IDLE
+} GcMode;
+
+/*! garbage collection dispatch configuration */
+typedef struct _GcModeConfig
+{
+    /*! dispatch mode */
+    GcMode mode;
+
+    /*! use the generational collector rather than the incremental one */
+    bool generational;
+
+    /*! heap growth in percent since the last collection which starts
+        a new idle collection */
+    int pause;
+
+    /*! size of each idle collection step in KB, or 0 for a basic step */
+    int stepKB;
+} GcModeConfig;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int GCMODE_Install( lua_State *L );
+int GCMODE_Set( lua_State *L, const GcModeConfig *pConfig );
+void GCMODE_Wait( lua_State *L, const sigset_t *mask );
+void GCMODE_Print( FILE *fp );
+void GCMODE_PushTable( lua_State *L );
+
+#endif
@@ -0,0 +1,458 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file handlers.c
+
+    Per variable notification handler accounting
+
+    The handlers module keeps, for every (variable handle, signal) pair
+    which has been handled, the number of invocations, the total and
+    maximum duration, a power-of-two duration histogram, and the number
+    of bytes allocated by Lua while the handler was running.
+
+    A compact histogram is used rather than the LuaVarsHist so that
+    processes serving thousands of variables stay small.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+#include <lauxlib.h>
+#include "stats.h"
+#include "handlers.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! number of power-of-two duration buckets */
+#define HANDLERS_BUCKETS        ( 64 )
+
+/*! initial number of hash table slots (must be a power of 2) */
+#define HANDLERS_INITIAL_SLOTS  ( 64 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! accounting for one (handle, signal) pair */
+typedef struct _HandlerEntry
+{
+    /*! indicates if the slot is in use */
+    bool used;
+
+    /*! signal index of the handled notification */
+    int sigIdx;
+
+    /*! handle of the variable serviced by the handler */
+    VAR_HANDLE hVar;
+
+    /*! number of invocations */
+    uint64_t count;
+
+    /*! total duration in nanoseconds */
+    uint64_t total;
+
+    /*! longest duration in nanoseconds */
+    uint64_t max;
+
+    /*! total bytes allocated by Lua during the handler */
+    uint64_t bytes;
+
+    /*! invocation counts by floor(log2(duration)) */
+    uint32_t buckets[HANDLERS_BUCKETS];
+} HandlerEntry;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static HandlerEntry *find_entry( int sigIdx, VAR_HANDLE hVar );
+static int grow_table( void );
+static uint32_t hash_key( int sigIdx, VAR_HANDLE hVar );
+static uint64_t entry_percentile( const HandlerEntry *pEntry, double p );
+static int compare_total( const void *a, const void *b );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! handler accounting hash table */
+static HandlerEntry *table = NULL;
+
+/*! number of slots in the hash table */
+static size_t tableSlots = 0;
+
+/*! number of used slots in the hash table */
+static size_t tableUsed = 0;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  HANDLERS_Record                                                           */
+/*!
+    Record a handler invocation
+
+    @param[in]
+        sigIdx
+            signal index of the handled notification
+
+    @param[in]
+        hVar
+            handle of the serviced variable, or VAR_INVALID if unknown
+
+    @param[in]
+        ns
+            handler duration in nanoseconds
+
+    @param[in]
+        bytes
+            number of bytes allocated by Lua during the handler
+
+==============================================================================*/
+void HANDLERS_Record( int sigIdx,
+                      VAR_HANDLE hVar,
+                      uint64_t ns,
+                      uint64_t bytes )
+{
+    HandlerEntry *pEntry;
+    int bucket;
+
+    pEntry = find_entry( sigIdx, hVar );
+    if( pEntry != NULL )
+    {
+        bucket = ( ns == 0 ) ? 0 : 63 - __builtin_clzll( ns );
+
+        pEntry->count++;
+        pEntry->total += ns;
+        pEntry->bytes += bytes;
+        pEntry->buckets[bucket]++;
+        if( ns > pEntry->max )
+        {
+            pEntry->max = ns;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  HANDLERS_PushTable                                                        */
+/*!
+    Push the handler accounting onto the Lua stack
+
+    The accounting is pushed as an array of tables sorted by the
+    total time spent in the handler, largest first.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        limit
+            maximum number of entries to push, or 0 for all entries
+
+==============================================================================*/
+void HANDLERS_PushTable( lua_State *L, int limit )
+{
+    HandlerEntry **sorted = NULL;
+    HandlerEntry *pEntry;
+    size_t n = 0;
+    size_t i;
+
+    if( tableUsed > 0 )
+    {
+        sorted = malloc( tableUsed * sizeof( HandlerEntry * ) );
+    }
+
+    if( sorted != NULL )
+    {
+        for( i = 0; i < tableSlots; i++ )
+        {
+            if( table[i].used )
+            {
+                sorted[n++] = &table[i];
+            }
+        }
+
+        qsort( sorted, n, sizeof( HandlerEntry * ), compare_total );
+
+        if( ( limit > 0 ) && ( (size_t)limit < n ) )
+        {
+            n = (size_t)limit;
+        }
+    }
+
+    lua_createtable( L, (int)n, 0 );
+
+    for( i = 0; i < n; i++ )
+    {
+        pEntry = sorted[i];
+
+        lua_createtable( L, 0, 10 );
+
+        lua_pushinteger( L, (lua_Integer)pEntry->hVar );
+        lua_setfield( L, -2, "handle" );
+
+        lua_pushstring( L, STATS_SignalName( pEntry->sigIdx ) );
+        lua_setfield( L, -2, "event" );
+
+        lua_pushinteger( L, (lua_Integer)pEntry->count );
+        lua_setfield( L, -2, "count" );
+
+        lua_pushinteger( L, (lua_Integer)pEntry->total );
+        lua_setfield( L, -2, "total" );
+
+        lua_pushinteger( L, (lua_Integer)( pEntry->total / pEntry->count ) );
+        lua_setfield( L, -2, "mean" );
+
+        lua_pushinteger( L, (lua_Integer)pEntry->max );
+        lua_setfield( L, -2, "max" );
+
+        lua_pushinteger( L, (lua_Integer)entry_percentile( pEntry, 0.5 ) );
+        lua_setfield( L, -2, "p50" );
+
+        lua_pushinteger( L, (lua_Integer)entry_percentile( pEntry, 0.99 ) );
+        lua_setfield( L, -2, "p99" );
+
+        lua_pushinteger( L, (lua_Integer)pEntry->bytes );
+        lua_setfield( L, -2, "alloc" );
+
+        lua_rawseti( L, -2, (lua_Integer)( i + 1 ) );
+    }
+
+    free( sorted );
+}
+
+/*============================================================================*/
+/*  HANDLERS_Reset                                                            */
+/*!
+    Discard all handler accounting
+
+==============================================================================*/
+void HANDLERS_Reset( void )
+{
+    free( table );
+    table = NULL;
+    tableSlots = 0;
+    tableUsed = 0;
+}
+
+/*============================================================================*/
+/*  find_entry                                                                */
+/*!
+    Find or create the accounting entry for a (handle, signal) pair
+
+    @param[in]
+        sigIdx
+            signal index of the handled notification
+
+    @param[in]
+        hVar
+            handle of the serviced variable
+
+    @return pointer to the entry, or NULL if out of memory
+
+==============================================================================*/
+static HandlerEntry *find_entry( int sigIdx, VAR_HANDLE hVar )
+{
+    HandlerEntry *pEntry = NULL;
+    size_t i;
+
+    if( ( ( tableUsed + 1 ) * 10 <= tableSlots * 7 ) ||
+        ( grow_table() == EOK ) )
+    {
+        i = hash_key( sigIdx, hVar ) & ( tableSlots - 1 );
+        while( ( table[i].used ) &&
+               ( ( table[i].sigIdx != sigIdx ) || ( table[i].hVar != hVar ) ) )
+        {
+            i = ( i + 1 ) & ( tableSlots - 1 );
+        }
+
+        pEntry = &table[i];
+        if( pEntry->used == false )
+        {
+            pEntry->used = true;
+            pEntry->sigIdx = sigIdx;
+            pEntry->hVar = hVar;
+            tableUsed++;
+        }
+    }
+
+    return pEntry;
+}
+
+/*============================================================================*/
+/*  grow_table                                                                */
+/*!
+    Double the size of the handler accounting hash table
+
+    @retval EOK the table was resized
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+static int grow_table( void )
+{
+    int result = ENOMEM;
+    HandlerEntry *newTable;
+    size_t newSlots;
+    size_t i;
+    size_t j;
+
+    newSlots = ( tableSlots == 0 ) ? HANDLERS_INITIAL_SLOTS : tableSlots * 2;
+    newTable = calloc( newSlots, sizeof( HandlerEntry ) );
+    if( newTable != NULL )
+    {
+        for( i = 0; i < tableSlots; i++ )
+        {
+            if( table[i].used )
+            {
+                j = hash_key( table[i].sigIdx, table[i].hVar )
+                    & ( newSlots - 1 );
+                while( newTable[j].used )
+                {
+                    j = ( j + 1 ) & ( newSlots - 1 );
+                }
+
+                newTable[j] = table[i];
+            }
+        }
+
+        free( table );
+        table = newTable;
+        tableSlots = newSlots;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  hash_key                                                                  */
+/*!
+    Hash a (handle, signal) pair
+
+    @param[in]
+        sigIdx
+            signal index
+
+    @param[in]
+        hVar
+            variable handle
+
+    @return the hash of the pair
+
+==============================================================================*/
+static uint32_t hash_key( int sigIdx, VAR_HANDLE hVar )
+{
+    uint32_t h = ( (uint32_t)hVar << 2 ) ^ (uint32_t)( sigIdx + 1 );
+
+    return h * 2654435761u;
+}
+
+/*============================================================================*/
+/*  entry_percentile                                                          */
+/*!
+    Get a duration percentile for a handler
+
+    @param[in]
+        pEntry
+            pointer to the handler entry
+
+    @param[in]
+        p
+            the percentile to get in the range 0.0 - 1.0
+
+    @return the upper bound of the power-of-two bucket containing the
+            percentile, limited to the maximum duration
+
+==============================================================================*/
+static uint64_t entry_percentile( const HandlerEntry *pEntry, double p )
+{
+    uint64_t target;
+    uint64_t sum = 0;
+    uint64_t value;
+    int i;
+
+    target = (uint64_t)( p * (double)pEntry->count );
+    if( target >= pEntry->count )
+    {
+        target = pEntry->count - 1;
+    }
+
+    for( i = 0; i < HANDLERS_BUCKETS - 1; i++ )
+    {
+        sum += pEntry->buckets[i];
+        if( sum > target )
+        {
+            break;
+        }
+    }
+
+    value = ( 2ULL << i ) - 1;
+
+    return ( value < pEntry->max ) ? value : pEntry->max;
+}
+
+/*============================================================================*/
+/*  compare_total                                                             */
+/*!
+    qsort comparison function ordering entries by decreasing total time
+
+    @param[in]
+        a
+            pointer to the first HandlerEntry pointer
+
+    @param[in]
+        b
+            pointer to the second HandlerEntry pointer
+
+    @return <0, 0 or >0 for the qsort ordering
+
+==============================================================================*/
+static int compare_total( const void *a, const void *b )
+{
+    const HandlerEntry *pA = *(const HandlerEntry * const *)a;
+    const HandlerEntry *pB = *(const HandlerEntry * const *)b;
+
+    return ( pA->total < pB->total ) - ( pA->total > pB->total );
+}
+
+/*! @}
+ * end of libluavars group */
@@ -0,0 +1,725 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file journal.c
+
+    Variable change journal
+
+    The journal keeps the most recent changes to variables seen by the
+    library in a fixed size ring, so a script can find out what changed
+    and when without keeping its own history.  The ring and a table of
+    the last value seen for each variable are allocated when the
+    journal is started, and nothing is allocated per change.
+
+    A change is journalled when the script sets a variable, or when a
+    modified notification is received.  A notification does not carry
+    the new value, so when the script next gets the variable the value
+    completes the notification's entry.  A value which the script gets
+    without a notification is journalled only if it differs from the
+    last value seen for the variable.
+
+    String values are kept up to JOURNAL_STR_LEN - 1 characters, so a
+    change beyond that length is not seen by a get.
+
+    The last value table has two slots per entry.  A handle is looked
+    up in the JOURNAL_TRACK_PROBE slots after its hash position, and
+    when those are all taken by other handles the least recently used
+    one is evicted and counted, so a script touching more variables
+    than the table holds loses old last values rather than new ones.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+#include "stats.h"
+#include "snapshot.h"
+#include "journal.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! minimum number of last value slots */
+#define JOURNAL_MIN_TRACK       ( 64 )
+
+/*! number of last value slots searched for a handle */
+#define JOURNAL_TRACK_PROBE     ( 16 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! last value seen for a variable */
+typedef struct _JournalTrack
+{
+    /*! handle of the variable, VAR_INVALID for a free slot */
+    VAR_HANDLE hVar;
+
+    /*! sequence number of an entry waiting for its new value, or 0 */
+    uint64_t pending;
+
+    /*! value of the journal's use counter when the slot was last used */
+    uint64_t used;
+
+    /*! last value seen */
+    JournalValue last;
+} JournalTrack;
+
+/*! variable change journal */
+typedef struct _Journal
+{
+    /*! number of entries in the ring */
+    size_t size;
+
+    /*! sequence number of the next entry */
+    uint64_t seq;
+
+    /*! ring of entries */
+    JournalEntry *entries;
+
+    /*! number of last value slots, a power of two */
+    size_t numTrack;
+
+    /*! last value slots, indexed by handle with linear probing */
+    JournalTrack *track;
+
+    /*! incremented each time a last value slot is used */
+    uint64_t uses;
+
+    /*! number of last value slots taken from another handle */
+    uint64_t evicted;
+} Journal;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static JournalTrack *track_find( VAR_HANDLE hVar );
+static JournalEntry *journal_add( JournalSource source,
+                                  VAR_HANDLE hVar,
+                                  const JournalValue *pFrom );
+static JournalEntry *journal_entry( uint64_t seq );
+static void set_value( JournalValue *pValue, const VarObject *obj );
+static bool same_value( const JournalValue *a, const JournalValue *b );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! the journal, NULL when it is not started */
+static Journal *pJournal = NULL;
+
+/*! names of the journal sources */
+static const char *sourceNames[JOURNAL_SOURCE_MAX] = {
+    "set",
+    "modified",
+    "get"
+};
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  JOURNAL_Start                                                             */
+/*!
+    Start the journal
+
+    Starting the journal again discards its entries.
+
+    @param[in]
+        entries
+            number of entries kept
+
+    @retval EOK the journal was started
+    @retval EINVAL invalid number of entries
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+int JOURNAL_Start( size_t entries )
+{
+    int result = EINVAL;
+    Journal *pNew = NULL;
+    size_t numTrack = JOURNAL_MIN_TRACK;
+
+    if( ( entries > 0 ) && ( entries <= JOURNAL_MAX_ENTRIES ) )
+    {
+        result = ENOMEM;
+        pNew = calloc( 1, sizeof( Journal ) );
+    }
+
+    if( pNew != NULL )
+    {
+        /* room for a variable per entry at half occupancy */
+        while( numTrack < entries * 2 )
+        {
+            numTrack *= 2;
+        }
+
+        pNew->size = entries;
+        pNew->seq = 1;
+        pNew->numTrack = numTrack;
+        pNew->entries = calloc( entries, sizeof( JournalEntry ) );
+        pNew->track = calloc( numTrack, sizeof( JournalTrack ) );
+
+        if( ( pNew->entries != NULL ) && ( pNew->track != NULL ) )
+        {
+            JOURNAL_Stop();
+            pJournal = pNew;
+            result = EOK;
+        }
+        else
+        {
+            free( pNew->entries );
+            free( pNew->track );
+            free( pNew );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  JOURNAL_Stop                                                              */
+/*!
+    Stop the journal and discard its entries
+
+==============================================================================*/
+void JOURNAL_Stop( void )
+{
+    if( pJournal != NULL )
+    {
+        free( pJournal->entries );
+        free( pJournal->track );
+        free( pJournal );
+        pJournal = NULL;
+    }
+}
+
+/*============================================================================*/
+/*  JOURNAL_Record                                                            */
+/*!
+    Record a value seen for a variable
+
+    @param[in]
+        source
+            how the value was seen
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        obj
+            the value, or NULL if it is not known
+
+==============================================================================*/
+void JOURNAL_Record( JournalSource source,
+                     VAR_HANDLE hVar,
+                     const VarObject *obj )
+{
+    JournalTrack *pTrack;
+    JournalEntry *pEntry = NULL;
+    JournalValue value;
+
+    if( ( pJournal != NULL ) && ( hVar != VAR_INVALID ) )
+    {
+        set_value( &value, obj );
+        pTrack = track_find( hVar );
+
+        if( source == JOURNAL_SOURCE_MODIFIED )
+        {
+            pEntry = journal_add( source,
+                                  hVar,
+                                  ( pTrack != NULL ) ? &pTrack->last : NULL );
+            if( pTrack != NULL )
+            {
+                pTrack->pending = pEntry->seq;
+            }
+        }
+        else if( ( pTrack != NULL ) && ( pTrack->pending != 0 ) )
+        {
+            /* complete the notification which announced the value,
+               unless it has been overwritten */
+            pEntry = journal_entry( pTrack->pending );
+            if( ( pEntry->seq != pTrack->pending ) ||
+                ( source == JOURNAL_SOURCE_SET ) )
+            {
+                pEntry = NULL;
+            }
+
+            pTrack->pending = 0;
+        }
+
+        if( ( pEntry == NULL ) &&
+            ( ( source == JOURNAL_SOURCE_SET ) ||
+              ( ( pTrack != NULL ) &&
+                ( pTrack->last.type != VARTYPE_INVALID ) &&
+                ( same_value( &pTrack->last, &value ) == false ) ) ) )
+        {
+            pEntry = journal_add( source,
+                                  hVar,
+                                  ( pTrack != NULL ) ? &pTrack->last : NULL );
+        }
+
+        if( ( pEntry != NULL ) && ( source != JOURNAL_SOURCE_MODIFIED ) )
+        {
+            pEntry->to = value;
+        }
+
+        if( ( pTrack != NULL ) && ( value.type != VARTYPE_INVALID ) )
+        {
+            pTrack->last = value;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  JOURNAL_RecordStr                                                         */
+/*!
+    Record a value given as a string for a variable
+
+    The string is converted to the type of the variable, as the
+    variable server converts the values set with VAR_SetStr().
+
+    @param[in]
+        source
+            how the value was seen
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        type
+            type of the variable
+
+    @param[in]
+        value
+            the value as a string
+
+==============================================================================*/
+void JOURNAL_RecordStr( JournalSource source,
+                        VAR_HANDLE hVar,
+                        VarType type,
+                        const char *value )
+{
+    VarObject obj;
+    VarObject *pObj = &obj;
+
+    if( ( pJournal != NULL ) && ( value != NULL ) )
+    {
+        memset( &obj, 0, sizeof( VarObject ) );
+        obj.type = type;
+
+        switch( type )
+        {
+            case VARTYPE_STR:
+                obj.val.str = (char *)value;
+                break;
+
+            case VARTYPE_UINT16:
+                obj.val.ui = (uint16_t)strtoul( value, NULL, 0 );
+                break;
+
+            case VARTYPE_INT16:
+                obj.val.i = (int16_t)strtol( value, NULL, 0 );
+                break;
+
+            case VARTYPE_UINT32:
+                obj.val.ul = (uint32_t)strtoul( value, NULL, 0 );
+                break;
+
+            case VARTYPE_INT32:
+                obj.val.l = (int32_t)strtol( value, NULL, 0 );
+                break;
+
+            case VARTYPE_UINT64:
+                obj.val.ull = strtoull( value, NULL, 0 );
+                break;
+
+            case VARTYPE_INT64:
+                obj.val.ll = strtoll( value, NULL, 0 );
+                break;
+
+            case VARTYPE_FLOAT:
+                obj.val.f = strtof( value, NULL );
+                break;
+
+            default:
+                pObj = NULL;
+                break;
+        }
+
+        JOURNAL_Record( source, hVar, pObj );
+    }
+}
+
+/*============================================================================*/
+/*  JOURNAL_Next                                                              */
+/*!
+    Get the journal entry following a sequence number
+
+    Entries which have been overwritten are skipped.
+
+    @param[in,out]
+        pSeq
+            sequence number of the previous entry, 0 to start from the
+            oldest entry, updated to the sequence number of the entry
+            returned
+
+    @return the next entry, or NULL if there are no more entries
+
+==============================================================================*/
+const JournalEntry *JOURNAL_Next( uint64_t *pSeq )
+{
+    const JournalEntry *pEntry = NULL;
+    uint64_t seq;
+
+    if( ( pJournal != NULL ) && ( pSeq != NULL ) )
+    {
+        seq = *pSeq + 1;
+        if( pJournal->seq > pJournal->size + seq )
+        {
+            seq = pJournal->seq - pJournal->size;
+        }
+
+        if( seq < pJournal->seq )
+        {
+            pEntry = journal_entry( seq );
+            *pSeq = seq;
+        }
+    }
+
+    return pEntry;
+}
+
+/*============================================================================*/
+/*  JOURNAL_Value                                                             */
+/*!
+    Convert a journalled value to a VarObject
+
+    String values point into the journalled value.
+
+    @param[in]
+        pValue
+            pointer to the journalled value
+
+    @param[out]
+        obj
+            the value is returned here
+
+    @retval EOK the value was converted
+    @retval ENOENT the value is not known
+
+==============================================================================*/
+int JOURNAL_Value( const JournalValue *pValue, VarObject *obj )
+{
+    int result = ENOENT;
+
+    if( pValue->type == VARTYPE_STR )
+    {
+        memset( obj, 0, sizeof( VarObject ) );
+        obj->type = VARTYPE_STR;
+        obj->val.str = (char *)pValue->str;
+        obj->len = strlen( pValue->str ) + 1;
+        result = EOK;
+    }
+    else if( pValue->type != VARTYPE_INVALID )
+    {
+        result = SNAPSHOT_Unpack( pValue->type, pValue->val, obj );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  JOURNAL_SourceName                                                        */
+/*!
+    Get the name of a journal source
+
+    @param[in]
+        source
+            the journal source
+
+    @return the name of the source
+
+==============================================================================*/
+const char *JOURNAL_SourceName( JournalSource source )
+{
+    return ( source < JOURNAL_SOURCE_MAX ) ? sourceNames[source] : "unknown";
+}
+
+/*============================================================================*/
+/*  JOURNAL_Print                                                             */
+/*!
+    Render the journal counters as text
+
+    @param[in]
+        fp
+            output stream
+
+==============================================================================*/
+void JOURNAL_Print( FILE *fp )
+{
+    if( pJournal != NULL )
+    {
+        fprintf( fp,
+                 "journal: entries=%llu size=%zu evicted=%llu\n",
+                 (unsigned long long)( pJournal->seq - 1 ),
+                 pJournal->size,
+                 (unsigned long long)pJournal->evicted );
+    }
+}
+
+/*============================================================================*/
+/*  JOURNAL_PushTable                                                         */
+/*!
+    Push the journal counters onto the Lua stack as a table
+
+    @param[in]
+        L
+            pointer to the lua state
+
+==============================================================================*/
+void JOURNAL_PushTable( lua_State *L )
+{
+    lua_newtable( L );
+
+    lua_pushboolean( L, pJournal != NULL );
+    lua_setfield( L, -2, "started" );
+
+    if( pJournal != NULL )
+    {
+        lua_pushinteger( L, (lua_Integer)( pJournal->seq - 1 ) );
+        lua_setfield( L, -2, "entries" );
+
+        lua_pushinteger( L, (lua_Integer)pJournal->size );
+        lua_setfield( L, -2, "size" );
+
+        lua_pushinteger( L, (lua_Integer)pJournal->evicted );
+        lua_setfield( L, -2, "evicted" );
+    }
+}
+
+/*============================================================================*/
+/*  track_find                                                                */
+/*!
+    Find or add the last value slot of a variable
+
+    If the JOURNAL_TRACK_PROBE slots searched all belong to other
+    handles, the least recently used of them is taken over and its
+    last value is lost.
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @return the slot
+
+==============================================================================*/
+static JournalTrack *track_find( VAR_HANDLE hVar )
+{
+    JournalTrack *pTrack = NULL;
+    JournalTrack *pOldest = NULL;
+    JournalTrack *p;
+    size_t mask = pJournal->numTrack - 1;
+    size_t idx;
+    size_t i;
+
+    idx = ( (size_t)hVar * 2654435761U ) & mask;
+
+    for( i = 0; ( pTrack == NULL ) && ( i < JOURNAL_TRACK_PROBE ); i++ )
+    {
+        p = &pJournal->track[idx];
+        if( p->hVar == hVar )
+        {
+            pTrack = p;
+        }
+        else if( p->hVar == VAR_INVALID )
+        {
+            pTrack = p;
+            pTrack->hVar = hVar;
+        }
+        else if( ( pOldest == NULL ) || ( p->used < pOldest->used ) )
+        {
+            pOldest = p;
+        }
+
+        idx = ( idx + 1 ) & mask;
+    }
+
+    if( pTrack == NULL )
+    {
+        pTrack = pOldest;
+        memset( pTrack, 0, sizeof( JournalTrack ) );
+        pTrack->hVar = hVar;
+        pJournal->evicted++;
+    }
+
+    pTrack->used = ++pJournal->uses;
+
+    return pTrack;
+}
+
+/*============================================================================*/
+/*  journal_add                                                               */
+/*!
+    Add an entry to the journal ring, overwriting the oldest entry
+    when the ring is full
+
+    @param[in]
+        source
+            how the change was seen
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        pFrom
+            last value seen, or NULL if it is not known
+
+    @return the new entry, with its new value not known
+
+==============================================================================*/
+static JournalEntry *journal_add( JournalSource source,
+                                  VAR_HANDLE hVar,
+                                  const JournalValue *pFrom )
+{
+    JournalEntry *pEntry;
+
+    pEntry = journal_entry( pJournal->seq );
+    memset( pEntry, 0, sizeof( JournalEntry ) );
+
+    pEntry->seq = pJournal->seq++;
+    pEntry->ts = STATS_Now();
+    pEntry->hVar = hVar;
+    pEntry->source = source;
+    if( pFrom != NULL )
+    {
+        pEntry->from = *pFrom;
+    }
+
+    return pEntry;
+}
+
+/*============================================================================*/
+/*  journal_entry                                                             */
+/*!
+    Get the ring slot of a sequence number
+
+    @param[in]
+        seq
+            sequence number of the entry
+
+    @return the entry, which has been overwritten if its sequence number
+            differs
+
+==============================================================================*/
+static JournalEntry *journal_entry( uint64_t seq )
+{
+    return &pJournal->entries[( seq - 1 ) % pJournal->size];
+}
+
+/*============================================================================*/
+/*  set_value                                                                 */
+/*!
+    Store a value in the journal representation
+
+    @param[out]
+        pValue
+            the journalled value
+
+    @param[in]
+        obj
+            the value, or NULL if it is not known
+
+==============================================================================*/
+static void set_value( JournalValue *pValue, const VarObject *obj )
+{
+    memset( pValue, 0, sizeof( JournalValue ) );
+
+    if( obj == NULL )
+    {
+        pValue->type = VARTYPE_INVALID;
+    }
+    else if( obj->type == VARTYPE_STR )
+    {
+        pValue->type = VARTYPE_STR;
+        if( obj->val.str != NULL )
+        {
+            strncpy( pValue->str, obj->val.str, JOURNAL_STR_LEN - 1 );
+        }
+    }
+    else if( SNAPSHOT_Pack( obj, &pValue->val ) == true )
+    {
+        pValue->type = obj->type;
+    }
+}
+
+/*============================================================================*/
+/*  same_value                                                                */
+/*!
+    Compare two journalled values
+
+    @param[in]
+        a
+            first value
+
+    @param[in]
+        b
+            second value
+
+    @retval true the values have the same type and value
+    @retval false the values differ
+
+==============================================================================*/
+static bool same_value( const JournalValue *a, const JournalValue *b )
+{
+    return ( a->type == b->type ) &&
+           ( a->val == b->val ) &&
+           ( strcmp( a->str, b->str ) == 0 );
+}
+
+/*! @}
+ * end of libluavars group */
@@ -0,0 +1,125 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! default number of journal entries */
+#define JOURNAL_DEFAULT_ENTRIES ( 1024 )
+
+/*! maximum number of journal entries */
+#define JOURNAL_MAX_ENTRIES     ( 1048576 )
+
+/*! maximum length of a journalled string value including the NUL */
+#define JOURNAL_STR_LEN         ( 64 )
+
+/*==============================================================================
+        Public types
+==============================================================================*/
+
+/*! how a change was seen */
+typedef enum _JournalSource
+{
+    /*! the script set the variable */
+    JOURNAL_SOURCE_SET = 0,
+
+    /*! a modified notification was received for the variable */
+    JOURNAL_SOURCE_MODIFIED,
+
+    /*! the script got a value which differs from the last one seen */
+    JOURNAL_SOURCE_GET,
+
+    JOURNAL_SOURCE_MAX
+} JournalSource;
+
+/*! journalled value */
+typedef struct _JournalValue
+{
+    /*! type of the value, VARTYPE_INVALID if the value is not known */
+    VarType type;
+
+    /*! scalar value as stored by SNAPSHOT_Pack() */
+    uint64_t val;
+
+    /*! string value, truncated to JOURNAL_STR_LEN - 1 characters */
+    char str[JOURNAL_STR_LEN];
+} JournalValue;
+
+/*! journal entry */
+typedef struct _JournalEntry
+{
+    /*! sequence number of the entry, starting from 1 */
+    uint64_t seq;
+
+    /*! time of the change in nanoseconds from STATS_Now() */
+    uint64_t ts;
+
+    /*! handle of the variable */
+    VAR_HANDLE hVar;
+
+    /*! how the change was seen */
+    JournalSource source;
+
+    /*! last value seen before the change */
+    JournalValue from;
+
+    /*! value after the change */
+    JournalValue to;
+} JournalEntry;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int JOURNAL_Start( size_t entries );
+void JOURNAL_Stop( void );
+void JOURNAL_Record( JournalSource source,
+                     VAR_HANDLE hVar,
+                     const VarObject *obj );
+void JOURNAL_RecordStr( JournalSource source,
+                        VAR_HANDLE hVar,
+                        VarType type,
+                        const char *value );
+const JournalEntry *JOURNAL_Next( uint64_t *pSeq );
+int JOURNAL_Value( const JournalValue *pValue, VarObject *obj );
+const char *JOURNAL_SourceName( JournalSource source );
+void JOURNAL_Print( FILE *fp );
+void JOURNAL_PushTable( lua_State *L );
+
+#endif
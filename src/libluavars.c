@@ -55,10 +55,29 @@ SOFTWARE.
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <signal.h>
+#include <stdbool.h>
 #include <varserver/varserver.h>
 #include <varserver/var.h>
 #include <lua.h>
 #include <lauxlib.h>
+#include "stats.h"
+#include "probes.h"
+#include "profile.h"
+#include "alloc.h"
+#include "handlers.h"
+#include "backend.h"
+#include "eventlog.h"
+#include "loadgen.h"
+#include "realtime.h"
+#include "gcmode.h"
+#include "manifest.h"
+#include "reconnect.h"
+#include "metacache.h"
+#include "mirror.h"
+#include "fetch.h"
+#include "snapshot.h"
+#include "journal.h"
 
 /*==============================================================================
         Private definitions
@@ -68,10 +87,49 @@ SOFTWARE.
 #define lua_setConst(name) { lua_pushnumber( L, name ); \
                              lua_setglobal(L, #name ); }
 
+/*! name of the load generator userdata metatable */
+#define LUAVARS_LOADGEN         "LuaVarsLoadGen"
+
+/*! name of the watch set userdata metatable */
+#define LUAVARS_WATCHSET        "LuaVarsWatchSet"
+
+/*! name of the binding userdata metatable */
+#define LUAVARS_BINDING         "LuaVarsBinding"
+
+/*! registry key of the bindings of each variable, by handle */
+#define LUAVARS_BOUND           "LuaVarsBound"
+
+/*! registry key of the bindings with unflushed writes */
+#define LUAVARS_DIRTY           "LuaVarsDirty"
+
+/*! registry key of the failures of the writes flushed by var.wait() */
+#define LUAVARS_FLUSH_ERRORS    "LuaVarsFlushErrors"
+
+/*! name of the value buffer userdata metatable */
+#define LUAVARS_BUFFER          "LuaVarsBuffer"
+
+/*! number of notification types with registration counts */
+#define LUAVARS_NOTIFY_TYPES    ( NOTIFY_PRINT + 1 )
+
+/*! maximum number of print sessions held for the script to claim */
+#define LUAVARS_MAX_PENDING_PRINT   ( 16 )
+
+/*! seconds var.wait() waits before checking for a variable server
+    restart under the reconnect backend */
+#define LUAVARS_RESTART_CHECK_S ( 1 )
+
 /*==============================================================================
         Type Definitions
 ==============================================================================*/
 
+/*! registrations of each notification type on a variable */
+typedef struct _LuaNotifyRefs
+{
+    /*! number of registrations made by the script, watch sets,
+        bound tables and the startup manifest */
+    uint32_t count[LUAVARS_NOTIFY_TYPES];
+} LuaNotifyRefs;
+
 /*! Print Session Object */
 typedef struct _LuaPrintSession
 {
@@ -88,22 +146,209 @@ typedef struct _LuaPrintSession
     VAR_HANDLE hVar;
 } LuaPrintSession;
 
+/*! Print session opened inside var.wait() but not yet claimed by Lua */
+typedef struct _PendingPrintSession
+{
+    /*! print session identifier */
+    uint32_t id;
+
+    /*! handle to the variable to be printed */
+    VAR_HANDLE hVar;
+
+    /*! file descriptor for the print session output */
+    int fd;
+} PendingPrintSession;
+
+/*! roles of the variable server connections */
+typedef enum _LuaVarsConn
+{
+    /*! notification registrations and event handling */
+    LUAVARS_CONN_EVENT = 0,
+
+    /*! synchronous gets, sets and lookups */
+    LUAVARS_CONN_SYNC,
+
+    /*! validation responses, calc results and print sessions */
+    LUAVARS_CONN_REPLY,
+
+    LUAVARS_CONN_MAX
+} LuaVarsConn;
+
+/*! Set of notifications which are cancelled together */
+typedef struct _LuaWatchSet
+{
+    /*! type of notification registered on each variable */
+    NotificationType type;
+
+    /*! number of variables with an active notification */
+    size_t count;
+
+    /*! handles of the variables with an active notification */
+    VAR_HANDLE handles[];
+} LuaWatchSet;
+
+/*! Variable bound to a field of a Lua table */
+typedef struct _LuaBoundVar
+{
+    /*! handle of the variable */
+    VAR_HANDLE hVar;
+
+    /*! type of the variable */
+    VarType type;
+
+    /*! set when the variable was modified since it was cached */
+    bool stale;
+
+    /*! set when the field was written since the last flush */
+    bool dirty;
+} LuaBoundVar;
+
+/*! Lua table fields bound to a group of variables */
+typedef struct _LuaBinding
+{
+    /*! number of bound variables */
+    size_t count;
+
+    /*! number of bound variables with unflushed writes */
+    size_t dirty;
+
+    /*! bound variables, in field index order */
+    LuaBoundVar vars[];
+} LuaBinding;
+
+/*! Buffer holding a string or blob value */
+typedef struct _LuaBuffer
+{
+    /*! length of the value */
+    size_t len;
+
+    /*! size of the data */
+    size_t size;
+
+    /*! value, with room for a terminator after the data */
+    char data[];
+} LuaBuffer;
+
 /*==============================================================================
         Private function declarations
 ==============================================================================*/
 int luaopen_vars( lua_State *L );
 
 static int var_get( lua_State *L );
+static int var_get_many( lua_State *L );
+static int var_set_many( lua_State *L );
+static int var_snapshot( lua_State *L );
+static int var_restore( lua_State *L );
+static int var_diff( lua_State *L );
+static int var_journal_start( lua_State *L );
+static int var_journal_stop( lua_State *L );
+static int var_journal( lua_State *L );
 static int var_set( lua_State *L );
 static int global_unload(lua_State *L );
 static int var_find( lua_State *L );
+static int var_info( lua_State *L );
+static int var_name( lua_State *L );
 static int var_notify( lua_State *L );
+static int var_notify_many( lua_State *L );
+static int var_notify_prefix( lua_State *L );
+static int var_unnotify( lua_State *L );
+static int var_watch( lua_State *L );
+static int var_manifest( lua_State *L );
+static int var_reconnect( lua_State *L );
+static int var_mirror_publish( lua_State *L );
+static int var_mirror_attach( lua_State *L );
+static int var_connections( lua_State *L );
+static int watchset_cancel( lua_State *L );
+static int watchset_handles( lua_State *L );
+static int watchset_gc( lua_State *L );
+static int var_bind( lua_State *L );
+static int var_flush( lua_State *L );
+static int var_flush_errors( lua_State *L );
+static int bind_index( lua_State *L );
+static int bind_newindex( lua_State *L );
+static int binding_gc( lua_State *L );
+static int var_buffer( lua_State *L );
+static int var_get_buffer( lua_State *L );
+static int buffer_len( lua_State *L );
+static int buffer_sub( lua_State *L );
+static int buffer_tostring( lua_State *L );
 static int var_wait( lua_State *L );
 static int var_validate_start( lua_State *L );
 static int var_validate_end( lua_State *L );
 static int var_open_print_session( lua_State *L );
 static int var_close_print_session( lua_State *L );
+static int var_stats( lua_State *L );
+static int var_publish_stats( lua_State *L );
+static int var_profile_start( lua_State *L );
+static int var_profile_stop( lua_State *L );
+static int var_handler_stats( lua_State *L );
+static int var_create( lua_State *L );
+static int var_eventlog_start( lua_State *L );
+static int var_eventlog_stop( lua_State *L );
+static int var_loadgen( lua_State *L );
+static int loadgen_done( lua_State *L );
+static int loadgen_stop( lua_State *L );
+static int loadgen_gc( lua_State *L );
+static int var_realtime( lua_State *L );
+static int var_gc_mode( lua_State *L );
+static int var_alloc_pool( lua_State *L );
 static void setup_globals( lua_State *L );
+static void setup_loadgen( lua_State *L );
+static void setup_watchset( lua_State *L );
+static void setup_binding( lua_State *L );
+static void setup_buffer( lua_State *L );
+static void load_manifest( lua_State *L );
+static void manifest_resolve( lua_State *L, int idx );
+static void manifest_notify( lua_State *L,
+                             const char *name,
+                             VAR_HANDLE hVar,
+                             int failures );
+static int loadgen_handles( lua_State *L, int idx, LoadGenConfig *pConfig );
+static int loadgen_subscribe( lua_State *L,
+                              int idx,
+                              const LoadGenConfig *pConfig );
+static void loadgen_unsubscribe( lua_State *L, int idx );
+static int select_backend( lua_State *L );
+static bool service_stats( int sig, int id );
+static int open_print_session( uint32_t id, VAR_HANDLE *hVar, int *fd );
+static void hold_print_session( uint32_t id, VAR_HANDLE hVar, int fd );
+static void close_pending_sessions( size_t keep );
+static int pending_signals( const sigset_t *mask );
+static int wait_signal( const sigset_t *mask, siginfo_t *info );
+static int notify_register( VAR_HANDLE hVar, NotificationType type );
+static int notify_cancel( VAR_HANDLE hVar, NotificationType type );
+static VAR_HANDLE resolve_entry( lua_State *L, int idx );
+static size_t watchset_release( LuaWatchSet *pWatchSet );
+static void bind_registry( lua_State *L, const char *key );
+static void bind_refresh( lua_State *L,
+                          int store,
+                          int key,
+                          LuaBoundVar *pVar );
+static void bind_invalidate( lua_State *L, VAR_HANDLE hVar );
+static int bind_flush( lua_State *L, int failures, lua_Integer *pCount );
+static void bind_value( lua_State *L, int idx, VarType type, VarObject *obj );
+static VARSERVER_HANDLE conn( LuaVarsConn role, VAR_HANDLE hVar );
+static uint32_t notify_refs( VAR_HANDLE hVar,
+                            NotificationType type,
+                            int delta );
+static void conn_own( VAR_HANDLE hVar,
+                      NotificationType type,
+                      bool registered );
+static int conn_open( LuaVarsConn role, bool enable );
+static bool conn_local( VAR_HANDLE hVar );
+static int push_var( lua_State *L, const VarObject *pVar );
+static const char *type_name( VarType type );
+static LuaBuffer *new_buffer( lua_State *L, size_t size );
+static int read_buffer( VAR_HANDLE hVar, LuaBuffer *pBuffer, VarObject *obj );
+static int read_new_buffer( lua_State *L, VAR_HANDLE hVar, VarObject *obj );
+static void push_journal_entry( lua_State *L, const JournalEntry *pEntry );
+static int fetch_pool( lua_State *L, int idx );
+static void snapshot_names( lua_State *L, const char *prefix );
+static int snapshot_live( const Snapshot *pSaved, Snapshot **ppLive );
+static void diff_entry( void *arg,
+                        const char *name,
+                        const VarObject *a,
+                        const VarObject *b );
 
 /*==============================================================================
         Local/Private variables
@@ -112,21 +357,158 @@ static void setup_globals( lua_State *L );
 /*! handle to the variable server */
 static VARSERVER_HANDLE hVarServer = NULL;
 
+/*! variable server backend */
+static const LuaVarsBackend *backend = NULL;
+
+/*! additional connections by role, NULL to use hVarServer */
+static VARSERVER_HANDLE hConn[LUAVARS_CONN_MAX];
+
+/*! names of the connection roles accepted by var.connections() */
+static const char *connNames[LUAVARS_CONN_MAX] = {
+    "event",
+    "sync",
+    "reply"
+};
+
+/*! non-zero for handles with calc, validate or print notifications
+    registered by this process, indexed by handle */
+static uint8_t *owned = NULL;
+
+/*! number of entries in the owned array */
+static size_t numOwned = 0;
+
+/*! notification registration counts indexed by handle */
+static LuaNotifyRefs *notifyRefs = NULL;
+
+/*! number of entries in the notifyRefs array */
+static size_t numNotifyRefs = 0;
+
+/*! fetch threads used by var.get_many() */
+static Fetch *pFetch = NULL;
+
+/*! number of variables bound to table fields */
+static size_t numBound = 0;
+
+/*! number of bound fields with unflushed writes */
+static size_t numDirty = 0;
+
+/*! names of the variable types accepted by var.create() */
+static const char *typeNames[] = {
+    "str",
+    "uint16",
+    "int16",
+    "uint32",
+    "int32",
+    "uint64",
+    "int64",
+    "float",
+    NULL
+};
+
+/*! variable types corresponding to typeNames */
+static const VarType types[] = {
+    VARTYPE_STR,
+    VARTYPE_UINT16,
+    VARTYPE_INT16,
+    VARTYPE_UINT32,
+    VARTYPE_INT32,
+    VARTYPE_UINT64,
+    VARTYPE_INT64,
+    VARTYPE_FLOAT
+};
+
+/*! names of the garbage collection modes accepted by var.gc_mode() */
+static const char *gcModeNames[] = {
+    "auto",
+    "idle",
+    NULL
+};
+
+/*! garbage collection modes corresponding to gcModeNames */
+static const GcMode gcModes[] = {
+    GCMODE_AUTO,
+    GCMODE_IDLE
+};
+
+/*! print sessions opened while servicing the statistics variables,
+    oldest first */
+static PendingPrintSession pendingPrint[LUAVARS_MAX_PENDING_PRINT];
+
+/*! number of entries in the pendingPrint array */
+static size_t numPendingPrint = 0;
+
 /*! mapping of luavars library functions to c functions */
 static const luaL_Reg vars_lib[] = {
     { "get", var_get },
+    { "get_many", var_get_many },
+    { "set_many", var_set_many },
+    { "snapshot", var_snapshot },
+    { "restore", var_restore },
+    { "diff", var_diff },
+    { "journal_start", var_journal_start },
+    { "journal_stop", var_journal_stop },
+    { "journal", var_journal },
     { "find", var_find },
+    { "info", var_info },
+    { "name", var_name },
     { "set", var_set },
     { "notify", var_notify },
+    { "notify_many", var_notify_many },
+    { "notify_prefix", var_notify_prefix },
+    { "unnotify", var_unnotify },
+    { "watch", var_watch },
+    { "bind", var_bind },
+    { "flush", var_flush },
+    { "flush_errors", var_flush_errors },
+    { "buffer", var_buffer },
+    { "get_buffer", var_get_buffer },
+    { "manifest", var_manifest },
+    { "reconnect", var_reconnect },
+    { "mirror_publish", var_mirror_publish },
+    { "mirror_attach", var_mirror_attach },
+    { "connections", var_connections },
     { "wait", var_wait },
     { "validate_start", var_validate_start },
     { "validate_end", var_validate_end },
     { "open_print_session", var_open_print_session },
     { "close_print_session", var_close_print_session },
+    { "stats", var_stats },
+    { "publish_stats", var_publish_stats },
+    { "profile_start", var_profile_start },
+    { "profile_stop", var_profile_stop },
+    { "handler_stats", var_handler_stats },
+    { "create", var_create },
+    { "eventlog_start", var_eventlog_start },
+    { "eventlog_stop", var_eventlog_stop },
+    { "loadgen", var_loadgen },
+    { "realtime", var_realtime },
+    { "gc_mode", var_gc_mode },
+    { "alloc_pool", var_alloc_pool },
     { "__unload", global_unload },
     { NULL, NULL }
 };
 
+/*! methods of the load generator userdata */
+static const luaL_Reg loadgen_methods[] = {
+    { "done", loadgen_done },
+    { "stop", loadgen_stop },
+    { NULL, NULL }
+};
+
+/*! methods of the watch set userdata */
+static const luaL_Reg watchset_methods[] = {
+    { "cancel", watchset_cancel },
+    { "handles", watchset_handles },
+    { NULL, NULL }
+};
+
+/*! methods of the value buffer userdata */
+static const luaL_Reg buffer_methods[] = {
+    { "len", buffer_len },
+    { "sub", buffer_sub },
+    { NULL, NULL }
+};
+
 /*==============================================================================
         Function definitions
 ==============================================================================*/
@@ -161,9 +543,34 @@ static int global_unload(lua_State *L )
 {
     (void)L;
 
+    (void)EVENTLOG_Stop();
+
+    MIRROR_Close();
+
+    close_pending_sessions( 0 );
+
+    (void)conn_open( LUAVARS_CONN_SYNC, false );
+    (void)conn_open( LUAVARS_CONN_REPLY, false );
+    free( owned );
+    owned = NULL;
+    numOwned = 0;
+    free( notifyRefs );
+    notifyRefs = NULL;
+    numNotifyRefs = 0;
+
+    FETCH_Free( pFetch );
+    pFetch = NULL;
+
+    JOURNAL_Stop();
+
+    METACACHE_Clear();
+
     if( hVarServer != NULL )
     {
-        (void)VARSERVER_Close(hVarServer);
+        (void)backend->close( hVarServer );
+
+        /* watch sets collected after this have nothing to cancel */
+        hVarServer = NULL;
     }
 
     return 0;
@@ -177,6 +584,12 @@ static int global_unload(lua_State *L )
     This function is the entry point for the lua vars library which
     is invoked by the lua require('vars') statement
 
+    The variable server backend is selected by the first require,
+    from the LUAVARS_BACKEND global or environment variable.
+
+    If a startup manifest is given by the LUAVARS_MANIFEST global or
+    environment variable, its handles are returned in vars.handles.
+
     @param[in]
         L
             pointer to the lua state
@@ -186,18 +599,85 @@ static int global_unload(lua_State *L )
 ==============================================================================*/
 int luaopen_libluavars( lua_State *L )
 {
+    int result;
+
     if( L != NULL )
     {
         if( hVarServer == NULL )
         {
-            hVarServer = VARSERVER_Open();
+            /* the backend can only be chosen before the variable
+               server connection is opened */
+            result = select_backend( L );
+            if( result != EOK )
+            {
+                return luaL_error( L,
+                                   "LUAVARS_BACKEND: %s",
+                                   ( result == ENOENT ) ? "unknown backend"
+                                                        : strerror( result ) );
+            }
+
+            backend = BACKEND_Current();
+            hVarServer = backend->open( backend );
+
+            /* allow statistics publication to be enabled without
+               changes to the Lua script */
+            if( getenv( "LUAVARS_STATS" ) != NULL )
+            {
+                (void)STATS_Publish( hVarServer );
+            }
+
+            /* record the event traffic of an unmodified script */
+            if( getenv( "LUAVARS_EVENTLOG" ) != NULL )
+            {
+                (void)EVENTLOG_Start( getenv( "LUAVARS_EVENTLOG" ),
+                                      hVarServer );
+            }
+
+            /* read mirrored variables without changes to the script */
+            if( getenv( "LUAVARS_MIRROR" ) != NULL )
+            {
+                (void)MIRROR_Attach( getenv( "LUAVARS_MIRROR" ) );
+            }
+
+            /* journal the changes seen by an unmodified script */
+            if( getenv( "LUAVARS_JOURNAL" ) != NULL )
+            {
+                (void)JOURNAL_Start( strtoul( getenv( "LUAVARS_JOURNAL" ),
+                                              NULL,
+                                              0 ) );
+            }
+        }
+
+        /* account for Lua allocations made by notification handlers */
+        if( ( getenv( "LUAVARS_ALLOC" ) != NULL ) ||
+            ( getenv( "LUAVARS_POOL" ) != NULL ) )
+        {
+            (void)ALLOC_Install( L );
         }
 
+        /* count garbage collection cycles inside and outside handlers */
+        (void)GCMODE_Install( L );
+
         lua_newtable( L );
         luaL_setfuncs( L, vars_lib, 0 );
 
         /* set up the global variables */
         setup_globals( L );
+
+        /* set up the load generator object */
+        setup_loadgen( L );
+
+        /* set up the watch set object */
+        setup_watchset( L );
+
+        /* set up the bound table object */
+        setup_binding( L );
+
+        /* set up the value buffer object */
+        setup_buffer( L );
+
+        /* resolve the startup manifest into vars.handles */
+        load_manifest( L );
     }
 
     return 1;
@@ -224,6 +704,7 @@ static void setup_globals( lua_State *L )
         lua_setConst( SIG_VAR_CALC );
         lua_setConst( SIG_VAR_VALIDATE );
         lua_setConst( SIG_VAR_PRINT );
+        lua_setConst( SIG_LOADGEN_DONE );
         lua_setConst( NOTIFY_MODIFIED );
         lua_setConst( NOTIFY_CALC );
         lua_setConst( NOTIFY_VALIDATE );
@@ -232,329 +713,219 @@ static void setup_globals( lua_State *L )
 }
 
 /*============================================================================*/
-/*  var_get                                                                   */
+/*  setup_loadgen                                                             */
 /*!
-    var.get()
-
-    This var.get() function interfaces to the VAR_Get() function
-    in the libvarserver.so library
+    Set up the load generator userdata metatable
 
-    The name of the variable is passed in on the lua stack
-    and the variable value is pushed back onto the lua stack
+    The metatable is created once per Lua state.  It provides the
+    done() and stop() methods and stops the load generator when the
+    userdata is garbage collected.
 
     @param[in]
         L
             pointer to the lua state
 
-    @return always returns 0
-
 ==============================================================================*/
-static int var_get( lua_State *L )
+static void setup_loadgen( lua_State *L )
 {
-    int result = 0;
-    const char *name;
-    size_t len;
-    VAR_HANDLE hVar;
-    VarObject var;
-    char buf[BUFSIZ];
-
-    if( L != NULL )
+    if( luaL_newmetatable( L, LUAVARS_LOADGEN ) != 0 )
     {
-        memset( &var, 0, sizeof( VarObject ) );
-
-        name = luaL_checklstring( L, 1, &len );
-        if( name != NULL )
-        {
-            hVar = VAR_FindByName( hVarServer, (char *)name );
-            if( hVar != VAR_INVALID )
-            {
-                /* set up string buffer */
-                var.val.str = buf;
-                var.len = BUFSIZ;
+        luaL_newlib( L, loadgen_methods );
+        lua_setfield( L, -2, "__index" );
 
-                if( VAR_Get( hVarServer, hVar, &var ) == EOK )
-                {
-                    result = 0;
-                    switch( var.type )
-                    {
-                        case VARTYPE_STR:
-                            lua_pushstring( L, var.val.str );
-                            result = 1;
-                            break;
-
-                        case VARTYPE_UINT16:
-                            lua_pushnumber( L, var.val.ui );
-                            result = 1;
-                            break;
-
-                        case VARTYPE_UINT32:
-                            lua_pushnumber( L, var.val.ul );
-                            result = 1;
-                            break;
-
-                        case VARTYPE_FLOAT:
-                            lua_pushnumber( L, var.val.f );
-                            result = 1;
-                            break;
-
-                        default:
-                            break;
-                    }
-                }
-            }
-        }
+        lua_pushcfunction( L, loadgen_gc );
+        lua_setfield( L, -2, "__gc" );
     }
 
-    if( result == 0 )
-    {
-        lua_pushnil( L );
-    }
-    return result;
+    lua_pop( L, 1 );
 }
 
 /*============================================================================*/
-/*  var_set                                                                   */
+/*  setup_watchset                                                            */
 /*!
-    var.set()
-
-    This var.set() function interfaces to the VAR_SetStr() function
-    in the libvarserver.so library
-
-    The name of the variable is passed in on the lua stack
-    The value to be set is passed in as a string on the lua stack
-    and the result is pushed back onto the lua stack.
-    If the set fails, then nil is pusedh back onto the lua stack
+    Set up the watch set userdata metatable
 
     @param[in]
         L
             pointer to the lua state
 
-    @return always returns 0
-
 ==============================================================================*/
-static int var_set( lua_State *L )
+static void setup_watchset( lua_State *L )
 {
-    char *name;
-    char *value;
-    int result = 0;
-    size_t len;
-    VAR_HANDLE hVar = VAR_INVALID;
-    VarType type;
-    const char *argtype;
-
-    if( L != NULL )
+    if( luaL_newmetatable( L, LUAVARS_WATCHSET ) != 0 )
     {
-        /* check if a variable name was supplied */
+        luaL_newlib( L, watchset_methods );
+        lua_setfield( L, -2, "__index" );
 
-        argtype = luaL_typename( L, 1 );
+        lua_pushcfunction( L, watchset_gc );
+        lua_setfield( L, -2, "__gc" );
+    }
 
-        if( strcmp( argtype, "string") == 0 )
-        {
-            name = (char *)luaL_checklstring(L, 1, &len );
-            if( name != NULL )
-            {
-                hVar = VAR_FindByName( hVarServer, name );
-            }
-        }
-        else if( strcmp( argtype, "number" ) == 0 )
-        {
-            /* get the variable handle from the lua stack */
-            hVar = luaL_checknumber( L, 1 );
-        }
+    lua_pop( L, 1 );
+}
 
-        /* get the value from the lua stack */
-        value = (char *)luaL_checklstring( L, 2, &len );
+/*============================================================================*/
+/*  setup_binding                                                             */
+/*!
+    Set up the binding userdata metatable
 
-        if( hVar != VAR_INVALID )
-        {
-            /* get the variable type so we can convert the
-            string to a VarObject */
-            if( VAR_GetType( hVarServer, hVar, &type ) == EOK )
-            {
-                /* set the variable value from the string */
-                if( VAR_SetStr( hVarServer, hVar, type, value ) == EOK )
-                {
-                    lua_pushnumber( L, 1 );
-                    result = 1;
-                }
-                else
-                {
-                    lua_pushnil( L );
-                }
-            }
-        }
-        else
-        {
-            /* invalid variable handle */
-            lua_pushnil( L );
-        }
+    @param[in]
+        L
+            pointer to the lua state
+
+==============================================================================*/
+static void setup_binding( lua_State *L )
+{
+    if( luaL_newmetatable( L, LUAVARS_BINDING ) != 0 )
+    {
+        lua_pushcfunction( L, binding_gc );
+        lua_setfield( L, -2, "__gc" );
     }
 
-    return result;
+    lua_pop( L, 1 );
 }
 
 /*============================================================================*/
-/*  var_find                                                                  */
+/*  setup_buffer                                                              */
 /*!
-    var.find()
-
-    This var.find() function interfaces to the VAR_FindByName() function
-    in the libvarserver.so library
-
-    The name of the variable is passed in on the lua stack
-    and the variable handle is pushed back onto the lua stack.
-    If the variable is not found, then nil is pushed back onto the lua stack
+    Set up the value buffer userdata metatable
 
     @param[in]
         L
             pointer to the lua state
 
-    @return always returns 0
-
 ==============================================================================*/
-static int var_find( lua_State *L )
+static void setup_buffer( lua_State *L )
 {
-    int result = 0;
-    char *name;
-    size_t len;
-    VAR_HANDLE hVar;
-
-    if( L != NULL )
+    if( luaL_newmetatable( L, LUAVARS_BUFFER ) != 0 )
     {
-        name = (char *)luaL_checklstring( L, 1, &len );
-        if( name != NULL )
-        {
-            hVar = VAR_FindByName( hVarServer, name );
+        luaL_newlib( L, buffer_methods );
+        lua_setfield( L, -2, "__index" );
 
-            if( hVar != VAR_INVALID )
-            {
-                lua_pushnumber( L, hVar );
-                result = 1;
-            }
-        }
-    }
+        lua_pushcfunction( L, buffer_len );
+        lua_setfield( L, -2, "__len" );
 
-    if( result == 0 )
-    {
-        lua_pushnil( L );
+        lua_pushcfunction( L, buffer_tostring );
+        lua_setfield( L, -2, "__tostring" );
     }
 
-    return result;
+    lua_pop( L, 1 );
 }
 
 /*============================================================================*/
-/*  var_notify                                                                */
+/*  load_manifest                                                             */
 /*!
-    var.notify()
-
-    This var.notify() function interfaces to the VAR_Notify() function
-    in the libvarserver.so library
-
-    The variable handle to be notified on is passed in on the lua stack
-    The type of notification being requested is passed in on the lua stack
+    Resolve the startup manifest
 
+    The manifest is taken from the LUAVARS_MANIFEST Lua global, which
+    may be a manifest table or the path of a manifest file, otherwise
+    from the path in the LUAVARS_MANIFEST environment variable.  The
+    resolved handles are stored in the handles field of the library
+    table on the top of the stack and any failures in its
+    manifest_errors field.
 
     @param[in]
         L
             pointer to the lua state
 
-    @return always returns 0
-
 ==============================================================================*/
-static int var_notify( lua_State *L )
+static void load_manifest( lua_State *L )
 {
-    int result = 0;
-    char *name;
-    size_t len;
-    VAR_HANDLE hVar;
-    NotificationType notificationType;
+    int lib = lua_gettop( L );
+    const char *path = NULL;
+    int rc = EOK;
+    int type;
 
-    if( L != NULL )
+    type = lua_getglobal( L, "LUAVARS_MANIFEST" );
+    if( type == LUA_TSTRING )
     {
-        hVar = (VAR_HANDLE)luaL_checknumber( L, 1 );
-        notificationType = (NotificationType)luaL_checknumber( L, 2 );
+        path = lua_tostring( L, -1 );
+    }
+    else if( type != LUA_TTABLE )
+    {
+        path = getenv( "LUAVARS_MANIFEST" );
+    }
 
-        result = VAR_Notify( hVarServer, hVar, notificationType );
-        if( result == EOK )
+    if( path != NULL )
+    {
+        rc = MANIFEST_Load( L, path );
+        if( rc == EOK )
         {
-            lua_pushnumber( L, result );
+            lua_replace( L, lib + 1 );
         }
-        else
+    }
+
+    if( rc == EOK )
+    {
+        if( lua_type( L, lib + 1 ) == LUA_TTABLE )
         {
-            lua_pushnil( L );
+            manifest_resolve( L, lib + 1 );
+            lua_setfield( L, lib, "manifest_errors" );
+            lua_setfield( L, lib, "handles" );
         }
     }
+    else
+    {
+        lua_newtable( L );
+        lua_setfield( L, lib, "handles" );
 
-    return 1;
+        lua_newtable( L );
+        lua_pushstring( L, strerror( rc ) );
+        lua_setfield( L, -2, path );
+        lua_setfield( L, lib, "manifest_errors" );
+    }
+
+    lua_settop( L, lib );
 }
 
 /*============================================================================*/
-/*  var_wait                                                                  */
+/*  select_backend                                                            */
 /*!
-    var.wait()
+    Select the variable server backend
 
-    This var.wait() function waits for a variable notification signal
-
-    When the signal is received the signal and payload ID are pushed
-    onto the lua stack
+    The backend name is taken from the LUAVARS_BACKEND Lua global if it
+    is set, otherwise from the LUAVARS_BACKEND environment variable.
+    If neither is set the varserver daemon is used.
 
     @param[in]
         L
             pointer to the lua state
 
-    @return always returns 0
+    @retval EOK the backend was selected
+    @retval other error from BACKEND_Select()
 
 ==============================================================================*/
-static int var_wait( lua_State *L )
+static int select_backend( lua_State *L )
 {
-    int result = 0;
-    sigset_t mask;
-    siginfo_t info;
-    int sig;
+    int result;
 
-    if( L != NULL )
+    if( lua_getglobal( L, "LUAVARS_BACKEND" ) == LUA_TSTRING )
     {
-        sigemptyset( &mask );
-        /* timer notification */
-        sigaddset( &mask, SIGRTMIN+5 );
-        /* modified notification */
-        sigaddset( &mask, SIG_VAR_MODIFIED );
-        /* calc notification */
-        sigaddset( &mask, SIG_VAR_CALC );
-        /* validate notification */
-        sigaddset( &mask, SIG_VAR_PRINT );
-        /* print notification */
-        sigaddset( &mask, SIG_VAR_VALIDATE );
-
-        /* block on these signals */
-        sigprocmask( SIG_BLOCK, &mask, NULL );
-
-        /* wait for a signal */
-        sig = sigwaitinfo( &mask, &info );
-        lua_pushnumber( L, sig );
-        lua_pushnumber( L, info._sifields._timer.si_sigval.sival_int );
-
-        result = 2;
+        result = BACKEND_Select( lua_tostring( L, -1 ) );
+    }
+    else
+    {
+        result = BACKEND_Select( getenv( "LUAVARS_BACKEND" ) );
     }
 
+    lua_pop( L, 1 );
+
     return result;
 }
 
 /*============================================================================*/
-/*  var_validate_start                                                        */
+/*  var_get                                                                   */
 /*!
-    var.validate_start()
-
-    This var.validate_start() function starts a validation on a variable.
+    var.get()
 
-    The validation identifier that is received via var.wait() is passed
-    in as an argument on the lua stack.
+    This var.get() function interfaces to the VAR_Get() function
+    in the libvarserver.so library
 
-    The validate_start() function calls the VAR_GetValidationRequest()
-    in the variable server library.
+    The name of the variable is passed in on the lua stack
+    and the variable value is pushed back onto the lua stack
 
-    The variable handle and the variable value are passed back on the
-    lua stack.
+    Blob values are returned in a value buffer.  Values which do not
+    fit BUFSIZ are read into a buffer of the variable's length.
 
     @param[in]
         L
@@ -563,255 +934,5536 @@ static int var_wait( lua_State *L )
     @return always returns 0
 
 ==============================================================================*/
-static int var_validate_start( lua_State *L )
+static int var_get( lua_State *L )
 {
     int result = 0;
-    char buf[BUFSIZ];
-    VarObject var;
-    uint32_t id;
+    const char *name;
+    size_t len;
     VAR_HANDLE hVar;
+    VarObject var;
+    char buf[BUFSIZ];
+    uint64_t t0;
+    int rc = ENOENT;
+
+    hVar = VAR_INVALID;
 
     if( L != NULL )
     {
-        id = luaL_checknumber( L, 1 );
+        STATS_Call( LUAVARS_CALL_GET );
 
+        memset( &var, 0, sizeof( VarObject ) );
+
+        name = luaL_checklstring( L, 1, &len );
+        LUAVARS_PROBE1( get__entry, name );
+
+        /* set up string buffer */
         var.val.str = buf;
         var.len = BUFSIZ;
 
-        if( VAR_GetValidationRequest( hVarServer,
-                                      id,
-                                      &hVar,
-                                      &var ) == EOK )
+        /* mirrored variables are read from shared memory */
+        if( ( name != NULL ) && ( MIRROR_Get( name, &var ) == EOK ) )
         {
-            lua_pushnumber( L, hVar );
-            switch( var.type )
-            {
-                case VARTYPE_STR:
-                    lua_pushstring( L, var.val.str );
-                    result = 2;
-                    break;
-
-                case VARTYPE_INT16:
-                    lua_pushnumber( L, var.val.i );
-                    result = 2;
-                    break;
-
-                case VARTYPE_UINT16:
-                    lua_pushnumber( L, var.val.ui );
-                    result = 2;
-                    break;
-
-                case VARTYPE_INT32:
-                    lua_pushnumber( L, var.val.l );
-                    result = 2;
-                    break;
-
-                case VARTYPE_UINT32:
-                    lua_pushnumber( L, var.val.ul );
-                    result = 2;
-                    break;
-
-                case VARTYPE_INT64:
-                    lua_pushnumber( L, var.val.ll );
-                    result = 2;
-                    break;
-
-                case VARTYPE_UINT64:
-                    lua_pushnumber( L, var.val.ull );
-                    result = 2;
-                    break;
+            rc = EOK;
+        }
+        else if( name != NULL )
+        {
+            t0 = STATS_Now();
+            hVar = backend->find( conn( LUAVARS_CONN_SYNC, VAR_INVALID ),
+                                  (char *)name );
+            STATS_Ipc( LUAVARS_IPC_FIND,
+                       t0,
+                       hVar != VAR_INVALID ? EOK : ENOENT );
+            EVENTLOG_Name( hVar, name );
 
-                case VARTYPE_FLOAT:
-                    lua_pushnumber( L, var.val.f );
-                    result = 2;
-                    break;
+            if( hVar != VAR_INVALID )
+            {
+                t0 = STATS_Now();
+                rc = backend->get( conn( LUAVARS_CONN_SYNC, hVar ),
+                                   hVar,
+                                   &var );
+                STATS_Ipc( LUAVARS_IPC_GET, t0, rc );
+                if( rc == EOK )
+                {
+                    JOURNAL_Record( JOURNAL_SOURCE_GET, hVar, &var );
+                }
+            }
+        }
 
-                default:
-                    break;
+        if( rc == E2BIG )
+        {
+            /* values larger than BUFSIZ are read into a buffer */
+            rc = read_new_buffer( L, hVar, &var );
+            if( ( rc == EOK ) && ( var.type == VARTYPE_STR ) )
+            {
+                lua_pushlstring( L, var.val.str, strlen( var.val.str ) );
+                lua_remove( L, -2 );
             }
+
+            result = ( rc == EOK ) ? 1 : 0;
+        }
+        else if( rc == EOK )
+        {
+            result = push_var( L, &var );
         }
     }
 
+    LUAVARS_PROBE3( get__return, hVar, var.type, rc );
+
+    if( result == 0 )
+    {
+        lua_pushnil( L );
+    }
     return result;
 }
 
-/*================================================--==========================*/
-/*  var_validate_end                                                          */
+/*============================================================================*/
+/*  var_buffer                                                                */
 /*!
-    var.validate_end()
-
-    This var.validate_end() function completes a validation on a variable.
-
-    The validation identifier that is received via var.wait() is passed
-    in as an argument on the lua stack.
+    var.buffer()
 
-    The result indicating if the validation is successful is also passed
-    as an argument on the lua stack.
+    Create a value buffer to read variables into with
+    var.get_buffer(), or to set a variable from with var.set().
 
-    The validate_end() function calls the VAR_SendValidationResponse()
-    in the variable server library.
+    The size of the buffer, or a string to copy into it, is passed in
+    on the lua stack, and the buffer is pushed onto the lua stack.
 
     @param[in]
         L
             pointer to the lua state
 
-    @return always returns 0
+    @return always returns 1
 
 ==============================================================================*/
-static int var_validate_end( lua_State *L )
+static int var_buffer( lua_State *L )
 {
-    uint32_t id;
-    uint32_t response;
-
-    id = luaL_checknumber( L, 1 );
-    response = luaL_checknumber( L, 2 );
+    LuaBuffer *pBuffer;
+    const char *value;
+    lua_Integer size;
+    size_t len;
 
-    if( L != NULL )
+    if( lua_type( L, 1 ) == LUA_TSTRING )
     {
-        if( VAR_SendValidationResponse( hVarServer, id, response ) == EOK )
-        {
-            lua_pushnumber( L, 1 );
-        }
-        else
-        {
-            lua_pushnil( L );
-        }
+        value = lua_tolstring( L, 1, &len );
+        pBuffer = new_buffer( L, len );
+        memcpy( pBuffer->data, value, len );
+        pBuffer->data[len] = '\0';
+        pBuffer->len = len;
+    }
+    else
+    {
+        size = luaL_checkinteger( L, 1 );
+        luaL_argcheck( L, size >= 0, 1, "invalid buffer size" );
+        (void)new_buffer( L, (size_t)size );
     }
 
     return 1;
 }
 
 /*============================================================================*/
-/*  var_open_print_session                                                    */
+/*  var_get_buffer                                                            */
 /*!
-    var.open_print_session()
-
-    This var.open_print_session() function sets up a print session
-    to be used to render variable strings.
-
-    The session id is passed as the first argument on the lua stack.
-
-    The function creates a new LuaPrintSession user data object
-    starting with a luaL_stream object which contains the
-    file pointer for the output stream.
+    var.get_buffer()
 
-    The LuaPrintSession object also includes the variable handle
-    and the session identifier.
+    Read a string or blob variable directly into a value buffer
 
-    If the print session was successfully opened, the function
-    returns the LuaPrintSession object (aka luaL_stream) and the
-    handle of the system variable to render.
+    The variable name or handle, and optionally a buffer to reuse,
+    are passed in on the lua stack.  The value is read into the given
+    buffer if it fits, otherwise into a new buffer of the variable's
+    length, so large values are read without truncation and without
+    creating a Lua string.
 
-    If the print session could not be successfully opened,
-    the function returns nil.
+    On success, the buffer holding the value is pushed onto the lua
+    stack.  On failure, nil and the failure error string are pushed
+    onto the lua stack.
 
     @param[in]
         L
             pointer to the lua state
 
-    @return the number of arguments returned on the Lua stack
+    @return the number of values pushed onto the lua stack
 
 ==============================================================================*/
-static int var_open_print_session( lua_State *L )
+static int var_get_buffer( lua_State *L )
 {
-    LuaPrintSession *pLuaPrintSession;
-    uint32_t id;
+    LuaBuffer *pBuffer = NULL;
     VAR_HANDLE hVar;
-    FILE *fp;
-    int fd;
-    int result = 0;
+    VarObject obj;
+    int result = E2BIG;
 
-    id = luaL_checknumber( L, 1 );
+    STATS_Call( LUAVARS_CALL_GET_BUFFER );
 
-    if ( VAR_OpenPrintSession( hVarServer, id, &hVar, &fd ) == EOK )
+    if( lua_isnoneornil( L, 2 ) == false )
     {
-        pLuaPrintSession = (LuaPrintSession *)
-                            lua_newuserdata ( L, sizeof( LuaPrintSession ));
-        if( pLuaPrintSession != NULL )
-        {
-            luaL_setmetatable( L, LUA_FILEHANDLE );
+        pBuffer = (LuaBuffer *)luaL_checkudata( L, 2, LUAVARS_BUFFER );
+    }
 
-            pLuaPrintSession->id = id;
-            pLuaPrintSession->fd = fd;
-            fp = fdopen( fd, "w" );
-            pLuaPrintSession->hVar = hVar;
-            pLuaPrintSession->stream.f = fp;
-            pLuaPrintSession->stream.closef = &var_close_print_session;
+    hVar = resolve_entry( L, 1 );
+    if( hVar == VAR_INVALID )
+    {
+        result = ENOENT;
+    }
+    else if( pBuffer != NULL )
+    {
+        result = read_buffer( hVar, pBuffer, &obj );
+        if( result == EOK )
+        {
+            lua_pushvalue( L, 2 );
+        }
+    }
 
-            lua_pushnumber( L, hVar );
+    if( result == E2BIG )
+    {
+        result = read_new_buffer( L, hVar, &obj );
+    }
 
-            result = 2;
-        }
+    if( result == EOK )
+    {
+        result = 1;
     }
     else
     {
         lua_pushnil( L );
-        result = 1;
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
     }
 
     return result;
 }
 
-
 /*============================================================================*/
-/*  var_close_print_session                                                   */
+/*  var_get_many                                                              */
 /*!
-    var.close_print_session()
-
-    This var.close_print_session() function shuts down a print session
-    that was used to render variable strings.
+    var.get_many()
 
-    The Lua Print Session object containing the luaL_Stream
-    is passed as the first argument on the lua stack.
+    Get a batch of variables with overlapping requests
 
-    The function closes the print session using the
-    VAR_ClosePrintSession function and clears the
-    LuaPrintSession object.
+    A list of variable names or handles, and optionally the number of
+    threads to fetch them with, are passed in on the lua stack.  With
+    more than one thread, the batch is split between threads which
+    each make their requests on their own variable server connection.
+    The threads are kept for later batches with the same number of
+    threads.  By default, the batch is fetched by the calling thread.
 
-    On success this function pushes 1 onto the Lua stack
+    A table of the values keyed by list entry, and a table of failures
+    keyed by list entry, are pushed onto the lua stack.  Values of
+    types which var.get() does not return are failures.
 
-    On failure this function pushes nil and the failure error string
+    On failure to start the threads, nil and the failure error string
+    are pushed onto the lua stack.
 
     @param[in]
         L
             pointer to the lua state
 
-    @return the numbner of arguments returned on the Lua stack
+    @return always returns 2
 
 ==============================================================================*/
-static int var_close_print_session( lua_State *L )
+static int var_get_many( lua_State *L )
 {
-    LuaPrintSession *pLuaPrintSession;
+    FetchEntry *entries = NULL;
+    size_t n;
+    size_t i;
+    int result;
+    int rc;
+
+    STATS_Call( LUAVARS_CALL_GET_MANY );
+
+    luaL_checktype( L, 1, LUA_TTABLE );
+    result = fetch_pool( L, 2 );
+
+    n = lua_rawlen( L, 1 );
+    if( ( result == EOK ) && ( n > 0 ) )
+    {
+        entries = calloc( n, sizeof( FetchEntry ) );
+        result = ( entries != NULL ) ? EOK : ENOMEM;
+    }
+
+    /* the names remain referenced by the list during the fetch */
+    for( i = 0; ( result == EOK ) && ( i < n ); i++ )
+    {
+        lua_rawgeti( L, 1, (lua_Integer)i + 1 );
+        if( lua_type( L, -1 ) == LUA_TSTRING )
+        {
+            entries[i].name = lua_tostring( L, -1 );
+        }
+        else if( lua_type( L, -1 ) == LUA_TNUMBER )
+        {
+            entries[i].hVar = (VAR_HANDLE)lua_tonumber( L, -1 );
+        }
+
+        lua_pop( L, 1 );
+    }
+
+    if( result == EOK )
+    {
+        result = FETCH_Get( pFetch,
+                            conn( LUAVARS_CONN_SYNC, VAR_INVALID ),
+                            hVarServer,
+                            conn_local,
+                            entries,
+                            n );
+    }
+
+    if( result == EOK )
+    {
+        lua_newtable( L );
+        lua_newtable( L );
+
+        for( i = 0; i < n; i++ )
+        {
+            lua_rawgeti( L, 1, (lua_Integer)i + 1 );
+
+            rc = entries[i].result;
+            if( rc == EOK )
+            {
+                JOURNAL_Record( JOURNAL_SOURCE_GET,
+                                entries[i].hVar,
+                                &entries[i].obj );
+            }
+
+            if( ( rc == EOK ) && ( push_var( L, &entries[i].obj ) == 1 ) )
+            {
+                lua_rawset( L, -4 );
+            }
+            else
+            {
+                rc = ( rc == EOK ) ? ENOTSUP : rc;
+                lua_pushstring( L, strerror( rc ) );
+                lua_rawset( L, -3 );
+            }
+        }
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+    }
+
+    FETCH_Release( entries, n );
+    free( entries );
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  var_set_many                                                              */
+/*!
+    var.set_many()
+
+    Set a batch of variables with overlapping requests
+
+    A table of values keyed by variable name or handle, and optionally
+    the number of threads to set them with, are passed in on the lua
+    stack.  Each value is converted to the type of its variable as by
+    var.set(), and the batch is divided between threads as for
+    var.get_many().  The order in which the variables are set is not
+    defined.
+
+    The number of variables set and a table of failures keyed by
+    name or handle are pushed onto the lua stack.
+
+    On failure to start the threads, nil and the failure error string
+    are pushed onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_set_many( lua_State *L )
+{
+    FetchEntry *entries = NULL;
+    lua_Integer count = 0;
+    size_t n = 0;
+    size_t i;
+    int result;
+
+    STATS_Call( LUAVARS_CALL_SET_MANY );
+
+    luaL_checktype( L, 1, LUA_TTABLE );
+    result = fetch_pool( L, 2 );
+
+    lua_settop( L, 1 );
+
+    /* keys and converted values, kept referenced during the batch */
+    lua_newtable( L );
+    lua_newtable( L );
+
+    lua_pushnil( L );
+    while( lua_next( L, 1 ) != 0 )
+    {
+        lua_pushvalue( L, -2 );
+        lua_rawseti( L, 2, (lua_Integer)++n );
+        (void)lua_tostring( L, -1 );
+        lua_rawseti( L, 3, (lua_Integer)n );
+    }
+
+    if( ( result == EOK ) && ( n > 0 ) )
+    {
+        entries = calloc( n, sizeof( FetchEntry ) );
+        result = ( entries != NULL ) ? EOK : ENOMEM;
+    }
+
+    for( i = 0; ( result == EOK ) && ( i < n ); i++ )
+    {
+        lua_rawgeti( L, 2, (lua_Integer)i + 1 );
+        if( lua_type( L, -1 ) == LUA_TSTRING )
+        {
+            entries[i].name = lua_tostring( L, -1 );
+        }
+        else if( lua_type( L, -1 ) == LUA_TNUMBER )
+        {
+            entries[i].hVar = (VAR_HANDLE)lua_tonumber( L, -1 );
+        }
+
+        lua_rawgeti( L, 3, (lua_Integer)i + 1 );
+        entries[i].value = lua_tostring( L, -1 );
+        lua_pop( L, 2 );
+
+        if( entries[i].value == NULL )
+        {
+            /* values other than strings and numbers are not set */
+            entries[i].name = NULL;
+            entries[i].hVar = VAR_INVALID;
+        }
+    }
+
+    if( result == EOK )
+    {
+        result = FETCH_Set( pFetch,
+                            conn( LUAVARS_CONN_SYNC, VAR_INVALID ),
+                            hVarServer,
+                            conn_local,
+                            entries,
+                            n );
+    }
+
+    if( result == EOK )
+    {
+        lua_newtable( L );
+
+        for( i = 0; i < n; i++ )
+        {
+            if( entries[i].result == EOK )
+            {
+                JOURNAL_RecordStr( JOURNAL_SOURCE_SET,
+                                   entries[i].hVar,
+                                   entries[i].obj.type,
+                                   entries[i].value );
+                count++;
+            }
+            else
+            {
+                lua_rawgeti( L, 2, (lua_Integer)i + 1 );
+                lua_pushstring( L,
+                                strerror( entries[i].value != NULL
+                                          ? entries[i].result
+                                          : EINVAL ) );
+                lua_rawset( L, -3 );
+            }
+        }
+
+        lua_pushinteger( L, count );
+        lua_insert( L, -2 );
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+    }
+
+    free( entries );
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  var_snapshot                                                              */
+/*!
+    var.snapshot()
+
+    Save the values of a set of variables to a binary snapshot file
+
+    A name prefix or a list of variable names, the path of the
+    snapshot file, and optionally the number of threads to fetch the
+    variables with, are passed in on the lua stack.  The snapshot is
+    restored with var.restore(); see snapshot.c for the file format.
+
+    On success, the number of variables saved and a table of failures
+    keyed by name are pushed onto the lua stack.
+
+    On failure to fetch the variables or write the file, nil and the
+    failure error string are pushed onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_snapshot( lua_State *L )
+{
+    FetchEntry *entries = NULL;
+    const char *path;
+    lua_Integer count = 0;
+    size_t n;
+    size_t i;
+    int result;
+
+    STATS_Call( LUAVARS_CALL_SNAPSHOT );
+
+    path = luaL_checkstring( L, 2 );
+    result = fetch_pool( L, 3 );
+    lua_settop( L, 2 );
+
+    if( lua_type( L, 1 ) == LUA_TSTRING )
+    {
+        snapshot_names( L, lua_tostring( L, 1 ) );
+        lua_replace( L, 1 );
+    }
+
+    luaL_checktype( L, 1, LUA_TTABLE );
+
+    n = lua_rawlen( L, 1 );
+    if( ( result == EOK ) && ( n > 0 ) )
+    {
+        entries = calloc( n, sizeof( FetchEntry ) );
+        result = ( entries != NULL ) ? EOK : ENOMEM;
+    }
+
+    /* the names remain referenced by the list during the fetch */
+    for( i = 0; ( result == EOK ) && ( i < n ); i++ )
+    {
+        lua_rawgeti( L, 1, (lua_Integer)i + 1 );
+        if( lua_type( L, -1 ) == LUA_TSTRING )
+        {
+            entries[i].name = lua_tostring( L, -1 );
+        }
+
+        lua_pop( L, 1 );
+    }
+
+    if( result == EOK )
+    {
+        result = FETCH_Get( pFetch,
+                            conn( LUAVARS_CONN_SYNC, VAR_INVALID ),
+                            hVarServer,
+                            conn_local,
+                            entries,
+                            n );
+    }
+
+    if( result == EOK )
+    {
+        result = SNAPSHOT_Write( path, entries, n );
+    }
+
+    if( result == EOK )
+    {
+        lua_newtable( L );
+
+        for( i = 0; i < n; i++ )
+        {
+            if( entries[i].result == EOK )
+            {
+                count++;
+            }
+            else
+            {
+                lua_rawgeti( L, 1, (lua_Integer)i + 1 );
+                lua_pushstring( L,
+                                strerror( entries[i].name != NULL
+                                          ? entries[i].result
+                                          : EINVAL ) );
+                lua_rawset( L, -3 );
+            }
+        }
+
+        lua_pushinteger( L, count );
+        lua_insert( L, -2 );
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+    }
+
+    FETCH_Release( entries, n );
+    free( entries );
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  var_restore                                                               */
+/*!
+    var.restore()
+
+    Restore the variables saved in a snapshot file by var.snapshot()
+
+    The path of the snapshot file and optionally the number of threads
+    to set the variables with are passed in on the lua stack.  The
+    saved values are set as they are, without conversion to text.
+
+    On success, the number of variables restored and a table of
+    failures keyed by name are pushed onto the lua stack.
+
+    On failure to read the snapshot, nil and the failure error string
+    are pushed onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_restore( lua_State *L )
+{
+    FetchEntry *entries = NULL;
+    Snapshot *pSnapshot = NULL;
+    lua_Integer count = 0;
+    size_t n = 0;
+    size_t i;
+    int result;
+
+    STATS_Call( LUAVARS_CALL_RESTORE );
+
+    result = fetch_pool( L, 2 );
+    if( result == EOK )
+    {
+        result = SNAPSHOT_Open( luaL_checkstring( L, 1 ), &pSnapshot );
+    }
+
+    if( result == EOK )
+    {
+        n = SNAPSHOT_Count( pSnapshot );
+        if( n > 0 )
+        {
+            entries = calloc( n, sizeof( FetchEntry ) );
+            result = ( entries != NULL ) ? EOK : ENOMEM;
+        }
+    }
+
+    /* string values are set from the mapped snapshot */
+    for( i = 0; ( result == EOK ) && ( i < n ); i++ )
+    {
+        entries[i].name = SNAPSHOT_Name( pSnapshot, i );
+        (void)SNAPSHOT_Value( pSnapshot, i, &entries[i].obj );
+    }
+
+    if( result == EOK )
+    {
+        result = FETCH_Set( pFetch,
+                            conn( LUAVARS_CONN_SYNC, VAR_INVALID ),
+                            hVarServer,
+                            conn_local,
+                            entries,
+                            n );
+    }
+
+    if( result == EOK )
+    {
+        lua_newtable( L );
+
+        for( i = 0; i < n; i++ )
+        {
+            if( entries[i].result == EOK )
+            {
+                JOURNAL_Record( JOURNAL_SOURCE_SET,
+                                entries[i].hVar,
+                                &entries[i].obj );
+                count++;
+            }
+            else
+            {
+                lua_pushstring( L, strerror( entries[i].result ) );
+                lua_setfield( L, -2, entries[i].name );
+            }
+        }
+
+        lua_pushinteger( L, count );
+        lua_insert( L, -2 );
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+    }
+
+    free( entries );
+    SNAPSHOT_Close( pSnapshot );
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  var_diff                                                                  */
+/*!
+    var.diff()
+
+    Compare two snapshot files saved by var.snapshot(), or a snapshot
+    file with the live values of the variables it holds
+
+    The paths of the earlier and, optionally, the later snapshot are
+    passed in on the lua stack.  Without a later snapshot, the
+    variables in the earlier snapshot are fetched and compared with it.
+
+    On success, a table of the changed variables keyed by name, each
+    a table with the "from" and "to" values, and the number of
+    changed variables are pushed onto the lua stack.  A variable
+    which is only in one snapshot has no "from" or "to" value.
+
+    On failure to read a snapshot, nil and the failure error string
+    are pushed onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_diff( lua_State *L )
+{
+    Snapshot *pA = NULL;
+    Snapshot *pB = NULL;
+    size_t count;
+    int result;
+
+    STATS_Call( LUAVARS_CALL_DIFF );
+
+    result = SNAPSHOT_Open( luaL_checkstring( L, 1 ), &pA );
+    if( result == EOK )
+    {
+        result = lua_isnoneornil( L, 2 )
+                    ? snapshot_live( pA, &pB )
+                    : SNAPSHOT_Open( luaL_checkstring( L, 2 ), &pB );
+    }
+
+    if( result == EOK )
+    {
+        lua_newtable( L );
+        count = SNAPSHOT_Diff( pA, pB, diff_entry, L );
+        lua_pushinteger( L, (lua_Integer)count );
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+    }
+
+    SNAPSHOT_Close( pB );
+    SNAPSHOT_Close( pA );
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  var_journal_start                                                         */
+/*!
+    var.journal_start()
+
+    Start keeping a journal of the most recent variable changes seen
+    by the library, which is read with var.journal().  Starting the
+    journal again discards its entries.
+
+    The number of entries to keep is optionally passed in on the lua
+    stack, and defaults to JOURNAL_DEFAULT_ENTRIES.
+
+    On success, 1 is pushed onto the lua stack.  On failure, nil and
+    the failure error string are pushed onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return number of values pushed onto the lua stack
+
+==============================================================================*/
+static int var_journal_start( lua_State *L )
+{
+    lua_Integer entries;
+    int result;
+
+    entries = luaL_optinteger( L, 1, JOURNAL_DEFAULT_ENTRIES );
+    luaL_argcheck( L,
+                   ( entries > 0 ) && ( entries <= JOURNAL_MAX_ENTRIES ),
+                   1,
+                   "invalid number of entries" );
+
+    result = JOURNAL_Start( (size_t)entries );
+    if( result == EOK )
+    {
+        lua_pushnumber( L, 1 );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_journal_stop                                                          */
+/*!
+    var.journal_stop()
+
+    Stop the journal and discard its entries
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int var_journal_stop( lua_State *L )
+{
+    (void)L;
+
+    JOURNAL_Stop();
+
+    return 0;
+}
+
+/*============================================================================*/
+/*  var_journal                                                               */
+/*!
+    var.journal()
+
+    Query the journal started by var.journal_start()
+
+    Optionally, a timestamp and a filter are passed in on the lua
+    stack.  Only entries later than the timestamp are returned.  The
+    filter is a variable handle, or the name of a source: "set" for
+    changes made by the script, "modified" for modified notifications,
+    or "get" for changed values seen by var.get().
+
+    A list of entries, oldest first, and the timestamp of the latest
+    entry, to pass to the next call, are pushed onto the lua stack.
+    Each entry is a table with the ts, handle and source of the
+    change, and its from and to values where they are known.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_journal( lua_State *L )
+{
+    const JournalEntry *pEntry;
+    const char *source = NULL;
+    VAR_HANDLE hVar = VAR_INVALID;
+    lua_Integer since;
+    lua_Integer last;
+    lua_Integer n = 0;
+    uint64_t seq = 0;
+
+    STATS_Call( LUAVARS_CALL_JOURNAL );
+
+    since = luaL_optinteger( L, 1, 0 );
+    last = since;
+
+    if( lua_type( L, 2 ) == LUA_TNUMBER )
+    {
+        hVar = (VAR_HANDLE)lua_tonumber( L, 2 );
+    }
+    else if( lua_isnoneornil( L, 2 ) == false )
+    {
+        source = luaL_checkstring( L, 2 );
+    }
+
+    lua_newtable( L );
+
+    while( ( pEntry = JOURNAL_Next( &seq ) ) != NULL )
+    {
+        if( ( (lua_Integer)pEntry->ts > since ) &&
+            ( ( hVar == VAR_INVALID ) || ( pEntry->hVar == hVar ) ) &&
+            ( ( source == NULL ) ||
+              ( strcmp( source,
+                        JOURNAL_SourceName( pEntry->source ) ) == 0 ) ) )
+        {
+            push_journal_entry( L, pEntry );
+            lua_rawseti( L, -2, ++n );
+        }
+
+        if( (lua_Integer)pEntry->ts > last )
+        {
+            last = (lua_Integer)pEntry->ts;
+        }
+    }
+
+    lua_pushinteger( L, last );
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  fetch_pool                                                                */
+/*!
+    Prepare the fetch threads for a batched call
+
+    The number of threads is taken from the optional argument at idx,
+    and defaults to 1, in which case the batch is handled by the
+    calling thread.  The threads are only replaced when the number of
+    threads changes.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        idx
+            stack index of the number of threads
+
+    @retval EOK the threads are ready
+    @retval other error from FETCH_Create()
+
+==============================================================================*/
+static int fetch_pool( lua_State *L, int idx )
+{
+    lua_Integer workers;
+    int result = EOK;
+
+    workers = luaL_optinteger( L, idx, 1 );
+    luaL_argcheck( L,
+                   ( workers > 0 ) && ( workers <= FETCH_MAX_WORKERS ),
+                   idx,
+                   "invalid number of threads" );
+
+    if( FETCH_Workers( pFetch ) != ( ( workers > 1 ) ? workers : 0 ) )
+    {
+        FETCH_Free( pFetch );
+        pFetch = NULL;
+
+        if( workers > 1 )
+        {
+            result = FETCH_Create( (int)workers, &pFetch );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  snapshot_names                                                            */
+/*!
+    Push a list of the variable names starting with a prefix
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        prefix
+            name prefix of the variables
+
+==============================================================================*/
+static void snapshot_names( lua_State *L, const char *prefix )
+{
+    VarQuery query;
+    VarObject obj;
+    char buf[BUFSIZ];
+    lua_Integer n = 0;
+    size_t len;
+    uint64_t t0;
+    int result;
+
+    lua_newtable( L );
+
+    len = strlen( prefix );
+
+    memset( &query, 0, sizeof query );
+    query.type = QUERY_MATCH;
+    query.match = (char *)prefix;
+
+    memset( &obj, 0, sizeof obj );
+    obj.val.str = buf;
+    obj.len = sizeof buf;
+
+    t0 = STATS_Now();
+    result = backend->getFirst( hVarServer, &query, &obj );
+    STATS_Ipc( LUAVARS_IPC_QUERY, t0, result == ENOENT ? EOK : result );
+
+    while( result == EOK )
+    {
+        /* QUERY_MATCH is a substring match: keep only the prefix */
+        if( strncmp( query.name, prefix, len ) == 0 )
+        {
+            lua_pushstring( L, query.name );
+            lua_rawseti( L, -2, ++n );
+        }
+
+        obj.val.str = buf;
+        obj.len = sizeof buf;
+
+        t0 = STATS_Now();
+        result = backend->getNext( hVarServer, &query, &obj );
+        STATS_Ipc( LUAVARS_IPC_QUERY, t0, result == ENOENT ? EOK : result );
+    }
+}
+
+/*============================================================================*/
+/*  snapshot_live                                                             */
+/*!
+    Build a snapshot of the live values of the variables in a snapshot
+
+    Variables which cannot be fetched are left out, so they compare
+    as removed.
+
+    @param[in]
+        pSaved
+            pointer to the saved snapshot
+
+    @param[out]
+        ppLive
+            the snapshot of the live values is returned here
+
+    @retval EOK the snapshot was built
+    @retval ENOMEM out of memory
+    @retval other error from SNAPSHOT_Create()
+
+==============================================================================*/
+static int snapshot_live( const Snapshot *pSaved, Snapshot **ppLive )
+{
+    FetchEntry *entries = NULL;
+    size_t n;
+    size_t i;
+    int result = EOK;
+
+    n = SNAPSHOT_Count( pSaved );
+    if( n > 0 )
+    {
+        entries = calloc( n, sizeof( FetchEntry ) );
+        result = ( entries != NULL ) ? EOK : ENOMEM;
+    }
+
+    for( i = 0; ( result == EOK ) && ( i < n ); i++ )
+    {
+        entries[i].name = SNAPSHOT_Name( pSaved, i );
+    }
+
+    if( result == EOK )
+    {
+        result = FETCH_Get( pFetch,
+                            conn( LUAVARS_CONN_SYNC, VAR_INVALID ),
+                            hVarServer,
+                            conn_local,
+                            entries,
+                            n );
+    }
+
+    if( result == EOK )
+    {
+        result = SNAPSHOT_Create( entries, n, ppLive );
+    }
+
+    FETCH_Release( entries, n );
+    free( entries );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  diff_entry                                                                */
+/*!
+    Add a changed variable to the var.diff() result table
+
+    @param[in]
+        arg
+            pointer to the lua state, with the result table on top
+
+    @param[in]
+        name
+            name of the variable
+
+    @param[in]
+        a
+            earlier value, or NULL
+
+    @param[in]
+        b
+            later value, or NULL
+
+==============================================================================*/
+static void diff_entry( void *arg,
+                        const char *name,
+                        const VarObject *a,
+                        const VarObject *b )
+{
+    lua_State *L = (lua_State *)arg;
+
+    lua_createtable( L, 0, 2 );
+
+    if( ( a != NULL ) && ( push_var( L, a ) == 1 ) )
+    {
+        lua_setfield( L, -2, "from" );
+    }
+
+    if( ( b != NULL ) && ( push_var( L, b ) == 1 ) )
+    {
+        lua_setfield( L, -2, "to" );
+    }
+
+    lua_setfield( L, -2, name );
+}
+
+/*============================================================================*/
+/*  push_journal_entry                                                        */
+/*!
+    Push a journal entry onto the lua stack as a table
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        pEntry
+            pointer to the journal entry
+
+==============================================================================*/
+static void push_journal_entry( lua_State *L, const JournalEntry *pEntry )
+{
+    VarObject obj;
+
+    lua_createtable( L, 0, 5 );
+
+    lua_pushinteger( L, (lua_Integer)pEntry->ts );
+    lua_setfield( L, -2, "ts" );
+
+    lua_pushnumber( L, pEntry->hVar );
+    lua_setfield( L, -2, "handle" );
+
+    lua_pushstring( L, JOURNAL_SourceName( pEntry->source ) );
+    lua_setfield( L, -2, "source" );
+
+    if( ( JOURNAL_Value( &pEntry->from, &obj ) == EOK ) &&
+        ( push_var( L, &obj ) == 1 ) )
+    {
+        lua_setfield( L, -2, "from" );
+    }
+
+    if( ( JOURNAL_Value( &pEntry->to, &obj ) == EOK ) &&
+        ( push_var( L, &obj ) == 1 ) )
+    {
+        lua_setfield( L, -2, "to" );
+    }
+}
+
+/*============================================================================*/
+/*  push_var                                                                  */
+/*!
+    Push a variable value onto the lua stack
+
+    Nothing is pushed for types which are not returned to Lua.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        pVar
+            pointer to the variable value
+
+    @return the number of values pushed
+
+==============================================================================*/
+static int push_var( lua_State *L, const VarObject *pVar )
+{
+    LuaBuffer *pBuffer;
+    int result = 0;
+
+    switch( pVar->type )
+    {
+        case VARTYPE_STR:
+            lua_pushstring( L, pVar->val.str );
+            result = 1;
+            break;
+
+        case VARTYPE_INT16:
+            lua_pushnumber( L, pVar->val.i );
+            result = 1;
+            break;
+
+        case VARTYPE_UINT16:
+            lua_pushnumber( L, pVar->val.ui );
+            result = 1;
+            break;
+
+        case VARTYPE_INT32:
+            lua_pushnumber( L, pVar->val.l );
+            result = 1;
+            break;
+
+        case VARTYPE_UINT32:
+            lua_pushnumber( L, pVar->val.ul );
+            result = 1;
+            break;
+
+        case VARTYPE_INT64:
+            lua_pushnumber( L, pVar->val.ll );
+            result = 1;
+            break;
+
+        case VARTYPE_UINT64:
+            lua_pushnumber( L, pVar->val.ull );
+            result = 1;
+            break;
+
+        case VARTYPE_FLOAT:
+            lua_pushnumber( L, pVar->val.f );
+            result = 1;
+            break;
+
+        case VARTYPE_BLOB:
+            pBuffer = new_buffer( L, pVar->len );
+            if( pVar->val.blob != NULL )
+            {
+                memcpy( pBuffer->data, pVar->val.blob, pVar->len );
+            }
+
+            pBuffer->len = pVar->len;
+            result = 1;
+            break;
+
+        default:
+            break;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  type_name                                                                 */
+/*!
+    Get the name of a variable type
+
+    @param[in]
+        type
+            the variable type
+
+    @return the name used for the type by var.create(), "blob" for
+            blobs, or "invalid" for any other type
+
+==============================================================================*/
+static const char *type_name( VarType type )
+{
+    const char *name = ( type == VARTYPE_BLOB ) ? "blob" : "invalid";
+    size_t i;
+
+    for( i = 0; typeNames[i] != NULL; i++ )
+    {
+        if( types[i] == type )
+        {
+            name = typeNames[i];
+        }
+    }
+
+    return name;
+}
+
+/*============================================================================*/
+/*  new_buffer                                                                */
+/*!
+    Push a new empty value buffer onto the lua stack
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        size
+            size of the buffer data
+
+    @return pointer to the buffer
+
+==============================================================================*/
+static LuaBuffer *new_buffer( lua_State *L, size_t size )
+{
+    LuaBuffer *pBuffer;
+
+    pBuffer = lua_newuserdatauv( L, sizeof( LuaBuffer ) + size + 1, 0 );
+    pBuffer->len = 0;
+    pBuffer->size = size;
+    pBuffer->data[0] = '\0';
+    luaL_setmetatable( L, LUAVARS_BUFFER );
+
+    return pBuffer;
+}
+
+/*============================================================================*/
+/*  read_buffer                                                               */
+/*!
+    Read a variable directly into a value buffer
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        pBuffer
+            buffer to read into
+
+    @param[out]
+        obj
+            the variable value, pointing into the buffer, is returned here
+
+    @retval EOK the value was read
+    @retval E2BIG the value does not fit the buffer
+    @retval other error from the variable server
+
+==============================================================================*/
+static int read_buffer( VAR_HANDLE hVar, LuaBuffer *pBuffer, VarObject *obj )
+{
+    int result;
+    uint64_t t0;
+
+    memset( obj, 0, sizeof( VarObject ) );
+    obj->val.blob = pBuffer->data;
+    obj->len = pBuffer->size;
+
+    t0 = STATS_Now();
+    result = backend->get( conn( LUAVARS_CONN_SYNC, hVar ), hVar, obj );
+    STATS_Ipc( LUAVARS_IPC_GET, t0, result );
+
+    if( result == EOK )
+    {
+        pBuffer->len = ( obj->type == VARTYPE_BLOB )
+                        ? obj->len
+                        : strnlen( pBuffer->data, pBuffer->size );
+        pBuffer->data[pBuffer->len] = '\0';
+
+        JOURNAL_Record( JOURNAL_SOURCE_GET, hVar, obj );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  read_new_buffer                                                           */
+/*!
+    Read a variable directly into a new value buffer the length of
+    the variable, which is pushed onto the lua stack
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[out]
+        obj
+            the variable value, pointing into the buffer, is returned here
+
+    @retval EOK the value was read and the buffer was pushed
+    @retval other error from the variable server, nothing was pushed
+
+==============================================================================*/
+static int read_new_buffer( lua_State *L, VAR_HANDLE hVar, VarObject *obj )
+{
+    int result;
+    size_t len = 0;
+
+    result = METACACHE_GetLength( backend,
+                                  conn( LUAVARS_CONN_SYNC, hVar ),
+                                  hVar,
+                                  &len );
+
+    if( result == EOK )
+    {
+        result = read_buffer( hVar, new_buffer( L, len ), obj );
+        if( result != EOK )
+        {
+            lua_pop( L, 1 );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  buffer_len                                                                */
+/*!
+    buffer:len()
+
+    Push the length of the value in a value buffer onto the lua stack.
+    This is also the # operator of the buffer.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int buffer_len( lua_State *L )
+{
+    LuaBuffer *pBuffer;
+
+    pBuffer = (LuaBuffer *)luaL_checkudata( L, 1, LUAVARS_BUFFER );
+    lua_pushinteger( L, (lua_Integer)pBuffer->len );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  buffer_sub                                                                */
+/*!
+    buffer:sub()
+
+    Push part of the value in a value buffer onto the lua stack as a
+    string.  The start and optional end positions are interpreted as
+    by string.sub().
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int buffer_sub( lua_State *L )
+{
+    LuaBuffer *pBuffer;
+    lua_Integer len;
+    lua_Integer i;
+    lua_Integer j;
+
+    pBuffer = (LuaBuffer *)luaL_checkudata( L, 1, LUAVARS_BUFFER );
+    len = (lua_Integer)pBuffer->len;
+    i = luaL_checkinteger( L, 2 );
+    j = luaL_optinteger( L, 3, -1 );
+
+    /* negative positions count back from the end */
+    i = ( i < 0 ) ? len + i + 1 : i;
+    j = ( j < 0 ) ? len + j + 1 : j;
+    i = ( i < 1 ) ? 1 : i;
+    j = ( j > len ) ? len : j;
+
+    if( i <= j )
+    {
+        lua_pushlstring( L, &pBuffer->data[i - 1], (size_t)( j - i + 1 ) );
+    }
+    else
+    {
+        lua_pushstring( L, "" );
+    }
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  buffer_tostring                                                           */
+/*!
+    Push the value in a value buffer onto the lua stack as a string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int buffer_tostring( lua_State *L )
+{
+    LuaBuffer *pBuffer;
+
+    pBuffer = (LuaBuffer *)luaL_checkudata( L, 1, LUAVARS_BUFFER );
+    lua_pushlstring( L, pBuffer->data, pBuffer->len );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  var_set                                                                   */
+/*!
+    var.set()
+
+    This var.set() function interfaces to the VAR_SetStr() function
+    in the libvarserver.so library
+
+    The name of the variable is passed in on the lua stack
+    The value to be set is passed in as a string on the lua stack
+    and the result is pushed back onto the lua stack.
+    If the set fails, then nil is pusedh back onto the lua stack
+
+    The value may also be a value buffer.  Blob variables are set from
+    the bytes of the string or buffer without conversion.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int var_set( lua_State *L )
+{
+    char *name;
+    char *value;
+    int result = 0;
+    size_t len;
+    LuaBuffer *pBuffer;
+    VarObject obj;
+    VAR_HANDLE hVar = VAR_INVALID;
+    VarType type = VARTYPE_INVALID;
+    const char *argtype;
+    uint64_t t0;
+    int rc = ENOENT;
+
+    if( L != NULL )
+    {
+        STATS_Call( LUAVARS_CALL_SET );
+        LUAVARS_PROBE0( set__entry );
+
+        /* check if a variable name was supplied */
+
+        argtype = luaL_typename( L, 1 );
+
+        if( strcmp( argtype, "string") == 0 )
+        {
+            name = (char *)luaL_checklstring(L, 1, &len );
+            if( name != NULL )
+            {
+                t0 = STATS_Now();
+                hVar = backend->find( conn( LUAVARS_CONN_SYNC, VAR_INVALID ),
+                                      name );
+                STATS_Ipc( LUAVARS_IPC_FIND,
+                           t0,
+                           hVar != VAR_INVALID ? EOK : ENOENT );
+                EVENTLOG_Name( hVar, name );
+            }
+        }
+        else if( strcmp( argtype, "number" ) == 0 )
+        {
+            /* get the variable handle from the lua stack */
+            hVar = luaL_checknumber( L, 1 );
+        }
+
+        /* get the value from the lua stack, or from a value buffer */
+        pBuffer = (LuaBuffer *)luaL_testudata( L, 2, LUAVARS_BUFFER );
+        if( pBuffer != NULL )
+        {
+            value = pBuffer->data;
+            len = pBuffer->len;
+        }
+        else
+        {
+            value = (char *)luaL_checklstring( L, 2, &len );
+        }
+
+        if( hVar != VAR_INVALID )
+        {
+            /* get the variable type so we can convert the
+            string to a VarObject */
+            rc = METACACHE_GetType( backend,
+                                    conn( LUAVARS_CONN_SYNC, hVar ),
+                                    hVar,
+                                    &type );
+
+            if( ( rc == EOK ) && ( type == VARTYPE_BLOB ) )
+            {
+                /* blobs are set from the bytes of the value */
+                memset( &obj, 0, sizeof( VarObject ) );
+                obj.type = VARTYPE_BLOB;
+                obj.val.blob = value;
+                obj.len = len;
+
+                t0 = STATS_Now();
+                rc = backend->set( conn( LUAVARS_CONN_SYNC, hVar ),
+                                   hVar,
+                                   &obj );
+                STATS_Ipc( LUAVARS_IPC_SET, t0, rc );
+            }
+            else if( rc == EOK )
+            {
+                /* set the variable value from the string */
+                t0 = STATS_Now();
+                rc = backend->setStr( conn( LUAVARS_CONN_SYNC, hVar ),
+                                      hVar,
+                                      type,
+                                      value );
+                STATS_Ipc( LUAVARS_IPC_SET, t0, rc );
+            }
+
+            if( rc == EOK )
+            {
+                EVENTLOG_Set( hVar,
+                              type,
+                              ( type != VARTYPE_BLOB ) ? value : NULL );
+                JOURNAL_RecordStr( JOURNAL_SOURCE_SET, hVar, type, value );
+                lua_pushnumber( L, 1 );
+                result = 1;
+            }
+            else
+            {
+                lua_pushnil( L );
+            }
+        }
+        else
+        {
+            /* invalid variable handle */
+            lua_pushnil( L );
+        }
+
+        LUAVARS_PROBE3( set__return, hVar, type, rc );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_find                                                                  */
+/*!
+    var.find()
+
+    This var.find() function interfaces to the VAR_FindByName() function
+    in the libvarserver.so library
+
+    The name of the variable is passed in on the lua stack
+    and the variable handle is pushed back onto the lua stack.
+    If the variable is not found, then nil is pushed back onto the lua stack
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int var_find( lua_State *L )
+{
+    int result = 0;
+    char *name;
+    size_t len;
+    VAR_HANDLE hVar;
+    uint64_t t0;
+
+    if( L != NULL )
+    {
+        STATS_Call( LUAVARS_CALL_FIND );
+
+        name = (char *)luaL_checklstring( L, 1, &len );
+        LUAVARS_PROBE1( find__entry, name );
+        if( name != NULL )
+        {
+            t0 = STATS_Now();
+            hVar = backend->find( conn( LUAVARS_CONN_SYNC, VAR_INVALID ),
+                                  name );
+            STATS_Ipc( LUAVARS_IPC_FIND,
+                       t0,
+                       hVar != VAR_INVALID ? EOK : ENOENT );
+            LUAVARS_PROBE2( find__return, name, hVar );
+            EVENTLOG_Name( hVar, name );
+
+            if( hVar != VAR_INVALID )
+            {
+                lua_pushnumber( L, hVar );
+                result = 1;
+            }
+        }
+    }
+
+    if( result == 0 )
+    {
+        lua_pushnil( L );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_info                                                                  */
+/*!
+    var.info()
+
+    Get the metadata of a variable given by name or handle.  A table
+    with the handle, name, type and length of the variable is pushed
+    onto the lua stack.  The length is the size of the buffer needed
+    to get the value, including the terminator of a string.
+
+    The type and name come from the metadata cache, so only the first
+    query of a variable makes variable server requests, except for the
+    length of a string or blob variable which depends on its value.
+
+    On failure nil and an error message are pushed onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of values pushed onto the lua stack
+
+==============================================================================*/
+static int var_info( lua_State *L )
+{
+    VARSERVER_HANDLE hSync;
+    VAR_HANDLE hVar;
+    VarType type = VARTYPE_INVALID;
+    char name[MAX_NAME_LEN + 1];
+    size_t len = 0;
+    int result;
+
+    STATS_Call( LUAVARS_CALL_INFO );
+
+    hVar = resolve_entry( L, 1 );
+    hSync = conn( LUAVARS_CONN_SYNC, hVar );
+
+    if( hVar == VAR_INVALID )
+    {
+        result = ENOENT;
+    }
+    else if( lua_type( L, 1 ) == LUA_TSTRING )
+    {
+        /* the variable was found by this name */
+        strncpy( name, lua_tostring( L, 1 ), sizeof( name ) - 1 );
+        name[sizeof( name ) - 1] = '\0';
+        result = EOK;
+    }
+    else
+    {
+        result = METACACHE_GetName( backend, hSync, hVar, name, sizeof name );
+    }
+
+    if( result == EOK )
+    {
+        result = METACACHE_GetType( backend, hSync, hVar, &type );
+    }
+
+    if( result == EOK )
+    {
+        result = METACACHE_GetLength( backend, hSync, hVar, &len );
+    }
+
+    if( result == EOK )
+    {
+        lua_createtable( L, 0, 4 );
+
+        lua_pushnumber( L, hVar );
+        lua_setfield( L, -2, "handle" );
+
+        lua_pushstring( L, name );
+        lua_setfield( L, -2, "name" );
+
+        lua_pushstring( L, type_name( type ) );
+        lua_setfield( L, -2, "type" );
+
+        lua_pushinteger( L, (lua_Integer)len );
+        lua_setfield( L, -2, "length" );
+
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_name                                                                  */
+/*!
+    var.name()
+
+    Get the name of a variable from its handle.  The name is pushed
+    onto the lua stack, or nil and an error message if the handle is
+    not valid.  Names are kept in the metadata cache once they have
+    been fetched.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of values pushed onto the lua stack
+
+==============================================================================*/
+static int var_name( lua_State *L )
+{
+    VAR_HANDLE hVar;
+    char name[MAX_NAME_LEN + 1];
+    int result;
+
+    STATS_Call( LUAVARS_CALL_NAME );
+
+    hVar = (VAR_HANDLE)luaL_checkinteger( L, 1 );
+
+    result = METACACHE_GetName( backend,
+                                conn( LUAVARS_CONN_SYNC, hVar ),
+                                hVar,
+                                name,
+                                sizeof name );
+    if( result == EOK )
+    {
+        lua_pushstring( L, name );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_notify                                                                */
+/*!
+    var.notify()
+
+    This var.notify() function interfaces to the VAR_Notify() function
+    in the libvarserver.so library
+
+    The variable handle to be notified on is passed in on the lua stack
+    The type of notification being requested is passed in on the lua stack
+
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int var_notify( lua_State *L )
+{
+    int result = 0;
+    char *name;
+    size_t len;
+    VAR_HANDLE hVar;
+    NotificationType notificationType;
+
+    if( L != NULL )
+    {
+        STATS_Call( LUAVARS_CALL_NOTIFY );
+
+        hVar = (VAR_HANDLE)luaL_checknumber( L, 1 );
+        notificationType = (NotificationType)luaL_checknumber( L, 2 );
+
+        result = notify_register( hVar, notificationType );
+        if( result == EOK )
+        {
+            lua_pushnumber( L, result );
+        }
+        else
+        {
+            lua_pushnil( L );
+        }
+    }
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  var_notify_many                                                           */
+/*!
+    var.notify_many()
+
+    Register the same notification on a list of variables in a single
+    call.  Each list entry may be a variable name or a variable handle.
+    Names are resolved and the notifications registered in one loop so
+    a script subscribing to many variables does not pay a Lua to C
+    transition per variable.
+
+    On return, the number of successful registrations and a table of
+    failures are pushed onto the lua stack.  The failure table is keyed
+    by the list entry which failed and holds the error string.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_notify_many( lua_State *L )
+{
+    NotificationType notificationType;
+    VAR_HANDLE hVar;
+    lua_Integer n;
+    lua_Integer i;
+    lua_Integer count = 0;
+    int rc;
+
+    STATS_Call( LUAVARS_CALL_NOTIFY_MANY );
+
+    luaL_checktype( L, 1, LUA_TTABLE );
+    notificationType = (NotificationType)luaL_checkinteger( L, 2 );
+
+    n = (lua_Integer)lua_rawlen( L, 1 );
+    lua_newtable( L );
+
+    for( i = 1; i <= n; i++ )
+    {
+        lua_rawgeti( L, 1, i );
+        hVar = resolve_entry( L, -1 );
+
+        rc = ( hVar != VAR_INVALID ) ? notify_register( hVar,
+                                                        notificationType )
+                                     : ENOENT;
+        if( rc == EOK )
+        {
+            count++;
+            lua_pop( L, 1 );
+        }
+        else
+        {
+            /* failures[entry] = error string */
+            lua_pushstring( L, strerror( rc ) );
+            lua_rawset( L, -3 );
+        }
+    }
+
+    lua_pushinteger( L, count );
+    lua_insert( L, -2 );
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  var_notify_prefix                                                         */
+/*!
+    var.notify_prefix()
+
+    Register a notification on every variable whose name starts with
+    the given prefix.  The variables are enumerated with a
+    VAR_GetFirst()/VAR_GetNext() query so the whole subtree is
+    subscribed without resolving each name from Lua.
+
+    On return, the number of successful registrations and a table of
+    failures are pushed onto the lua stack.  The failure table is keyed
+    by variable name and holds the error string.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_notify_prefix( lua_State *L )
+{
+    NotificationType notificationType;
+    VarQuery query;
+    VarObject obj;
+    char buf[MAX_NAME_LEN + 1];
+    const char *prefix;
+    size_t len;
+    lua_Integer count = 0;
+    uint64_t t0;
+    int result;
+    int rc;
+
+    STATS_Call( LUAVARS_CALL_NOTIFY_PREFIX );
+
+    prefix = luaL_checklstring( L, 1, &len );
+    notificationType = (NotificationType)luaL_checkinteger( L, 2 );
+
+    lua_newtable( L );
+
+    memset( &query, 0, sizeof query );
+    query.type = QUERY_MATCH;
+    query.match = (char *)prefix;
+
+    memset( &obj, 0, sizeof obj );
+    obj.val.str = buf;
+    obj.len = sizeof buf;
+
+    t0 = STATS_Now();
+    result = backend->getFirst( hVarServer, &query, &obj );
+    STATS_Ipc( LUAVARS_IPC_QUERY, t0, result == ENOENT ? EOK : result );
+
+    while( result == EOK )
+    {
+        /* QUERY_MATCH is a substring match: keep only the prefix */
+        if( strncmp( query.name, prefix, len ) == 0 )
+        {
+            EVENTLOG_Name( query.hVar, query.name );
+            rc = notify_register( query.hVar, notificationType );
+            if( rc == EOK )
+            {
+                count++;
+            }
+            else
+            {
+                lua_pushstring( L, strerror( rc ) );
+                lua_setfield( L, -2, query.name );
+            }
+        }
+
+        obj.val.str = buf;
+        obj.len = sizeof buf;
+
+        t0 = STATS_Now();
+        result = backend->getNext( hVarServer, &query, &obj );
+        STATS_Ipc( LUAVARS_IPC_QUERY, t0, result == ENOENT ? EOK : result );
+    }
+
+    lua_pushinteger( L, count );
+    lua_insert( L, -2 );
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  var_manifest                                                              */
+/*!
+    var.manifest()
+
+    Resolve a manifest of variable names and notifications in one
+    call.  The manifest is either a table or the path of a manifest
+    file (see manifest.c for the file format).  In a manifest table,
+    list entries are names which are only resolved, and name = value
+    entries give the notifications to register on the variable as a
+    NOTIFY_... value or a list of them, or true for none.
+
+    On success, a table mapping each name to its handle and a table
+    of failures keyed by name are pushed onto the lua stack.
+
+    On failure to load a manifest file, nil and the failure error
+    string are pushed onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_manifest( lua_State *L )
+{
+    int result;
+
+    if( lua_type( L, 1 ) == LUA_TSTRING )
+    {
+        result = MANIFEST_Load( L, lua_tostring( L, 1 ) );
+        if( result == EOK )
+        {
+            lua_replace( L, 1 );
+        }
+    }
+    else
+    {
+        luaL_checktype( L, 1, LUA_TTABLE );
+        result = EOK;
+    }
+
+    if( result == EOK )
+    {
+        manifest_resolve( L, 1 );
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+    }
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  manifest_resolve                                                          */
+/*!
+    Resolve a manifest table
+
+    All of the names are resolved first and then all of the
+    notifications are registered, so the lookups are issued back to
+    back instead of being interleaved with the script's start up.
+
+    The handle table and the failure table are pushed onto the lua
+    stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        idx
+            absolute stack index of the manifest table
+
+==============================================================================*/
+static void manifest_resolve( lua_State *L, int idx )
+{
+    int handles;
+    int failures;
+    VAR_HANDLE hVar;
+    const char *name;
+
+    lua_newtable( L );
+    handles = lua_gettop( L );
+    lua_newtable( L );
+    failures = lua_gettop( L );
+
+    /* resolve every name: list entries hold the name in the value,
+       name = notifications entries hold it in the key */
+    lua_pushnil( L );
+    while( lua_next( L, idx ) != 0 )
+    {
+        if( lua_type( L, -2 ) == LUA_TSTRING )
+        {
+            lua_pushvalue( L, -2 );
+        }
+        else
+        {
+            lua_pushvalue( L, -1 );
+        }
+
+        if( lua_type( L, -1 ) == LUA_TSTRING )
+        {
+            hVar = resolve_entry( L, -1 );
+            if( hVar != VAR_INVALID )
+            {
+                lua_pushnumber( L, hVar );
+                lua_rawset( L, handles );
+            }
+            else
+            {
+                lua_pushstring( L, strerror( ENOENT ) );
+                lua_rawset( L, failures );
+            }
+        }
+        else
+        {
+            lua_pop( L, 1 );
+        }
+
+        /* keep the key for lua_next() */
+        lua_pop( L, 1 );
+    }
+
+    /* register the notifications of the resolved variables */
+    lua_pushnil( L );
+    while( lua_next( L, idx ) != 0 )
+    {
+        if( lua_type( L, -2 ) == LUA_TSTRING )
+        {
+            name = lua_tostring( L, -2 );
+            lua_getfield( L, handles, name );
+            hVar = (VAR_HANDLE)lua_tonumber( L, -1 );
+            lua_pop( L, 1 );
+
+            if( hVar != VAR_INVALID )
+            {
+                manifest_notify( L, name, hVar, failures );
+            }
+        }
+
+        lua_pop( L, 1 );
+    }
+}
+
+/*============================================================================*/
+/*  manifest_notify                                                           */
+/*!
+    Register the notifications of one manifest entry
+
+    The notifications are given by the value on the top of the stack:
+    a NOTIFY_... value, a list of them, or any other value for none.
+    The first failure is recorded in the failure table.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        name
+            variable name
+
+    @param[in]
+        hVar
+            variable handle
+
+    @param[in]
+        failures
+            absolute stack index of the failure table
+
+==============================================================================*/
+static void manifest_notify( lua_State *L,
+                             const char *name,
+                             VAR_HANDLE hVar,
+                             int failures )
+{
+    int rc = EOK;
+    lua_Integer n;
+    lua_Integer i;
+
+    if( lua_type( L, -1 ) == LUA_TNUMBER )
+    {
+        rc = notify_register( hVar, (NotificationType)lua_tointeger( L, -1 ) );
+    }
+    else if( lua_type( L, -1 ) == LUA_TTABLE )
+    {
+        n = (lua_Integer)lua_rawlen( L, -1 );
+        for( i = 1; ( i <= n ) && ( rc == EOK ); i++ )
+        {
+            lua_rawgeti( L, -1, i );
+            rc = notify_register( hVar,
+                                  (NotificationType)lua_tointeger( L, -1 ) );
+            lua_pop( L, 1 );
+        }
+    }
+
+    if( rc != EOK )
+    {
+        lua_pushstring( L, strerror( rc ) );
+        lua_setfield( L, failures, name );
+    }
+}
+
+/*============================================================================*/
+/*  var_reconnect                                                             */
+/*!
+    var.reconnect()
+
+    Reconnect to the variable server when the library was loaded with
+    the reconnect backend (LUAVARS_BACKEND=reconnect).  The connection
+    is reopened, every variable name the script has resolved is
+    resolved again, and the notifications are registered again.  The
+    handles held by the script remain valid.
+
+    The reconnect backend does this by itself when an operation fails
+    because the connection was lost, and var.wait() checks for a
+    restart every LUAVARS_RESTART_CHECK_S seconds while it is blocked;
+    var.reconnect() lets a script or a supervisor force it.
+
+    On success the number of names resolved and the number of names
+    which no longer exist are pushed onto the lua stack.
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_reconnect( lua_State *L )
+{
+    int result;
+    size_t resolved = 0;
+    size_t failed = 0;
+
+    result = RECONNECT_Reconnect( hVarServer, &resolved, &failed );
+    if( result == EOK )
+    {
+        lua_pushinteger( L, (lua_Integer)resolved );
+        lua_pushinteger( L, (lua_Integer)failed );
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+    }
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  var_mirror_publish                                                        */
+/*!
+    var.mirror_publish()
+
+    Publish a set of variables to a shared memory mirror which other
+    Lua processes on the host attach to with var.mirror_attach(), or
+    the LUAVARS_MIRROR environment variable, so that their var.get()
+    calls for these variables make no variable server requests.
+
+    The segment name (e.g. "/luavars"), a list of variable names, and
+    optionally the number of slots in the segment are passed in on the
+    lua stack.  A modified notification is registered on each
+    variable; the publisher keeps the mirror current by calling
+    var.wait(), which services these notifications itself.
+
+    On success, the number of variables published and a table of
+    failures keyed by variable name are pushed onto the lua stack.
+
+    On failure to create the segment, nil and the failure error
+    string are pushed onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_mirror_publish( lua_State *L )
+{
+    const char *segment;
+    const char *name;
+    lua_Integer slots;
+    lua_Integer count = 0;
+    lua_Integer n;
+    lua_Integer i;
+    VAR_HANDLE hVar;
+    int result;
+    int rc;
+
+    segment = luaL_checkstring( L, 1 );
+    luaL_checktype( L, 2, LUA_TTABLE );
+    slots = luaL_optinteger( L, 3, MIRROR_DEFAULT_SLOTS );
+    luaL_argcheck( L,
+                   ( slots > 0 ) && ( slots <= MIRROR_MAX_SLOTS ),
+                   3,
+                   "invalid number of slots" );
+
+    result = MIRROR_Publish( segment, (size_t)slots, hVarServer );
+    if( result == EOK )
+    {
+        lua_newtable( L );
+
+        n = (lua_Integer)lua_rawlen( L, 2 );
+        for( i = 1; i <= n; i++ )
+        {
+            lua_rawgeti( L, 2, i );
+            name = lua_tostring( L, -1 );
+            hVar = ( name != NULL ) ? resolve_entry( L, -1 ) : VAR_INVALID;
+
+            rc = ( hVar != VAR_INVALID ) ? MIRROR_Add( name, hVar ) : ENOENT;
+            if( rc == EOK )
+            {
+                rc = notify_register( hVar, NOTIFY_MODIFIED );
+            }
+
+            if( rc == EOK )
+            {
+                count++;
+                lua_pop( L, 1 );
+            }
+            else
+            {
+                lua_pushstring( L, strerror( rc ) );
+                lua_rawset( L, -3 );
+            }
+        }
+
+        lua_pushinteger( L, count );
+        lua_insert( L, -2 );
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+    }
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  var_mirror_attach                                                         */
+/*!
+    var.mirror_attach()
+
+    Attach to a shared memory mirror published by another process.
+    var.get() then reads the mirrored variables from shared memory and
+    only makes variable server requests for other names.
+
+    The segment name is passed in on the lua stack
+
+    On success this function pushes 1 onto the Lua stack
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_mirror_attach( lua_State *L )
+{
+    int result;
+
+    result = MIRROR_Attach( luaL_checkstring( L, 1 ) );
+    if( result == EOK )
+    {
+        lua_pushnumber( L, 1 );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_connections                                                           */
+/*!
+    var.connections()
+
+    Configure additional variable server connections so that a slow
+    synchronous request does not delay event handling behind it, and
+    event handling does not delay the replies which other clients are
+    blocked on.
+
+    An optional table is passed in on the lua stack, with boolean
+    "sync" and "reply" fields.  The sync connection carries var.get(),
+    var.set() and var.find() requests.  The reply connection carries
+    validation requests and responses, and print sessions.  Fields
+    which are absent leave the connection unchanged, and false closes
+    it so its requests return to the event connection.
+
+    Variables which this process has calc, validate or print
+    notifications registered on are always accessed on the event
+    connection, since the variable server recognises the owner of
+    these notifications by its connection.
+
+    On success, a table of booleans keyed by connection role is pushed
+    onto the lua stack showing which connections are open.
+
+    On failure, nil and the failure error string are pushed onto the
+    lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return number of values pushed onto the lua stack
+
+==============================================================================*/
+static int var_connections( lua_State *L )
+{
+    int result = EOK;
+    int rc;
+    int i;
+
+    if( lua_isnoneornil( L, 1 ) == false )
+    {
+        luaL_checktype( L, 1, LUA_TTABLE );
+
+        for( i = LUAVARS_CONN_SYNC; i < LUAVARS_CONN_MAX; i++ )
+        {
+            lua_getfield( L, 1, connNames[i] );
+            if( lua_type( L, -1 ) == LUA_TBOOLEAN )
+            {
+                rc = conn_open( (LuaVarsConn)i, lua_toboolean( L, -1 ) );
+                result = ( result == EOK ) ? rc : result;
+            }
+
+            lua_pop( L, 1 );
+        }
+    }
+
+    if( result == EOK )
+    {
+        lua_newtable( L );
+        for( i = 0; i < LUAVARS_CONN_MAX; i++ )
+        {
+            lua_pushboolean( L,
+                             ( i == LUAVARS_CONN_EVENT ) ||
+                             ( hConn[i] != NULL ) );
+            lua_setfield( L, -2, connNames[i] );
+        }
+
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_unnotify                                                              */
+/*!
+    var.unnotify()
+
+    This var.unnotify() function interfaces to the VAR_NotifyCancel()
+    function in the libvarserver.so library.  It stops the signals for
+    a notification registered with var.notify() so a script which no
+    longer cares about a variable is not woken on every change.
+
+    Registrations are counted, so the variable server registration is
+    kept while a watch set or bound table still holds the notification,
+    and a notification registered twice must be cancelled twice.
+
+    The variable name or handle and the type of notification to cancel
+    are passed in on the lua stack
+
+    On success this function pushes 1 onto the Lua stack
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_unnotify( lua_State *L )
+{
+    int result;
+    VAR_HANDLE hVar;
+    NotificationType notificationType;
+
+    STATS_Call( LUAVARS_CALL_UNNOTIFY );
+
+    luaL_checkany( L, 1 );
+    notificationType = (NotificationType)luaL_checkinteger( L, 2 );
+
+    hVar = resolve_entry( L, 1 );
+    result = ( hVar != VAR_INVALID ) ? notify_cancel( hVar,
+                                                      notificationType )
+                                     : ENOENT;
+    if( result == EOK )
+    {
+        lua_pushnumber( L, 1 );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_watch                                                                 */
+/*!
+    var.watch()
+
+    Register a notification on a list of variables and return a watch
+    set object which owns the registrations.  The notifications are
+    cancelled by the watch set's cancel() method, or automatically
+    when the watch set is garbage collected, so a dynamic script can
+    drop interest in a group of variables just by dropping the object.
+
+    A list of variable names and/or handles and the type of
+    notification are passed in on the lua stack.
+
+    On return, the watch set and a table of failures keyed by the list
+    entry which failed are pushed onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_watch( lua_State *L )
+{
+    LuaWatchSet *pWatchSet;
+    NotificationType notificationType;
+    VAR_HANDLE hVar;
+    lua_Integer n;
+    lua_Integer i;
+    int rc;
+
+    STATS_Call( LUAVARS_CALL_WATCH );
+
+    luaL_checktype( L, 1, LUA_TTABLE );
+    notificationType = (NotificationType)luaL_checkinteger( L, 2 );
+
+    n = (lua_Integer)lua_rawlen( L, 1 );
+
+    pWatchSet = lua_newuserdatauv( L,
+                                   sizeof( LuaWatchSet ) +
+                                   (size_t)n * sizeof( VAR_HANDLE ),
+                                   0 );
+    pWatchSet->type = notificationType;
+    pWatchSet->count = 0;
+    luaL_setmetatable( L, LUAVARS_WATCHSET );
+
+    lua_newtable( L );
+
+    for( i = 1; i <= n; i++ )
+    {
+        lua_rawgeti( L, 1, i );
+        hVar = resolve_entry( L, -1 );
+
+        rc = ( hVar != VAR_INVALID ) ? notify_register( hVar,
+                                                        notificationType )
+                                     : ENOENT;
+        if( rc == EOK )
+        {
+            pWatchSet->handles[pWatchSet->count++] = hVar;
+            lua_pop( L, 1 );
+        }
+        else
+        {
+            lua_pushstring( L, strerror( rc ) );
+            lua_rawset( L, -3 );
+        }
+    }
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  watchset_cancel                                                           */
+/*!
+    watchset:cancel()
+
+    Cancel every notification held by a watch set.  The number of
+    notifications cancelled is pushed onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int watchset_cancel( lua_State *L )
+{
+    LuaWatchSet *pWatchSet;
+
+    pWatchSet = (LuaWatchSet *)luaL_checkudata( L, 1, LUAVARS_WATCHSET );
+    lua_pushinteger( L, (lua_Integer)watchset_release( pWatchSet ) );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  watchset_handles                                                          */
+/*!
+    watchset:handles()
+
+    Push a list of the variable handles with an active notification
+    in the watch set onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int watchset_handles( lua_State *L )
+{
+    LuaWatchSet *pWatchSet;
+    size_t i;
+
+    pWatchSet = (LuaWatchSet *)luaL_checkudata( L, 1, LUAVARS_WATCHSET );
+
+    lua_createtable( L, (int)pWatchSet->count, 0 );
+    for( i = 0; i < pWatchSet->count; i++ )
+    {
+        lua_pushinteger( L, (lua_Integer)pWatchSet->handles[i] );
+        lua_rawseti( L, -2, (lua_Integer)( i + 1 ) );
+    }
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  watchset_gc                                                               */
+/*!
+    Cancel the notifications of a garbage collected watch set
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int watchset_gc( lua_State *L )
+{
+    LuaWatchSet *pWatchSet;
+
+    pWatchSet = (LuaWatchSet *)luaL_checkudata( L, 1, LUAVARS_WATCHSET );
+    (void)watchset_release( pWatchSet );
+
+    return 0;
+}
+
+/*============================================================================*/
+/*  watchset_release                                                          */
+/*!
+    Cancel the notifications held by a watch set
+
+    The watch set is left empty so releasing it again does nothing.
+    Nothing is cancelled once the variable server connection has been
+    closed.
+
+    @param[in]
+        pWatchSet
+            pointer to the watch set
+
+    @return the number of notifications cancelled
+
+==============================================================================*/
+static size_t watchset_release( LuaWatchSet *pWatchSet )
+{
+    size_t cancelled = 0;
+    size_t i;
+
+    if( hVarServer != NULL )
+    {
+        for( i = 0; i < pWatchSet->count; i++ )
+        {
+            if( notify_cancel( pWatchSet->handles[i],
+                               pWatchSet->type ) == EOK )
+            {
+                cancelled++;
+            }
+        }
+    }
+
+    pWatchSet->count = 0;
+
+    return cancelled;
+}
+
+/*============================================================================*/
+/*  var_bind                                                                  */
+/*!
+    var.bind()
+
+    Bind the fields of a Lua table to a group of variables
+
+    A table, a map of field names to variable names or handles, and
+    optionally the number of threads to read the initial values with,
+    are passed in on the lua stack.  Reading a bound field returns
+    the cached value of its variable, which is read again only after
+    a modified notification for the variable.  Writing a bound field
+    updates the cache and marks the field dirty, and the dirty fields
+    of every binding are set in one batch by the next var.wait() or
+    var.flush().  The failures of the writes set by var.wait() are
+    returned by var.flush_errors().
+
+    The table must not already have a metatable, and blob variables
+    cannot be bound.  Any existing values of the bound fields are
+    replaced by the variable values.  The modified notifications are
+    cancelled when the table is garbage collected.
+
+    On return, the table and a table of failures keyed by field are
+    pushed onto the lua stack.  On failure to start the threads, nil
+    and the failure error string are pushed onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_bind( lua_State *L )
+{
+    LuaBinding *pBinding;
+    LuaBoundVar *pVar;
+    FetchEntry *entries = NULL;
+    VAR_HANDLE hVar;
+    size_t n = 0;
+    size_t i;
+    int result;
+    int rc;
+
+    STATS_Call( LUAVARS_CALL_BIND );
+
+    luaL_checktype( L, 1, LUA_TTABLE );
+    luaL_checktype( L, 2, LUA_TTABLE );
+    luaL_argcheck( L,
+                   lua_getmetatable( L, 1 ) == 0,
+                   1,
+                   "table already has a metatable" );
+    result = fetch_pool( L, 3 );
+
+    lua_settop( L, 2 );
+
+    /* list of the fields, and the failures */
+    lua_newtable( L );
+    lua_newtable( L );
+
+    lua_pushnil( L );
+    while( lua_next( L, 2 ) != 0 )
+    {
+        lua_pop( L, 1 );
+        lua_pushvalue( L, -1 );
+        lua_rawseti( L, 3, (lua_Integer)++n );
+    }
+
+    if( ( result == EOK ) && ( n > 0 ) )
+    {
+        entries = calloc( n, sizeof( FetchEntry ) );
+        result = ( entries != NULL ) ? EOK : ENOMEM;
+    }
+
+    /* register the notifications before reading the values so no
+       change is missed */
+    for( i = 0; ( result == EOK ) && ( i < n ); i++ )
+    {
+        lua_rawgeti( L, 3, (lua_Integer)i + 1 );
+        lua_rawget( L, 2 );
+        hVar = resolve_entry( L, -1 );
+        lua_pop( L, 1 );
+
+        rc = ( hVar != VAR_INVALID ) ? notify_register( hVar,
+                                                        NOTIFY_MODIFIED )
+                                     : ENOENT;
+        if( rc == EOK )
+        {
+            entries[i].hVar = hVar;
+        }
+        else
+        {
+            lua_rawgeti( L, 3, (lua_Integer)i + 1 );
+            lua_pushstring( L, strerror( rc ) );
+            lua_rawset( L, 4 );
+        }
+    }
+
+    if( result == EOK )
+    {
+        result = FETCH_Get( pFetch,
+                            conn( LUAVARS_CONN_SYNC, VAR_INVALID ),
+                            hVarServer,
+                            conn_local,
+                            entries,
+                            n );
+    }
+
+    if( result == EOK )
+    {
+        pBinding = lua_newuserdatauv( L,
+                                      sizeof( LuaBinding ) +
+                                      n * sizeof( LuaBoundVar ),
+                                      3 );
+        pBinding->count = 0;
+        pBinding->dirty = 0;
+        luaL_setmetatable( L, LUAVARS_BINDING );
+
+        /* cached values and field indexes by field, and fields by
+           index, at 6, 7 and 8 */
+        lua_createtable( L, 0, (int)n );
+        lua_createtable( L, 0, (int)n );
+        lua_createtable( L, (int)n, 0 );
+        bind_registry( L, LUAVARS_BOUND );
+
+        for( i = 0; i < n; i++ )
+        {
+            hVar = entries[i].hVar;
+            rc = entries[i].result;
+
+            lua_rawgeti( L, 3, (lua_Integer)i + 1 );
+
+            if( hVar == VAR_INVALID )
+            {
+                /* the failure is already recorded */
+            }
+            else if( ( rc == EOK ) &&
+                     ( entries[i].obj.type != VARTYPE_BLOB ) &&
+                     ( push_var( L, &entries[i].obj ) == 1 ) )
+            {
+                pVar = &pBinding->vars[pBinding->count++];
+                pVar->hVar = hVar;
+                pVar->type = entries[i].obj.type;
+                pVar->stale = false;
+                pVar->dirty = false;
+                numBound++;
+
+                lua_pushvalue( L, 10 );
+                lua_insert( L, -2 );
+                lua_rawset( L, 6 );
+
+                lua_pushvalue( L, 10 );
+                lua_pushinteger( L, (lua_Integer)pBinding->count );
+                lua_rawset( L, 7 );
+
+                lua_pushvalue( L, 10 );
+                lua_rawseti( L, 8, (lua_Integer)pBinding->count );
+
+                /* notifications for the handle find the binding */
+                if( lua_rawgeti( L, 9, (lua_Integer)hVar ) != LUA_TTABLE )
+                {
+                    lua_pop( L, 1 );
+                    lua_newtable( L );
+                    lua_createtable( L, 0, 1 );
+                    lua_pushstring( L, "k" );
+                    lua_setfield( L, -2, "__mode" );
+                    lua_setmetatable( L, -2 );
+                    lua_pushvalue( L, -1 );
+                    lua_rawseti( L, 9, (lua_Integer)hVar );
+                }
+
+                lua_pushvalue( L, 5 );
+                lua_pushboolean( L, 1 );
+                lua_rawset( L, -3 );
+
+                /* reads of the field go through the metatable */
+                lua_pushvalue( L, 10 );
+                lua_pushnil( L );
+                lua_rawset( L, 1 );
+            }
+            else
+            {
+                (void)notify_cancel( hVar, NOTIFY_MODIFIED );
+
+                rc = ( rc == EOK ) ? ENOTSUP : rc;
+                lua_pushvalue( L, 10 );
+                lua_pushstring( L, strerror( rc ) );
+                lua_rawset( L, 4 );
+            }
+
+            lua_settop( L, 9 );
+        }
+
+        lua_pushvalue( L, 6 );
+        lua_setiuservalue( L, 5, 1 );
+        lua_pushvalue( L, 7 );
+        lua_setiuservalue( L, 5, 2 );
+        lua_pushvalue( L, 8 );
+        lua_setiuservalue( L, 5, 3 );
+
+        lua_createtable( L, 0, 2 );
+        lua_pushvalue( L, 5 );
+        lua_pushcclosure( L, bind_index, 1 );
+        lua_setfield( L, -2, "__index" );
+        lua_pushvalue( L, 5 );
+        lua_pushcclosure( L, bind_newindex, 1 );
+        lua_setfield( L, -2, "__newindex" );
+        lua_setmetatable( L, 1 );
+
+        lua_pushvalue( L, 1 );
+        lua_pushvalue( L, 4 );
+    }
+    else
+    {
+        /* release the notifications registered for the bindings */
+        for( i = 0; ( entries != NULL ) && ( i < n ); i++ )
+        {
+            if( entries[i].hVar != VAR_INVALID )
+            {
+                (void)notify_cancel( entries[i].hVar, NOTIFY_MODIFIED );
+            }
+        }
+
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+    }
+
+    FETCH_Release( entries, n );
+    free( entries );
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  var_flush                                                                 */
+/*!
+    var.flush()
+
+    Set the variables of the dirty fields of every bound table in one
+    batch, which var.wait() otherwise does before waiting for the
+    next notification.
+
+    The number of variables set and a table of failures keyed by
+    variable handle are pushed onto the lua stack.  A field which
+    failed to be set is read from its variable again.  On failure,
+    nil and the failure error string are pushed onto the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 2
+
+==============================================================================*/
+static int var_flush( lua_State *L )
+{
+    lua_Integer count = 0;
+    int result;
+
+    STATS_Call( LUAVARS_CALL_FLUSH );
+
+    lua_settop( L, 0 );
+    lua_newtable( L );
+
+    result = bind_flush( L, 1, &count );
+    if( result == EOK )
+    {
+        lua_pushinteger( L, count );
+        lua_insert( L, 1 );
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+    }
+
+    return 2;
+}
+
+/*============================================================================*/
+/*  var_flush_errors                                                          */
+/*!
+    var.flush_errors()
+
+    Get the failures of the bound field writes set by var.wait()
+
+    A table of the error strings keyed by variable handle, for the
+    writes which failed since the last call, is pushed onto the lua
+    stack.  The failures are cleared.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int var_flush_errors( lua_State *L )
+{
+    STATS_Call( LUAVARS_CALL_FLUSH_ERRORS );
+
+    bind_registry( L, LUAVARS_FLUSH_ERRORS );
+    lua_pushnil( L );
+    lua_setfield( L, LUA_REGISTRYINDEX, LUAVARS_FLUSH_ERRORS );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  bind_index                                                                */
+/*!
+    Read a field of a bound table
+
+    The binding is the first upvalue.  A stale field is read from its
+    variable before its cached value is returned.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int bind_index( lua_State *L )
+{
+    LuaBinding *pBinding;
+    lua_Integer i;
+
+    pBinding = (LuaBinding *)lua_touserdata( L, lua_upvalueindex( 1 ) );
+
+    lua_getiuservalue( L, lua_upvalueindex( 1 ), 2 );
+    lua_pushvalue( L, 2 );
+    lua_rawget( L, -2 );
+    i = lua_tointeger( L, -1 );
+
+    lua_settop( L, 2 );
+    lua_getiuservalue( L, lua_upvalueindex( 1 ), 1 );
+
+    if( ( i > 0 ) &&
+        ( (size_t)i <= pBinding->count ) &&
+        ( pBinding->vars[i - 1].stale == true ) )
+    {
+        bind_refresh( L, 3, 2, &pBinding->vars[i - 1] );
+    }
+
+    lua_pushvalue( L, 2 );
+    lua_rawget( L, 3 );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  bind_newindex                                                             */
+/*!
+    Write a field of a bound table
+
+    The binding is the first upvalue.  A bound field is converted to
+    the type of its variable, cached and marked dirty.  Other fields
+    are stored in the table.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int bind_newindex( lua_State *L )
+{
+    LuaBinding *pBinding;
+    LuaBoundVar *pVar;
+    lua_Integer i;
+
+    pBinding = (LuaBinding *)lua_touserdata( L, lua_upvalueindex( 1 ) );
+
+    lua_getiuservalue( L, lua_upvalueindex( 1 ), 2 );
+    lua_pushvalue( L, 2 );
+    lua_rawget( L, -2 );
+    i = lua_tointeger( L, -1 );
+
+    lua_settop( L, 3 );
+
+    if( ( i > 0 ) && ( (size_t)i <= pBinding->count ) )
+    {
+        pVar = &pBinding->vars[i - 1];
+
+        /* cache the value as var.get() would return it */
+        if( pVar->type == VARTYPE_STR )
+        {
+            luaL_argcheck( L,
+                           lua_isstring( L, 3 ) != 0,
+                           3,
+                           "string expected" );
+            (void)lua_tostring( L, 3 );
+        }
+        else
+        {
+            luaL_argcheck( L,
+                           lua_isnumber( L, 3 ) != 0,
+                           3,
+                           "number expected" );
+        }
+
+        if( ( pVar->type != VARTYPE_STR ) &&
+            ( lua_type( L, 3 ) != LUA_TNUMBER ) )
+        {
+            lua_pushnumber( L, lua_tonumber( L, 3 ) );
+            lua_replace( L, 3 );
+        }
+
+        lua_getiuservalue( L, lua_upvalueindex( 1 ), 1 );
+        lua_pushvalue( L, 2 );
+        lua_pushvalue( L, 3 );
+        lua_rawset( L, -3 );
+
+        pVar->stale = false;
+        if( pVar->dirty == false )
+        {
+            pVar->dirty = true;
+            numDirty++;
+
+            if( pBinding->dirty++ == 0 )
+            {
+                bind_registry( L, LUAVARS_DIRTY );
+                lua_pushvalue( L, lua_upvalueindex( 1 ) );
+                lua_pushboolean( L, 1 );
+                lua_rawset( L, -3 );
+            }
+        }
+    }
+    else
+    {
+        lua_rawset( L, 1 );
+    }
+
+    return 0;
+}
+
+/*============================================================================*/
+/*  binding_gc                                                                */
+/*!
+    Cancel the notifications of a garbage collected binding
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int binding_gc( lua_State *L )
+{
+    LuaBinding *pBinding;
+    size_t i;
+
+    pBinding = (LuaBinding *)luaL_checkudata( L, 1, LUAVARS_BINDING );
+
+    for( i = 0; i < pBinding->count; i++ )
+    {
+        if( hVarServer != NULL )
+        {
+            (void)notify_cancel( pBinding->vars[i].hVar, NOTIFY_MODIFIED );
+        }
+
+        if( pBinding->vars[i].dirty == true )
+        {
+            numDirty--;
+        }
+    }
+
+    numBound -= pBinding->count;
+    pBinding->count = 0;
+    pBinding->dirty = 0;
+
+    return 0;
+}
+
+/*============================================================================*/
+/*  bind_registry                                                             */
+/*!
+    Push a table of the bindings from the Lua registry, creating it if
+    it does not exist
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        key
+            registry key of the table
+
+==============================================================================*/
+static void bind_registry( lua_State *L, const char *key )
+{
+    if( lua_getfield( L, LUA_REGISTRYINDEX, key ) != LUA_TTABLE )
+    {
+        lua_pop( L, 1 );
+        lua_newtable( L );
+        lua_pushvalue( L, -1 );
+        lua_setfield( L, LUA_REGISTRYINDEX, key );
+    }
+}
+
+/*============================================================================*/
+/*  bind_refresh                                                              */
+/*!
+    Read the value of a stale bound field from its variable
+
+    The cached value is kept if the variable cannot be read.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        store
+            stack index of the binding's cached values
+
+    @param[in]
+        key
+            stack index of the field
+
+    @param[in]
+        pVar
+            pointer to the bound variable
+
+==============================================================================*/
+static void bind_refresh( lua_State *L,
+                          int store,
+                          int key,
+                          LuaBoundVar *pVar )
+{
+    VarObject obj;
+    char buf[BUFSIZ];
+    uint64_t t0;
+    int rc;
+
+    memset( &obj, 0, sizeof( VarObject ) );
+    obj.val.str = buf;
+    obj.len = BUFSIZ;
+
+    t0 = STATS_Now();
+    rc = backend->get( conn( LUAVARS_CONN_SYNC, pVar->hVar ),
+                       pVar->hVar,
+                       &obj );
+    STATS_Ipc( LUAVARS_IPC_GET, t0, rc );
+
+    if( rc == EOK )
+    {
+        JOURNAL_Record( JOURNAL_SOURCE_GET, pVar->hVar, &obj );
+
+        lua_pushvalue( L, key );
+        if( push_var( L, &obj ) == 1 )
+        {
+            lua_rawset( L, store );
+            pVar->stale = false;
+        }
+        else
+        {
+            lua_pop( L, 1 );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  bind_invalidate                                                           */
+/*!
+    Mark the bound fields of a modified variable stale
+
+    Fields with an unflushed write keep their value.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        hVar
+            handle of the modified variable
+
+==============================================================================*/
+static void bind_invalidate( lua_State *L, VAR_HANDLE hVar )
+{
+    LuaBinding *pBinding;
+    size_t i;
+    int top;
+
+    if( numBound > 0 )
+    {
+        top = lua_gettop( L );
+
+        bind_registry( L, LUAVARS_BOUND );
+        if( lua_rawgeti( L, -1, (lua_Integer)hVar ) == LUA_TTABLE )
+        {
+            lua_pushnil( L );
+            while( lua_next( L, -2 ) != 0 )
+            {
+                pBinding = (LuaBinding *)lua_touserdata( L, -2 );
+                for( i = 0; i < pBinding->count; i++ )
+                {
+                    if( ( pBinding->vars[i].hVar == hVar ) &&
+                        ( pBinding->vars[i].dirty == false ) )
+                    {
+                        pBinding->vars[i].stale = true;
+                    }
+                }
+
+                lua_pop( L, 1 );
+            }
+        }
+
+        lua_settop( L, top );
+    }
+}
+
+/*============================================================================*/
+/*  bind_flush                                                                */
+/*!
+    Set the variables of the dirty fields of every binding in one batch
+
+    The batch is set with the threads of the last batched call.  The
+    dirty fields are clean afterwards, and those which failed to be
+    set are marked stale so they are read from their variables again.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        failures
+            stack index of a table to store failures in keyed by
+            variable handle, or 0 to discard them
+
+    @param[out]
+        pCount
+            the number of variables set is returned here, if not NULL
+
+    @retval EOK the batch was set
+    @retval ENOMEM out of memory, the fields remain dirty
+
+==============================================================================*/
+static int bind_flush( lua_State *L, int failures, lua_Integer *pCount )
+{
+    FetchEntry *entries = NULL;
+    LuaBoundVar **ppVars = NULL;
+    LuaBinding *pBinding;
+    lua_Integer count = 0;
+    size_t n = 0;
+    size_t i;
+    size_t j;
+    int result = EOK;
+    int top;
+
+    if( numDirty > 0 )
+    {
+        entries = calloc( numDirty, sizeof( FetchEntry ) );
+        ppVars = calloc( numDirty, sizeof( LuaBoundVar * ) );
+        result = ( ( entries != NULL ) && ( ppVars != NULL ) ) ? EOK
+                                                                : ENOMEM;
+    }
+
+    if( ( numDirty > 0 ) && ( result == EOK ) )
+    {
+        top = lua_gettop( L );
+
+        /* the dirty bindings keep the string values referenced until
+           the batch is done */
+        bind_registry( L, LUAVARS_DIRTY );
+        lua_newtable( L );
+        lua_setfield( L, LUA_REGISTRYINDEX, LUAVARS_DIRTY );
+
+        lua_pushnil( L );
+        while( lua_next( L, top + 1 ) != 0 )
+        {
+            lua_pop( L, 1 );
+            pBinding = (LuaBinding *)lua_touserdata( L, -1 );
+            lua_getiuservalue( L, -1, 1 );
+            lua_getiuservalue( L, -2, 3 );
+
+            for( j = 0; ( j < pBinding->count ) && ( n < numDirty ); j++ )
+            {
+                if( pBinding->vars[j].dirty == true )
+                {
+                    lua_rawgeti( L, -1, (lua_Integer)j + 1 );
+                    lua_rawget( L, -3 );
+                    entries[n].hVar = pBinding->vars[j].hVar;
+                    bind_value( L,
+                                -1,
+                                pBinding->vars[j].type,
+                                &entries[n].obj );
+                    ppVars[n++] = &pBinding->vars[j];
+                    lua_pop( L, 1 );
+                }
+            }
+
+            pBinding->dirty = 0;
+            lua_pop( L, 2 );
+        }
+
+        numDirty = 0;
+
+        result = FETCH_Set( pFetch,
+                            conn( LUAVARS_CONN_SYNC, VAR_INVALID ),
+                            hVarServer,
+                            conn_local,
+                            entries,
+                            n );
+
+        for( i = 0; i < n; i++ )
+        {
+            if( result != EOK )
+            {
+                entries[i].result = result;
+            }
+
+            ppVars[i]->dirty = false;
+            if( entries[i].result == EOK )
+            {
+                JOURNAL_Record( JOURNAL_SOURCE_SET,
+                                entries[i].hVar,
+                                &entries[i].obj );
+                count++;
+            }
+            else
+            {
+                ppVars[i]->stale = true;
+
+                if( failures != 0 )
+                {
+                    lua_pushnumber( L, entries[i].hVar );
+                    lua_pushstring( L, strerror( entries[i].result ) );
+                    lua_rawset( L, failures );
+                }
+            }
+        }
+
+        lua_settop( L, top );
+        result = EOK;
+    }
+
+    if( pCount != NULL )
+    {
+        *pCount = count;
+    }
+
+    free( entries );
+    free( ppVars );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  bind_value                                                                */
+/*!
+    Convert a cached bound value to a variable value
+
+    String values point to the Lua string, which must remain
+    referenced while the value is used.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        idx
+            stack index of the cached value
+
+    @param[in]
+        type
+            type of the variable
+
+    @param[out]
+        obj
+            the variable value is returned here
+
+==============================================================================*/
+static void bind_value( lua_State *L, int idx, VarType type, VarObject *obj )
+{
+    lua_Integer i;
+    lua_Number d;
+
+    memset( obj, 0, sizeof( VarObject ) );
+    obj->type = type;
+
+    i = ( lua_isinteger( L, idx ) != 0 ) ? lua_tointeger( L, idx )
+                                          : (lua_Integer)lua_tonumber( L, idx );
+    d = lua_tonumber( L, idx );
+
+    switch( type )
+    {
+        case VARTYPE_STR:
+            obj->val.str = (char *)lua_tostring( L, idx );
+            obj->len = ( obj->val.str != NULL ) ? strlen( obj->val.str ) + 1
+                                                : 0;
+            break;
+
+        case VARTYPE_UINT16:
+            obj->val.ui = (uint16_t)i;
+            break;
+
+        case VARTYPE_INT16:
+            obj->val.i = (int16_t)i;
+            break;
+
+        case VARTYPE_UINT32:
+            obj->val.ul = (uint32_t)i;
+            break;
+
+        case VARTYPE_INT32:
+            obj->val.l = (int32_t)i;
+            break;
+
+        case VARTYPE_UINT64:
+            obj->val.ull = (uint64_t)i;
+            break;
+
+        case VARTYPE_INT64:
+            obj->val.ll = (int64_t)i;
+            break;
+
+        case VARTYPE_FLOAT:
+            obj->val.f = (float)d;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*============================================================================*/
+/*  resolve_entry                                                             */
+/*!
+    Get the variable handle for a name or handle on the lua stack
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        idx
+            stack index of the variable name or handle
+
+    @return the variable handle, or VAR_INVALID if the name was not
+            found or the value is neither a name nor a handle
+
+==============================================================================*/
+static VAR_HANDLE resolve_entry( lua_State *L, int idx )
+{
+    VAR_HANDLE hVar = VAR_INVALID;
+    char *name;
+    uint64_t t0;
+
+    if( lua_type( L, idx ) == LUA_TSTRING )
+    {
+        name = (char *)lua_tostring( L, idx );
+        t0 = STATS_Now();
+        hVar = backend->find( conn( LUAVARS_CONN_SYNC, VAR_INVALID ), name );
+        STATS_Ipc( LUAVARS_IPC_FIND,
+                   t0,
+                   hVar != VAR_INVALID ? EOK : ENOENT );
+        EVENTLOG_Name( hVar, name );
+    }
+    else if( lua_type( L, idx ) == LUA_TNUMBER )
+    {
+        hVar = (VAR_HANDLE)lua_tonumber( L, idx );
+    }
+
+    return hVar;
+}
+
+/*============================================================================*/
+/*  notify_register                                                           */
+/*!
+    Register a notification on behalf of the script, a watch set, a
+    bound table, a load generator or the startup manifest
+
+    Registrations are counted per variable and notification type, and
+    only the first one is sent to the variable server.
+
+    @param[in]
+        hVar
+            handle of the variable to register the notification on
+
+    @param[in]
+        type
+            type of notification to register
+
+    @retval EOK the notification was registered
+    @retval other error from the backend
+
+==============================================================================*/
+static int notify_register( VAR_HANDLE hVar, NotificationType type )
+{
+    int result = EOK;
+    uint64_t t0;
+
+    LUAVARS_PROBE2( notify__entry, hVar, type );
+    if( notify_refs( hVar, type, 0 ) == 0 )
+    {
+        t0 = STATS_Now();
+        result = backend->notify( hVarServer, hVar, type );
+        STATS_Ipc( LUAVARS_IPC_NOTIFY, t0, result );
+    }
+    LUAVARS_PROBE3( notify__return, hVar, type, result );
+
+    if( result == EOK )
+    {
+        (void)notify_refs( hVar, type, 1 );
+        conn_own( hVar, type, true );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  notify_cancel                                                             */
+/*!
+    Cancel a notification on behalf of var.unnotify(), watch sets and
+    bound tables
+
+    This releases one registration made with notify_register().  The
+    variable server registration is only cancelled when the last one
+    is released, so a watch set or bound table which is collected does
+    not cancel a notification the script registered itself.
+
+    @param[in]
+        hVar
+            handle of the variable to cancel the notification on
+
+    @param[in]
+        type
+            type of notification to cancel
+
+    @retval EOK the notification was cancelled
+    @retval other error from the backend
+
+==============================================================================*/
+static int notify_cancel( VAR_HANDLE hVar, NotificationType type )
+{
+    int result = EOK;
+    uint64_t t0;
+
+    if( notify_refs( hVar, type, 0 ) <= 1 )
+    {
+        t0 = STATS_Now();
+        result = backend->notifyCancel( hVarServer, hVar, type );
+        STATS_Ipc( LUAVARS_IPC_NOTIFY_CANCEL, t0, result );
+    }
+
+    if( ( result == EOK ) && ( notify_refs( hVar, type, -1 ) == 0 ) )
+    {
+        conn_own( hVar, type, false );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  notify_refs                                                               */
+/*!
+    Count the registrations of a notification on a variable
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        type
+            type of notification
+
+    @param[in]
+        delta
+            1 to add a registration, -1 to release one, or 0 to only
+            get the count
+
+    @return the number of registrations after the change.  Types which
+            are not counted always have no registrations.
+
+==============================================================================*/
+static uint32_t notify_refs( VAR_HANDLE hVar,
+                             NotificationType type,
+                             int delta )
+{
+    uint32_t count = 0;
+    LuaNotifyRefs *p;
+    size_t n;
+
+    if( ( (int)type >= 0 ) && ( type < LUAVARS_NOTIFY_TYPES ) )
+    {
+        if( ( hVar >= numNotifyRefs ) && ( delta > 0 ) )
+        {
+            n = ( (size_t)hVar + 1 ) * 2;
+            p = realloc( notifyRefs, n * sizeof( LuaNotifyRefs ) );
+            if( p != NULL )
+            {
+                memset( &p[numNotifyRefs],
+                        0,
+                        ( n - numNotifyRefs ) * sizeof( LuaNotifyRefs ) );
+                notifyRefs = p;
+                numNotifyRefs = n;
+            }
+        }
+
+        if( hVar < numNotifyRefs )
+        {
+            count = notifyRefs[hVar].count[type];
+            if( delta > 0 )
+            {
+                count++;
+            }
+            else if( ( delta < 0 ) && ( count > 0 ) )
+            {
+                count--;
+            }
+
+            notifyRefs[hVar].count[type] = count;
+        }
+    }
+
+    return count;
+}
+
+/*============================================================================*/
+/*  conn                                                                      */
+/*!
+    Select the variable server connection for a request
+
+    Requests for variables which this process owns the calc, validate
+    or print notifications of stay on the event connection, so they
+    are recognised as coming from the owner rather than being sent
+    back to this process as another notification.
+
+    @param[in]
+        role
+            role of the request
+
+    @param[in]
+        hVar
+            handle of the variable the request is for, or VAR_INVALID
+
+    @retval connection to send the request on
+
+==============================================================================*/
+static VARSERVER_HANDLE conn( LuaVarsConn role, VAR_HANDLE hVar )
+{
+    VARSERVER_HANDLE hConnection = hVarServer;
+
+    if( ( role < LUAVARS_CONN_MAX ) &&
+        ( hConn[role] != NULL ) &&
+        ( conn_local( hVar ) == false ) )
+    {
+        hConnection = hConn[role];
+    }
+
+    return hConnection;
+}
+
+/*============================================================================*/
+/*  conn_own                                                                  */
+/*!
+    Track the notifications which tie a variable to the event connection
+
+    Modified notifications are not tracked since they do not change
+    how the variable server treats requests from this process.
+
+    @param[in]
+        hVar
+            handle of the variable the notification is registered on
+
+    @param[in]
+        type
+            type of notification
+
+    @param[in]
+        registered
+            true if the notification was registered, false if cancelled
+
+==============================================================================*/
+static void conn_own( VAR_HANDLE hVar, NotificationType type, bool registered )
+{
+    uint8_t *p;
+    size_t n;
+
+    if( ( type == NOTIFY_CALC ) ||
+        ( type == NOTIFY_VALIDATE ) ||
+        ( type == NOTIFY_PRINT ) )
+    {
+        if( ( hVar >= numOwned ) && ( registered == true ) )
+        {
+            n = ( (size_t)hVar + 1 ) * 2;
+            p = realloc( owned, n );
+            if( p != NULL )
+            {
+                memset( &p[numOwned], 0, n - numOwned );
+                owned = p;
+                numOwned = n;
+            }
+        }
+
+        if( hVar < numOwned )
+        {
+            if( registered == true )
+            {
+                owned[hVar] |= (uint8_t)( 1 << type );
+            }
+            else
+            {
+                owned[hVar] &= (uint8_t)~( 1 << type );
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  conn_open                                                                 */
+/*!
+    Open or close an additional variable server connection
+
+    @param[in]
+        role
+            role of the connection, other than the event connection
+
+    @param[in]
+        enable
+            true to open the connection, false to close it
+
+    @retval EOK the connection is in the requested state
+    @retval ENOTCONN the connection could not be opened
+    @retval EINVAL invalid role
+
+==============================================================================*/
+static int conn_open( LuaVarsConn role, bool enable )
+{
+    int result = EOK;
+
+    if( ( role == LUAVARS_CONN_EVENT ) || ( role >= LUAVARS_CONN_MAX ) )
+    {
+        result = EINVAL;
+    }
+    else if( ( enable == true ) && ( hConn[role] == NULL ) )
+    {
+        hConn[role] = backend->open( backend );
+        result = ( hConn[role] != NULL ) ? EOK : ENOTCONN;
+    }
+    else if( ( enable == false ) && ( hConn[role] != NULL ) )
+    {
+        (void)backend->close( hConn[role] );
+        hConn[role] = NULL;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  conn_local                                                                */
+/*!
+    Check if a variable must be accessed on the event connection
+
+    Used by var.get_many() to keep the variables which this process
+    services calc requests for off the fetch threads, since the script
+    cannot service a request while it waits for them.
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @retval true the variable is accessed on the event connection
+    @retval false the variable can be accessed on any connection
+
+==============================================================================*/
+static bool conn_local( VAR_HANDLE hVar )
+{
+    return ( ( hVar < numOwned ) && ( owned[hVar] != 0 ) ) ||
+           ( STATS_Owns( hVar ) == true );
+}
+
+/*============================================================================*/
+/*  var_wait                                                                  */
+/*!
+    var.wait()
+
+    This var.wait() function waits for a variable notification signal
+
+    When the signal is received the signal and payload ID are pushed
+    onto the lua stack
+
+    Notifications for the published statistics variables are serviced
+    internally and are not returned to the caller.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int var_wait( lua_State *L )
+{
+    int result = 0;
+    sigset_t mask;
+    siginfo_t info;
+    int sig;
+    int id;
+
+    if( L != NULL )
+    {
+        /* write back the bound fields set by the previous handler,
+           keeping the failures for var.flush_errors() */
+        if( numDirty > 0 )
+        {
+            bind_registry( L, LUAVARS_FLUSH_ERRORS );
+            (void)bind_flush( L, lua_gettop( L ), NULL );
+            lua_pop( L, 1 );
+        }
+
+        /* the Lua handler for the previous event has completed */
+        STATS_HandlerEnd();
+        STATS_Call( LUAVARS_CALL_WAIT );
+        LUAVARS_PROBE0( wait__entry );
+
+        sigemptyset( &mask );
+        /* timer notification */
+        sigaddset( &mask, SIGRTMIN+5 );
+        /* load generator completion */
+        sigaddset( &mask, SIG_LOADGEN_DONE );
+        /* modified notification */
+        sigaddset( &mask, SIG_VAR_MODIFIED );
+        /* calc notification */
+        sigaddset( &mask, SIG_VAR_CALC );
+        /* validate notification */
+        sigaddset( &mask, SIG_VAR_PRINT );
+        /* print notification */
+        sigaddset( &mask, SIG_VAR_VALIDATE );
+
+        /* block on these signals */
+        sigprocmask( SIG_BLOCK, &mask, NULL );
+
+        /* collect garbage between handlers rather than inside them */
+        GCMODE_Wait( L, &mask );
+
+        do
+        {
+            sig = wait_signal( &mask, &info );
+
+            id = info._sifields._timer.si_sigval.sival_int;
+
+            /* modified and calc notifications carry the variable
+               handle, which a wrapping backend may remap */
+            if( ( ( sig == SIG_VAR_MODIFIED ) || ( sig == SIG_VAR_CALC ) ) &&
+                ( backend->signalHandle != NULL ) )
+            {
+                id = (int)backend->signalHandle( backend, (VAR_HANDLE)id );
+            }
+
+            STATS_Event( sig, pending_signals( &mask ) );
+
+        } while( ( service_stats( sig, id ) == true ) ||
+                 ( MIRROR_Service( sig, (VAR_HANDLE)id ) == true ) );
+
+        EVENTLOG_Received( sig, id );
+
+        if( sig == SIG_VAR_MODIFIED )
+        {
+            JOURNAL_Record( JOURNAL_SOURCE_MODIFIED, (VAR_HANDLE)id, NULL );
+            bind_invalidate( L, (VAR_HANDLE)id );
+        }
+
+        /* modified and calc notifications carry the variable handle,
+           the others are bound to a handle once they are opened */
+        STATS_HandlerBegin( sig,
+                            ( ( sig == SIG_VAR_MODIFIED ) ||
+                              ( sig == SIG_VAR_CALC ) ) ? (VAR_HANDLE)id
+                                                        : VAR_INVALID );
+        LUAVARS_PROBE2( wait__return, sig, id );
+
+        lua_pushnumber( L, sig );
+        lua_pushnumber( L, id );
+
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_validate_start                                                        */
+/*!
+    var.validate_start()
+
+    This var.validate_start() function starts a validation on a variable.
+
+    The validation identifier that is received via var.wait() is passed
+    in as an argument on the lua stack.
+
+    The validate_start() function calls the VAR_GetValidationRequest()
+    in the variable server library.
+
+    The variable handle and the variable value are passed back on the
+    lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int var_validate_start( lua_State *L )
+{
+    int result = 0;
+    char buf[BUFSIZ];
+    VarObject var;
+    uint32_t id;
+    VAR_HANDLE hVar;
+    uint64_t t0;
+    int rc;
+
+    if( L != NULL )
+    {
+        STATS_Call( LUAVARS_CALL_VALIDATE_START );
+
+        id = luaL_checknumber( L, 1 );
+        LUAVARS_PROBE1( validate_start__entry, id );
+
+        hVar = VAR_INVALID;
+        var.type = VARTYPE_INVALID;
+        var.val.str = buf;
+        var.len = BUFSIZ;
+
+        t0 = STATS_Now();
+        rc = backend->getValidationRequest( conn( LUAVARS_CONN_REPLY,
+                                                  VAR_INVALID ),
+                                            id,
+                                            &hVar,
+                                            &var );
+        STATS_Ipc( LUAVARS_IPC_VALIDATION_REQUEST, t0, rc );
+        LUAVARS_PROBE3( validate_start__return, hVar, var.type, rc );
+
+        if( rc == EOK )
+        {
+            STATS_HandlerSetHandle( hVar );
+            EVENTLOG_Handle( hVar, &var );
+
+            lua_pushnumber( L, hVar );
+            switch( var.type )
+            {
+                case VARTYPE_STR:
+                    lua_pushstring( L, var.val.str );
+                    result = 2;
+                    break;
+
+                case VARTYPE_INT16:
+                    lua_pushnumber( L, var.val.i );
+                    result = 2;
+                    break;
+
+                case VARTYPE_UINT16:
+                    lua_pushnumber( L, var.val.ui );
+                    result = 2;
+                    break;
+
+                case VARTYPE_INT32:
+                    lua_pushnumber( L, var.val.l );
+                    result = 2;
+                    break;
+
+                case VARTYPE_UINT32:
+                    lua_pushnumber( L, var.val.ul );
+                    result = 2;
+                    break;
+
+                case VARTYPE_INT64:
+                    lua_pushnumber( L, var.val.ll );
+                    result = 2;
+                    break;
+
+                case VARTYPE_UINT64:
+                    lua_pushnumber( L, var.val.ull );
+                    result = 2;
+                    break;
+
+                case VARTYPE_FLOAT:
+                    lua_pushnumber( L, var.val.f );
+                    result = 2;
+                    break;
+
+                case VARTYPE_BLOB:
+                    result = 1 + push_var( L, &var );
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*================================================--==========================*/
+/*  var_validate_end                                                          */
+/*!
+    var.validate_end()
+
+    This var.validate_end() function completes a validation on a variable.
+
+    The validation identifier that is received via var.wait() is passed
+    in as an argument on the lua stack.
+
+    The result indicating if the validation is successful is also passed
+    as an argument on the lua stack.
+
+    The validate_end() function calls the VAR_SendValidationResponse()
+    in the variable server library.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int var_validate_end( lua_State *L )
+{
+    uint32_t id;
+    uint32_t response;
+    uint64_t t0;
+    int rc;
+
+    id = luaL_checknumber( L, 1 );
+    response = luaL_checknumber( L, 2 );
+
+    if( L != NULL )
+    {
+        STATS_Call( LUAVARS_CALL_VALIDATE_END );
+        LUAVARS_PROBE2( validate_end__entry, id, response );
+
+        t0 = STATS_Now();
+        rc = backend->sendValidationResponse( conn( LUAVARS_CONN_REPLY,
+                                                    VAR_INVALID ),
+                                              id,
+                                              response );
+        STATS_Ipc( LUAVARS_IPC_VALIDATION_RESPONSE, t0, rc );
+        LUAVARS_PROBE2( validate_end__return, id, rc );
+
+        if( rc == EOK )
+        {
+            lua_pushnumber( L, 1 );
+        }
+        else
+        {
+            lua_pushnil( L );
+        }
+    }
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  var_open_print_session                                                    */
+/*!
+    var.open_print_session()
+
+    This var.open_print_session() function sets up a print session
+    to be used to render variable strings.
+
+    The session id is passed as the first argument on the lua stack.
+
+    The function creates a new LuaPrintSession user data object
+    starting with a luaL_stream object which contains the
+    file pointer for the output stream.
+
+    The LuaPrintSession object also includes the variable handle
+    and the session identifier.
+
+    If the print session was successfully opened, the function
+    returns the LuaPrintSession object (aka luaL_stream) and the
+    handle of the system variable to render.
+
+    If the print session could not be successfully opened,
+    the function returns nil.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_open_print_session( lua_State *L )
+{
+    LuaPrintSession *pLuaPrintSession;
+    uint32_t id;
+    VAR_HANDLE hVar;
+    FILE *fp;
+    int fd;
+    int result = 0;
+    int rc;
+
+    STATS_Call( LUAVARS_CALL_OPEN_PRINT_SESSION );
+
+    id = luaL_checknumber( L, 1 );
+    LUAVARS_PROBE1( print_open__entry, id );
+
+    hVar = VAR_INVALID;
+    rc = open_print_session( id, &hVar, &fd );
+    LUAVARS_PROBE3( print_open__return, id, hVar, rc );
+
+    if ( rc == EOK )
+    {
+        STATS_HandlerSetHandle( hVar );
+        EVENTLOG_Handle( hVar, NULL );
+
+        pLuaPrintSession = (LuaPrintSession *)
+                            lua_newuserdata ( L, sizeof( LuaPrintSession ));
+        if( pLuaPrintSession != NULL )
+        {
+            luaL_setmetatable( L, LUA_FILEHANDLE );
+
+            pLuaPrintSession->id = id;
+            pLuaPrintSession->fd = fd;
+            fp = fdopen( fd, "w" );
+            pLuaPrintSession->hVar = hVar;
+            pLuaPrintSession->stream.f = fp;
+            pLuaPrintSession->stream.closef = &var_close_print_session;
+
+            lua_pushnumber( L, hVar );
+
+            result = 2;
+        }
+    }
+    else
+    {
+        lua_pushnil( L );
+        result = 1;
+    }
+
+    return result;
+}
+
+
+/*============================================================================*/
+/*  var_close_print_session                                                   */
+/*!
+    var.close_print_session()
+
+    This var.close_print_session() function shuts down a print session
+    that was used to render variable strings.
+
+    The Lua Print Session object containing the luaL_Stream
+    is passed as the first argument on the lua stack.
+
+    The function closes the print session using the
+    VAR_ClosePrintSession function and clears the
+    LuaPrintSession object.
+
+    On success this function pushes 1 onto the Lua stack
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the numbner of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_close_print_session( lua_State *L )
+{
+    LuaPrintSession *pLuaPrintSession;
     int result = 0;
+    uint64_t t0;
+
+    if( L != NULL )
+    {
+        STATS_Call( LUAVARS_CALL_CLOSE_PRINT_SESSION );
+
+        pLuaPrintSession = (LuaPrintSession *)
+                        luaL_checkudata( L, 1, LUA_FILEHANDLE );
+        if( pLuaPrintSession != NULL )
+        {
+            LUAVARS_PROBE2( print_close__entry,
+                            pLuaPrintSession->id,
+                            pLuaPrintSession->hVar );
+
+            t0 = STATS_Now();
+            result = backend->closePrintSession( conn( LUAVARS_CONN_REPLY,
+                                                       VAR_INVALID ),
+                                                 pLuaPrintSession->id,
+                                                 pLuaPrintSession->fd );
+            STATS_Ipc( LUAVARS_IPC_CLOSE_PRINT_SESSION, t0, result );
+
+            LUAVARS_PROBE2( print_close__return,
+                            pLuaPrintSession->id,
+                            result );
+
+            fclose( pLuaPrintSession->stream.f );
+
+            memset( pLuaPrintSession, 0, sizeof( LuaPrintSession ) );
+        }
+
+        if( result == EOK )
+        {
+            lua_pushnumber( L, 1 );
+            result = 1;
+        }
+        else
+        {
+            lua_pushnil( L );
+            lua_pushstring( L, strerror( result ) );
+            result = 2;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  open_print_session                                                        */
+/*!
+    Open a print session
+
+    The open_print_session function returns the print session which
+    was opened inside var.wait() with the requested id, otherwise it
+    opens a new print session with the variable server.
+
+    @param[in]
+        id
+            print session identifier received via var.wait()
+
+    @param[out]
+        hVar
+            handle of the variable to be printed
+
+    @param[out]
+        fd
+            output file descriptor for the print session
+
+    @retval EOK the print session was opened
+    @retval other error from the variable server
+
+==============================================================================*/
+static int open_print_session( uint32_t id, VAR_HANDLE *hVar, int *fd )
+{
+    int result = ENOENT;
+    uint64_t t0;
+    size_t i;
+
+    for( i = 0; ( i < numPendingPrint ) && ( result != EOK ); i++ )
+    {
+        if( pendingPrint[i].id == id )
+        {
+            *hVar = pendingPrint[i].hVar;
+            *fd = pendingPrint[i].fd;
+
+            numPendingPrint--;
+            memmove( &pendingPrint[i],
+                     &pendingPrint[i + 1],
+                     ( numPendingPrint - i ) * sizeof( PendingPrintSession ) );
+            result = EOK;
+        }
+    }
+
+    if( result != EOK )
+    {
+        t0 = STATS_Now();
+        result = backend->openPrintSession( conn( LUAVARS_CONN_REPLY,
+                                                  VAR_INVALID ),
+                                            id,
+                                            hVar,
+                                            fd );
+        STATS_Ipc( LUAVARS_IPC_OPEN_PRINT_SESSION, t0, result );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  service_stats                                                             */
+/*!
+    Service a notification for the published statistics variables
+
+    CALC notifications carry the variable handle, so they can be
+    checked directly.  PRINT notifications carry a session identifier,
+    so the session is opened here, on the connection the script's
+    print sessions use, and if it is not for a statistics variable it
+    is held until the Lua script calls var.open_print_session() for it.
+
+    @param[in]
+        sig
+            the received signal
+
+    @param[in]
+        id
+            the signal payload
+
+    @retval true the notification was serviced
+    @retval false the notification must be passed to the Lua script
+
+==============================================================================*/
+static bool service_stats( int sig, int id )
+{
+    bool result = false;
+    VARSERVER_HANDLE hReply;
+    VAR_HANDLE hVar;
+    int fd;
+    FILE *fp;
+    uint64_t t0;
+    int rc;
+
+    if( STATS_IsPublished() == true )
+    {
+        hReply = conn( LUAVARS_CONN_REPLY, VAR_INVALID );
+
+        if( sig == SIG_VAR_CALC )
+        {
+            result = ( STATS_Calc( hVarServer, (VAR_HANDLE)id ) == EOK );
+        }
+        else if( sig == SIG_VAR_PRINT )
+        {
+            t0 = STATS_Now();
+            rc = backend->openPrintSession( hReply, id, &hVar, &fd );
+            STATS_Ipc( LUAVARS_IPC_OPEN_PRINT_SESSION, t0, rc );
+
+            if( rc == EOK )
+            {
+                if( STATS_Owns( hVar ) == true )
+                {
+                    fp = fdopen( fd, "w" );
+                    if( fp != NULL )
+                    {
+                        STATS_Print( fp );
+                        fflush( fp );
+                    }
+
+                    (void)backend->closePrintSession( hReply, id, fd );
+
+                    if( fp != NULL )
+                    {
+                        fclose( fp );
+                    }
+
+                    result = true;
+                }
+                else
+                {
+                    hold_print_session( (uint32_t)id, hVar, fd );
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  hold_print_session                                                        */
+/*!
+    Hold a print session for the Lua script to claim
+
+    If LUAVARS_MAX_PENDING_PRINT sessions are already held, the oldest
+    is closed with no output so its client is not left waiting.
+
+    @param[in]
+        id
+            print session identifier
+
+    @param[in]
+        hVar
+            handle of the variable to be printed
+
+    @param[in]
+        fd
+            output file descriptor for the print session
+
+==============================================================================*/
+static void hold_print_session( uint32_t id, VAR_HANDLE hVar, int fd )
+{
+    close_pending_sessions( LUAVARS_MAX_PENDING_PRINT - 1 );
+
+    pendingPrint[numPendingPrint].id = id;
+    pendingPrint[numPendingPrint].hVar = hVar;
+    pendingPrint[numPendingPrint].fd = fd;
+    numPendingPrint++;
+}
+
+/*============================================================================*/
+/*  close_pending_sessions                                                    */
+/*!
+    Close the oldest held print sessions with no output
+
+    @param[in]
+        keep
+            number of the newest sessions to keep
+
+==============================================================================*/
+static void close_pending_sessions( size_t keep )
+{
+    size_t n = 0;
+    size_t i;
+
+    if( numPendingPrint > keep )
+    {
+        n = numPendingPrint - keep;
+        for( i = 0; i < n; i++ )
+        {
+            (void)backend->closePrintSession( conn( LUAVARS_CONN_REPLY,
+                                                    VAR_INVALID ),
+                                              pendingPrint[i].id,
+                                              pendingPrint[i].fd );
+            close( pendingPrint[i].fd );
+        }
+
+        memmove( &pendingPrint[0],
+                 &pendingPrint[n],
+                 keep * sizeof( PendingPrintSession ) );
+        numPendingPrint = keep;
+    }
+}
+
+/*============================================================================*/
+/*  wait_signal                                                               */
+/*!
+    Wait for one of the notification signals
+
+    Interruptions by other signals, such as the profiler timer, are
+    ignored.  Under the reconnect backend a blocked script makes no
+    requests which would notice a variable server restart, so the
+    connections are checked every LUAVARS_RESTART_CHECK_S seconds
+    while no signal arrives.
+
+    @param[in]
+        mask
+            the set of signals waited on by var.wait()
+
+    @param[out]
+        info
+            receives the signal information
+
+    @return the received signal
+
+==============================================================================*/
+static int wait_signal( const sigset_t *mask, siginfo_t *info )
+{
+    struct timespec timeout = { LUAVARS_RESTART_CHECK_S, 0 };
+    bool check = RECONNECT_InUse();
+    int sig;
+    int i;
+
+    do
+    {
+        sig = ( check == true ) ? sigtimedwait( mask, info, &timeout )
+                                : sigwaitinfo( mask, info );
+        if( ( sig == -1 ) && ( errno == EAGAIN ) )
+        {
+            (void)RECONNECT_Check( hVarServer );
+            for( i = LUAVARS_CONN_SYNC; i < LUAVARS_CONN_MAX; i++ )
+            {
+                if( hConn[i] != NULL )
+                {
+                    (void)RECONNECT_Check( hConn[i] );
+                }
+            }
+
+            errno = EAGAIN;
+        }
+    } while( ( sig == -1 ) && ( ( errno == EINTR ) || ( errno == EAGAIN ) ) );
+
+    return sig;
+}
+
+/*============================================================================*/
+/*  pending_signals                                                           */
+/*!
+    Count the notification signals which are still pending
+
+    The kernel does not expose the length of the realtime signal
+    queue, so this counts the distinct notification signals which
+    are pending and is a lower bound on the event queue depth.
+
+    @param[in]
+        mask
+            the set of signals waited on by var.wait()
+
+    @return the number of distinct pending signals in the mask
+
+==============================================================================*/
+static int pending_signals( const sigset_t *mask )
+{
+    sigset_t pending;
+    int count = 0;
+    int sig;
+
+    if( sigpending( &pending ) == 0 )
+    {
+        for( sig = SIGRTMIN; sig <= SIGRTMAX; sig++ )
+        {
+            if( sigismember( mask, sig ) && sigismember( &pending, sig ) )
+            {
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+/*============================================================================*/
+/*  var_stats                                                                 */
+/*!
+    var.stats()
+
+    This var.stats() function returns the library statistics as
+    a Lua table containing the API call counts, IPC latency
+    percentiles, event counts, event queue depth, and notification
+    handler durations.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int var_stats( lua_State *L )
+{
+    STATS_PushTable( L );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  var_create                                                                */
+/*!
+    var.create()
+
+    This var.create() function interfaces to the VARSERVER_CreateVar()
+    function of the selected backend.  It is mainly used to set up
+    variables for scripts run against the in-memory backend.
+
+    The name, type ("str", "uint16", "int16", "uint32", "int32",
+    "uint64", "int64" or "float") and optional initial value of the
+    variable are passed in on the lua stack.
+
+    On success this function pushes the variable handle onto the
+    Lua stack
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_create( lua_State *L )
+{
+    int result;
+    VarInfo info;
+    VAR_HANDLE hVar = VAR_INVALID;
+    const char *name;
+    const char *value;
+    char empty[1] = "";
+    uint64_t t0;
+
+    STATS_Call( LUAVARS_CALL_CREATE );
+
+    name = luaL_checkstring( L, 1 );
+    memset( &info, 0, sizeof( VarInfo ) );
+    strncpy( info.name, name, sizeof( info.name ) - 1 );
+    info.var.type = types[luaL_checkoption( L, 2, NULL, typeNames )];
+    value = luaL_optstring( L, 3, NULL );
+
+    if( info.var.type == VARTYPE_STR )
+    {
+        /* size the string variable to hold its initial value */
+        info.var.val.str = empty;
+        info.var.len = ( value != NULL ) ? strlen( value ) + 1
+                                         : sizeof( empty );
+    }
+
+    t0 = STATS_Now();
+    result = backend->create( hVarServer, &info );
+    STATS_Ipc( LUAVARS_IPC_CREATE, t0, result );
+
+    if( result == EOK )
+    {
+        t0 = STATS_Now();
+        hVar = backend->find( hVarServer, info.name );
+        STATS_Ipc( LUAVARS_IPC_FIND,
+                   t0,
+                   hVar != VAR_INVALID ? EOK : ENOENT );
+
+        if( hVar == VAR_INVALID )
+        {
+            result = ENOENT;
+        }
+        else if( value != NULL )
+        {
+            t0 = STATS_Now();
+            result = backend->setStr( hVarServer,
+                                      hVar,
+                                      info.var.type,
+                                      (char *)value );
+            STATS_Ipc( LUAVARS_IPC_SET, t0, result );
+        }
+    }
+
+    if( result == EOK )
+    {
+        lua_pushnumber( L, hVar );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_eventlog_start                                                        */
+/*!
+    var.eventlog_start()
+
+    This var.eventlog_start() function starts recording the
+    notifications received by var.wait() and the variables set by
+    the script to a binary event log, for replay with luavars_replay.
+
+    The path of the event log file is passed in on the Lua stack.
+    Only variables looked up by name after logging starts are named
+    in the log.  Logging can also be started when the library is
+    loaded by setting the LUAVARS_EVENTLOG environment variable.
+
+    On success this function pushes 1 onto the Lua stack
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_eventlog_start( lua_State *L )
+{
+    int result;
+
+    result = EVENTLOG_Start( luaL_checkstring( L, 1 ), hVarServer );
+    if( result == EOK )
+    {
+        lua_pushnumber( L, 1 );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_eventlog_stop                                                         */
+/*!
+    var.eventlog_stop()
+
+    This var.eventlog_stop() function stops recording notification
+    events and closes the event log.
+
+    On success this function pushes 1 onto the Lua stack
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_eventlog_stop( lua_State *L )
+{
+    int result;
+
+    result = EVENTLOG_Stop();
+    if( result == EOK )
+    {
+        lua_pushnumber( L, 1 );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_publish_stats                                                         */
+/*!
+    var.publish_stats()
+
+    This var.publish_stats() function publishes the library statistics
+    as /sys/luavars/<pid>/... varserver variables.  The statistics
+    can then be read with "getvar /sys/luavars/<pid>/stats" while
+    the script is waiting in var.wait().
+
+    Publication can also be enabled by setting the LUAVARS_STATS
+    environment variable before the library is loaded.
+
+    On success this function pushes 1 onto the Lua stack
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_publish_stats( lua_State *L )
+{
+    int result;
+
+    result = STATS_Publish( hVarServer );
+    if( result == EOK )
+    {
+        lua_pushnumber( L, 1 );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_profile_start                                                         */
+/*!
+    var.profile_start()
+
+    This var.profile_start() function starts sampling the Lua call
+    stack.  The optional sampling frequency in samples per CPU second
+    is passed in on the lua stack.  Any previously collected samples
+    are discarded.
+
+    Coroutines run by coroutine.resume() are sampled in the coroutine.
+    Functions made by coroutine.wrap(), and references to
+    coroutine.resume() taken before profiling started, are sampled
+    only once control returns to the thread which resumed them.
+
+    On success this function pushes 1 onto the Lua stack
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_profile_start( lua_State *L )
+{
+    int hz;
+    int result;
+
+    hz = (int)luaL_optinteger( L, 1, PROFILE_DEFAULT_HZ );
+
+    PROFILE_Clear();
+
+    result = PROFILE_Start( L, hz );
+    if( result == EOK )
+    {
+        lua_pushnumber( L, 1 );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_profile_stop                                                          */
+/*!
+    var.profile_stop()
+
+    This var.profile_stop() function stops the sampling profiler.
+
+    If a file path is passed in on the lua stack, the samples are
+    written to it as folded stacks for flamegraph.pl, and the number
+    of samples is pushed onto the Lua stack.  Otherwise a table
+    mapping each folded stack to its sample count is pushed onto
+    the Lua stack.
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_profile_stop( lua_State *L )
+{
+    const char *path;
+    int result;
+
+    path = luaL_optstring( L, 1, NULL );
+
+    (void)PROFILE_Stop();
+
+    if( path != NULL )
+    {
+        result = PROFILE_Write( path );
+        if( result == EOK )
+        {
+            lua_pushinteger( L, (lua_Integer)PROFILE_Samples() );
+            result = 1;
+        }
+        else
+        {
+            lua_pushnil( L );
+            lua_pushstring( L, strerror( result ) );
+            result = 2;
+        }
+    }
+    else
+    {
+        PROFILE_PushTable( L );
+        result = 1;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_handler_stats                                                         */
+/*!
+    var.handler_stats()
+
+    This var.handler_stats() function returns the notification handler
+    accounting as an array of tables, one for each (variable handle,
+    event type) pair, sorted by the total time spent in the handler.
+
+    Each table contains the handle, event, count, total, mean, max,
+    p50 and p99 durations in nanoseconds, and alloc, the number of
+    bytes allocated by Lua while handling the event.
+
+    An optional limit on the number of entries returned is passed
+    in on the lua stack.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int var_handler_stats( lua_State *L )
+{
+    int limit;
+
+    limit = (int)luaL_optinteger( L, 1, 0 );
+
+    HANDLERS_PushTable( L, limit );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  var_loadgen                                                               */
+/*!
+    var.loadgen()
+
+    This var.loadgen() function starts C threads which get and set
+    variables at a controlled rate, to measure the throughput and
+    latency of the variable server, and of the Lua handlers which
+    service notifications for the variables, under load.
+
+    A table of options is passed in on the Lua stack:
+
+    handles - array of variable names or handles (required)
+    writers - number of threads setting the variables (default 1)
+    readers - number of threads getting the variables (default 1)
+    rate - operations per second per thread, 0 for no limit (default 0)
+    duration - run time in milliseconds, 0 to run until stopped
+    subscribe - register for modified notifications on the variables
+                until the load generator is stopped or collected
+
+    The threads run in the background so the script can keep handling
+    notifications with var.wait().  Each thread uses its own variable
+    server connection and operates on the variables in turn.
+
+    On success this function pushes a load generator object onto the
+    Lua stack.  Its done() method returns true once the duration has
+    elapsed, and its stop() method stops the threads and returns the
+    results table.  When the duration elapses, var.wait() returns the
+    SIG_LOADGEN_DONE signal so a waiting script can check done().
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
 
-    if( L != NULL )
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_loadgen( lua_State *L )
+{
+    int result;
+    LoadGenConfig config;
+    LoadGen **ppLoadGen;
+    bool subscribe;
+    int idx;
+
+    luaL_checktype( L, 1, LUA_TTABLE );
+
+    memset( &config, 0, sizeof( LoadGenConfig ) );
+
+    lua_getfield( L, 1, "writers" );
+    config.writers = (int)luaL_optinteger( L, -1, 1 );
+    lua_getfield( L, 1, "readers" );
+    config.readers = (int)luaL_optinteger( L, -1, 1 );
+    lua_getfield( L, 1, "rate" );
+    config.rate = (uint32_t)luaL_optinteger( L, -1, 0 );
+    lua_getfield( L, 1, "duration" );
+    config.duration = (uint32_t)luaL_optinteger( L, -1, 0 );
+    lua_getfield( L, 1, "subscribe" );
+    subscribe = lua_toboolean( L, -1 );
+    lua_pop( L, 5 );
+
+    ppLoadGen = (LoadGen **)lua_newuserdatauv( L, sizeof( LoadGen * ), 1 );
+    *ppLoadGen = NULL;
+    luaL_setmetatable( L, LUAVARS_LOADGEN );
+    idx = lua_gettop( L );
+
+    result = loadgen_handles( L, 1, &config );
+
+    if( ( result == EOK ) && ( subscribe == true ) )
     {
-        pLuaPrintSession = (LuaPrintSession *)
-                        luaL_checkudata( L, 1, LUA_FILEHANDLE );
-        if( pLuaPrintSession != NULL )
-        {
-            result = VAR_ClosePrintSession( hVarServer,
-                                            pLuaPrintSession->id,
-                                            pLuaPrintSession->fd );
+        result = loadgen_subscribe( L, idx, &config );
+    }
 
-            fclose( pLuaPrintSession->stream.f );
+    if( result == EOK )
+    {
+        result = LOADGEN_Start( &config, ppLoadGen );
+    }
 
-            memset( pLuaPrintSession, 0, sizeof( LuaPrintSession ) );
+    free( config.handles );
+    free( config.types );
+
+    if( result == EOK )
+    {
+        result = 1;
+    }
+    else
+    {
+        loadgen_unsubscribe( L, idx );
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  loadgen_handles                                                           */
+/*!
+    Resolve the variables of a load generator
+
+    The handles field of the options table is an array of variable
+    names or handles.  The handle and type arrays are allocated and
+    must be freed by the caller.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        idx
+            stack index of the options table
+
+    @param[in,out]
+        pConfig
+            load generator configuration to fill in
+
+    @retval EOK the variables were resolved
+    @retval EINVAL the handles array is missing or empty
+    @retval ENOENT a variable was not found
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+static int loadgen_handles( lua_State *L, int idx, LoadGenConfig *pConfig )
+{
+    int result = EINVAL;
+    size_t n;
+    size_t i;
+    VAR_HANDLE hVar;
+
+    lua_getfield( L, idx, "handles" );
+    n = ( lua_type( L, -1 ) == LUA_TTABLE ) ? lua_rawlen( L, -1 ) : 0;
+
+    if( n > 0 )
+    {
+        result = ENOMEM;
+        pConfig->handles = calloc( n, sizeof( VAR_HANDLE ) );
+        pConfig->types = calloc( n, sizeof( VarType ) );
+        if( ( pConfig->handles != NULL ) && ( pConfig->types != NULL ) )
+        {
+            result = EOK;
+            pConfig->numHandles = n;
         }
+    }
 
-        if( result == EOK )
+    for( i = 0; ( result == EOK ) && ( i < n ); i++ )
+    {
+        if( lua_rawgeti( L, -1, (lua_Integer)( i + 1 ) ) == LUA_TSTRING )
         {
-            lua_pushnumber( L, 1 );
-            result = 1;
+            hVar = backend->find( hVarServer, (char *)lua_tostring( L, -1 ) );
         }
         else
         {
-            lua_pushnil( L );
-            lua_pushstring( L, strerror( result ) );
-            result = 2;
+            hVar = (VAR_HANDLE)lua_tointeger( L, -1 );
+        }
+
+        lua_pop( L, 1 );
+
+        result = ( hVar != VAR_INVALID )
+                    ? METACACHE_GetType( backend,
+                                         hVarServer,
+                                         hVar,
+                                         &pConfig->types[i] )
+                    : ENOENT;
+        pConfig->handles[i] = hVar;
+    }
+
+    lua_pop( L, 1 );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  loadgen_subscribe                                                         */
+/*!
+    Register the modified notifications of a load generator
+
+    The registrations are held by a watch set kept as the user value
+    of the load generator, so they can be cancelled when it is stopped
+    or collected.  If a registration fails, the ones already made are
+    cancelled.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        idx
+            stack index of the load generator userdata
+
+    @param[in]
+        pConfig
+            load generator configuration with the resolved handles
+
+    @retval EOK the notifications were registered
+    @retval other error from the backend
+
+==============================================================================*/
+static int loadgen_subscribe( lua_State *L,
+                              int idx,
+                              const LoadGenConfig *pConfig )
+{
+    int result = EOK;
+    LuaWatchSet *pWatchSet;
+    size_t i;
+
+    pWatchSet = lua_newuserdatauv( L,
+                                   sizeof( LuaWatchSet ) +
+                                   pConfig->numHandles * sizeof( VAR_HANDLE ),
+                                   0 );
+    pWatchSet->type = NOTIFY_MODIFIED;
+    pWatchSet->count = 0;
+    luaL_setmetatable( L, LUAVARS_WATCHSET );
+
+    for( i = 0; ( result == EOK ) && ( i < pConfig->numHandles ); i++ )
+    {
+        result = notify_register( pConfig->handles[i], NOTIFY_MODIFIED );
+        if( result == EOK )
+        {
+            pWatchSet->handles[pWatchSet->count++] = pConfig->handles[i];
         }
     }
 
+    if( result != EOK )
+    {
+        (void)watchset_release( pWatchSet );
+    }
+
+    lua_setiuservalue( L, idx, 1 );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  loadgen_unsubscribe                                                       */
+/*!
+    Cancel the modified notifications of a load generator
+
+    The watch set is left empty, so cancelling again does nothing.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        idx
+            stack index of the load generator userdata
+
+==============================================================================*/
+static void loadgen_unsubscribe( lua_State *L, int idx )
+{
+    if( lua_getiuservalue( L, idx, 1 ) == LUA_TUSERDATA )
+    {
+        (void)watchset_release( (LuaWatchSet *)lua_touserdata( L, -1 ) );
+    }
+
+    lua_pop( L, 1 );
+}
+
+/*============================================================================*/
+/*  loadgen_done                                                              */
+/*!
+    loadgen:done()
+
+    This loadgen:done() method pushes true onto the Lua stack if all
+    of the load generator threads have finished, otherwise false.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int loadgen_done( lua_State *L )
+{
+    LoadGen **ppLoadGen;
+
+    ppLoadGen = (LoadGen **)luaL_checkudata( L, 1, LUAVARS_LOADGEN );
+    lua_pushboolean( L, LOADGEN_Done( *ppLoadGen ) );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  loadgen_stop                                                              */
+/*!
+    loadgen:stop()
+
+    This loadgen:stop() method stops the load generator threads,
+    cancels the modified notifications registered by the subscribe
+    option, and pushes the results table onto the Lua stack.
+
+    The table contains the elapsed time in nanoseconds, and reads and
+    writes tables with the number of threads, the achieved rate in
+    operations per second, the number of errors, and the count, total,
+    max, p50, p99 and p999 operation latency in nanoseconds.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 1
+
+==============================================================================*/
+static int loadgen_stop( lua_State *L )
+{
+    LoadGen **ppLoadGen;
+
+    ppLoadGen = (LoadGen **)luaL_checkudata( L, 1, LUAVARS_LOADGEN );
+    LOADGEN_Stop( *ppLoadGen );
+    loadgen_unsubscribe( L, 1 );
+    LOADGEN_PushTable( L, *ppLoadGen );
+
+    return 1;
+}
+
+/*============================================================================*/
+/*  loadgen_gc                                                                */
+/*!
+    Load generator garbage collection
+
+    Stops the load generator threads, cancels its subscriptions and
+    releases the load generator when the userdata is collected.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return always returns 0
+
+==============================================================================*/
+static int loadgen_gc( lua_State *L )
+{
+    LoadGen **ppLoadGen;
+
+    ppLoadGen = (LoadGen **)luaL_checkudata( L, 1, LUAVARS_LOADGEN );
+    LOADGEN_Free( *ppLoadGen );
+    *ppLoadGen = NULL;
+    loadgen_unsubscribe( L, 1 );
+
+    return 0;
+}
+
+/*============================================================================*/
+/*  var_realtime                                                              */
+/*!
+    var.realtime()
+
+    This var.realtime() function prepares the calling thread to run
+    the var.wait() loop as a low jitter service.
+
+    A table of options is passed in on the Lua stack:
+
+    cpu - CPU to pin the thread to
+    priority - SCHED_FIFO priority (1-99)
+    mlock - lock the current and future process memory
+    prefault_kb - KB of heap to pre-fault
+
+    Once called, the page faults taken inside and outside of the
+    notification handlers are reported by var.stats().  Lua garbage
+    collection should be tuned separately, as collection steps still
+    run inside the handlers.
+
+    On success this function pushes 1 onto the Lua stack
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_realtime( lua_State *L )
+{
+    int result;
+    RealtimeConfig config;
+
+    luaL_checktype( L, 1, LUA_TTABLE );
+
+    lua_getfield( L, 1, "cpu" );
+    config.cpu = (int)luaL_optinteger( L, -1, -1 );
+    lua_getfield( L, 1, "priority" );
+    config.priority = (int)luaL_optinteger( L, -1, 0 );
+    lua_getfield( L, 1, "mlock" );
+    config.mlock = lua_toboolean( L, -1 );
+    lua_getfield( L, 1, "prefault_kb" );
+    config.prefaultKB = (size_t)luaL_optinteger( L, -1, 0 );
+    lua_pop( L, 4 );
+
+    result = REALTIME_Configure( &config );
+    if( result == EOK )
+    {
+        lua_pushnumber( L, 1 );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_gc_mode                                                               */
+/*!
+    var.gc_mode()
+
+    This var.gc_mode() function selects when the Lua garbage collector
+    runs.  In the "auto" mode (the default) it runs whenever Lua
+    allocates memory, including inside notification handlers.  In the
+    "idle" mode it is stopped, and var.wait() takes collection steps
+    while no notification is pending, so handlers are not paused by
+    the collector.
+
+    The mode is passed in on the Lua stack, followed by an optional
+    table of options:
+
+    generational - use the generational collector
+    pause - heap growth in percent which starts an idle collection
+    step_kb - size of each idle collection step in KB
+
+    The GC time and the bytes freed and cycles completed inside and
+    outside of handlers are reported in the gc table of var.stats().
+    The freed bytes are counted by the accounting allocator, so it is
+    installed on the Lua state if it was not installed when the library
+    was loaded.
+
+    On success this function pushes 1 onto the Lua stack
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_gc_mode( lua_State *L )
+{
+    GcModeConfig config;
+    int result;
+
+    config.mode = gcModes[luaL_checkoption( L, 1, NULL, gcModeNames )];
+    config.generational = false;
+    config.pause = GCMODE_DEFAULT_PAUSE;
+    config.stepKB = 0;
+
+    if( lua_istable( L, 2 ) )
+    {
+        lua_getfield( L, 2, "generational" );
+        config.generational = lua_toboolean( L, -1 );
+        lua_getfield( L, 2, "pause" );
+        config.pause = (int)luaL_optinteger( L, -1, GCMODE_DEFAULT_PAUSE );
+        lua_getfield( L, 2, "step_kb" );
+        config.stepKB = (int)luaL_optinteger( L, -1, 0 );
+        lua_pop( L, 3 );
+    }
+
+    result = ALLOC_Install( L );
+    if( ( result == EOK ) || ( result == EALREADY ) )
+    {
+        result = GCMODE_Set( L, &config );
+    }
+
+    if( result == EOK )
+    {
+        lua_pushnumber( L, 1 );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  var_alloc_pool                                                            */
+/*!
+    var.alloc_pool()
+
+    This var.alloc_pool() function enables or disables the size-class
+    pools of the library's Lua allocator.  When enabled, small blocks
+    such as the strings and tables created while handling an event are
+    recycled from per-size free lists instead of malloc().  Pooling
+    can also be enabled when the library is loaded by setting the
+    LUAVARS_POOL environment variable.
+
+    The accounting allocator is installed on the Lua state if it was
+    not installed when the library was loaded.
+
+    A boolean is passed in on the Lua stack.  The allocation counters
+    are reported in the alloc table of var.stats().
+
+    On success this function pushes 1 onto the Lua stack
+
+    On failure this function pushes nil and the failure error string
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the number of arguments returned on the Lua stack
+
+==============================================================================*/
+static int var_alloc_pool( lua_State *L )
+{
+    int result;
+
+    luaL_checkany( L, 1 );
+
+    result = ALLOC_Pool( L, lua_toboolean( L, 1 ) );
+    if( result == EOK )
+    {
+        lua_pushnumber( L, 1 );
+        result = 1;
+    }
+    else
+    {
+        lua_pushnil( L );
+        lua_pushstring( L, strerror( result ) );
+        result = 2;
+    }
+
     return result;
 }
 
@@ -0,0 +1,705 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file loadgen.c
+
+    Variable server load generator
+
+    The load generator starts reader and writer threads which each
+    open their own connection to the selected backend and get or set
+    the configured variables in turn, to find the request rate at
+    which the variable server, or a Lua handler servicing calc or
+    validate notifications for the variables, saturates.
+
+    Writers set each variable with a value of its own type.  Each
+    thread is paced at a fixed rate, or runs as fast as its requests
+    complete.  Paced requests are timed from when they were scheduled
+    rather than when they were sent, so latency which delays later
+    requests is not hidden when the server falls behind.
+
+    The threads block the notification signals so notifications are
+    only received by the script's var.wait().  When the run time
+    elapses, the timer signal is queued to the process so that a
+    script blocked in var.wait() wakes up to check for completion.
+    The starting thread keeps the timer signal blocked, so a script
+    which polls for completion instead is not killed by it.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+#include "stats.h"
+#include "backend.h"
+#include "loadgen.h"
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! load generator thread */
+typedef struct _LoadGenWorker
+{
+    /*! worker thread */
+    pthread_t thread;
+
+    /*! load generator the thread belongs to */
+    LoadGen *pLoadGen;
+
+    /*! set for a writer thread */
+    bool writer;
+
+    /*! index of the first variable operated on */
+    size_t first;
+
+    /*! number of failed operations */
+    uint64_t errors;
+
+    /*! time from the first operation until the thread stopped in ns */
+    uint64_t elapsed;
+
+    /*! operation latency */
+    LuaVarsHist hist;
+} LoadGenWorker;
+
+/*! running load generator */
+struct _LoadGen
+{
+    /*! configuration, with copies of the handle and type arrays */
+    LoadGenConfig config;
+
+    /*! backend used by the threads */
+    const LuaVarsBackend *backend;
+
+    /*! set to stop the threads */
+    bool stop;
+
+    /*! number of threads which have finished */
+    int finished;
+
+    /*! number of threads started */
+    int numWorkers;
+
+    /*! set once the threads have been joined */
+    bool joined;
+
+    /*! time the threads were started */
+    uint64_t start;
+
+    /*! time the threads were joined */
+    uint64_t end;
+
+    /*! reader and writer threads */
+    LoadGenWorker *workers;
+};
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static void *loadgen_thread( void *arg );
+static int loadgen_set( const LuaVarsBackend *backend,
+                        VARSERVER_HANDLE hVarServer,
+                        VAR_HANDLE hVar,
+                        VarType type,
+                        uint64_t i );
+static int loadgen_get( const LuaVarsBackend *backend,
+                        VARSERVER_HANDLE hVarServer,
+                        VAR_HANDLE hVar );
+static void wait_until( uint64_t ns );
+static void push_summary( lua_State *L, LoadGen *pLoadGen, bool writer );
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  LOADGEN_Start                                                             */
+/*!
+    Start a load generator
+
+    The reader and writer threads are started with the notification
+    signals blocked.
+
+    @param[in]
+        pConfig
+            pointer to the load generator configuration
+
+    @param[out]
+        ppLoadGen
+            the new load generator is returned here, to be stopped
+            with LOADGEN_Stop() and released with LOADGEN_Free()
+
+    @retval EOK the load generator was started
+    @retval EINVAL invalid configuration
+    @retval ENOMEM out of memory
+    @retval other error from pthread_create()
+
+==============================================================================*/
+int LOADGEN_Start( const LoadGenConfig *pConfig, LoadGen **ppLoadGen )
+{
+    int result = EINVAL;
+    LoadGen *pLoadGen = NULL;
+    LoadGenWorker *pWorker;
+    sigset_t oldmask;
+    int total;
+    int i;
+
+    if( ( pConfig != NULL ) &&
+        ( ppLoadGen != NULL ) &&
+        ( pConfig->readers >= 0 ) &&
+        ( pConfig->writers >= 0 ) &&
+        ( pConfig->numHandles > 0 ) )
+    {
+        total = pConfig->readers + pConfig->writers;
+        if( ( total > 0 ) && ( total <= LOADGEN_MAX_THREADS ) )
+        {
+            result = ENOMEM;
+            pLoadGen = calloc( 1, sizeof( LoadGen ) );
+        }
+    }
+
+    if( pLoadGen != NULL )
+    {
+        pLoadGen->config = *pConfig;
+        pLoadGen->backend = BACKEND_Current();
+        pLoadGen->config.handles = calloc( pConfig->numHandles,
+                                           sizeof( VAR_HANDLE ) );
+        pLoadGen->config.types = calloc( pConfig->numHandles,
+                                         sizeof( VarType ) );
+        pLoadGen->workers = calloc( total, sizeof( LoadGenWorker ) );
+
+        if( ( pLoadGen->config.handles != NULL ) &&
+            ( pLoadGen->config.types != NULL ) &&
+            ( pLoadGen->workers != NULL ) )
+        {
+            memcpy( pLoadGen->config.handles,
+                    pConfig->handles,
+                    pConfig->numHandles * sizeof( VAR_HANDLE ) );
+            memcpy( pLoadGen->config.types,
+                    pConfig->types,
+                    pConfig->numHandles * sizeof( VarType ) );
+            result = EOK;
+        }
+    }
+
+    if( result == EOK )
+    {
+        BACKEND_BlockSignals( &oldmask );
+
+        pLoadGen->start = STATS_Now();
+
+        for( i = 0; i < total; i++ )
+        {
+            pWorker = &pLoadGen->workers[i];
+            pWorker->pLoadGen = pLoadGen;
+            pWorker->writer = ( i < pConfig->writers );
+            pWorker->first = i % pConfig->numHandles;
+
+            result = pthread_create( &pWorker->thread,
+                                     NULL,
+                                     loadgen_thread,
+                                     pWorker );
+            if( result != EOK )
+            {
+                break;
+            }
+
+            pLoadGen->numWorkers++;
+        }
+
+        /* the completion signal is queued to the process, so it stays
+           blocked in the calling thread until var.wait() accepts it.
+           Otherwise a script which polls done() instead of waiting
+           would be killed by it */
+        sigaddset( &oldmask, SIG_LOADGEN_DONE );
+        pthread_sigmask( SIG_SETMASK, &oldmask, NULL );
+
+        if( result != EOK )
+        {
+            LOADGEN_Stop( pLoadGen );
+        }
+    }
+
+    if( result == EOK )
+    {
+        *ppLoadGen = pLoadGen;
+    }
+    else
+    {
+        LOADGEN_Free( pLoadGen );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  LOADGEN_Stop                                                              */
+/*!
+    Stop a load generator
+
+    The threads are stopped after their current operation and joined.
+    Stopping a load generator which has already been stopped has no
+    effect.
+
+    @param[in]
+        pLoadGen
+            pointer to the load generator
+
+==============================================================================*/
+void LOADGEN_Stop( LoadGen *pLoadGen )
+{
+    int i;
+
+    if( ( pLoadGen != NULL ) && ( pLoadGen->joined == false ) )
+    {
+        __atomic_store_n( &pLoadGen->stop, true, __ATOMIC_RELAXED );
+
+        for( i = 0; i < pLoadGen->numWorkers; i++ )
+        {
+            pthread_join( pLoadGen->workers[i].thread, NULL );
+        }
+
+        pLoadGen->end = STATS_Now();
+        pLoadGen->joined = true;
+    }
+}
+
+/*============================================================================*/
+/*  LOADGEN_Done                                                              */
+/*!
+    Check if a load generator has finished
+
+    @param[in]
+        pLoadGen
+            pointer to the load generator
+
+    @retval true all of the threads have finished
+    @retval false the load generator is still running
+
+==============================================================================*/
+bool LOADGEN_Done( LoadGen *pLoadGen )
+{
+    return ( pLoadGen == NULL ) ||
+           ( __atomic_load_n( &pLoadGen->finished, __ATOMIC_ACQUIRE ) ==
+             pLoadGen->numWorkers );
+}
+
+/*============================================================================*/
+/*  LOADGEN_PushTable                                                         */
+/*!
+    Push the load generator results onto the Lua stack
+
+    The load generator must have been stopped.  The table contains
+    the elapsed time in nanoseconds, and the reads and writes
+    summaries, each with the number of threads, the achieved rate in
+    operations per second, the error count, and the count, total,
+    max, p50, p99 and p999 latency in nanoseconds.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        pLoadGen
+            pointer to the load generator
+
+==============================================================================*/
+void LOADGEN_PushTable( lua_State *L, LoadGen *pLoadGen )
+{
+    lua_newtable( L );
+
+    if( ( pLoadGen != NULL ) && ( pLoadGen->joined == true ) )
+    {
+        lua_pushinteger( L, (lua_Integer)( pLoadGen->end - pLoadGen->start ) );
+        lua_setfield( L, -2, "elapsed" );
+
+        push_summary( L, pLoadGen, false );
+        lua_setfield( L, -2, "reads" );
+
+        push_summary( L, pLoadGen, true );
+        lua_setfield( L, -2, "writes" );
+    }
+}
+
+/*============================================================================*/
+/*  LOADGEN_Free                                                              */
+/*!
+    Stop and release a load generator
+
+    @param[in]
+        pLoadGen
+            pointer to the load generator
+
+==============================================================================*/
+void LOADGEN_Free( LoadGen *pLoadGen )
+{
+    if( pLoadGen != NULL )
+    {
+        LOADGEN_Stop( pLoadGen );
+
+        free( pLoadGen->config.handles );
+        free( pLoadGen->config.types );
+        free( pLoadGen->workers );
+        free( pLoadGen );
+    }
+}
+
+/*============================================================================*/
+/*  loadgen_thread                                                            */
+/*!
+    Load generator thread main function
+
+    @param[in]
+        arg
+            pointer to the LoadGenWorker
+
+    @return always returns NULL
+
+==============================================================================*/
+static void *loadgen_thread( void *arg )
+{
+    LoadGenWorker *pWorker = (LoadGenWorker *)arg;
+    LoadGen *pLoadGen = pWorker->pLoadGen;
+    const LoadGenConfig *pConfig = &pLoadGen->config;
+    const LuaVarsBackend *backend = pLoadGen->backend;
+    VARSERVER_HANDLE hVarServer;
+    uint64_t interval = 0;
+    uint64_t deadline = 0;
+    uint64_t start;
+    uint64_t next;
+    uint64_t i;
+    union sigval sv;
+    int finished;
+    size_t n;
+    int rc;
+
+    hVarServer = backend->open( backend );
+    if( hVarServer == NULL )
+    {
+        pWorker->errors++;
+    }
+    else
+    {
+        if( pConfig->rate != 0 )
+        {
+            interval = 1000000000ULL / pConfig->rate;
+        }
+
+        start = STATS_Now();
+        if( pConfig->duration != 0 )
+        {
+            deadline = start + pConfig->duration * 1000000ULL;
+        }
+
+        next = start;
+
+        for( i = 0;
+             __atomic_load_n( &pLoadGen->stop, __ATOMIC_RELAXED ) == false;
+             i++ )
+        {
+            if( interval == 0 )
+            {
+                next = STATS_Now();
+            }
+
+            if( ( deadline != 0 ) && ( next >= deadline ) )
+            {
+                break;
+            }
+
+            wait_until( next );
+
+            n = ( pWorker->first + i ) % pConfig->numHandles;
+            if( pWorker->writer == true )
+            {
+                rc = loadgen_set( backend,
+                                  hVarServer,
+                                  pConfig->handles[n],
+                                  pConfig->types[n],
+                                  i );
+            }
+            else
+            {
+                rc = loadgen_get( backend, hVarServer, pConfig->handles[n] );
+            }
+
+            HIST_Record( &pWorker->hist, STATS_Now() - next );
+            if( rc != EOK )
+            {
+                pWorker->errors++;
+            }
+
+            next += interval;
+        }
+
+        pWorker->elapsed = STATS_Now() - start;
+
+        (void)backend->close( hVarServer );
+    }
+
+    finished = __atomic_add_fetch( &pLoadGen->finished, 1, __ATOMIC_RELEASE );
+    if( ( finished == pConfig->readers + pConfig->writers ) &&
+        ( __atomic_load_n( &pLoadGen->stop, __ATOMIC_RELAXED ) == false ) )
+    {
+        /* wake a script blocked in var.wait() so it can see that
+           the run is complete */
+        sv.sival_int = 0;
+        (void)sigqueue( getpid(), SIG_LOADGEN_DONE, sv );
+    }
+
+    return NULL;
+}
+
+/*============================================================================*/
+/*  loadgen_set                                                               */
+/*!
+    Set a variable to a value of its type
+
+    @param[in]
+        backend
+            variable server backend
+
+    @param[in]
+        hVarServer
+            connection of the calling thread
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        type
+            type of the variable
+
+    @param[in]
+        i
+            operation number, used as the value
+
+    @retval EOK the variable was set
+    @retval other error from the variable server
+
+==============================================================================*/
+static int loadgen_set( const LuaVarsBackend *backend,
+                        VARSERVER_HANDLE hVarServer,
+                        VAR_HANDLE hVar,
+                        VarType type,
+                        uint64_t i )
+{
+    VarObject obj;
+    char buf[32];
+
+    memset( &obj, 0, sizeof( VarObject ) );
+    obj.type = type;
+
+    switch( type )
+    {
+        case VARTYPE_UINT16:
+            obj.val.ui = (uint16_t)i;
+            break;
+
+        case VARTYPE_INT16:
+            obj.val.i = (int16_t)i;
+            break;
+
+        case VARTYPE_UINT32:
+            obj.val.ul = (uint32_t)i;
+            break;
+
+        case VARTYPE_INT32:
+            obj.val.l = (int32_t)i;
+            break;
+
+        case VARTYPE_UINT64:
+            obj.val.ull = i;
+            break;
+
+        case VARTYPE_INT64:
+            obj.val.ll = (int64_t)i;
+            break;
+
+        case VARTYPE_FLOAT:
+            obj.val.f = (float)i;
+            break;
+
+        case VARTYPE_STR:
+            snprintf( buf, sizeof( buf ), "%llu", (unsigned long long)i );
+            obj.val.str = buf;
+            obj.len = strlen( buf ) + 1;
+            break;
+
+        default:
+            break;
+    }
+
+    return backend->set( hVarServer, hVar, &obj );
+}
+
+/*============================================================================*/
+/*  loadgen_get                                                               */
+/*!
+    Get the value of a variable
+
+    @param[in]
+        backend
+            variable server backend
+
+    @param[in]
+        hVarServer
+            connection of the calling thread
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @retval EOK the variable was read
+    @retval other error from the variable server
+
+==============================================================================*/
+static int loadgen_get( const LuaVarsBackend *backend,
+                        VARSERVER_HANDLE hVarServer,
+                        VAR_HANDLE hVar )
+{
+    VarObject obj;
+    char buf[BUFSIZ];
+
+    memset( &obj, 0, sizeof( VarObject ) );
+    obj.val.str = buf;
+    obj.len = sizeof( buf );
+
+    return backend->get( hVarServer, hVar, &obj );
+}
+
+/*============================================================================*/
+/*  wait_until                                                                */
+/*!
+    Sleep until a monotonic time
+
+    @param[in]
+        ns
+            monotonic time to sleep until, as returned by STATS_Now()
+
+==============================================================================*/
+static void wait_until( uint64_t ns )
+{
+    struct timespec ts;
+
+    if( ns > STATS_Now() )
+    {
+        ts.tv_sec = ns / 1000000000ULL;
+        ts.tv_nsec = ns % 1000000000ULL;
+        while( clock_nanosleep( CLOCK_MONOTONIC,
+                                TIMER_ABSTIME,
+                                &ts,
+                                NULL ) == EINTR )
+        {
+        }
+    }
+}
+
+/*============================================================================*/
+/*  push_summary                                                              */
+/*!
+    Push the combined results of the reader or writer threads
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        pLoadGen
+            pointer to the stopped load generator
+
+    @param[in]
+        writer
+            true for the writer threads, false for the readers
+
+==============================================================================*/
+static void push_summary( lua_State *L, LoadGen *pLoadGen, bool writer )
+{
+    LuaVarsHist *pHist;
+    LoadGenWorker *pWorker;
+    uint64_t errors = 0;
+    double rate = 0.0;
+    int threads = 0;
+    int i;
+
+    pHist = calloc( 1, sizeof( LuaVarsHist ) );
+    if( pHist != NULL )
+    {
+        for( i = 0; i < pLoadGen->numWorkers; i++ )
+        {
+            pWorker = &pLoadGen->workers[i];
+            if( pWorker->writer == writer )
+            {
+                threads++;
+                errors += pWorker->errors;
+                HIST_Merge( pHist, &pWorker->hist );
+                if( pWorker->elapsed != 0 )
+                {
+                    rate += (double)pWorker->hist.count * 1e9 /
+                            (double)pWorker->elapsed;
+                }
+            }
+        }
+
+        HIST_PushTable( L, pHist );
+        free( pHist );
+    }
+    else
+    {
+        lua_newtable( L );
+    }
+
+    lua_pushinteger( L, threads );
+    lua_setfield( L, -2, "threads" );
+
+    lua_pushnumber( L, rate );
+    lua_setfield( L, -2, "rate" );
+
+    lua_pushinteger( L, (lua_Integer)errors );
+    lua_setfield( L, -2, "errors" );
+}
+
+/*! @}
+ * end of libluavars group */
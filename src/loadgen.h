@@ -0,0 +1,92 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! maximum number of reader plus writer threads */
+#define LOADGEN_MAX_THREADS     ( 256 )
+
+/*! signal queued when a timed run completes.  It is separate from the
+    variable server timer signal so var.wait() does not report a
+    completed run as a timer event */
+#define SIG_LOADGEN_DONE        ( SIGRTMIN + 4 )
+
+/*==============================================================================
+        Public types
+==============================================================================*/
+
+/*! load generator configuration */
+typedef struct _LoadGenConfig
+{
+    /*! number of threads setting the variables */
+    int writers;
+
+    /*! number of threads getting the variables */
+    int readers;
+
+    /*! operations per second per thread, or 0 for no limit */
+    uint32_t rate;
+
+    /*! run time in milliseconds, or 0 to run until stopped */
+    uint32_t duration;
+
+    /*! number of variables */
+    size_t numHandles;
+
+    /*! handles of the variables operated on in turn by each thread */
+    VAR_HANDLE *handles;
+
+    /*! types of the variables */
+    VarType *types;
+} LoadGenConfig;
+
+/*! running load generator */
+typedef struct _LoadGen LoadGen;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int LOADGEN_Start( const LoadGenConfig *pConfig, LoadGen **ppLoadGen );
+void LOADGEN_Stop( LoadGen *pLoadGen );
+bool LOADGEN_Done( LoadGen *pLoadGen );
+void LOADGEN_PushTable( lua_State *L, LoadGen *pLoadGen );
+void LOADGEN_Free( LoadGen *pLoadGen );
+
+#endif
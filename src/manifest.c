@@ -0,0 +1,256 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file manifest.c
+
+    Startup manifest files
+
+    A manifest lists the variables a script uses so that their handles
+    can be resolved, and their notifications registered, in one pass
+    when the library is loaded instead of by a series of var.find()
+    calls at the top of the script.
+
+    Each line of a manifest file holds a variable name followed by
+    the notifications to register on it, separated by white space:
+
+        # name              notifications
+        /sys/test/a         modified
+        /sys/test/b         validate print
+        /sys/test/c
+
+    Blank lines and lines starting with '#' are ignored.  The file is
+    loaded into the same table form accepted by the LUAVARS_MANIFEST
+    global: name = true for a variable which is only resolved, or
+    name = { NOTIFY_... } for a variable with notifications.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+#include "manifest.h"
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static int parse_line( lua_State *L, char *line );
+static int notification_type( const char *name );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! names of the notifications accepted in a manifest */
+static const char *notifyNames[] = {
+    "modified",
+    "calc",
+    "validate",
+    "print",
+    NULL
+};
+
+/*! notification types corresponding to notifyNames */
+static const NotificationType notifyTypes[] = {
+    NOTIFY_MODIFIED,
+    NOTIFY_CALC,
+    NOTIFY_VALIDATE,
+    NOTIFY_PRINT
+};
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  MANIFEST_Load                                                             */
+/*!
+    Load a manifest file
+
+    On success the manifest table is pushed onto the Lua stack.
+    On failure nothing is pushed.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        path
+            path of the manifest file
+
+    @retval EOK the manifest was loaded
+    @retval EINVAL a line names an unknown notification or is too long
+    @retval other error opening the file
+
+==============================================================================*/
+int MANIFEST_Load( lua_State *L, const char *path )
+{
+    int result = EOK;
+    char line[MANIFEST_MAX_LINE];
+    FILE *fp;
+
+    fp = fopen( path, "r" );
+    if( fp != NULL )
+    {
+        lua_newtable( L );
+
+        while( ( result == EOK ) &&
+               ( fgets( line, sizeof line, fp ) != NULL ) )
+        {
+            if( ( strchr( line, '\n' ) == NULL ) && ( feof( fp ) == 0 ) )
+            {
+                result = EINVAL;
+            }
+            else
+            {
+                result = parse_line( L, line );
+            }
+        }
+
+        fclose( fp );
+
+        if( result != EOK )
+        {
+            lua_pop( L, 1 );
+        }
+    }
+    else
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  parse_line                                                                */
+/*!
+    Add one manifest line to the manifest table on the top of the stack
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        line
+            manifest line.  The line is modified by the parser.
+
+    @retval EOK the line was added or ignored
+    @retval EINVAL the line names an unknown notification
+
+==============================================================================*/
+static int parse_line( lua_State *L, char *line )
+{
+    int result = EOK;
+    const char *delim = " \t\r\n";
+    char *save = NULL;
+    char *name;
+    char *tok;
+    int type;
+    lua_Integer n = 0;
+
+    name = strtok_r( line, delim, &save );
+    if( ( name != NULL ) && ( name[0] != '#' ) )
+    {
+        lua_newtable( L );
+
+        while( ( result == EOK ) &&
+               ( ( tok = strtok_r( NULL, delim, &save ) ) != NULL ) )
+        {
+            type = notification_type( tok );
+            if( type != NOTIFY_NONE )
+            {
+                lua_pushinteger( L, type );
+                lua_rawseti( L, -2, ++n );
+            }
+            else
+            {
+                result = EINVAL;
+            }
+        }
+
+        if( n == 0 )
+        {
+            lua_pop( L, 1 );
+            lua_pushboolean( L, 1 );
+        }
+
+        if( result == EOK )
+        {
+            lua_setfield( L, -2, name );
+        }
+        else
+        {
+            lua_pop( L, 1 );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  notification_type                                                         */
+/*!
+    Look up a manifest notification name
+
+    @param[in]
+        name
+            notification name, e.g. "modified"
+
+    @return the notification type, or NOTIFY_NONE if the name is unknown
+
+==============================================================================*/
+static int notification_type( const char *name )
+{
+    int result = NOTIFY_NONE;
+    size_t i;
+
+    for( i = 0; notifyNames[i] != NULL; i++ )
+    {
+        if( strcmp( name, notifyNames[i] ) == 0 )
+        {
+            result = (int)notifyTypes[i];
+            break;
+        }
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of libluavars group */
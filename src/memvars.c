@@ -0,0 +1,2056 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @defgroup memvars memvars
+ * @brief In-memory variable server backend
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file memvars.c
+
+    In-memory variable server backend
+
+    The memvars module implements the subset of the VARSERVER_* and VAR_*
+    API used by libluavars on top of an in-memory variable store, so the
+    library can be exercised without a running varserver daemon.  It is
+    available as the "memory" backend, and is linked under the VAR_*
+    names by the benchmark programs (see bench/varstub.c).
+
+    Each MEMVARS_Open() creates a memory client.  Notifications are
+    delivered to the current process with sigqueue(), exactly as the
+    real variable server does, so vars.wait() works unchanged.  Clients
+    in other threads must block the SIG_VAR_* signals so that only the
+    thread calling vars.wait() receives them.
+
+    VALIDATE, CALC and PRINT notifications are only raised for clients
+    other than the one which registered for them, and the requesting
+    client blocks (up to MEMVARS_TIMEOUT_MS) until the handler responds.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <varserver/varserver.h>
+#include "memvars.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! minimum string variable capacity */
+#define MEMVARS_MIN_STR_LEN     ( 256 )
+
+/*! maximum number of concurrent validation and print requests */
+#define MEMVARS_MAX_REQUESTS    ( 256 )
+
+/*! initial number of name hash slots (must be a power of 2) */
+#define MEMVARS_INITIAL_SLOTS   ( 1024 )
+
+/*! highest notification type index */
+#define MEMVARS_NOTIFY_MAX      ( NOTIFY_PRINT + 1 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! memory client created by MEMVARS_Open */
+typedef struct _MemClient
+{
+    /*! client identifier */
+    uint32_t id;
+} MemClient;
+
+/*! memory variable */
+typedef struct _MemVar
+{
+    /*! variable name */
+    char name[MAX_NAME_LEN+1];
+
+    /*! variable value.  String and blob values point to the str
+        buffer */
+    VarObject obj;
+
+    /*! string or blob value buffer */
+    char *str;
+
+    /*! size of the blob value buffer */
+    size_t size;
+
+    /*! incremented every time the variable is written */
+    uint32_t version;
+
+    /*! client registered for each notification type */
+    MemClient *notify[MEMVARS_NOTIFY_MAX];
+} MemVar;
+
+/*! pending validation or print request */
+typedef struct _MemRequest
+{
+    /*! indicates if the request slot is in use */
+    bool used;
+
+    /*! indicates if the handler has completed the request */
+    bool done;
+
+    /*! request identifier sent with the signal */
+    uint32_t id;
+
+    /*! variable being validated or printed */
+    VAR_HANDLE hVar;
+
+    /*! proposed value for a validation request */
+    VarObject obj;
+
+    /*! output file descriptor for a print request */
+    int fd;
+
+    /*! validation response */
+    int response;
+} MemRequest;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static MemVar *get_var( VAR_HANDLE hVar );
+static VAR_HANDLE find_name( const char *name );
+static int add_name( const char *name, VAR_HANDLE hVar );
+static uint32_t hash_name( const char *name );
+static MemRequest *new_request( VAR_HANDLE hVar );
+static MemRequest *get_request( uint32_t id );
+static int wait_until( bool *flag, uint32_t *version, uint32_t start );
+static void send_signal( int sig, int value );
+static int copy_out( const VarObject *src, VarObject *dst );
+static int store_value( MemVar *pVar, const VarObject *obj );
+static int parse_value( VarType type, const char *str, VarObject *obj );
+static int format_value( const VarObject *obj, char *buf, size_t len );
+static int query_next( VarQuery *query, VarObject *obj );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! store lock */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*! signalled when a request completes or a variable is written */
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+
+/*! variables indexed by handle - 1 */
+static MemVar **vars = NULL;
+
+/*! number of variables */
+static size_t numVars = 0;
+
+/*! capacity of the vars array */
+static size_t maxVars = 0;
+
+/*! name hash table of variable handles */
+static VAR_HANDLE *names = NULL;
+
+/*! number of slots in the name hash table */
+static size_t nameSlots = 0;
+
+/*! pending requests */
+static MemRequest requests[MEMVARS_MAX_REQUESTS];
+
+/*! last request identifier */
+static uint32_t lastRequestId = 0;
+
+/*! last client identifier */
+static uint32_t lastClientId = 0;
+
+/*! names of the variable types */
+static const char *typeNames[VARTYPE_END_MARKER] =
+{
+    "invalid",
+    "str",
+    "uint16",
+    "int16",
+    "uint32",
+    "int32",
+    "uint64",
+    "int64",
+    "float",
+    "blob"
+};
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  MEMVARS_Open                                                              */
+/*!
+    Open a memory client
+
+    @return handle to the memory client, or NULL if out of memory
+
+==============================================================================*/
+VARSERVER_HANDLE MEMVARS_Open( void )
+{
+    MemClient *pClient;
+
+    pClient = calloc( 1, sizeof( MemClient ) );
+    if( pClient != NULL )
+    {
+        pClient->id = __atomic_add_fetch( &lastClientId, 1, __ATOMIC_RELAXED );
+    }
+
+    return (VARSERVER_HANDLE)pClient;
+}
+
+/*============================================================================*/
+/*  MEMVARS_Close                                                             */
+/*!
+    Close a memory client
+
+    Notifications registered by the client are cancelled.
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @retval EOK the client was closed
+    @retval EINVAL invalid client handle
+
+==============================================================================*/
+int MEMVARS_Close( VARSERVER_HANDLE hVarServer )
+{
+    MemClient *pClient = (MemClient *)hVarServer;
+    int result = EINVAL;
+    size_t i;
+    int n;
+
+    if( pClient != NULL )
+    {
+        pthread_mutex_lock( &lock );
+
+        for( i = 0; i < numVars; i++ )
+        {
+            for( n = 0; n < MEMVARS_NOTIFY_MAX; n++ )
+            {
+                if( vars[i]->notify[n] == pClient )
+                {
+                    vars[i]->notify[n] = NULL;
+                }
+            }
+        }
+
+        pthread_mutex_unlock( &lock );
+
+        free( pClient );
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_CreateVar                                                         */
+/*!
+    Create a memory variable
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in,out]
+        pVarInfo
+            variable name, type and initial value.  The handle of the
+            new variable is returned in pVarInfo->hVar.
+
+    @retval EOK the variable was created
+    @retval EEXIST a variable with the same name already exists
+    @retval EINVAL invalid arguments
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+int MEMVARS_CreateVar( VARSERVER_HANDLE hVarServer, VarInfo *pVarInfo )
+{
+    int result = EINVAL;
+    MemVar *pVar;
+    MemVar **newVars;
+    size_t len;
+
+    if( ( hVarServer != NULL ) &&
+        ( pVarInfo != NULL ) &&
+        ( pVarInfo->name[0] != '\0' ) &&
+        ( pVarInfo->var.type > VARTYPE_INVALID ) &&
+        ( pVarInfo->var.type < VARTYPE_END_MARKER ) )
+    {
+        pthread_mutex_lock( &lock );
+
+        if( find_name( pVarInfo->name ) != VAR_INVALID )
+        {
+            result = EEXIST;
+        }
+        else
+        {
+            result = ENOMEM;
+
+            if( numVars == maxVars )
+            {
+                maxVars = ( maxVars == 0 ) ? 64 : maxVars * 2;
+                newVars = realloc( vars, maxVars * sizeof( MemVar * ) );
+                if( newVars != NULL )
+                {
+                    vars = newVars;
+                }
+                else
+                {
+                    maxVars = numVars;
+                }
+            }
+
+            pVar = ( numVars < maxVars ) ? calloc( 1, sizeof( MemVar ) )
+                                         : NULL;
+            if( pVar != NULL )
+            {
+                strncpy( pVar->name, pVarInfo->name, MAX_NAME_LEN );
+                pVar->obj.type = pVarInfo->var.type;
+
+                if( pVar->obj.type == VARTYPE_STR )
+                {
+                    len = pVarInfo->var.len;
+                    if( len < MEMVARS_MIN_STR_LEN )
+                    {
+                        len = MEMVARS_MIN_STR_LEN;
+                    }
+
+                    pVar->str = calloc( 1, len );
+                    pVar->obj.val.str = pVar->str;
+                    pVar->obj.len = len;
+                }
+                else if( pVar->obj.type == VARTYPE_BLOB )
+                {
+                    len = pVarInfo->var.len;
+                    if( len < MEMVARS_MIN_STR_LEN )
+                    {
+                        len = MEMVARS_MIN_STR_LEN;
+                    }
+
+                    pVar->str = calloc( 1, len );
+                    pVar->obj.val.blob = pVar->str;
+                    pVar->size = len;
+                }
+
+                if( ( ( pVar->obj.type != VARTYPE_STR ) &&
+                      ( pVar->obj.type != VARTYPE_BLOB ) ) ||
+                    ( pVar->str != NULL ) )
+                {
+                    vars[numVars] = pVar;
+                    result = add_name( pVar->name,
+                                       (VAR_HANDLE)( numVars + 1 ) );
+                }
+
+                if( result == EOK )
+                {
+                    numVars++;
+                    pVarInfo->hVar = (VAR_HANDLE)numVars;
+                    if( ( ( pVar->obj.type != VARTYPE_STR ) &&
+                          ( pVar->obj.type != VARTYPE_BLOB ) ) ||
+                        ( pVarInfo->var.val.str != NULL ) )
+                    {
+                        (void)store_value( pVar, &pVarInfo->var );
+                    }
+                }
+                else
+                {
+                    free( pVar->str );
+                    free( pVar );
+                }
+            }
+        }
+
+        pthread_mutex_unlock( &lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_FindByName                                                        */
+/*!
+    Find a memory variable by name
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        name
+            name of the variable to find
+
+    @return handle of the variable, or VAR_INVALID if it was not found
+
+==============================================================================*/
+VAR_HANDLE MEMVARS_FindByName( VARSERVER_HANDLE hVarServer, char *name )
+{
+    VAR_HANDLE hVar = VAR_INVALID;
+
+    if( ( hVarServer != NULL ) && ( name != NULL ) )
+    {
+        pthread_mutex_lock( &lock );
+        hVar = find_name( name );
+        pthread_mutex_unlock( &lock );
+    }
+
+    return hVar;
+}
+
+/*============================================================================*/
+/*  MEMVARS_GetType                                                           */
+/*!
+    Get the type of a memory variable
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[out]
+        pVarType
+            the type of the variable
+
+    @retval EOK the type was returned
+    @retval ENOENT the variable does not exist
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int MEMVARS_GetType( VARSERVER_HANDLE hVarServer,
+                     VAR_HANDLE hVar,
+                     VarType *pVarType )
+{
+    int result = EINVAL;
+    MemVar *pVar;
+
+    if( ( hVarServer != NULL ) && ( pVarType != NULL ) )
+    {
+        pthread_mutex_lock( &lock );
+
+        pVar = get_var( hVar );
+        if( pVar != NULL )
+        {
+            *pVarType = pVar->obj.type;
+            result = EOK;
+        }
+        else
+        {
+            result = ENOENT;
+        }
+
+        pthread_mutex_unlock( &lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_GetLength                                                         */
+/*!
+    Get the length of the value of a memory variable
+
+    The length is the size of the buffer needed to get the value,
+    including the terminator of a string.
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[out]
+        len
+            the length of the value
+
+    @retval EOK the length was returned
+    @retval ENOENT the variable does not exist
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int MEMVARS_GetLength( VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       size_t *len )
+{
+    int result = EINVAL;
+    MemVar *pVar;
+
+    if( ( hVarServer != NULL ) && ( len != NULL ) )
+    {
+        pthread_mutex_lock( &lock );
+
+        pVar = get_var( hVar );
+        if( pVar != NULL )
+        {
+            *len = ( pVar->obj.type == VARTYPE_STR ) ? strlen( pVar->str ) + 1
+                                                     : pVar->obj.len;
+            result = EOK;
+        }
+        else
+        {
+            result = ENOENT;
+        }
+
+        pthread_mutex_unlock( &lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_GetName                                                           */
+/*!
+    Get the name of a memory variable
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[out]
+        buf
+            buffer to receive the NUL terminated name
+
+    @param[in]
+        len
+            size of the buffer
+
+    @retval EOK the name was returned
+    @retval ENOENT the variable does not exist
+    @retval E2BIG the buffer is too small for the name
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int MEMVARS_GetName( VARSERVER_HANDLE hVarServer,
+                     VAR_HANDLE hVar,
+                     char *buf,
+                     size_t len )
+{
+    int result = EINVAL;
+    MemVar *pVar;
+    size_t n;
+
+    if( ( hVarServer != NULL ) && ( buf != NULL ) && ( len > 0 ) )
+    {
+        pthread_mutex_lock( &lock );
+
+        pVar = get_var( hVar );
+        if( pVar != NULL )
+        {
+            n = strlen( pVar->name );
+            if( n < len )
+            {
+                memcpy( buf, pVar->name, n + 1 );
+                result = EOK;
+            }
+            else
+            {
+                result = E2BIG;
+            }
+        }
+        else
+        {
+            result = ENOENT;
+        }
+
+        pthread_mutex_unlock( &lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_Get                                                               */
+/*!
+    Get the value of a memory variable
+
+    If another client has registered for NOTIFY_CALC on the variable,
+    a SIG_VAR_CALC signal is raised and the call blocks until the
+    variable is written.
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in,out]
+        obj
+            receives the variable value.  For string and blob variables
+            obj->val.str and obj->len describe the output buffer.
+
+    @retval EOK the value was returned
+    @retval ENOENT the variable does not exist
+    @retval ETIMEDOUT the calc handler did not respond
+    @retval E2BIG the value does not fit the output buffer
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int MEMVARS_Get( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar, VarObject *obj )
+{
+    int result = EINVAL;
+    MemVar *pVar;
+    uint32_t start;
+
+    if( ( hVarServer != NULL ) && ( obj != NULL ) )
+    {
+        pthread_mutex_lock( &lock );
+
+        pVar = get_var( hVar );
+        if( pVar != NULL )
+        {
+            result = EOK;
+
+            if( ( pVar->notify[NOTIFY_CALC] != NULL ) &&
+                ( pVar->notify[NOTIFY_CALC] != (MemClient *)hVarServer ) )
+            {
+                start = pVar->version;
+                pthread_mutex_unlock( &lock );
+                send_signal( SIG_VAR_CALC, (int)hVar );
+                pthread_mutex_lock( &lock );
+                result = wait_until( NULL, &pVar->version, start );
+            }
+
+            if( result == EOK )
+            {
+                result = copy_out( &pVar->obj, obj );
+            }
+        }
+        else
+        {
+            result = ENOENT;
+        }
+
+        pthread_mutex_unlock( &lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_Set                                                               */
+/*!
+    Set the value of a memory variable
+
+    If another client has registered for NOTIFY_VALIDATE on the variable,
+    a SIG_VAR_VALIDATE signal is raised and the call blocks until the
+    validation response is received.  A SIG_VAR_MODIFIED signal is
+    raised after the variable is written if a client has registered
+    for NOTIFY_MODIFIED.
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        obj
+            the new value, which must have the type of the variable
+
+    @retval EOK the value was written
+    @retval ENOENT the variable does not exist
+    @retval ETIMEDOUT the validation handler did not respond
+    @retval EINVAL invalid arguments or type mismatch
+    @retval other validation response
+
+==============================================================================*/
+int MEMVARS_Set( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar, VarObject *obj )
+{
+    int result = EINVAL;
+    MemVar *pVar;
+    MemRequest *pRequest;
+    bool modified = false;
+
+    if( ( hVarServer != NULL ) && ( obj != NULL ) )
+    {
+        pthread_mutex_lock( &lock );
+
+        pVar = get_var( hVar );
+        if( pVar == NULL )
+        {
+            result = ENOENT;
+        }
+        else if( pVar->obj.type == obj->type )
+        {
+            result = EOK;
+
+            if( ( pVar->notify[NOTIFY_VALIDATE] != NULL ) &&
+                ( pVar->notify[NOTIFY_VALIDATE] != (MemClient *)hVarServer ) )
+            {
+                pRequest = new_request( hVar );
+                if( pRequest != NULL )
+                {
+                    pRequest->obj = *obj;
+                    pthread_mutex_unlock( &lock );
+                    send_signal( SIG_VAR_VALIDATE, (int)pRequest->id );
+                    pthread_mutex_lock( &lock );
+
+                    result = wait_until( &pRequest->done, NULL, 0 );
+                    if( result == EOK )
+                    {
+                        result = pRequest->response;
+                    }
+
+                    pRequest->used = false;
+                }
+                else
+                {
+                    result = EBUSY;
+                }
+            }
+
+            if( result == EOK )
+            {
+                result = store_value( pVar, obj );
+                modified = ( result == EOK ) &&
+                           ( pVar->notify[NOTIFY_MODIFIED] != NULL );
+            }
+        }
+
+        pthread_mutex_unlock( &lock );
+
+        if( modified == true )
+        {
+            send_signal( SIG_VAR_MODIFIED, (int)hVar );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_SetStr                                                            */
+/*!
+    Set the value of a memory variable from a string
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        type
+            type of the variable
+
+    @param[in]
+        str
+            string representation of the new value
+
+    @retval EOK the value was written
+    @retval EINVAL the string could not be converted
+    @retval other error from MEMVARS_Set()
+
+==============================================================================*/
+int MEMVARS_SetStr( VARSERVER_HANDLE hVarServer,
+                    VAR_HANDLE hVar,
+                    VarType type,
+                    char *str )
+{
+    VarObject obj;
+    int result;
+
+    result = parse_value( type, str, &obj );
+    if( result == EOK )
+    {
+        result = MEMVARS_Set( hVarServer, hVar, &obj );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_Notify                                                            */
+/*!
+    Register for a memory variable notification
+
+    Only one client can register for each notification type on a
+    variable.  A later registration replaces an earlier one.
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        notificationType
+            the type of notification requested
+
+    @retval EOK the notification was registered
+    @retval ENOENT the variable does not exist
+    @retval ENOTSUP the notification type is not supported
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int MEMVARS_Notify( VARSERVER_HANDLE hVarServer,
+                    VAR_HANDLE hVar,
+                    NotificationType notificationType )
+{
+    int result = EINVAL;
+    MemVar *pVar;
+
+    if( hVarServer != NULL )
+    {
+        if( ( notificationType == NOTIFY_MODIFIED ) ||
+            ( notificationType == NOTIFY_CALC ) ||
+            ( notificationType == NOTIFY_VALIDATE ) ||
+            ( notificationType == NOTIFY_PRINT ) )
+        {
+            pthread_mutex_lock( &lock );
+
+            pVar = get_var( hVar );
+            if( pVar != NULL )
+            {
+                pVar->notify[notificationType] = (MemClient *)hVarServer;
+                result = EOK;
+            }
+            else
+            {
+                result = ENOENT;
+            }
+
+            pthread_mutex_unlock( &lock );
+        }
+        else
+        {
+            result = ENOTSUP;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_NotifyCancel                                                      */
+/*!
+    Cancel a memory variable notification
+
+    Only the client which holds the registration can cancel it.
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        notificationType
+            the type of notification to cancel
+
+    @retval EOK the notification was cancelled
+    @retval ENOENT the variable does not exist or the client does not
+            hold the notification
+    @retval ENOTSUP the notification type is not supported
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int MEMVARS_NotifyCancel( VARSERVER_HANDLE hVarServer,
+                          VAR_HANDLE hVar,
+                          NotificationType notificationType )
+{
+    int result = EINVAL;
+    MemVar *pVar;
+
+    if( hVarServer != NULL )
+    {
+        if( ( notificationType == NOTIFY_MODIFIED ) ||
+            ( notificationType == NOTIFY_CALC ) ||
+            ( notificationType == NOTIFY_VALIDATE ) ||
+            ( notificationType == NOTIFY_PRINT ) )
+        {
+            pthread_mutex_lock( &lock );
+
+            pVar = get_var( hVar );
+            if( ( pVar != NULL ) &&
+                ( pVar->notify[notificationType] ==
+                  (MemClient *)hVarServer ) )
+            {
+                pVar->notify[notificationType] = NULL;
+                result = EOK;
+            }
+            else
+            {
+                result = ENOENT;
+            }
+
+            pthread_mutex_unlock( &lock );
+        }
+        else
+        {
+            result = ENOTSUP;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_GetValidationRequest                                              */
+/*!
+    Get a pending validation request
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        id
+            validation request identifier received with SIG_VAR_VALIDATE
+
+    @param[out]
+        hVar
+            handle of the variable being validated
+
+    @param[in,out]
+        obj
+            receives the proposed value
+
+    @retval EOK the request was returned
+    @retval ENOENT the request does not exist
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int MEMVARS_GetValidationRequest( VARSERVER_HANDLE hVarServer,
+                                  uint32_t id,
+                                  VAR_HANDLE *hVar,
+                                  VarObject *obj )
+{
+    int result = EINVAL;
+    MemRequest *pRequest;
+
+    if( ( hVarServer != NULL ) && ( hVar != NULL ) && ( obj != NULL ) )
+    {
+        pthread_mutex_lock( &lock );
+
+        pRequest = get_request( id );
+        if( pRequest != NULL )
+        {
+            *hVar = pRequest->hVar;
+            result = copy_out( &pRequest->obj, obj );
+        }
+        else
+        {
+            result = ENOENT;
+        }
+
+        pthread_mutex_unlock( &lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_SendValidationResponse                                            */
+/*!
+    Complete a pending validation request
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        id
+            validation request identifier received with SIG_VAR_VALIDATE
+
+    @param[in]
+        response
+            EOK to accept the new value, otherwise the error returned
+            to the client which tried to set the variable
+
+    @retval EOK the response was sent
+    @retval ENOENT the request does not exist
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int MEMVARS_SendValidationResponse( VARSERVER_HANDLE hVarServer,
+                                    uint32_t id,
+                                    int response )
+{
+    int result = EINVAL;
+    MemRequest *pRequest;
+
+    if( hVarServer != NULL )
+    {
+        pthread_mutex_lock( &lock );
+
+        pRequest = get_request( id );
+        if( pRequest != NULL )
+        {
+            pRequest->response = response;
+            pRequest->done = true;
+            pthread_cond_broadcast( &changed );
+            result = EOK;
+        }
+        else
+        {
+            result = ENOENT;
+        }
+
+        pthread_mutex_unlock( &lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_OpenPrintSession                                                  */
+/*!
+    Open a pending print session
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        id
+            print session identifier received with SIG_VAR_PRINT
+
+    @param[out]
+        hVar
+            handle of the variable to print
+
+    @param[out]
+        fd
+            output file descriptor owned by the caller
+
+    @retval EOK the session was opened
+    @retval ENOENT the session does not exist
+    @retval EINVAL invalid arguments
+    @retval other error from dup()
+
+==============================================================================*/
+int MEMVARS_OpenPrintSession( VARSERVER_HANDLE hVarServer,
+                              uint32_t id,
+                              VAR_HANDLE *hVar,
+                              int *fd )
+{
+    int result = EINVAL;
+    MemRequest *pRequest;
+
+    if( ( hVarServer != NULL ) && ( hVar != NULL ) && ( fd != NULL ) )
+    {
+        pthread_mutex_lock( &lock );
+
+        pRequest = get_request( id );
+        if( pRequest != NULL )
+        {
+            *hVar = pRequest->hVar;
+            *fd = dup( pRequest->fd );
+            result = ( *fd >= 0 ) ? EOK : errno;
+        }
+        else
+        {
+            result = ENOENT;
+        }
+
+        pthread_mutex_unlock( &lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_ClosePrintSession                                                 */
+/*!
+    Complete a print session
+
+    The output file descriptor remains owned by the caller.
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        id
+            print session identifier received with SIG_VAR_PRINT
+
+    @param[in]
+        fd
+            output file descriptor returned by MEMVARS_OpenPrintSession()
+
+    @retval EOK the session was closed
+    @retval ENOENT the session does not exist
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int MEMVARS_ClosePrintSession( VARSERVER_HANDLE hVarServer,
+                               uint32_t id,
+                               int fd )
+{
+    int result = EINVAL;
+    MemRequest *pRequest;
+
+    (void)fd;
+
+    if( hVarServer != NULL )
+    {
+        pthread_mutex_lock( &lock );
+
+        pRequest = get_request( id );
+        if( pRequest != NULL )
+        {
+            pRequest->done = true;
+            pthread_cond_broadcast( &changed );
+            result = EOK;
+        }
+        else
+        {
+            result = ENOENT;
+        }
+
+        pthread_mutex_unlock( &lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_Print                                                             */
+/*!
+    Print a variable as a client
+
+    If another client has registered for NOTIFY_PRINT on the variable,
+    a SIG_VAR_PRINT signal is raised and the call blocks until the
+    print session is closed.  Otherwise the value is written directly.
+
+    The handler may still be flushing its output when this function
+    returns, so the caller should read fd until end of file after
+    closing its own copy of the write end.
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        hVar
+            handle of the variable to print
+
+    @param[in]
+        fd
+            file descriptor to write the output to
+
+    @retval EOK the variable was printed
+    @retval ENOENT the variable does not exist
+    @retval ETIMEDOUT the print handler did not respond
+    @retval EBUSY too many requests are pending
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int MEMVARS_Print( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar, int fd )
+{
+    int result = EINVAL;
+    MemVar *pVar;
+    MemRequest *pRequest;
+    char buf[BUFSIZ];
+
+    if( hVarServer != NULL )
+    {
+        pthread_mutex_lock( &lock );
+
+        pVar = get_var( hVar );
+        if( pVar == NULL )
+        {
+            result = ENOENT;
+        }
+        else if( ( pVar->notify[NOTIFY_PRINT] != NULL ) &&
+                 ( pVar->notify[NOTIFY_PRINT] != (MemClient *)hVarServer ) )
+        {
+            pRequest = new_request( hVar );
+            if( pRequest != NULL )
+            {
+                pRequest->fd = fd;
+                pthread_mutex_unlock( &lock );
+                send_signal( SIG_VAR_PRINT, (int)pRequest->id );
+                pthread_mutex_lock( &lock );
+
+                result = wait_until( &pRequest->done, NULL, 0 );
+                pRequest->used = false;
+            }
+            else
+            {
+                result = EBUSY;
+            }
+        }
+        else
+        {
+            result = format_value( &pVar->obj, buf, sizeof( buf ) );
+            if( ( result == EOK ) &&
+                ( write( fd, buf, strlen( buf ) ) < 0 ) )
+            {
+                result = errno;
+            }
+        }
+
+        pthread_mutex_unlock( &lock );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_GetFirst                                                          */
+/*!
+    Start a search of the memory variables
+
+    Only QUERY_MATCH (a substring of the name) is supported.  A query
+    with no QUERY_MATCH flag matches every variable.
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in,out]
+        query
+            search query.  The name and handle of the first matching
+            variable are returned in query->name and query->hVar
+
+    @param[in,out]
+        obj
+            receives the value of the first matching variable
+
+    @retval EOK a matching variable was found
+    @retval ENOENT no variable matched
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int MEMVARS_GetFirst( VARSERVER_HANDLE hVarServer,
+                      VarQuery *query,
+                      VarObject *obj )
+{
+    int result = EINVAL;
+
+    if( ( hVarServer != NULL ) && ( query != NULL ) && ( obj != NULL ) )
+    {
+        query->context = 0;
+        result = query_next( query, obj );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_GetNext                                                           */
+/*!
+    Continue a search of the memory variables
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in,out]
+        query
+            search query started by MEMVARS_GetFirst()
+
+    @param[in,out]
+        obj
+            receives the value of the next matching variable
+
+    @retval EOK a matching variable was found
+    @retval ENOENT no more variables matched
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int MEMVARS_GetNext( VARSERVER_HANDLE hVarServer,
+                     VarQuery *query,
+                     VarObject *obj )
+{
+    int result = EINVAL;
+
+    if( ( hVarServer != NULL ) && ( query != NULL ) && ( obj != NULL ) )
+    {
+        result = query_next( query, obj );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_Create                                                            */
+/*!
+    Create a memory variable from a type and string value
+
+    @param[in]
+        hVarServer
+            handle to the memory client
+
+    @param[in]
+        name
+            name of the variable to create
+
+    @param[in]
+        type
+            type of the variable to create
+
+    @param[in]
+        value
+            initial value of the variable, or NULL
+
+    @retval EOK the variable was created
+    @retval other error from MEMVARS_CreateVar()
+
+==============================================================================*/
+int MEMVARS_Create( VARSERVER_HANDLE hVarServer,
+                    const char *name,
+                    VarType type,
+                    const char *value )
+{
+    int result = EINVAL;
+    VarInfo info;
+
+    if( name != NULL )
+    {
+        memset( &info, 0, sizeof( VarInfo ) );
+        strncpy( info.name, name, MAX_NAME_LEN );
+        info.var.type = type;
+
+        result = EOK;
+        if( value != NULL )
+        {
+            result = parse_value( type, value, &info.var );
+        }
+
+        if( ( result == EOK ) && ( type == VARTYPE_STR ) )
+        {
+            info.var.len = ( value != NULL ) ? strlen( value ) + 1 : 0;
+        }
+
+        if( result == EOK )
+        {
+            result = MEMVARS_CreateVar( hVarServer, &info );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MEMVARS_TypeFromName                                                      */
+/*!
+    Convert a type name (as used by mkvar) to a VarType
+
+    @param[in]
+        name
+            type name, e.g. "uint32", "str"
+
+    @return the variable type, or VARTYPE_INVALID
+
+==============================================================================*/
+VarType MEMVARS_TypeFromName( const char *name )
+{
+    VarType type = VARTYPE_INVALID;
+    int i;
+
+    if( name != NULL )
+    {
+        for( i = VARTYPE_INVALID + 1; i < VARTYPE_END_MARKER; i++ )
+        {
+            if( strcasecmp( name, typeNames[i] ) == 0 )
+            {
+                type = (VarType)i;
+                break;
+            }
+        }
+    }
+
+    return type;
+}
+
+/*============================================================================*/
+/*  get_var                                                                   */
+/*!
+    Get a memory variable by handle.  The lock must be held.
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @return pointer to the variable, or NULL if it does not exist
+
+==============================================================================*/
+static MemVar *get_var( VAR_HANDLE hVar )
+{
+    return ( ( hVar != VAR_INVALID ) && ( hVar <= numVars ) ) ? vars[hVar - 1]
+                                                              : NULL;
+}
+
+/*============================================================================*/
+/*  find_name                                                                 */
+/*!
+    Look up a variable handle by name.  The lock must be held.
+
+    @param[in]
+        name
+            name of the variable
+
+    @return handle of the variable, or VAR_INVALID if it was not found
+
+==============================================================================*/
+static VAR_HANDLE find_name( const char *name )
+{
+    VAR_HANDLE hVar = VAR_INVALID;
+    size_t i;
+
+    if( nameSlots > 0 )
+    {
+        i = hash_name( name ) & ( nameSlots - 1 );
+        while( names[i] != VAR_INVALID )
+        {
+            if( strcmp( vars[names[i] - 1]->name, name ) == 0 )
+            {
+                hVar = names[i];
+                break;
+            }
+
+            i = ( i + 1 ) & ( nameSlots - 1 );
+        }
+    }
+
+    return hVar;
+}
+
+/*============================================================================*/
+/*  add_name                                                                  */
+/*!
+    Add a variable to the name hash table.  The lock must be held and
+    vars[hVar - 1] must already be set.
+
+    @param[in]
+        name
+            name of the variable
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @retval EOK the name was added
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+static int add_name( const char *name, VAR_HANDLE hVar )
+{
+    int result = EOK;
+    VAR_HANDLE *newNames;
+    size_t newSlots;
+    size_t i;
+    size_t j;
+
+    if( (size_t)hVar * 2 > nameSlots )
+    {
+        newSlots = ( nameSlots == 0 ) ? MEMVARS_INITIAL_SLOTS : nameSlots * 2;
+        newNames = calloc( newSlots, sizeof( VAR_HANDLE ) );
+        if( newNames != NULL )
+        {
+            for( i = 0; i < nameSlots; i++ )
+            {
+                if( names[i] != VAR_INVALID )
+                {
+                    j = hash_name( vars[names[i] - 1]->name )
+                        & ( newSlots - 1 );
+                    while( newNames[j] != VAR_INVALID )
+                    {
+                        j = ( j + 1 ) & ( newSlots - 1 );
+                    }
+
+                    newNames[j] = names[i];
+                }
+            }
+
+            free( names );
+            names = newNames;
+            nameSlots = newSlots;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if( result == EOK )
+    {
+        i = hash_name( name ) & ( nameSlots - 1 );
+        while( names[i] != VAR_INVALID )
+        {
+            i = ( i + 1 ) & ( nameSlots - 1 );
+        }
+
+        names[i] = hVar;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  hash_name                                                                 */
+/*!
+    FNV-1a hash of a variable name
+
+    @param[in]
+        name
+            name to hash
+
+    @return the 32-bit hash of the name
+
+==============================================================================*/
+static uint32_t hash_name( const char *name )
+{
+    uint32_t hash = 2166136261u;
+
+    while( *name != '\0' )
+    {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/*============================================================================*/
+/*  new_request                                                               */
+/*!
+    Allocate a validation or print request.  The lock must be held.
+
+    @param[in]
+        hVar
+            handle of the variable the request is for
+
+    @return pointer to the request, or NULL if all slots are in use
+
+==============================================================================*/
+static MemRequest *new_request( VAR_HANDLE hVar )
+{
+    MemRequest *pRequest = NULL;
+    int i;
+
+    for( i = 0; i < MEMVARS_MAX_REQUESTS; i++ )
+    {
+        if( requests[i].used == false )
+        {
+            pRequest = &requests[i];
+            memset( pRequest, 0, sizeof( MemRequest ) );
+            pRequest->used = true;
+            pRequest->id = ++lastRequestId;
+            pRequest->hVar = hVar;
+            pRequest->fd = -1;
+            break;
+        }
+    }
+
+    return pRequest;
+}
+
+/*============================================================================*/
+/*  get_request                                                               */
+/*!
+    Find a pending request by identifier.  The lock must be held.
+
+    @param[in]
+        id
+            request identifier
+
+    @return pointer to the request, or NULL if it does not exist
+
+==============================================================================*/
+static MemRequest *get_request( uint32_t id )
+{
+    MemRequest *pRequest = NULL;
+    int i;
+
+    for( i = 0; i < MEMVARS_MAX_REQUESTS; i++ )
+    {
+        if( ( requests[i].used == true ) &&
+            ( requests[i].done == false ) &&
+            ( requests[i].id == id ) )
+        {
+            pRequest = &requests[i];
+            break;
+        }
+    }
+
+    return pRequest;
+}
+
+/*============================================================================*/
+/*  wait_until                                                                */
+/*!
+    Wait for a request to complete or a variable to be written.
+    The lock must be held.
+
+    @param[in]
+        flag
+            if not NULL, wait until *flag is true
+
+    @param[in]
+        version
+            if not NULL, wait until *version differs from start
+
+    @param[in]
+        start
+            initial value of *version
+
+    @retval EOK the condition was met
+    @retval ETIMEDOUT the condition was not met within MEMVARS_TIMEOUT_MS
+
+==============================================================================*/
+static int wait_until( bool *flag, uint32_t *version, uint32_t start )
+{
+    int result = EOK;
+    struct timespec deadline;
+
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_sec += MEMVARS_TIMEOUT_MS / 1000;
+    deadline.tv_nsec += ( MEMVARS_TIMEOUT_MS % 1000 ) * 1000000L;
+    if( deadline.tv_nsec >= 1000000000L )
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    while( ( result == EOK ) &&
+           ( ( ( flag != NULL ) && ( *flag == false ) ) ||
+             ( ( version != NULL ) && ( *version == start ) ) ) )
+    {
+        result = pthread_cond_timedwait( &changed, &lock, &deadline );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  send_signal                                                               */
+/*!
+    Queue a notification signal to this process
+
+    Retries while the realtime signal queue is full.
+
+    @param[in]
+        sig
+            signal to send
+
+    @param[in]
+        value
+            signal payload
+
+==============================================================================*/
+static void send_signal( int sig, int value )
+{
+    union sigval sv;
+
+    sv.sival_int = value;
+
+    while( ( sigqueue( getpid(), sig, sv ) == -1 ) && ( errno == EAGAIN ) )
+    {
+        sched_yield();
+    }
+}
+
+/*============================================================================*/
+/*  copy_out                                                                  */
+/*!
+    Copy a variable value to a caller supplied VarObject
+
+    String and blob values are copied into the caller's buffer.  The
+    length of a blob is returned in dst->len.
+
+    @param[in]
+        src
+            source value
+
+    @param[in,out]
+        dst
+            destination.  For strings and blobs, dst->val.str and
+            dst->len describe the output buffer.
+
+    @retval EOK the value was copied
+    @retval E2BIG the value does not fit the output buffer
+    @retval EINVAL no output buffer was supplied
+
+==============================================================================*/
+static int copy_out( const VarObject *src, VarObject *dst )
+{
+    int result = EOK;
+    size_t len;
+
+    if( ( src->type == VARTYPE_STR ) || ( src->type == VARTYPE_BLOB ) )
+    {
+        if( src->type == VARTYPE_STR )
+        {
+            len = ( src->val.str != NULL ) ? strlen( src->val.str ) + 1 : 0;
+        }
+        else
+        {
+            len = src->len;
+        }
+
+        if( ( dst->val.str == NULL ) || ( dst->len == 0 ) )
+        {
+            result = EINVAL;
+        }
+        else if( len > dst->len )
+        {
+            result = E2BIG;
+        }
+        else if( src->type == VARTYPE_STR )
+        {
+            memcpy( dst->val.str, ( len > 0 ) ? src->val.str : "", len );
+            dst->val.str[( len > 0 ) ? len - 1 : 0] = '\0';
+        }
+        else
+        {
+            memcpy( dst->val.blob, src->val.blob, len );
+            dst->len = len;
+        }
+    }
+    else
+    {
+        dst->val = src->val;
+        dst->len = src->len;
+    }
+
+    dst->type = src->type;
+
+    return result;
+}
+
+/*============================================================================*/
+/*  store_value                                                               */
+/*!
+    Write a value to a memory variable.  The lock must be held.
+
+    @param[in]
+        pVar
+            variable to write
+
+    @param[in]
+        obj
+            new value with the variable's type
+
+    @retval EOK the value was written
+    @retval E2BIG the string or blob does not fit the variable
+
+==============================================================================*/
+static int store_value( MemVar *pVar, const VarObject *obj )
+{
+    int result = EOK;
+    size_t len;
+
+    if( pVar->obj.type == VARTYPE_STR )
+    {
+        len = ( obj->val.str != NULL ) ? strlen( obj->val.str ) : 0;
+        if( len < pVar->obj.len )
+        {
+            memcpy( pVar->str, obj->val.str, len );
+            pVar->str[len] = '\0';
+        }
+        else
+        {
+            result = E2BIG;
+        }
+    }
+    else if( pVar->obj.type == VARTYPE_BLOB )
+    {
+        len = ( obj->val.blob != NULL ) ? obj->len : 0;
+        if( len <= pVar->size )
+        {
+            memcpy( pVar->str, obj->val.blob, len );
+            pVar->obj.len = len;
+        }
+        else
+        {
+            result = E2BIG;
+        }
+    }
+    else
+    {
+        pVar->obj.val = obj->val;
+        pVar->obj.len = obj->len;
+    }
+
+    if( result == EOK )
+    {
+        pVar->version++;
+        pthread_cond_broadcast( &changed );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  parse_value                                                               */
+/*!
+    Convert a string to a VarObject of the specified type
+
+    String and blob values are not copied: obj->val.str points to str.
+    A blob value holds the characters of str without the terminator.
+
+    @param[in]
+        type
+            type of the value
+
+    @param[in]
+        str
+            string to convert
+
+    @param[out]
+        obj
+            converted value
+
+    @retval EOK the string was converted
+    @retval EINVAL the string could not be converted
+
+==============================================================================*/
+static int parse_value( VarType type, const char *str, VarObject *obj )
+{
+    int result = EOK;
+    char *end = NULL;
+
+    memset( obj, 0, sizeof( VarObject ) );
+    obj->type = type;
+
+    if( str == NULL )
+    {
+        result = EINVAL;
+    }
+    else
+    {
+        switch( type )
+        {
+            case VARTYPE_STR:
+                obj->val.str = (char *)str;
+                obj->len = strlen( str ) + 1;
+                end = (char *)str + strlen( str );
+                break;
+
+            case VARTYPE_BLOB:
+                obj->val.blob = (char *)str;
+                obj->len = strlen( str );
+                end = (char *)str + strlen( str );
+                break;
+
+            case VARTYPE_UINT16:
+                obj->val.ui = (uint16_t)strtoul( str, &end, 0 );
+                obj->len = sizeof( uint16_t );
+                break;
+
+            case VARTYPE_INT16:
+                obj->val.i = (int16_t)strtol( str, &end, 0 );
+                obj->len = sizeof( int16_t );
+                break;
+
+            case VARTYPE_UINT32:
+                obj->val.ul = (uint32_t)strtoul( str, &end, 0 );
+                obj->len = sizeof( uint32_t );
+                break;
+
+            case VARTYPE_INT32:
+                obj->val.l = (int32_t)strtol( str, &end, 0 );
+                obj->len = sizeof( int32_t );
+                break;
+
+            case VARTYPE_UINT64:
+                obj->val.ull = (uint64_t)strtoull( str, &end, 0 );
+                obj->len = sizeof( uint64_t );
+                break;
+
+            case VARTYPE_INT64:
+                obj->val.ll = (int64_t)strtoll( str, &end, 0 );
+                obj->len = sizeof( int64_t );
+                break;
+
+            case VARTYPE_FLOAT:
+                obj->val.f = strtof( str, &end );
+                obj->len = sizeof( float );
+                break;
+
+            default:
+                result = EINVAL;
+                break;
+        }
+
+        if( ( result == EOK ) &&
+            ( end == str ) &&
+            ( type != VARTYPE_STR ) &&
+            ( type != VARTYPE_BLOB ) )
+        {
+            result = EINVAL;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  query_next                                                                */
+/*!
+    Find the next variable matching a query
+
+    query->context holds the index of the next variable to check.
+
+    @param[in,out]
+        query
+            search query
+
+    @param[in,out]
+        obj
+            receives the value of the matching variable
+
+    @retval EOK a matching variable was found
+    @retval ENOENT no more variables matched
+
+==============================================================================*/
+static int query_next( VarQuery *query, VarObject *obj )
+{
+    int result = ENOENT;
+    MemVar *pVar;
+    size_t i;
+
+    pthread_mutex_lock( &lock );
+
+    for( i = query->context; i < numVars; i++ )
+    {
+        pVar = vars[i];
+        if( ( ( query->type & QUERY_MATCH ) == 0 ) ||
+            ( query->match == NULL ) ||
+            ( strstr( pVar->name, query->match ) != NULL ) )
+        {
+            query->hVar = (VAR_HANDLE)( i + 1 );
+            strcpy( query->name, pVar->name );
+            result = copy_out( &pVar->obj, obj );
+            break;
+        }
+    }
+
+    query->context = (uint32_t)( i + 1 );
+
+    pthread_mutex_unlock( &lock );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  format_value                                                              */
+/*!
+    Render a VarObject as a string
+
+    @param[in]
+        obj
+            value to render
+
+    @param[out]
+        buf
+            output buffer
+
+    @param[in]
+        len
+            size of the output buffer
+
+    @retval EOK the value was rendered
+    @retval ENOTSUP the value type cannot be rendered
+
+==============================================================================*/
+static int format_value( const VarObject *obj, char *buf, size_t len )
+{
+    int result = EOK;
+
+    switch( obj->type )
+    {
+        case VARTYPE_STR:
+            snprintf( buf, len, "%s", obj->val.str ? obj->val.str : "" );
+            break;
+
+        case VARTYPE_UINT16:
+            snprintf( buf, len, "%u", (unsigned int)obj->val.ui );
+            break;
+
+        case VARTYPE_INT16:
+            snprintf( buf, len, "%d", (int)obj->val.i );
+            break;
+
+        case VARTYPE_UINT32:
+            snprintf( buf, len, "%u", (unsigned int)obj->val.ul );
+            break;
+
+        case VARTYPE_INT32:
+            snprintf( buf, len, "%d", (int)obj->val.l );
+            break;
+
+        case VARTYPE_UINT64:
+            snprintf( buf, len, "%llu", (unsigned long long)obj->val.ull );
+            break;
+
+        case VARTYPE_INT64:
+            snprintf( buf, len, "%lld", (long long)obj->val.ll );
+            break;
+
+        case VARTYPE_FLOAT:
+            snprintf( buf, len, "%f", (double)obj->val.f );
+            break;
+
+        default:
+            result = ENOTSUP;
+            break;
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of memvars group */
@@ -0,0 +1,100 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef MEMVARS_H
+#define MEMVARS_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <varserver/varserver.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! time limit for a client waiting on a notification handler */
+#define MEMVARS_TIMEOUT_MS  ( 5000 )
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+VARSERVER_HANDLE MEMVARS_Open( void );
+int MEMVARS_Close( VARSERVER_HANDLE hVarServer );
+int MEMVARS_CreateVar( VARSERVER_HANDLE hVarServer, VarInfo *pVarInfo );
+VAR_HANDLE MEMVARS_FindByName( VARSERVER_HANDLE hVarServer, char *name );
+int MEMVARS_GetType( VARSERVER_HANDLE hVarServer,
+                     VAR_HANDLE hVar,
+                     VarType *pVarType );
+int MEMVARS_GetLength( VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       size_t *len );
+int MEMVARS_GetName( VARSERVER_HANDLE hVarServer,
+                     VAR_HANDLE hVar,
+                     char *buf,
+                     size_t len );
+int MEMVARS_Get( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar, VarObject *obj );
+int MEMVARS_Set( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar, VarObject *obj );
+int MEMVARS_SetStr( VARSERVER_HANDLE hVarServer,
+                    VAR_HANDLE hVar,
+                    VarType type,
+                    char *str );
+int MEMVARS_Notify( VARSERVER_HANDLE hVarServer,
+                    VAR_HANDLE hVar,
+                    NotificationType notificationType );
+int MEMVARS_NotifyCancel( VARSERVER_HANDLE hVarServer,
+                          VAR_HANDLE hVar,
+                          NotificationType notificationType );
+int MEMVARS_GetValidationRequest( VARSERVER_HANDLE hVarServer,
+                                  uint32_t id,
+                                  VAR_HANDLE *hVar,
+                                  VarObject *obj );
+int MEMVARS_SendValidationResponse( VARSERVER_HANDLE hVarServer,
+                                    uint32_t id,
+                                    int response );
+int MEMVARS_OpenPrintSession( VARSERVER_HANDLE hVarServer,
+                              uint32_t id,
+                              VAR_HANDLE *hVar,
+                              int *fd );
+int MEMVARS_ClosePrintSession( VARSERVER_HANDLE hVarServer,
+                               uint32_t id,
+                               int fd );
+int MEMVARS_Print( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar, int fd );
+int MEMVARS_GetFirst( VARSERVER_HANDLE hVarServer,
+                      VarQuery *query,
+                      VarObject *obj );
+int MEMVARS_GetNext( VARSERVER_HANDLE hVarServer,
+                     VarQuery *query,
+                     VarObject *obj );
+
+int MEMVARS_Create( VARSERVER_HANDLE hVarServer,
+                    const char *name,
+                    VarType type,
+                    const char *value );
+VarType MEMVARS_TypeFromName( const char *name );
+
+#endif
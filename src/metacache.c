@@ -0,0 +1,555 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file metacache.c
+
+    Variable metadata cache
+
+    The type and name of a variable do not change while the variable
+    server is running, but var.set() and the other typed paths used to
+    ask the variable server for the type on every call.  The cache
+    keeps the type and name of each variable handle once they have
+    been fetched, so only the first lookup of each makes a request.
+
+    The cache is a table indexed by handle which grows as larger
+    handles are seen.  Entries are filled lazily: the type when it is
+    first needed, and the name only when it is asked for.  The whole
+    cache is discarded when the reconnecting backend reports a new
+    server generation, since a restarted server may have recreated
+    the variables with other types.
+
+    The length of a string or blob variable depends on its value, so
+    it is never cached.  The lock is not held while the variable server
+    is asked, so two threads may both fetch a missing entry.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+#include "backend.h"
+#include "stats.h"
+#include "reconnect.h"
+#include "metacache.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! initial number of cache entries */
+#define METACACHE_INITIAL_SIZE  ( 64 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! cached metadata of a variable */
+typedef struct _MetaCacheEntry
+{
+    /*! variable type, or VARTYPE_INVALID if it is not cached */
+    VarType type;
+
+    /*! variable name, or NULL if it is not cached */
+    char *name;
+} MetaCacheEntry;
+
+/*! cache counters */
+typedef struct _MetaCacheStats
+{
+    /*! lookups answered from the cache */
+    uint64_t hits;
+
+    /*! lookups which made a variable server request */
+    uint64_t misses;
+
+    /*! times the cache was discarded */
+    uint64_t invalidations;
+} MetaCacheStats;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static MetaCacheEntry *lookup( VAR_HANDLE hVar );
+static MetaCacheEntry *grow( VAR_HANDLE hVar );
+static void clear( void );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! protects the cache entries */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*! cache entries indexed by handle */
+static MetaCacheEntry *entries = NULL;
+
+/*! number of cache entries */
+static size_t numEntries = 0;
+
+/*! server generation the cache entries belong to */
+static unsigned int generation = 0;
+
+/*! cache counters */
+static MetaCacheStats stats;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  METACACHE_GetType                                                         */
+/*!
+    Get the type of a variable
+
+    The type is taken from the cache, or fetched from the variable
+    server and cached.
+
+    @param[in]
+        backend
+            variable server backend
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[out]
+        pVarType
+            receives the variable type
+
+    @retval EOK the type was returned
+    @retval EINVAL invalid arguments
+    @retval other error from the variable server
+
+==============================================================================*/
+int METACACHE_GetType( const LuaVarsBackend *backend,
+                       VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       VarType *pVarType )
+{
+    int result = EINVAL;
+    MetaCacheEntry *pEntry;
+    VarType type = VARTYPE_INVALID;
+    uint64_t t0;
+
+    if( ( backend != NULL ) && ( pVarType != NULL ) )
+    {
+        pthread_mutex_lock( &lock );
+        pEntry = lookup( hVar );
+        if( pEntry != NULL )
+        {
+            type = pEntry->type;
+        }
+        pthread_mutex_unlock( &lock );
+
+        if( type != VARTYPE_INVALID )
+        {
+            __atomic_fetch_add( &stats.hits, 1, __ATOMIC_RELAXED );
+            result = EOK;
+        }
+        else
+        {
+            __atomic_fetch_add( &stats.misses, 1, __ATOMIC_RELAXED );
+
+            t0 = STATS_Now();
+            result = backend->getType( hVarServer, hVar, &type );
+            STATS_Ipc( LUAVARS_IPC_GET_TYPE, t0, result );
+
+            if( result == EOK )
+            {
+                pthread_mutex_lock( &lock );
+                pEntry = grow( hVar );
+                if( pEntry != NULL )
+                {
+                    pEntry->type = type;
+                }
+                pthread_mutex_unlock( &lock );
+            }
+        }
+
+        *pVarType = type;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  METACACHE_GetName                                                         */
+/*!
+    Get the name of a variable
+
+    The name is taken from the cache, or fetched from the variable
+    server and cached.
+
+    @param[in]
+        backend
+            variable server backend
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[out]
+        buf
+            buffer to receive the NUL terminated name
+
+    @param[in]
+        len
+            size of the buffer
+
+    @retval EOK the name was returned
+    @retval E2BIG the buffer is too small for the name
+    @retval EINVAL invalid arguments
+    @retval other error from the variable server
+
+==============================================================================*/
+int METACACHE_GetName( const LuaVarsBackend *backend,
+                       VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       char *buf,
+                       size_t len )
+{
+    int result = EINVAL;
+    MetaCacheEntry *pEntry;
+    bool hit = false;
+    size_t n;
+    uint64_t t0;
+
+    if( ( backend != NULL ) && ( buf != NULL ) && ( len > 0 ) )
+    {
+        pthread_mutex_lock( &lock );
+        pEntry = lookup( hVar );
+        if( ( pEntry != NULL ) && ( pEntry->name != NULL ) )
+        {
+            hit = true;
+            n = strlen( pEntry->name );
+            if( n < len )
+            {
+                memcpy( buf, pEntry->name, n + 1 );
+                result = EOK;
+            }
+            else
+            {
+                result = E2BIG;
+            }
+        }
+        pthread_mutex_unlock( &lock );
+
+        if( hit == true )
+        {
+            __atomic_fetch_add( &stats.hits, 1, __ATOMIC_RELAXED );
+        }
+        else
+        {
+            __atomic_fetch_add( &stats.misses, 1, __ATOMIC_RELAXED );
+
+            t0 = STATS_Now();
+            result = backend->getName( hVarServer, hVar, buf, len );
+            STATS_Ipc( LUAVARS_IPC_GET_NAME, t0, result );
+
+            if( result == EOK )
+            {
+                pthread_mutex_lock( &lock );
+                pEntry = grow( hVar );
+                if( ( pEntry != NULL ) && ( pEntry->name == NULL ) )
+                {
+                    pEntry->name = strdup( buf );
+                }
+                pthread_mutex_unlock( &lock );
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  METACACHE_GetLength                                                       */
+/*!
+    Get the length of the value of a variable
+
+    The length of a numeric variable follows from its cached type.  The
+    length of a string or blob variable is always fetched from the
+    variable server since it may change with the value.
+
+    @param[in]
+        backend
+            variable server backend
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[out]
+        len
+            receives the length of the value
+
+    @retval EOK the length was returned
+    @retval EINVAL invalid arguments
+    @retval other error from the variable server
+
+==============================================================================*/
+int METACACHE_GetLength( const LuaVarsBackend *backend,
+                         VARSERVER_HANDLE hVarServer,
+                         VAR_HANDLE hVar,
+                         size_t *len )
+{
+    VarType type;
+    uint64_t t0;
+    int result = EINVAL;
+
+    if( len != NULL )
+    {
+        result = METACACHE_GetType( backend, hVarServer, hVar, &type );
+    }
+
+    if( result == EOK )
+    {
+        switch( type )
+        {
+            case VARTYPE_UINT16:
+            case VARTYPE_INT16:
+                *len = sizeof( uint16_t );
+                break;
+
+            case VARTYPE_UINT32:
+            case VARTYPE_INT32:
+                *len = sizeof( uint32_t );
+                break;
+
+            case VARTYPE_UINT64:
+            case VARTYPE_INT64:
+                *len = sizeof( uint64_t );
+                break;
+
+            case VARTYPE_FLOAT:
+                *len = sizeof( float );
+                break;
+
+            default:
+                t0 = STATS_Now();
+                result = backend->getLength( hVarServer, hVar, len );
+                STATS_Ipc( LUAVARS_IPC_GET_LENGTH, t0, result );
+                break;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  METACACHE_Clear                                                           */
+/*!
+    Discard every cache entry
+
+    Used when the variables may have been recreated, for example after
+    var.reconnect().
+
+==============================================================================*/
+void METACACHE_Clear( void )
+{
+    pthread_mutex_lock( &lock );
+    clear();
+    pthread_mutex_unlock( &lock );
+}
+
+/*============================================================================*/
+/*  METACACHE_Print                                                           */
+/*!
+    Print the cache counters
+
+    @param[in]
+        fp
+            output file pointer
+
+==============================================================================*/
+void METACACHE_Print( FILE *fp )
+{
+    if( ( stats.hits != 0 ) || ( stats.misses != 0 ) )
+    {
+        fprintf( fp,
+                 "metacache: hits=%llu misses=%llu invalidations=%llu\n",
+                 (unsigned long long)stats.hits,
+                 (unsigned long long)stats.misses,
+                 (unsigned long long)stats.invalidations );
+    }
+}
+
+/*============================================================================*/
+/*  METACACHE_PushTable                                                       */
+/*!
+    Push the cache counters onto the Lua stack as a table
+
+    @param[in]
+        L
+            pointer to the lua state
+
+==============================================================================*/
+void METACACHE_PushTable( lua_State *L )
+{
+    lua_newtable( L );
+
+    lua_pushinteger( L, (lua_Integer)stats.hits );
+    lua_setfield( L, -2, "hits" );
+
+    lua_pushinteger( L, (lua_Integer)stats.misses );
+    lua_setfield( L, -2, "misses" );
+
+    lua_pushinteger( L, (lua_Integer)stats.invalidations );
+    lua_setfield( L, -2, "invalidations" );
+}
+
+/*============================================================================*/
+/*  lookup                                                                    */
+/*!
+    Find the cache entry of a variable
+
+    The cache is discarded first if the server generation has changed.
+    Must be called with the lock held.
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @return the cache entry, or NULL if the handle has no entry
+
+==============================================================================*/
+static MetaCacheEntry *lookup( VAR_HANDLE hVar )
+{
+    unsigned int current = RECONNECT_Generation();
+
+    if( current != generation )
+    {
+        clear();
+        generation = current;
+    }
+
+    return ( (size_t)hVar < numEntries ) ? &entries[hVar] : NULL;
+}
+
+/*============================================================================*/
+/*  grow                                                                      */
+/*!
+    Get the cache entry of a variable, growing the cache to hold it
+
+    Must be called with the lock held.
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @return the cache entry, or NULL if the handle cannot be cached
+
+==============================================================================*/
+static MetaCacheEntry *grow( VAR_HANDLE hVar )
+{
+    MetaCacheEntry *pEntry = NULL;
+    MetaCacheEntry *p;
+    size_t n;
+
+    if( ( hVar != VAR_INVALID ) && ( hVar < METACACHE_MAX_HANDLES ) )
+    {
+        pEntry = lookup( hVar );
+        if( pEntry == NULL )
+        {
+            n = ( numEntries == 0 ) ? METACACHE_INITIAL_SIZE : numEntries;
+            while( n <= (size_t)hVar )
+            {
+                n *= 2;
+            }
+
+            p = realloc( entries, n * sizeof( MetaCacheEntry ) );
+            if( p != NULL )
+            {
+                memset( &p[numEntries],
+                        0,
+                        ( n - numEntries ) * sizeof( MetaCacheEntry ) );
+                entries = p;
+                numEntries = n;
+                pEntry = &entries[hVar];
+            }
+        }
+    }
+
+    return pEntry;
+}
+
+/*============================================================================*/
+/*  clear                                                                     */
+/*!
+    Discard every cache entry
+
+    Must be called with the lock held.
+
+==============================================================================*/
+static void clear( void )
+{
+    size_t i;
+
+    if( numEntries != 0 )
+    {
+        for( i = 0; i < numEntries; i++ )
+        {
+            free( entries[i].name );
+        }
+
+        free( entries );
+        entries = NULL;
+        numEntries = 0;
+        stats.invalidations++;
+    }
+}
+
+/*! @}
+ * end of libluavars group */
@@ -0,0 +1,66 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef METACACHE_H
+#define METACACHE_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stddef.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+#include "backend.h"
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! handles at or above this value are never cached */
+#define METACACHE_MAX_HANDLES   ( 65536 )
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int METACACHE_GetType( const LuaVarsBackend *backend,
+                       VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       VarType *pVarType );
+int METACACHE_GetName( const LuaVarsBackend *backend,
+                       VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       char *buf,
+                       size_t len );
+int METACACHE_GetLength( const LuaVarsBackend *backend,
+                         VARSERVER_HANDLE hVarServer,
+                         VAR_HANDLE hVar,
+                         size_t *len );
+void METACACHE_Clear( void );
+void METACACHE_Print( FILE *fp );
+void METACACHE_PushTable( lua_State *L );
+
+#endif
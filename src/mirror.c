@@ -0,0 +1,951 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file mirror.c
+
+    Shared memory variable mirror
+
+    Many Lua processes on one host polling the same variables each
+    make their own variable server requests.  With a mirror, one
+    process (the publisher) registers for modified notifications on a
+    set of variables and keeps their current values in a POSIX shared
+    memory segment.  Other processes attach to the segment and
+    var.get() reads mirrored variables from it without any IPC,
+    falling back to the variable server for other names.
+
+    The segment is an open addressed hash table of variable slots
+    keyed by name.  A slot's name is written once, before the slot is
+    marked used.  Each value is protected by a sequence lock: the
+    publisher makes the sequence number odd while it writes the value
+    and even again when it is done, and a reader retries its copy of
+    the value until it sees the same even sequence number before and
+    after.  Readers never block the publisher or each other.
+
+    The publisher updates a slot when it services the modified
+    notification inside var.wait(), so the mirror is as current as the
+    publisher's event loop.  A value which cannot be read, such as a
+    string longer than the slot, marks the slot invalid until it can be
+    read again, and readers ask the variable server instead.
+
+    Readers give up on a slot which stays locked for MIRROR_MAX_RETRIES
+    attempts, and stop using the mirror once its publisher has exited,
+    which they check at most every MIRROR_CHECK_NS.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+#include "backend.h"
+#include "stats.h"
+#include "mirror.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! identifies a mirror segment */
+#define MIRROR_MAGIC            ( 0x4c564d52 )
+
+/*! segment layout version */
+#define MIRROR_VERSION          ( 1 )
+
+/*! initial size of the publisher's handle to slot map */
+#define MIRROR_INITIAL_MAP      ( 64 )
+
+/*! number of attempts to read a slot which is being written */
+#define MIRROR_MAX_RETRIES      ( 1000 )
+
+/*! interval between checks that the publisher is running */
+#define MIRROR_CHECK_NS         ( 100000000ULL )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! mirrored variable slot */
+typedef struct _MirrorSlot
+{
+    /*! sequence lock: odd while the value is being written */
+    uint32_t seq;
+
+    /*! non-zero once the slot name is valid */
+    uint32_t used;
+
+    /*! variable type */
+    VarType type;
+
+    /*! scalar value */
+    VarData val;
+
+    /*! string value */
+    char str[MIRROR_STR_LEN];
+
+    /*! variable name */
+    char name[MAX_NAME_LEN + 1];
+} MirrorSlot;
+
+/*! mirror segment */
+typedef struct _MirrorSegment
+{
+    /*! MIRROR_MAGIC */
+    uint32_t magic;
+
+    /*! MIRROR_VERSION */
+    uint32_t version;
+
+    /*! number of slots, a power of two */
+    uint32_t slots;
+
+    /*! process identifier of the publisher, zero once it has closed */
+    uint32_t pid;
+
+    /*! variable slots */
+    MirrorSlot slot[];
+} MirrorSegment;
+
+/*! mirror counters */
+typedef struct _MirrorStats
+{
+    /*! var.get() calls answered from the mirror */
+    uint64_t hits;
+
+    /*! var.get() calls for names which are not mirrored */
+    uint64_t misses;
+
+    /*! reads retried because the value was being written */
+    uint64_t retries;
+
+    /*! values written by the publisher */
+    uint64_t updates;
+
+    /*! values which could not be read by the publisher */
+    uint64_t invalid;
+} MirrorStats;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static int map_segment( const char *segment, size_t slots, bool publish );
+static MirrorSlot *find_slot( const char *name, bool reserve );
+static uint32_t hash_name( const char *name );
+static int update_slot( MirrorSlot *pSlot, VAR_HANDLE hVar );
+static int map_handle( VAR_HANDLE hVar, uint32_t index );
+static bool publisher_alive( bool force );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! mapped mirror segment */
+static MirrorSegment *pSegment = NULL;
+
+/*! size of the mapped segment */
+static size_t segmentSize = 0;
+
+/*! name of the published segment, unlinked when the mirror is closed */
+static char *published = NULL;
+
+/*! variable server connection used by the publisher */
+static VARSERVER_HANDLE hPublisher = NULL;
+
+/*! publisher's slot index + 1 of each variable handle */
+static uint32_t *slotOf = NULL;
+
+/*! number of entries in slotOf */
+static size_t numSlotOf = 0;
+
+/*! mirror counters */
+static MirrorStats stats;
+
+/*! time of the last check that the publisher is running */
+static uint64_t lastCheck = 0;
+
+/*! true once the publisher of the attached mirror has exited */
+static bool publisherGone = false;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  MIRROR_Publish                                                            */
+/*!
+    Create a mirror segment to publish variables to
+
+    @param[in]
+        segment
+            shared memory object name, e.g. "/luavars"
+
+    @param[in]
+        slots
+            number of variable slots, rounded up to a power of two
+
+    @param[in]
+        hVarServer
+            variable server connection used to read the variables
+
+    @retval EOK the segment was created
+    @retval EEXIST a mirror is already published or attached
+    @retval EINVAL invalid number of slots
+    @retval other error creating the shared memory object
+
+==============================================================================*/
+int MIRROR_Publish( const char *segment,
+                    size_t slots,
+                    VARSERVER_HANDLE hVarServer )
+{
+    int result = EEXIST;
+    size_t n = 1;
+
+    if( pSegment == NULL )
+    {
+        if( ( slots == 0 ) || ( slots > MIRROR_MAX_SLOTS ) )
+        {
+            result = EINVAL;
+        }
+        else
+        {
+            while( n < slots )
+            {
+                n <<= 1;
+            }
+
+            result = map_segment( segment, n, true );
+            if( result == EOK )
+            {
+                published = strdup( segment );
+                hPublisher = hVarServer;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MIRROR_Add                                                                */
+/*!
+    Add a variable to the published mirror
+
+    A slot is reserved for the variable and its current value is
+    written to it.  The caller registers the modified notification.
+
+    @param[in]
+        name
+            variable name
+
+    @param[in]
+        hVar
+            variable handle
+
+    A string value too long for the slot leaves the slot invalid, so
+    readers use the variable server, until a shorter value is written.
+
+    @retval EOK the variable was added
+    @retval ENOTCONN no mirror is being published
+    @retval ENOSPC the mirror is full
+    @retval ENAMETOOLONG the name is too long
+    @retval other error reading the variable
+
+==============================================================================*/
+int MIRROR_Add( const char *name, VAR_HANDLE hVar )
+{
+    int result = ENOTCONN;
+    MirrorSlot *pSlot;
+
+    if( ( pSegment != NULL ) && ( published != NULL ) )
+    {
+        if( strlen( name ) > MAX_NAME_LEN )
+        {
+            result = ENAMETOOLONG;
+        }
+        else
+        {
+            pSlot = find_slot( name, true );
+            if( pSlot != NULL )
+            {
+                result = map_handle( hVar,
+                                     (uint32_t)( pSlot - pSegment->slot ) );
+                if( result == EOK )
+                {
+                    result = update_slot( pSlot, hVar );
+                    result = ( result == E2BIG ) ? EOK : result;
+                }
+            }
+            else
+            {
+                result = ENOSPC;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MIRROR_Service                                                            */
+/*!
+    Service a notification for a mirrored variable
+
+    Called by var.wait() for each received signal.  A modified
+    notification for a published variable updates its slot and is
+    not passed on to the script.
+
+    @param[in]
+        sig
+            received signal
+
+    @param[in]
+        hVar
+            variable handle carried by the signal
+
+    @retval true the notification was for a mirrored variable
+    @retval false the notification should be handled by the script
+
+==============================================================================*/
+bool MIRROR_Service( int sig, VAR_HANDLE hVar )
+{
+    bool result = false;
+    uint32_t index;
+
+    if( ( published != NULL ) &&
+        ( sig == SIG_VAR_MODIFIED ) &&
+        ( (size_t)hVar < numSlotOf ) )
+    {
+        index = slotOf[hVar];
+        if( index != 0 )
+        {
+            (void)update_slot( &pSegment->slot[index - 1], hVar );
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MIRROR_Attach                                                             */
+/*!
+    Attach to a mirror segment published by another process
+
+    @param[in]
+        segment
+            shared memory object name
+
+    @retval EOK the segment was attached
+    @retval EEXIST a mirror is already published or attached
+    @retval EPROTO the object is not a compatible mirror segment
+    @retval other error opening the shared memory object
+
+==============================================================================*/
+int MIRROR_Attach( const char *segment )
+{
+    int result = EEXIST;
+
+    if( pSegment == NULL )
+    {
+        result = map_segment( segment, 0, false );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MIRROR_Get                                                                */
+/*!
+    Read a variable from the mirror
+
+    @param[in]
+        name
+            variable name
+
+    @param[in,out]
+        obj
+            receives the value.  For strings, obj->val.str and obj->len
+            describe the output buffer.
+
+    @retval EOK the value was read from the mirror
+    @retval ENOENT the variable is not mirrored, its slot is invalid,
+            or the publisher has exited
+    @retval EAGAIN the slot was being written for too long
+
+==============================================================================*/
+int MIRROR_Get( const char *name, VarObject *obj )
+{
+    int result = ENOENT;
+    MirrorSlot *pSlot = NULL;
+    uint32_t seq;
+    VarType type = VARTYPE_INVALID;
+    VarData val;
+    char str[MIRROR_STR_LEN];
+    size_t len;
+    int tries;
+
+    if( ( pSegment != NULL ) && ( publisher_alive( false ) == true ) )
+    {
+        pSlot = find_slot( name, false );
+    }
+
+    if( pSlot != NULL )
+    {
+        for( tries = 0; tries < MIRROR_MAX_RETRIES; tries++ )
+        {
+            seq = __atomic_load_n( &pSlot->seq, __ATOMIC_ACQUIRE );
+            if( ( seq & 1 ) == 0 )
+            {
+                type = pSlot->type;
+                val = pSlot->val;
+                if( type == VARTYPE_STR )
+                {
+                    memcpy( str, pSlot->str, sizeof str );
+                }
+
+                __atomic_thread_fence( __ATOMIC_ACQUIRE );
+                if( __atomic_load_n( &pSlot->seq,
+                                     __ATOMIC_RELAXED ) == seq )
+                {
+                    break;
+                }
+            }
+
+            stats.retries++;
+        }
+
+        if( tries == MIRROR_MAX_RETRIES )
+        {
+            /* the publisher may have died while writing the slot */
+            type = VARTYPE_INVALID;
+            result = ( publisher_alive( true ) == true ) ? EAGAIN : ENOENT;
+        }
+
+        if( type == VARTYPE_STR )
+        {
+            if( ( obj->val.str != NULL ) && ( obj->len > 0 ) )
+            {
+                str[MIRROR_STR_LEN - 1] = '\0';
+                len = strlen( str );
+                if( len >= obj->len )
+                {
+                    len = obj->len - 1;
+                }
+
+                obj->type = type;
+                memcpy( obj->val.str, str, len );
+                obj->val.str[len] = '\0';
+                result = EOK;
+            }
+        }
+        else if( type != VARTYPE_INVALID )
+        {
+            obj->type = type;
+            obj->val = val;
+            result = EOK;
+        }
+    }
+
+    if( pSegment != NULL )
+    {
+        if( result == EOK )
+        {
+            stats.hits++;
+        }
+        else
+        {
+            stats.misses++;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  MIRROR_Close                                                              */
+/*!
+    Detach from the mirror, and remove the segment if it was published
+    by this process
+
+==============================================================================*/
+void MIRROR_Close( void )
+{
+    if( pSegment != NULL )
+    {
+        if( published != NULL )
+        {
+            /* tell the readers the mirror is no longer updated */
+            __atomic_store_n( &pSegment->pid, 0, __ATOMIC_RELEASE );
+        }
+
+        munmap( pSegment, segmentSize );
+        pSegment = NULL;
+        segmentSize = 0;
+    }
+
+    if( published != NULL )
+    {
+        shm_unlink( published );
+        free( published );
+        published = NULL;
+    }
+
+    free( slotOf );
+    slotOf = NULL;
+    numSlotOf = 0;
+    hPublisher = NULL;
+    publisherGone = false;
+    lastCheck = 0;
+}
+
+/*============================================================================*/
+/*  MIRROR_Print                                                              */
+/*!
+    Render the mirror counters as text
+
+    @param[in]
+        fp
+            output stream
+
+==============================================================================*/
+void MIRROR_Print( FILE *fp )
+{
+    if( pSegment != NULL )
+    {
+        fprintf( fp,
+                 "mirror: %s hits=%llu misses=%llu retries=%llu "
+                 "updates=%llu invalid=%llu%s\n",
+                 ( published != NULL ) ? "publisher" : "reader",
+                 (unsigned long long)stats.hits,
+                 (unsigned long long)stats.misses,
+                 (unsigned long long)stats.retries,
+                 (unsigned long long)stats.updates,
+                 (unsigned long long)stats.invalid,
+                 publisherGone ? " publisher exited" : "" );
+    }
+}
+
+/*============================================================================*/
+/*  MIRROR_PushTable                                                          */
+/*!
+    Push the mirror counters onto the Lua stack as a table
+
+    @param[in]
+        L
+            pointer to the lua state
+
+==============================================================================*/
+void MIRROR_PushTable( lua_State *L )
+{
+    lua_newtable( L );
+
+    lua_pushboolean( L, pSegment != NULL );
+    lua_setfield( L, -2, "attached" );
+
+    lua_pushboolean( L, published != NULL );
+    lua_setfield( L, -2, "publisher" );
+
+    lua_pushinteger( L, (lua_Integer)stats.hits );
+    lua_setfield( L, -2, "hits" );
+
+    lua_pushinteger( L, (lua_Integer)stats.misses );
+    lua_setfield( L, -2, "misses" );
+
+    lua_pushinteger( L, (lua_Integer)stats.retries );
+    lua_setfield( L, -2, "retries" );
+
+    lua_pushinteger( L, (lua_Integer)stats.updates );
+    lua_setfield( L, -2, "updates" );
+
+    lua_pushinteger( L, (lua_Integer)stats.invalid );
+    lua_setfield( L, -2, "invalid" );
+
+    lua_pushboolean( L, publisherGone );
+    lua_setfield( L, -2, "publisher_exited" );
+}
+
+/*============================================================================*/
+/*  map_segment                                                               */
+/*!
+    Create or open and map a mirror segment
+
+    @param[in]
+        segment
+            shared memory object name
+
+    @param[in]
+        slots
+            number of slots when publishing
+
+    @param[in]
+        publish
+            true to create the segment, false to attach to it
+
+    @retval EOK the segment was mapped
+    @retval EPROTO the object is not a compatible mirror segment
+    @retval other error opening or mapping the shared memory object
+
+==============================================================================*/
+static int map_segment( const char *segment, size_t slots, bool publish )
+{
+    int result = EOK;
+    MirrorSegment *p = MAP_FAILED;
+    struct stat st;
+    size_t size = 0;
+    int fd;
+
+    fd = publish ? shm_open( segment, O_RDWR | O_CREAT | O_TRUNC, 0644 )
+                 : shm_open( segment, O_RDONLY, 0 );
+    if( fd == -1 )
+    {
+        result = errno;
+    }
+    else
+    {
+        if( publish == true )
+        {
+            size = sizeof( MirrorSegment ) + slots * sizeof( MirrorSlot );
+            if( ftruncate( fd, (off_t)size ) == -1 )
+            {
+                result = errno;
+            }
+        }
+        else if( fstat( fd, &st ) == 0 )
+        {
+            size = (size_t)st.st_size;
+        }
+        else
+        {
+            result = errno;
+        }
+
+        if( ( result == EOK ) && ( size < sizeof( MirrorSegment ) ) )
+        {
+            result = EPROTO;
+        }
+
+        if( result == EOK )
+        {
+            p = mmap( NULL,
+                      size,
+                      publish ? PROT_READ | PROT_WRITE : PROT_READ,
+                      MAP_SHARED,
+                      fd,
+                      0 );
+            if( p == MAP_FAILED )
+            {
+                result = errno;
+            }
+        }
+
+        close( fd );
+    }
+
+    if( result == EOK )
+    {
+        if( publish == true )
+        {
+            p->version = MIRROR_VERSION;
+            p->slots = (uint32_t)slots;
+            p->pid = (uint32_t)getpid();
+            __atomic_store_n( &p->magic, MIRROR_MAGIC, __ATOMIC_RELEASE );
+        }
+        else if( ( __atomic_load_n( &p->magic,
+                                    __ATOMIC_ACQUIRE ) != MIRROR_MAGIC ) ||
+                 ( p->version != MIRROR_VERSION ) ||
+                 ( sizeof( MirrorSegment ) +
+                   p->slots * sizeof( MirrorSlot ) > size ) )
+        {
+            munmap( p, size );
+            result = EPROTO;
+        }
+    }
+
+    if( result == EOK )
+    {
+        memset( &stats, 0, sizeof stats );
+        pSegment = p;
+        segmentSize = size;
+    }
+    else if( ( publish == true ) && ( fd != -1 ) )
+    {
+        shm_unlink( segment );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  find_slot                                                                 */
+/*!
+    Find the slot of a variable name
+
+    @param[in]
+        name
+            variable name
+
+    @param[in]
+        reserve
+            true to reserve a free slot if the name is not found.
+            Only the publisher may reserve slots.
+
+    @return pointer to the slot, or NULL if the name was not found
+            and no slot was reserved
+
+==============================================================================*/
+static MirrorSlot *find_slot( const char *name, bool reserve )
+{
+    MirrorSlot *pSlot = NULL;
+    MirrorSlot *p;
+    uint32_t mask = pSegment->slots - 1;
+    uint32_t index = hash_name( name ) & mask;
+    uint32_t i;
+
+    for( i = 0; i <= mask; i++ )
+    {
+        p = &pSegment->slot[( index + i ) & mask];
+        if( __atomic_load_n( &p->used, __ATOMIC_ACQUIRE ) == 0 )
+        {
+            if( reserve == true )
+            {
+                strcpy( p->name, name );
+                __atomic_store_n( &p->used, 1, __ATOMIC_RELEASE );
+                pSlot = p;
+            }
+
+            break;
+        }
+
+        if( strcmp( p->name, name ) == 0 )
+        {
+            pSlot = p;
+            break;
+        }
+    }
+
+    return pSlot;
+}
+
+/*============================================================================*/
+/*  hash_name                                                                 */
+/*!
+    FNV-1a hash of a variable name
+
+    @param[in]
+        name
+            variable name
+
+    @return the hash value
+
+==============================================================================*/
+static uint32_t hash_name( const char *name )
+{
+    uint32_t hash = 2166136261u;
+
+    while( *name != '\0' )
+    {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/*============================================================================*/
+/*  update_slot                                                               */
+/*!
+    Read a variable and write its value to its slot
+
+    @param[in]
+        pSlot
+            pointer to the slot
+
+    @param[in]
+        hVar
+            variable handle
+
+    If the variable cannot be read, the slot is marked invalid so
+    readers do not return a stale value.
+
+    @retval EOK the slot was updated
+    @retval other error reading the variable
+
+==============================================================================*/
+static int update_slot( MirrorSlot *pSlot, VAR_HANDLE hVar )
+{
+    int result;
+    VarObject obj;
+    char buf[MIRROR_STR_LEN];
+    uint32_t seq;
+    uint64_t t0;
+
+    memset( &obj, 0, sizeof obj );
+    obj.val.str = buf;
+    obj.len = sizeof buf;
+
+    t0 = STATS_Now();
+    result = BACKEND_Current()->get( hPublisher, hVar, &obj );
+    STATS_Ipc( LUAVARS_IPC_GET, t0, result );
+
+    seq = pSlot->seq;
+    __atomic_store_n( &pSlot->seq, seq + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+
+    if( result == EOK )
+    {
+        pSlot->type = obj.type;
+        if( obj.type == VARTYPE_STR )
+        {
+            buf[sizeof buf - 1] = '\0';
+            strcpy( pSlot->str, buf );
+        }
+        else
+        {
+            pSlot->val = obj.val;
+        }
+
+        stats.updates++;
+    }
+    else
+    {
+        pSlot->type = VARTYPE_INVALID;
+        stats.invalid++;
+    }
+
+    __atomic_store_n( &pSlot->seq, seq + 2, __ATOMIC_RELEASE );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  map_handle                                                                */
+/*!
+    Record the slot of a published variable handle
+
+    @param[in]
+        hVar
+            variable handle
+
+    @param[in]
+        index
+            slot index
+
+    @retval EOK the handle was recorded
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+static int map_handle( VAR_HANDLE hVar, uint32_t index )
+{
+    int result = EOK;
+    uint32_t *p;
+    size_t n;
+
+    if( (size_t)hVar >= numSlotOf )
+    {
+        n = ( numSlotOf == 0 ) ? MIRROR_INITIAL_MAP : numSlotOf;
+        while( n <= (size_t)hVar )
+        {
+            n *= 2;
+        }
+
+        p = realloc( slotOf, n * sizeof( uint32_t ) );
+        if( p != NULL )
+        {
+            memset( &p[numSlotOf], 0, ( n - numSlotOf ) * sizeof( uint32_t ) );
+            slotOf = p;
+            numSlotOf = n;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if( result == EOK )
+    {
+        slotOf[hVar] = index + 1;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  publisher_alive                                                           */
+/*!
+    Check whether the publisher of the mapped mirror is still running
+
+    The check is made at most every MIRROR_CHECK_NS unless forced.
+    Once the publisher has gone, the mirror is not used again.
+
+    @param[in]
+        force
+            true to check now
+
+    @retval true the mirror is published by this process or a running one
+    @retval false the publisher has closed the mirror or exited
+
+==============================================================================*/
+static bool publisher_alive( bool force )
+{
+    uint64_t now;
+    pid_t pid;
+
+    if( ( published == NULL ) && ( publisherGone == false ) )
+    {
+        now = STATS_Now();
+        if( ( force == true ) || ( now - lastCheck >= MIRROR_CHECK_NS ) )
+        {
+            lastCheck = now;
+            pid = (pid_t)__atomic_load_n( &pSegment->pid, __ATOMIC_ACQUIRE );
+            publisherGone = ( pid == 0 ) ||
+                            ( ( kill( pid, 0 ) == -1 ) && ( errno == ESRCH ) );
+        }
+    }
+
+    return !publisherGone;
+}
+
+/*! @}
+ * end of libluavars group */
@@ -0,0 +1,66 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef MIRROR_H
+#define MIRROR_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+#include "backend.h"
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! default number of variable slots in a mirror segment */
+#define MIRROR_DEFAULT_SLOTS    ( 256 )
+
+/*! maximum number of variable slots in a mirror segment */
+#define MIRROR_MAX_SLOTS        ( 65536 )
+
+/*! maximum length of a mirrored string value including the NUL */
+#define MIRROR_STR_LEN          ( 256 )
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int MIRROR_Publish( const char *segment,
+                    size_t slots,
+                    VARSERVER_HANDLE hVarServer );
+int MIRROR_Add( const char *name, VAR_HANDLE hVar );
+bool MIRROR_Service( int sig, VAR_HANDLE hVar );
+int MIRROR_Attach( const char *segment );
+int MIRROR_Get( const char *name, VarObject *obj );
+void MIRROR_Close( void );
+void MIRROR_Print( FILE *fp );
+void MIRROR_PushTable( lua_State *L );
+
+#endif
@@ -0,0 +1,68 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef PROBES_H
+#define PROBES_H
+
+/*============================================================================*/
+/*!
+@file probes.h
+
+    USDT static tracepoints
+
+    When the library is built with the LUAVARS_USDT option, the
+    LUAVARS_PROBEn macros expand to sys/sdt.h probes in the "luavars"
+    provider.  A probe is a single nop until a tracer attaches to it.
+    Without the option the macros expand to nothing.
+
+    The probes can be listed with:
+
+        bpftrace -l 'usdt:/usr/local/lib/libluavars.so:luavars:*'
+
+*/
+/*============================================================================*/
+
+#ifdef LUAVARS_USDT
+
+#include <sys/sdt.h>
+
+#define LUAVARS_PROBE0(name) \
+    DTRACE_PROBE( luavars, name )
+#define LUAVARS_PROBE1(name, a) \
+    DTRACE_PROBE1( luavars, name, a )
+#define LUAVARS_PROBE2(name, a, b) \
+    DTRACE_PROBE2( luavars, name, a, b )
+#define LUAVARS_PROBE3(name, a, b, c) \
+    DTRACE_PROBE3( luavars, name, a, b, c )
+
+#else
+
+#define LUAVARS_PROBE0(name)
+#define LUAVARS_PROBE1(name, a)
+#define LUAVARS_PROBE2(name, a, b)
+#define LUAVARS_PROBE3(name, a, b, c)
+
+#endif
+
+#endif
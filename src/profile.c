@@ -0,0 +1,823 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file profile.c
+
+    Sampling profiler for Lua handler code
+
+    The profiler arms an ITIMER_PROF interval timer which delivers
+    SIGPROF at the requested frequency while the process consumes CPU.
+    SIGPROF is not one of the signals waited on by var.wait().
+
+    The signal handler only installs a one-shot Lua count hook, which
+    is safe to do from a signal handler.  The hook runs on the next
+    Lua instruction, walks the call stack with lua_getstack() and
+    accumulates the folded stack in a hash table.  Each stack is
+    rooted at the notification being handled and the variable handle
+    so samples can be attributed per event type and variable.
+
+    Lua hooks belong to a single thread, so while profiling
+    coroutine.resume() is replaced by a wrapper which records the
+    coroutine being run, and the signal handler hooks that thread
+    instead of the main one.  The hook which the thread had when the
+    signal arrived is put back once the sample is taken.  Functions
+    made by coroutine.wrap(), and copies of coroutine.resume() taken
+    before profiling started, do not go through the wrapper; their
+    time is sampled when control returns to the resuming thread.
+
+    The folded output can be passed directly to flamegraph.pl.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <lua.h>
+#include <lauxlib.h>
+#include "stats.h"
+#include "profile.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! maximum length of a folded stack */
+#define PROFILE_MAX_STACK_LEN   ( 4096 )
+
+/*! maximum number of Lua stack frames sampled */
+#define PROFILE_MAX_DEPTH       ( 64 )
+
+/*! initial number of hash table slots (must be a power of 2) */
+#define PROFILE_INITIAL_SLOTS   ( 256 )
+
+/*! registry key of the coroutine.resume() replaced while profiling */
+#define PROFILE_RESUME          "LuaVarsProfileResume"
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! folded stack sample counter */
+typedef struct _ProfileEntry
+{
+    /*! folded stack, or NULL for an empty slot */
+    char *stack;
+
+    /*! hash of the folded stack */
+    uint32_t hash;
+
+    /*! number of samples with this stack */
+    uint64_t count;
+} ProfileEntry;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static void profile_signal( int sig );
+static void profile_hook( lua_State *L, lua_Debug *ar );
+static int profile_resume( lua_State *L );
+static void wrap_resume( lua_State *L, bool enable );
+static void record_sample( lua_State *L );
+static size_t append_frame( char *buf, size_t len, lua_Debug *ar );
+static int add_stack( const char *stack );
+static int grow_table( void );
+static uint32_t hash_string( const char *s );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! lua state being profiled */
+static lua_State *profileL = NULL;
+
+/*! set by the signal handler while a sample hook is installed */
+static volatile sig_atomic_t samplePending = 0;
+
+/*! innermost coroutine resumed through coroutine.resume(), or NULL
+    when the main thread is running */
+static lua_State * volatile runningL = NULL;
+
+/*! thread the pending sample hook is installed on */
+static lua_State *sampleL = NULL;
+
+/*! hook the sampled thread had before the sample hook was installed */
+static lua_Hook sampleHook = NULL;
+
+/*! mask of the hook the sampled thread had */
+static int sampleMask = 0;
+
+/*! count of the hook the sampled thread had */
+static int sampleCount = 0;
+
+/*! SIGPROF action before profiling started */
+static struct sigaction prevAction;
+
+/*! folded stack hash table */
+static ProfileEntry *table = NULL;
+
+/*! number of slots in the hash table */
+static size_t tableSlots = 0;
+
+/*! number of used slots in the hash table */
+static size_t tableUsed = 0;
+
+/*! total number of samples taken */
+static uint64_t totalSamples = 0;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  PROFILE_Start                                                             */
+/*!
+    Start the sampling profiler
+
+    @param[in]
+        L
+            pointer to the lua state to sample
+
+    @param[in]
+        hz
+            sampling frequency in samples per CPU second
+
+    @retval EOK the profiler was started
+    @retval EBUSY the profiler is already running
+    @retval EINVAL invalid arguments
+    @retval other error from sigaction() or setitimer()
+
+==============================================================================*/
+int PROFILE_Start( lua_State *L, int hz )
+{
+    int result = EINVAL;
+    struct sigaction sa;
+    struct itimerval itv;
+    long usec;
+
+    if( profileL != NULL )
+    {
+        result = EBUSY;
+    }
+    else if( ( L != NULL ) && ( hz > 0 ) && ( hz <= PROFILE_MAX_HZ ) )
+    {
+        result = EOK;
+
+        if( table == NULL )
+        {
+            result = grow_table();
+        }
+
+        if( result == EOK )
+        {
+            samplePending = 0;
+            runningL = NULL;
+            profileL = L;
+
+            memset( &sa, 0, sizeof( sa ) );
+            sa.sa_handler = profile_signal;
+            sa.sa_flags = SA_RESTART;
+            sigemptyset( &sa.sa_mask );
+
+            if( sigaction( SIGPROF, &sa, &prevAction ) != 0 )
+            {
+                result = errno;
+                profileL = NULL;
+            }
+        }
+
+        if( result == EOK )
+        {
+            usec = 1000000L / hz;
+            itv.it_interval.tv_sec = usec / 1000000L;
+            itv.it_interval.tv_usec = usec % 1000000L;
+            itv.it_value = itv.it_interval;
+
+            if( setitimer( ITIMER_PROF, &itv, NULL ) != 0 )
+            {
+                result = errno;
+                (void)sigaction( SIGPROF, &prevAction, NULL );
+                profileL = NULL;
+            }
+        }
+
+        if( result == EOK )
+        {
+            wrap_resume( L, true );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  PROFILE_Stop                                                              */
+/*!
+    Stop the sampling profiler
+
+    The collected samples are kept until PROFILE_Clear() is called
+
+    @retval EOK the profiler was stopped
+    @retval ENOENT the profiler was not running
+
+==============================================================================*/
+int PROFILE_Stop( void )
+{
+    int result = ENOENT;
+    struct itimerval itv;
+
+    if( profileL != NULL )
+    {
+        memset( &itv, 0, sizeof( itv ) );
+        (void)setitimer( ITIMER_PROF, &itv, NULL );
+        (void)sigaction( SIGPROF, &prevAction, NULL );
+
+        /* remove any sample hook which has not fired yet */
+        if( samplePending != 0 )
+        {
+            lua_sethook( sampleL, sampleHook, sampleMask, sampleCount );
+            samplePending = 0;
+        }
+
+        wrap_resume( profileL, false );
+        runningL = NULL;
+        profileL = NULL;
+
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  PROFILE_Samples                                                           */
+/*!
+    Get the number of samples collected
+
+    @return the total number of samples collected
+
+==============================================================================*/
+uint64_t PROFILE_Samples( void )
+{
+    return totalSamples;
+}
+
+/*============================================================================*/
+/*  PROFILE_Write                                                             */
+/*!
+    Write the collected samples as folded stacks
+
+    Each line of the output contains the semicolon separated stack
+    followed by a space and the number of samples, as consumed by
+    flamegraph.pl.
+
+    @param[in]
+        path
+            path of the file to write
+
+    @retval EOK the samples were written
+    @retval EINVAL invalid path
+    @retval other error from fopen()
+
+==============================================================================*/
+int PROFILE_Write( const char *path )
+{
+    int result = EINVAL;
+    FILE *fp;
+    size_t i;
+
+    if( path != NULL )
+    {
+        fp = fopen( path, "w" );
+        if( fp != NULL )
+        {
+            for( i = 0; i < tableSlots; i++ )
+            {
+                if( table[i].stack != NULL )
+                {
+                    fprintf( fp,
+                             "%s %llu\n",
+                             table[i].stack,
+                             (unsigned long long)table[i].count );
+                }
+            }
+
+            fclose( fp );
+            result = EOK;
+        }
+        else
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  PROFILE_PushTable                                                         */
+/*!
+    Push the collected samples onto the Lua stack
+
+    The samples are pushed as a table mapping each folded stack
+    to its sample count.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+==============================================================================*/
+void PROFILE_PushTable( lua_State *L )
+{
+    size_t i;
+
+    lua_createtable( L, 0, (int)tableUsed );
+
+    for( i = 0; i < tableSlots; i++ )
+    {
+        if( table[i].stack != NULL )
+        {
+            lua_pushinteger( L, (lua_Integer)table[i].count );
+            lua_setfield( L, -2, table[i].stack );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  PROFILE_Clear                                                             */
+/*!
+    Discard the collected samples
+
+==============================================================================*/
+void PROFILE_Clear( void )
+{
+    size_t i;
+
+    for( i = 0; i < tableSlots; i++ )
+    {
+        free( table[i].stack );
+    }
+
+    free( table );
+    table = NULL;
+    tableSlots = 0;
+    tableUsed = 0;
+    totalSamples = 0;
+}
+
+/*============================================================================*/
+/*  profile_signal                                                            */
+/*!
+    SIGPROF signal handler
+
+    Installs a count hook on the running thread which will take the
+    sample on the next Lua instruction, keeping the thread's own hook
+    to put back afterwards.  lua_sethook() is safe to call from a
+    signal handler.
+
+    @param[in]
+        sig
+            the received signal
+
+==============================================================================*/
+static void profile_signal( int sig )
+{
+    lua_State *L;
+
+    (void)sig;
+
+    if( ( profileL != NULL ) && ( samplePending == 0 ) )
+    {
+        L = ( runningL != NULL ) ? runningL : profileL;
+
+        sampleL = L;
+        sampleHook = lua_gethook( L );
+        sampleMask = lua_gethookmask( L );
+        sampleCount = lua_gethookcount( L );
+        samplePending = 1;
+
+        lua_sethook( L,
+                     profile_hook,
+                     LUA_MASKCALL | LUA_MASKRET | LUA_MASKCOUNT,
+                     1 );
+    }
+}
+
+/*============================================================================*/
+/*  profile_hook                                                              */
+/*!
+    One-shot Lua hook which takes a sample
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        ar
+            activation record of the hook event (unused)
+
+==============================================================================*/
+static void profile_hook( lua_State *L, lua_Debug *ar )
+{
+    (void)ar;
+
+    lua_sethook( L, sampleHook, sampleMask, sampleCount );
+
+    if( samplePending != 0 )
+    {
+        record_sample( L );
+        samplePending = 0;
+    }
+}
+
+/*============================================================================*/
+/*  profile_resume                                                            */
+/*!
+    coroutine.resume() wrapper used while profiling
+
+    The original coroutine.resume() is the first upvalue.  The resumed
+    coroutine is recorded as the running thread so samples are taken
+    in it.  A sample hook still pending on the coroutine when it yields
+    or returns is removed, since the coroutine may never run again.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @return the results of coroutine.resume()
+
+==============================================================================*/
+static int profile_resume( lua_State *L )
+{
+    lua_State *co = lua_tothread( L, 1 );
+    lua_State *prev = runningL;
+    int rc;
+
+    lua_pushvalue( L, lua_upvalueindex( 1 ) );
+    lua_insert( L, 1 );
+
+    if( co != NULL )
+    {
+        runningL = co;
+    }
+
+    rc = lua_pcall( L, lua_gettop( L ) - 1, LUA_MULTRET, 0 );
+
+    runningL = prev;
+    if( ( samplePending != 0 ) && ( sampleL == co ) )
+    {
+        lua_sethook( co, sampleHook, sampleMask, sampleCount );
+        samplePending = 0;
+    }
+
+    if( rc != LUA_OK )
+    {
+        return lua_error( L );
+    }
+
+    return lua_gettop( L );
+}
+
+/*============================================================================*/
+/*  wrap_resume                                                               */
+/*!
+    Replace coroutine.resume() with profile_resume(), or put it back
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        enable
+            true to install the wrapper, false to restore the original
+
+==============================================================================*/
+static void wrap_resume( lua_State *L, bool enable )
+{
+    int top = lua_gettop( L );
+
+    if( lua_getglobal( L, "coroutine" ) == LUA_TTABLE )
+    {
+        if( enable == true )
+        {
+            if( lua_getfield( L, -1, "resume" ) == LUA_TFUNCTION )
+            {
+                lua_pushvalue( L, -1 );
+                lua_setfield( L, LUA_REGISTRYINDEX, PROFILE_RESUME );
+                lua_pushcclosure( L, profile_resume, 1 );
+                lua_setfield( L, -2, "resume" );
+            }
+        }
+        else if( lua_getfield( L,
+                               LUA_REGISTRYINDEX,
+                               PROFILE_RESUME ) == LUA_TFUNCTION )
+        {
+            lua_setfield( L, -2, "resume" );
+            lua_pushnil( L );
+            lua_setfield( L, LUA_REGISTRYINDEX, PROFILE_RESUME );
+        }
+    }
+
+    lua_settop( L, top );
+}
+
+/*============================================================================*/
+/*  record_sample                                                             */
+/*!
+    Fold the current Lua call stack and count it
+
+    The stack is rooted at the notification being handled (or "idle")
+    and, if known, the handle of the variable being serviced.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+==============================================================================*/
+static void record_sample( lua_State *L )
+{
+    char stack[PROFILE_MAX_STACK_LEN];
+    lua_Debug ar;
+    VAR_HANDLE hVar;
+    size_t len;
+    int depth;
+    int level;
+    int sigIdx;
+
+    sigIdx = STATS_HandlerContext( &hVar );
+
+    if( hVar != VAR_INVALID )
+    {
+        len = (size_t)snprintf( stack,
+                                sizeof( stack ),
+                                "%s;h%u",
+                                STATS_SignalName( sigIdx ),
+                                (unsigned int)hVar );
+    }
+    else
+    {
+        len = (size_t)snprintf( stack,
+                                sizeof( stack ),
+                                "%s",
+                                STATS_SignalName( sigIdx ) );
+    }
+
+    /* find the outermost frame */
+    depth = 0;
+    while( ( depth < PROFILE_MAX_DEPTH ) &&
+           ( lua_getstack( L, depth, &ar ) == 1 ) )
+    {
+        depth++;
+    }
+
+    /* fold from the outermost frame inwards */
+    for( level = depth - 1; level >= 0; level-- )
+    {
+        if( ( lua_getstack( L, level, &ar ) == 1 ) &&
+            ( lua_getinfo( L, "Sn", &ar ) != 0 ) )
+        {
+            len = append_frame( stack, len, &ar );
+        }
+    }
+
+    if( add_stack( stack ) == EOK )
+    {
+        totalSamples++;
+    }
+}
+
+/*============================================================================*/
+/*  append_frame                                                              */
+/*!
+    Append a stack frame to a folded stack
+
+    @param[in,out]
+        buf
+            folded stack buffer of PROFILE_MAX_STACK_LEN bytes
+
+    @param[in]
+        len
+            current length of the folded stack
+
+    @param[in]
+        ar
+            activation record of the frame
+
+    @return the new length of the folded stack
+
+==============================================================================*/
+static size_t append_frame( char *buf, size_t len, lua_Debug *ar )
+{
+    const char *name;
+    int n;
+
+    if( len < PROFILE_MAX_STACK_LEN - 1 )
+    {
+        name = ( ar->name != NULL ) ? ar->name : "?";
+
+        if( strcmp( ar->what, "C" ) == 0 )
+        {
+            n = snprintf( &buf[len],
+                          PROFILE_MAX_STACK_LEN - len,
+                          ";%s",
+                          name );
+        }
+        else if( strcmp( ar->what, "main" ) == 0 )
+        {
+            n = snprintf( &buf[len],
+                          PROFILE_MAX_STACK_LEN - len,
+                          ";main@%s",
+                          ar->short_src );
+        }
+        else
+        {
+            n = snprintf( &buf[len],
+                          PROFILE_MAX_STACK_LEN - len,
+                          ";%s@%s:%d",
+                          name,
+                          ar->short_src,
+                          ar->linedefined );
+        }
+
+        if( n > 0 )
+        {
+            len += (size_t)n;
+        }
+
+        if( len >= PROFILE_MAX_STACK_LEN )
+        {
+            len = PROFILE_MAX_STACK_LEN - 1;
+        }
+    }
+
+    return len;
+}
+
+/*============================================================================*/
+/*  add_stack                                                                 */
+/*!
+    Count a sample for a folded stack
+
+    @param[in]
+        stack
+            the folded stack
+
+    @retval EOK the sample was counted
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+static int add_stack( const char *stack )
+{
+    int result = EOK;
+    uint32_t hash;
+    size_t i;
+
+    if( ( tableUsed + 1 ) * 10 > tableSlots * 7 )
+    {
+        result = grow_table();
+    }
+
+    if( result == EOK )
+    {
+        hash = hash_string( stack );
+        i = hash & ( tableSlots - 1 );
+
+        while( ( table[i].stack != NULL ) &&
+               ( ( table[i].hash != hash ) ||
+                 ( strcmp( table[i].stack, stack ) != 0 ) ) )
+        {
+            i = ( i + 1 ) & ( tableSlots - 1 );
+        }
+
+        if( table[i].stack == NULL )
+        {
+            table[i].stack = strdup( stack );
+            if( table[i].stack != NULL )
+            {
+                table[i].hash = hash;
+                table[i].count = 0;
+                tableUsed++;
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if( result == EOK )
+        {
+            table[i].count++;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  grow_table                                                                */
+/*!
+    Double the size of the folded stack hash table
+
+    @retval EOK the table was resized
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+static int grow_table( void )
+{
+    int result = ENOMEM;
+    ProfileEntry *newTable;
+    size_t newSlots;
+    size_t i;
+    size_t j;
+
+    newSlots = ( tableSlots == 0 ) ? PROFILE_INITIAL_SLOTS : tableSlots * 2;
+    newTable = calloc( newSlots, sizeof( ProfileEntry ) );
+    if( newTable != NULL )
+    {
+        for( i = 0; i < tableSlots; i++ )
+        {
+            if( table[i].stack != NULL )
+            {
+                j = table[i].hash & ( newSlots - 1 );
+                while( newTable[j].stack != NULL )
+                {
+                    j = ( j + 1 ) & ( newSlots - 1 );
+                }
+
+                newTable[j] = table[i];
+            }
+        }
+
+        free( table );
+        table = newTable;
+        tableSlots = newSlots;
+        result = EOK;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  hash_string                                                               */
+/*!
+    FNV-1a hash of a NUL terminated string
+
+    @param[in]
+        s
+            string to hash
+
+    @return the 32-bit hash of the string
+
+==============================================================================*/
+static uint32_t hash_string( const char *s )
+{
+    uint32_t hash = 2166136261u;
+
+    while( *s != '\0' )
+    {
+        hash ^= (uint8_t)*s++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/*! @}
+ * end of libluavars group */
@@ -0,0 +1,312 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file realtime.c
+
+    Realtime controls for notification handlers
+
+    The realtime module runs the thread calling var.wait() as a low
+    jitter service: it pins the thread to a CPU, raises it to the
+    SCHED_FIFO policy, locks the process memory with mlockall() and
+    pre-faults the stack and heap so that handlers do not take page
+    faults on memory they have not touched before.
+
+    When the heap is pre-faulted, malloc() is told never to return
+    memory to the system or to satisfy requests with mmap(), so the
+    pre-faulted pages are reused by later allocations.
+
+    Once configured, the page faults taken by the thread are sampled
+    with getrusage() before and after each handler so the statistics
+    can show which notifications still fault.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <varserver/varserver.h>
+#include "realtime.h"
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static int set_affinity( int cpu );
+static int set_priority( int priority );
+static int prefault_heap( size_t kb );
+static void prefault_stack( void );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! set once the realtime settings have been applied */
+static bool faultAccounting = false;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  REALTIME_Configure                                                        */
+/*!
+    Apply realtime settings to the calling thread
+
+    The settings are applied in order: CPU affinity, scheduling
+    priority, memory locking, and stack and heap pre-faulting.
+    Page fault accounting is enabled even if a setting fails.
+
+    @param[in]
+        pConfig
+            pointer to the realtime settings
+
+    @retval EOK the settings were applied
+    @retval EINVAL invalid CPU or priority
+    @retval EPERM the process may not change its scheduling or lock
+            its memory
+    @retval ENOMEM the memory could not be locked or pre-faulted
+
+==============================================================================*/
+int REALTIME_Configure( const RealtimeConfig *pConfig )
+{
+    int result = EINVAL;
+
+    if( pConfig != NULL )
+    {
+        faultAccounting = true;
+        result = EOK;
+
+        if( pConfig->cpu >= 0 )
+        {
+            result = set_affinity( pConfig->cpu );
+        }
+
+        if( ( result == EOK ) && ( pConfig->priority != 0 ) )
+        {
+            result = set_priority( pConfig->priority );
+        }
+
+        if( ( result == EOK ) && ( pConfig->mlock == true ) )
+        {
+            if( mlockall( MCL_CURRENT | MCL_FUTURE ) != 0 )
+            {
+                result = errno;
+            }
+        }
+
+        if( ( result == EOK ) &&
+            ( ( pConfig->mlock == true ) || ( pConfig->prefaultKB != 0 ) ) )
+        {
+            prefault_stack();
+            result = prefault_heap( pConfig->prefaultKB );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  REALTIME_Faults                                                           */
+/*!
+    Get the page faults taken by the calling thread
+
+    @param[out]
+        minor
+            number of minor page faults
+
+    @param[out]
+        major
+            number of major page faults
+
+    @retval true the fault counts were returned
+    @retval false page fault accounting is not enabled
+
+==============================================================================*/
+bool REALTIME_Faults( uint64_t *minor, uint64_t *major )
+{
+    struct rusage usage;
+    bool result = false;
+
+    if( ( faultAccounting == true ) &&
+        ( getrusage( RUSAGE_THREAD, &usage ) == 0 ) )
+    {
+        *minor = (uint64_t)usage.ru_minflt;
+        *major = (uint64_t)usage.ru_majflt;
+        result = true;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  set_affinity                                                              */
+/*!
+    Pin the calling thread to a CPU
+
+    @param[in]
+        cpu
+            CPU number
+
+    @retval EOK the thread was pinned
+    @retval EINVAL the CPU does not exist or is not permitted
+
+==============================================================================*/
+static int set_affinity( int cpu )
+{
+    int result = EINVAL;
+    cpu_set_t set;
+
+    if( cpu < CPU_SETSIZE )
+    {
+        CPU_ZERO( &set );
+        CPU_SET( cpu, &set );
+        result = pthread_setaffinity_np( pthread_self(),
+                                         sizeof( cpu_set_t ),
+                                         &set );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  set_priority                                                              */
+/*!
+    Run the calling thread with the SCHED_FIFO policy
+
+    @param[in]
+        priority
+            SCHED_FIFO priority
+
+    @retval EOK the policy was changed
+    @retval EINVAL the priority is out of range
+    @retval EPERM the process may not use realtime scheduling
+
+==============================================================================*/
+static int set_priority( int priority )
+{
+    int result = EINVAL;
+    struct sched_param param;
+
+    if( ( priority >= sched_get_priority_min( SCHED_FIFO ) ) &&
+        ( priority <= sched_get_priority_max( SCHED_FIFO ) ) )
+    {
+        memset( &param, 0, sizeof( struct sched_param ) );
+        param.sched_priority = priority;
+        result = pthread_setschedparam( pthread_self(), SCHED_FIFO, &param );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  prefault_heap                                                             */
+/*!
+    Pre-fault the heap
+
+    malloc() is configured to keep freed memory in the heap, and a
+    block of the requested size is allocated, touched and freed so
+    later allocations up to that size do not fault.
+
+    @param[in]
+        kb
+            size of the heap to pre-fault in KB
+
+    @retval EOK the heap was pre-faulted
+    @retval ENOMEM the memory could not be allocated
+
+==============================================================================*/
+static int prefault_heap( size_t kb )
+{
+    int result = EOK;
+    size_t page;
+    size_t len;
+    size_t i;
+    char *p;
+
+    (void)mallopt( M_TRIM_THRESHOLD, -1 );
+    (void)mallopt( M_MMAP_MAX, 0 );
+
+    if( kb != 0 )
+    {
+        len = kb * 1024;
+        page = (size_t)sysconf( _SC_PAGESIZE );
+
+        p = malloc( len );
+        if( p != NULL )
+        {
+            for( i = 0; i < len; i += page )
+            {
+                ((volatile char *)p)[i] = 0;
+            }
+
+            free( p );
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  prefault_stack                                                            */
+/*!
+    Pre-fault REALTIME_STACK_KB of the calling thread's stack
+
+==============================================================================*/
+static void __attribute__ ((noinline)) prefault_stack( void )
+{
+    volatile char stack[REALTIME_STACK_KB * 1024];
+    size_t i;
+
+    for( i = 0; i < sizeof( stack ); i += 1024 )
+    {
+        stack[i] = 0;
+    }
+}
+
+/*! @}
+ * end of libluavars group */
@@ -0,0 +1,70 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef REALTIME_H
+#define REALTIME_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! size of the stack pre-faulted when memory is locked, in KB */
+#define REALTIME_STACK_KB       ( 64 )
+
+/*==============================================================================
+        Public types
+==============================================================================*/
+
+/*! realtime settings for the thread calling var.wait() */
+typedef struct _RealtimeConfig
+{
+    /*! CPU to pin the thread to, or -1 to leave the affinity unchanged */
+    int cpu;
+
+    /*! SCHED_FIFO priority, or 0 to leave the policy unchanged */
+    int priority;
+
+    /*! lock the current and future process memory */
+    bool mlock;
+
+    /*! heap to pre-fault in KB, or 0 for none */
+    size_t prefaultKB;
+} RealtimeConfig;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int REALTIME_Configure( const RealtimeConfig *pConfig );
+bool REALTIME_Faults( uint64_t *minor, uint64_t *major );
+
+#endif
@@ -0,0 +1,1586 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file reconnect.c
+
+    Reconnecting variable server backend
+
+    The reconnecting backend wraps another backend and survives a
+    restart of the variable server.  Variable handles are only valid
+    for the lifetime of the server, so the bindings are given virtual
+    handles instead: each variable name found through the backend is
+    assigned a virtual handle which maps to the server's current
+    handle for that name.
+
+    When an operation fails with an error which indicates the server
+    connection was lost, the connection is reopened, every cached name
+    is resolved again to its new server handle, the notifications
+    registered on the connection are registered again, and the
+    operation is retried once.  The virtual handles held by Lua do not
+    change.
+
+    Names are re-resolved once per server restart, by the first
+    connection to notice it.  Other connections re-register their
+    notifications on their next operation.
+
+    Handles received in notification signals are mapped back to
+    virtual handles through the signalHandle operation.  Handles first
+    seen in a signal, a validation request or a print session have no
+    name, so their names are looked up on the next operation while the
+    server is still running.  A handle whose name was not learned
+    before a restart cannot be resolved and is counted as not found.
+
+    A connection which makes no requests, such as one blocked waiting
+    for notifications, cannot notice a restart by itself.
+    RECONNECT_Check() probes it with a request on one of its
+    notification variables.
+
+    Each wrapped backend has its own reconnecting backend instance,
+    with its own virtual handles, so reconnecting backends can be
+    stacked or used with different wrapped backends in one process.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <varserver/varserver.h>
+#include "backend.h"
+#include "reconnect.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! initial capacity of the dynamic arrays */
+#define RECONNECT_INITIAL_SIZE  ( 64 )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! variable known to the reconnecting backend.  The virtual handle
+    is the index of the variable plus one */
+typedef struct _ReconnectVar
+{
+    /*! variable name, or NULL if the handle was not found by name */
+    char *name;
+
+    /*! server handle in the current server generation */
+    VAR_HANDLE hReal;
+
+    /*! true until the name of a handle found without one is looked up */
+    bool pending;
+} ReconnectVar;
+
+/*! notification registered on a connection */
+typedef struct _ReconnectNotify
+{
+    /*! virtual handle of the variable */
+    VAR_HANDLE hVar;
+
+    /*! notification type */
+    NotificationType type;
+} ReconnectNotify;
+
+/*! reconnecting backend instance.  The operations come first, so the
+    backend pointer passed to open() and signalHandle() is the instance */
+typedef struct _Reconnect
+{
+    /*! reconnecting backend operations */
+    LuaVarsBackend backend;
+
+    /*! backend which performs the operations */
+    const LuaVarsBackend *inner;
+
+    /*! protects the variable table and the server generation */
+    pthread_mutex_t lock;
+
+    /*! variables indexed by virtual handle - 1 */
+    ReconnectVar *vars;
+
+    /*! number of variables */
+    size_t numVars;
+
+    /*! capacity of the vars array */
+    size_t maxVars;
+
+    /*! virtual handles indexed by server handle */
+    VAR_HANDLE *realToVirtual;
+
+    /*! number of entries in the realToVirtual array */
+    size_t numReal;
+
+    /*! number of server restarts handled */
+    unsigned int generation;
+
+    /*! number of variables whose names have not been looked up */
+    size_t numPending;
+
+    /*! next reconnecting backend instance */
+    struct _Reconnect *pNext;
+} Reconnect;
+
+/*! connection to the variable server */
+typedef struct _ReconnectClient
+{
+    /*! reconnecting backend the connection was opened through */
+    Reconnect *pReconnect;
+
+    /*! backend which performs the operations */
+    const LuaVarsBackend *inner;
+
+    /*! handle of the connection to the wrapped backend */
+    VARSERVER_HANDLE hInner;
+
+    /*! server generation the connection's notifications belong to */
+    unsigned int generation;
+
+    /*! notifications registered on the connection */
+    ReconnectNotify *notify;
+
+    /*! number of registered notifications */
+    size_t numNotify;
+
+    /*! capacity of the notify array */
+    size_t maxNotify;
+} ReconnectClient;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static VARSERVER_HANDLE rc_open( const LuaVarsBackend *pBackend );
+static int rc_close( VARSERVER_HANDLE hVarServer );
+static int rc_create( VARSERVER_HANDLE hVarServer, VarInfo *pVarInfo );
+static VAR_HANDLE rc_find( VARSERVER_HANDLE hVarServer, char *name );
+static int rc_get( VARSERVER_HANDLE hVarServer,
+                   VAR_HANDLE hVar,
+                   VarObject *obj );
+static int rc_set( VARSERVER_HANDLE hVarServer,
+                   VAR_HANDLE hVar,
+                   VarObject *obj );
+static int rc_setStr( VARSERVER_HANDLE hVarServer,
+                      VAR_HANDLE hVar,
+                      VarType type,
+                      char *str );
+static int rc_getType( VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       VarType *pVarType );
+static int rc_getLength( VARSERVER_HANDLE hVarServer,
+                         VAR_HANDLE hVar,
+                         size_t *len );
+static int rc_getName( VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       char *buf,
+                       size_t len );
+static int rc_notify( VARSERVER_HANDLE hVarServer,
+                      VAR_HANDLE hVar,
+                      NotificationType notificationType );
+static int rc_notifyCancel( VARSERVER_HANDLE hVarServer,
+                            VAR_HANDLE hVar,
+                            NotificationType notificationType );
+static int rc_getValidationRequest( VARSERVER_HANDLE hVarServer,
+                                    uint32_t id,
+                                    VAR_HANDLE *hVar,
+                                    VarObject *obj );
+static int rc_sendValidationResponse( VARSERVER_HANDLE hVarServer,
+                                      uint32_t id,
+                                      int response );
+static int rc_openPrintSession( VARSERVER_HANDLE hVarServer,
+                                uint32_t id,
+                                VAR_HANDLE *hVar,
+                                int *fd );
+static int rc_closePrintSession( VARSERVER_HANDLE hVarServer,
+                                 uint32_t id,
+                                 int fd );
+static int rc_getFirst( VARSERVER_HANDLE hVarServer,
+                        VarQuery *query,
+                        VarObject *obj );
+static int rc_getNext( VARSERVER_HANDLE hVarServer,
+                       VarQuery *query,
+                       VarObject *obj );
+static VAR_HANDLE rc_signalHandle( const LuaVarsBackend *pBackend,
+                                   VAR_HANDLE hVar );
+
+static bool retry( ReconnectClient *pClient, int rc );
+static bool connection_lost( int rc );
+static int reconnect( ReconnectClient *pClient,
+                      size_t *pResolved,
+                      size_t *pFailed );
+static void resolve_all( ReconnectClient *pClient,
+                         size_t *pResolved,
+                         size_t *pFailed );
+static void name_vars( ReconnectClient *pClient );
+static VAR_HANDLE to_real( ReconnectClient *pClient, VAR_HANDLE hVar );
+static VAR_HANDLE to_virtual( Reconnect *pReconnect,
+                              VAR_HANDLE hReal,
+                              const char *name );
+static VAR_HANDLE add_var( Reconnect *pReconnect,
+                           VAR_HANDLE hReal,
+                           const char *name );
+static void map_real( Reconnect *pReconnect,
+                      VAR_HANDLE hReal,
+                      VAR_HANDLE hVar );
+static void add_notify( ReconnectClient *pClient,
+                        VAR_HANDLE hVar,
+                        NotificationType type );
+static void remove_notify( ReconnectClient *pClient,
+                           VAR_HANDLE hVar,
+                           NotificationType type );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! reconnecting backend operations copied into each instance */
+static const LuaVarsBackend reconnectOps = {
+    .name = "reconnect",
+    .open = rc_open,
+    .close = rc_close,
+    .create = rc_create,
+    .find = rc_find,
+    .get = rc_get,
+    .set = rc_set,
+    .setStr = rc_setStr,
+    .getType = rc_getType,
+    .getLength = rc_getLength,
+    .getName = rc_getName,
+    .notify = rc_notify,
+    .notifyCancel = rc_notifyCancel,
+    .getValidationRequest = rc_getValidationRequest,
+    .sendValidationResponse = rc_sendValidationResponse,
+    .openPrintSession = rc_openPrintSession,
+    .closePrintSession = rc_closePrintSession,
+    .getFirst = rc_getFirst,
+    .getNext = rc_getNext,
+    .signalHandle = rc_signalHandle
+};
+
+/*! reconnecting backend instances, one for each wrapped backend */
+static Reconnect *instances = NULL;
+
+/*! protects the list of instances */
+static pthread_mutex_t instancesLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*! number of server restarts handled by all of the instances */
+static unsigned int restarts = 0;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  RECONNECT_Backend                                                         */
+/*!
+    Get the reconnecting backend which wraps a backend
+
+    The instance for a wrapped backend is created by the first call,
+    and later calls return the same instance, so its virtual handles
+    stay valid when the backend is selected again.
+
+    @param[in]
+        pInner
+            backend which performs the operations
+
+    @return pointer to the reconnecting backend, or NULL with errno
+            set to ENOMEM if it could not be created
+
+==============================================================================*/
+const LuaVarsBackend *RECONNECT_Backend( const LuaVarsBackend *pInner )
+{
+    Reconnect *pReconnect;
+
+    pthread_mutex_lock( &instancesLock );
+
+    pReconnect = instances;
+    while( ( pReconnect != NULL ) && ( pReconnect->inner != pInner ) )
+    {
+        pReconnect = pReconnect->pNext;
+    }
+
+    if( pReconnect == NULL )
+    {
+        pReconnect = calloc( 1, sizeof( Reconnect ) );
+        if( pReconnect != NULL )
+        {
+            pReconnect->backend = reconnectOps;
+            pReconnect->inner = pInner;
+            pthread_mutex_init( &pReconnect->lock, NULL );
+            pReconnect->pNext = instances;
+            __atomic_store_n( &instances, pReconnect, __ATOMIC_RELEASE );
+        }
+        else
+        {
+            errno = ENOMEM;
+        }
+    }
+
+    pthread_mutex_unlock( &instancesLock );
+
+    return ( pReconnect != NULL ) ? &pReconnect->backend : NULL;
+}
+
+/*============================================================================*/
+/*  RECONNECT_Reconnect                                                       */
+/*!
+    Reconnect to the variable server
+
+    Reopen a connection made through the reconnecting backend, resolve
+    every cached variable name again and register the connection's
+    notifications again, as if the server had restarted.
+
+    @param[in]
+        hVarServer
+            connection opened through the reconnecting backend
+
+    @param[out]
+        pResolved
+            receives the number of names which were resolved
+
+    @param[out]
+        pFailed
+            receives the number of names which were not found
+
+    @retval EOK the connection was reopened
+    @retval ENOTSUP the reconnecting backend is not in use
+    @retval ENOTCONN the variable server could not be opened
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int RECONNECT_Reconnect( VARSERVER_HANDLE hVarServer,
+                         size_t *pResolved,
+                         size_t *pFailed )
+{
+    int result = EINVAL;
+
+    if( RECONNECT_InUse() == false )
+    {
+        result = ENOTSUP;
+    }
+    else if( hVarServer != NULL )
+    {
+        result = reconnect( (ReconnectClient *)hVarServer,
+                            pResolved,
+                            pFailed );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  RECONNECT_Generation                                                      */
+/*!
+    Get the server generation
+
+    The generation is incremented each time a reconnecting backend
+    reconnects to a restarted variable server.  Anything cached about
+    the variables, other than their handles, is stale once the
+    generation changes.
+
+    @return the number of server restarts handled
+
+==============================================================================*/
+unsigned int RECONNECT_Generation( void )
+{
+    return __atomic_load_n( &restarts, __ATOMIC_ACQUIRE );
+}
+
+/*============================================================================*/
+/*  RECONNECT_InUse                                                           */
+/*!
+    Check whether the reconnecting backend is in the backend chain
+
+    @retval true the reconnecting backend is in use
+    @retval false the reconnecting backend is not in use
+
+==============================================================================*/
+bool RECONNECT_InUse( void )
+{
+    return ( __atomic_load_n( &instances, __ATOMIC_ACQUIRE ) != NULL );
+}
+
+/*============================================================================*/
+/*  RECONNECT_Check                                                           */
+/*!
+    Check a connection for a restart of the variable server
+
+    A connection which only waits for notifications makes no requests
+    which could fail, so it is probed with a type request on one of its
+    notification variables, and reconnected if the server connection
+    was lost or another connection has noticed a restart.  The names of
+    handles learned without one are looked up while the server is
+    running.
+
+    @param[in]
+        hVarServer
+            connection opened through the reconnecting backend
+
+    @retval EOK the connection is open
+    @retval ENOTSUP the reconnecting backend is not in use
+    @retval ENOTCONN the variable server could not be opened
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int RECONNECT_Check( VARSERVER_HANDLE hVarServer )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result = EINVAL;
+    VarType type;
+    int rc = EOK;
+
+    if( RECONNECT_InUse() == false )
+    {
+        result = ENOTSUP;
+    }
+    else if( pClient != NULL )
+    {
+        if( ( pClient->hInner != NULL ) && ( pClient->numNotify > 0 ) )
+        {
+            rc = pClient->inner->getType( pClient->hInner,
+                                          to_real( pClient,
+                                                   pClient->notify[0].hVar ),
+                                          &type );
+        }
+
+        (void)retry( pClient, rc );
+
+        result = ( pClient->hInner != NULL ) ? EOK : ENOTCONN;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_open                                                                   */
+/*!
+    Open a reconnecting connection
+
+    @param[in]
+        pBackend
+            the reconnecting backend instance
+
+    @return handle to the connection, or NULL
+
+==============================================================================*/
+static VARSERVER_HANDLE rc_open( const LuaVarsBackend *pBackend )
+{
+    Reconnect *pReconnect = (Reconnect *)pBackend;
+    ReconnectClient *pClient;
+
+    pClient = calloc( 1, sizeof( ReconnectClient ) );
+    if( pClient != NULL )
+    {
+        pClient->pReconnect = pReconnect;
+        pClient->inner = pReconnect->inner;
+        pClient->hInner = pClient->inner->open( pClient->inner );
+        if( pClient->hInner != NULL )
+        {
+            pClient->generation = __atomic_load_n( &pReconnect->generation,
+                                                   __ATOMIC_ACQUIRE );
+        }
+        else
+        {
+            free( pClient );
+            pClient = NULL;
+        }
+    }
+
+    return (VARSERVER_HANDLE)pClient;
+}
+
+/*============================================================================*/
+/*  rc_close                                                                  */
+/*!
+    Close a reconnecting connection
+
+    @param[in]
+        hVarServer
+            handle to the connection
+
+    @return result of closing the wrapped connection
+
+==============================================================================*/
+static int rc_close( VARSERVER_HANDLE hVarServer )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result = EINVAL;
+
+    if( pClient != NULL )
+    {
+        result = ( pClient->hInner != NULL )
+                    ? pClient->inner->close( pClient->hInner )
+                    : EOK;
+        free( pClient->notify );
+        free( pClient );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_create                                                                 */
+/*!
+    VARSERVER_CreateVar() with reconnection
+
+==============================================================================*/
+static int rc_create( VARSERVER_HANDLE hVarServer, VarInfo *pVarInfo )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result;
+
+    result = pClient->inner->create( pClient->hInner, pVarInfo );
+    if( retry( pClient, result ) == true )
+    {
+        result = pClient->inner->create( pClient->hInner, pVarInfo );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_find                                                                   */
+/*!
+    VAR_FindByName() returning a virtual handle
+
+    A failed lookup cannot be told apart from a lost connection, so
+    lookups are not retried.
+
+==============================================================================*/
+static VAR_HANDLE rc_find( VARSERVER_HANDLE hVarServer, char *name )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    VAR_HANDLE hVar = VAR_INVALID;
+    VAR_HANDLE hReal;
+
+    (void)retry( pClient, EOK );
+
+    hReal = pClient->inner->find( pClient->hInner, name );
+    if( hReal != VAR_INVALID )
+    {
+        hVar = to_virtual( pClient->pReconnect, hReal, name );
+    }
+
+    return hVar;
+}
+
+/*============================================================================*/
+/*  rc_get                                                                    */
+/*!
+    VAR_Get() with reconnection
+
+==============================================================================*/
+static int rc_get( VARSERVER_HANDLE hVarServer,
+                   VAR_HANDLE hVar,
+                   VarObject *obj )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result;
+
+    result = pClient->inner->get( pClient->hInner,
+                                  to_real( pClient, hVar ),
+                                  obj );
+    if( retry( pClient, result ) == true )
+    {
+        result = pClient->inner->get( pClient->hInner,
+                                      to_real( pClient, hVar ),
+                                      obj );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_set                                                                    */
+/*!
+    VAR_Set() with reconnection
+
+==============================================================================*/
+static int rc_set( VARSERVER_HANDLE hVarServer,
+                   VAR_HANDLE hVar,
+                   VarObject *obj )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result;
+
+    result = pClient->inner->set( pClient->hInner,
+                                  to_real( pClient, hVar ),
+                                  obj );
+    if( retry( pClient, result ) == true )
+    {
+        result = pClient->inner->set( pClient->hInner,
+                                      to_real( pClient, hVar ),
+                                      obj );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_setStr                                                                 */
+/*!
+    VAR_SetStr() with reconnection
+
+==============================================================================*/
+static int rc_setStr( VARSERVER_HANDLE hVarServer,
+                      VAR_HANDLE hVar,
+                      VarType type,
+                      char *str )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result;
+
+    result = pClient->inner->setStr( pClient->hInner,
+                                     to_real( pClient, hVar ),
+                                     type,
+                                     str );
+    if( retry( pClient, result ) == true )
+    {
+        result = pClient->inner->setStr( pClient->hInner,
+                                         to_real( pClient, hVar ),
+                                         type,
+                                         str );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_getType                                                                */
+/*!
+    VAR_GetType() with reconnection
+
+==============================================================================*/
+static int rc_getType( VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       VarType *pVarType )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result;
+
+    result = pClient->inner->getType( pClient->hInner,
+                                      to_real( pClient, hVar ),
+                                      pVarType );
+    if( retry( pClient, result ) == true )
+    {
+        result = pClient->inner->getType( pClient->hInner,
+                                          to_real( pClient, hVar ),
+                                          pVarType );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_getLength                                                              */
+/*!
+    VAR_GetLength() with reconnection
+
+==============================================================================*/
+static int rc_getLength( VARSERVER_HANDLE hVarServer,
+                         VAR_HANDLE hVar,
+                         size_t *len )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result;
+
+    result = pClient->inner->getLength( pClient->hInner,
+                                        to_real( pClient, hVar ),
+                                        len );
+    if( retry( pClient, result ) == true )
+    {
+        result = pClient->inner->getLength( pClient->hInner,
+                                            to_real( pClient, hVar ),
+                                            len );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_getName                                                                */
+/*!
+    VAR_GetName() with reconnection
+
+==============================================================================*/
+static int rc_getName( VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       char *buf,
+                       size_t len )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result;
+
+    result = pClient->inner->getName( pClient->hInner,
+                                      to_real( pClient, hVar ),
+                                      buf,
+                                      len );
+    if( retry( pClient, result ) == true )
+    {
+        result = pClient->inner->getName( pClient->hInner,
+                                          to_real( pClient, hVar ),
+                                          buf,
+                                          len );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_notify                                                                 */
+/*!
+    VAR_Notify() with reconnection
+
+    Successful registrations are remembered so they can be registered
+    again after a reconnection.
+
+==============================================================================*/
+static int rc_notify( VARSERVER_HANDLE hVarServer,
+                      VAR_HANDLE hVar,
+                      NotificationType notificationType )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result;
+
+    result = pClient->inner->notify( pClient->hInner,
+                                     to_real( pClient, hVar ),
+                                     notificationType );
+    if( retry( pClient, result ) == true )
+    {
+        result = pClient->inner->notify( pClient->hInner,
+                                         to_real( pClient, hVar ),
+                                         notificationType );
+    }
+
+    if( result == EOK )
+    {
+        add_notify( pClient, hVar, notificationType );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_notifyCancel                                                           */
+/*!
+    VAR_NotifyCancel() with reconnection
+
+==============================================================================*/
+static int rc_notifyCancel( VARSERVER_HANDLE hVarServer,
+                            VAR_HANDLE hVar,
+                            NotificationType notificationType )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result;
+
+    result = pClient->inner->notifyCancel( pClient->hInner,
+                                           to_real( pClient, hVar ),
+                                           notificationType );
+    if( retry( pClient, result ) == true )
+    {
+        result = pClient->inner->notifyCancel( pClient->hInner,
+                                               to_real( pClient, hVar ),
+                                               notificationType );
+    }
+
+    if( result == EOK )
+    {
+        remove_notify( pClient, hVar, notificationType );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_getValidationRequest                                                   */
+/*!
+    VAR_GetValidationRequest() returning a virtual handle
+
+    Requests belong to the server which sent them, so they are not
+    retried on a new connection.
+
+==============================================================================*/
+static int rc_getValidationRequest( VARSERVER_HANDLE hVarServer,
+                                    uint32_t id,
+                                    VAR_HANDLE *hVar,
+                                    VarObject *obj )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result;
+
+    result = pClient->inner->getValidationRequest( pClient->hInner,
+                                                   id,
+                                                   hVar,
+                                                   obj );
+    if( result == EOK )
+    {
+        *hVar = to_virtual( pClient->pReconnect, *hVar, NULL );
+        name_vars( pClient );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_sendValidationResponse                                                 */
+/*!
+    VAR_SendValidationResponse() on the current connection
+
+==============================================================================*/
+static int rc_sendValidationResponse( VARSERVER_HANDLE hVarServer,
+                                      uint32_t id,
+                                      int response )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+
+    return pClient->inner->sendValidationResponse( pClient->hInner,
+                                                   id,
+                                                   response );
+}
+
+/*============================================================================*/
+/*  rc_openPrintSession                                                       */
+/*!
+    VAR_OpenPrintSession() returning a virtual handle
+
+==============================================================================*/
+static int rc_openPrintSession( VARSERVER_HANDLE hVarServer,
+                                uint32_t id,
+                                VAR_HANDLE *hVar,
+                                int *fd )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result;
+
+    result = pClient->inner->openPrintSession( pClient->hInner, id, hVar, fd );
+    if( result == EOK )
+    {
+        *hVar = to_virtual( pClient->pReconnect, *hVar, NULL );
+        name_vars( pClient );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_closePrintSession                                                      */
+/*!
+    VAR_ClosePrintSession() on the current connection
+
+==============================================================================*/
+static int rc_closePrintSession( VARSERVER_HANDLE hVarServer,
+                                 uint32_t id,
+                                 int fd )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+
+    return pClient->inner->closePrintSession( pClient->hInner, id, fd );
+}
+
+/*============================================================================*/
+/*  rc_getFirst                                                               */
+/*!
+    VAR_GetFirst() returning virtual handles
+
+    The wrapped backend sees its own handles in the query, and only the
+    handle returned to the caller is mapped to a virtual handle.
+
+==============================================================================*/
+static int rc_getFirst( VARSERVER_HANDLE hVarServer,
+                        VarQuery *query,
+                        VarObject *obj )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    int result;
+
+    result = pClient->inner->getFirst( pClient->hInner, query, obj );
+    if( retry( pClient, result ) == true )
+    {
+        result = pClient->inner->getFirst( pClient->hInner, query, obj );
+    }
+
+    if( result == EOK )
+    {
+        query->hVar = to_virtual( pClient->pReconnect,
+                                  query->hVar,
+                                  query->name );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_getNext                                                                */
+/*!
+    VAR_GetNext() returning virtual handles
+
+    The query holds the virtual handle of the previous match, so it is
+    given back its server handle before the wrapped backend continues
+    the query.  A query cannot be continued on a new connection, so it
+    is not retried.
+
+==============================================================================*/
+static int rc_getNext( VARSERVER_HANDLE hVarServer,
+                       VarQuery *query,
+                       VarObject *obj )
+{
+    ReconnectClient *pClient = (ReconnectClient *)hVarServer;
+    VAR_HANDLE hVar = query->hVar;
+    int result;
+
+    query->hVar = to_real( pClient, hVar );
+
+    result = pClient->inner->getNext( pClient->hInner, query, obj );
+    if( result == EOK )
+    {
+        query->hVar = to_virtual( pClient->pReconnect,
+                                  query->hVar,
+                                  query->name );
+    }
+    else
+    {
+        query->hVar = hVar;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rc_signalHandle                                                           */
+/*!
+    Map a server handle received in a notification signal to its
+    virtual handle
+
+    @param[in]
+        pBackend
+            the reconnecting backend instance
+
+    @param[in]
+        hVar
+            handle received in the signal
+
+    @return the virtual handle, or VAR_INVALID
+
+==============================================================================*/
+static VAR_HANDLE rc_signalHandle( const LuaVarsBackend *pBackend,
+                                   VAR_HANDLE hVar )
+{
+    Reconnect *pReconnect = (Reconnect *)pBackend;
+
+    if( pReconnect->inner->signalHandle != NULL )
+    {
+        hVar = pReconnect->inner->signalHandle( pReconnect->inner, hVar );
+    }
+
+    return to_virtual( pReconnect, hVar, NULL );
+}
+
+/*============================================================================*/
+/*  retry                                                                     */
+/*!
+    Decide whether to retry an operation
+
+    The connection is reopened if the operation failed because the
+    server connection was lost, or if another connection has noticed
+    a server restart since this connection last registered its
+    notifications.  Otherwise the connection is used to look up the
+    names of handles learned without one.
+
+    @param[in]
+        pClient
+            pointer to the connection
+
+    @param[in]
+        rc
+            result of the operation
+
+    @retval true the connection was reopened and a failed operation
+            should be retried
+    @retval false the operation should not be retried
+
+==============================================================================*/
+static bool retry( ReconnectClient *pClient, int rc )
+{
+    bool result = false;
+
+    if( ( connection_lost( rc ) == true ) || ( pClient->hInner == NULL ) )
+    {
+        result = ( reconnect( pClient, NULL, NULL ) == EOK );
+    }
+    else if( pClient->generation !=
+             __atomic_load_n( &pClient->pReconnect->generation,
+                              __ATOMIC_ACQUIRE ) )
+    {
+        (void)reconnect( pClient, NULL, NULL );
+    }
+    else
+    {
+        name_vars( pClient );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  connection_lost                                                           */
+/*!
+    Check if an error indicates the server connection was lost
+
+    @param[in]
+        rc
+            result of an operation
+
+    @retval true the connection was lost
+    @retval false the result is not a connection failure
+
+==============================================================================*/
+static bool connection_lost( int rc )
+{
+    return ( rc == EPIPE ) ||
+           ( rc == ECONNRESET ) ||
+           ( rc == ECONNREFUSED ) ||
+           ( rc == ENOTCONN ) ||
+           ( rc == ESHUTDOWN ) ||
+           ( rc == EBADF );
+}
+
+/*============================================================================*/
+/*  reconnect                                                                 */
+/*!
+    Reopen a connection and restore its state
+
+    If the connection is the first to reconnect since the last server
+    restart, every cached name is resolved again.  The connection's
+    notifications are then registered against the new server handles.
+
+    @param[in]
+        pClient
+            pointer to the connection
+
+    @param[out]
+        pResolved
+            optionally receives the number of names resolved
+
+    @param[out]
+        pFailed
+            optionally receives the number of names not found
+
+    @retval EOK the connection was reopened
+    @retval ENOTCONN the variable server could not be opened
+
+==============================================================================*/
+static int reconnect( ReconnectClient *pClient,
+                      size_t *pResolved,
+                      size_t *pFailed )
+{
+    Reconnect *pReconnect = pClient->pReconnect;
+    int result = ENOTCONN;
+    size_t resolved = 0;
+    size_t failed = 0;
+    VAR_HANDLE hReal;
+    size_t i;
+
+    pthread_mutex_lock( &pReconnect->lock );
+
+    if( pClient->hInner != NULL )
+    {
+        (void)pClient->inner->close( pClient->hInner );
+    }
+
+    pClient->hInner = pClient->inner->open( pClient->inner );
+    if( pClient->hInner != NULL )
+    {
+        if( pClient->generation == pReconnect->generation )
+        {
+            /* first connection to notice the restart */
+            resolve_all( pClient, &resolved, &failed );
+            __atomic_store_n( &pReconnect->generation,
+                              pReconnect->generation + 1,
+                              __ATOMIC_RELEASE );
+            __atomic_add_fetch( &restarts, 1, __ATOMIC_RELEASE );
+        }
+
+        for( i = 0; i < pClient->numNotify; i++ )
+        {
+            hReal = pReconnect->vars[pClient->notify[i].hVar - 1].hReal;
+            if( hReal != VAR_INVALID )
+            {
+                (void)pClient->inner->notify( pClient->hInner,
+                                              hReal,
+                                              pClient->notify[i].type );
+            }
+        }
+
+        pClient->generation = pReconnect->generation;
+        result = EOK;
+    }
+
+    pthread_mutex_unlock( &pReconnect->lock );
+
+    if( pResolved != NULL )
+    {
+        *pResolved = resolved;
+    }
+
+    if( pFailed != NULL )
+    {
+        *pFailed = failed;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  resolve_all                                                               */
+/*!
+    Resolve every cached variable name again.  The lock must be held.
+
+    Variables which were not found by name, and handles whose name was
+    never learned, cannot be resolved.  They lose their server handle
+    and are counted as not found.
+
+    @param[in]
+        pClient
+            pointer to the reopened connection
+
+    @param[out]
+        pResolved
+            receives the number of names resolved
+
+    @param[out]
+        pFailed
+            receives the number of names not found
+
+==============================================================================*/
+static void resolve_all( ReconnectClient *pClient,
+                         size_t *pResolved,
+                         size_t *pFailed )
+{
+    Reconnect *pReconnect = pClient->pReconnect;
+    ReconnectVar *pVar;
+    size_t i;
+
+    if( pReconnect->realToVirtual != NULL )
+    {
+        memset( pReconnect->realToVirtual,
+                0,
+                pReconnect->numReal * sizeof( VAR_HANDLE ) );
+    }
+
+    for( i = 0; i < pReconnect->numVars; i++ )
+    {
+        pVar = &pReconnect->vars[i];
+        pVar->hReal = VAR_INVALID;
+
+        if( pVar->pending == true )
+        {
+            pVar->pending = false;
+            pReconnect->numPending--;
+        }
+
+        if( pVar->name == NULL )
+        {
+            (*pFailed)++;
+        }
+        else
+        {
+            pVar->hReal = pClient->inner->find( pClient->hInner, pVar->name );
+            if( pVar->hReal != VAR_INVALID )
+            {
+                map_real( pReconnect, pVar->hReal, (VAR_HANDLE)( i + 1 ) );
+                (*pResolved)++;
+            }
+            else
+            {
+                (*pFailed)++;
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/*  name_vars                                                                 */
+/*!
+    Look up the names of the handles which were learned without one
+
+    Names are needed to resolve the handles again after a server
+    restart, so they are looked up while the connection is still open.
+    Each name is looked up once.
+
+    @param[in]
+        pClient
+            pointer to the connection
+
+==============================================================================*/
+static void name_vars( ReconnectClient *pClient )
+{
+    Reconnect *pReconnect = pClient->pReconnect;
+    char name[MAX_NAME_LEN + 1];
+    ReconnectVar *pVar;
+    VAR_HANDLE hReal;
+    size_t n;
+    size_t i;
+
+    pthread_mutex_lock( &pReconnect->lock );
+    n = ( pReconnect->numPending > 0 ) ? pReconnect->numVars : 0;
+    pthread_mutex_unlock( &pReconnect->lock );
+
+    for( i = 0; ( i < n ) && ( pClient->hInner != NULL ); i++ )
+    {
+        /* the vars array may be moved while the lock is released */
+        pthread_mutex_lock( &pReconnect->lock );
+        pVar = &pReconnect->vars[i];
+        hReal = ( pVar->pending == true ) ? pVar->hReal : VAR_INVALID;
+        pthread_mutex_unlock( &pReconnect->lock );
+
+        if( hReal != VAR_INVALID )
+        {
+            if( pClient->inner->getName( pClient->hInner,
+                                         hReal,
+                                         name,
+                                         sizeof( name ) ) != EOK )
+            {
+                name[0] = '\0';
+            }
+
+            pthread_mutex_lock( &pReconnect->lock );
+
+            pVar = &pReconnect->vars[i];
+            if( ( pVar->pending == true ) && ( pVar->hReal == hReal ) )
+            {
+                if( ( name[0] != '\0' ) && ( pVar->name == NULL ) )
+                {
+                    pVar->name = strdup( name );
+                }
+
+                pVar->pending = false;
+                pReconnect->numPending--;
+            }
+
+            pthread_mutex_unlock( &pReconnect->lock );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  to_real                                                                   */
+/*!
+    Map a virtual handle to the current server handle
+
+    @param[in]
+        pClient
+            connection the handle is used on
+
+    @param[in]
+        hVar
+            virtual handle
+
+    @return the server handle, or VAR_INVALID
+
+==============================================================================*/
+static VAR_HANDLE to_real( ReconnectClient *pClient, VAR_HANDLE hVar )
+{
+    Reconnect *pReconnect = pClient->pReconnect;
+    VAR_HANDLE hReal = VAR_INVALID;
+
+    pthread_mutex_lock( &pReconnect->lock );
+
+    if( ( hVar != VAR_INVALID ) && ( (size_t)hVar <= pReconnect->numVars ) )
+    {
+        hReal = pReconnect->vars[hVar - 1].hReal;
+    }
+
+    pthread_mutex_unlock( &pReconnect->lock );
+
+    return hReal;
+}
+
+/*============================================================================*/
+/*  to_virtual                                                                */
+/*!
+    Map a server handle to its virtual handle
+
+    A virtual handle is assigned if the server handle is not yet known.
+
+    @param[in]
+        pReconnect
+            reconnecting backend instance
+
+    @param[in]
+        hReal
+            server handle
+
+    @param[in]
+        name
+            variable name if known, otherwise NULL
+
+    @return the virtual handle, or VAR_INVALID
+
+==============================================================================*/
+static VAR_HANDLE to_virtual( Reconnect *pReconnect,
+                              VAR_HANDLE hReal,
+                              const char *name )
+{
+    VAR_HANDLE hVar = VAR_INVALID;
+    ReconnectVar *pVar;
+
+    if( hReal != VAR_INVALID )
+    {
+        pthread_mutex_lock( &pReconnect->lock );
+
+        if( (size_t)hReal < pReconnect->numReal )
+        {
+            hVar = pReconnect->realToVirtual[hReal];
+        }
+
+        if( hVar == VAR_INVALID )
+        {
+            hVar = add_var( pReconnect, hReal, name );
+        }
+        else if( ( name != NULL ) &&
+                 ( pReconnect->vars[hVar - 1].name == NULL ) )
+        {
+            pVar = &pReconnect->vars[hVar - 1];
+            pVar->name = strdup( name );
+            if( pVar->pending == true )
+            {
+                pVar->pending = false;
+                pReconnect->numPending--;
+            }
+        }
+
+        pthread_mutex_unlock( &pReconnect->lock );
+    }
+
+    return hVar;
+}
+
+/*============================================================================*/
+/*  add_var                                                                   */
+/*!
+    Assign a virtual handle to a server handle.  The lock must be held.
+
+    @param[in]
+        pReconnect
+            reconnecting backend instance
+
+    @param[in]
+        hReal
+            server handle
+
+    @param[in]
+        name
+            variable name if known, otherwise NULL
+
+    @return the virtual handle, or VAR_INVALID if out of memory
+
+==============================================================================*/
+static VAR_HANDLE add_var( Reconnect *pReconnect,
+                           VAR_HANDLE hReal,
+                           const char *name )
+{
+    VAR_HANDLE hVar = VAR_INVALID;
+    ReconnectVar *p;
+    size_t n;
+
+    if( pReconnect->numVars == pReconnect->maxVars )
+    {
+        n = ( pReconnect->maxVars == 0 ) ? RECONNECT_INITIAL_SIZE
+                                         : pReconnect->maxVars * 2;
+        p = realloc( pReconnect->vars, n * sizeof( ReconnectVar ) );
+        if( p != NULL )
+        {
+            pReconnect->vars = p;
+            pReconnect->maxVars = n;
+        }
+    }
+
+    if( pReconnect->numVars < pReconnect->maxVars )
+    {
+        p = &pReconnect->vars[pReconnect->numVars];
+        p->name = ( name != NULL ) ? strdup( name ) : NULL;
+        p->hReal = hReal;
+        p->pending = ( name == NULL );
+        pReconnect->numPending += ( name == NULL ) ? 1 : 0;
+        hVar = (VAR_HANDLE)++pReconnect->numVars;
+        map_real( pReconnect, hReal, hVar );
+    }
+
+    return hVar;
+}
+
+/*============================================================================*/
+/*  map_real                                                                  */
+/*!
+    Record the virtual handle of a server handle.  The lock must be held.
+
+    @param[in]
+        pReconnect
+            reconnecting backend instance
+
+    @param[in]
+        hReal
+            server handle
+
+    @param[in]
+        hVar
+            virtual handle
+
+==============================================================================*/
+static void map_real( Reconnect *pReconnect,
+                      VAR_HANDLE hReal,
+                      VAR_HANDLE hVar )
+{
+    VAR_HANDLE *p;
+    size_t numReal = pReconnect->numReal;
+    size_t n;
+
+    if( (size_t)hReal >= numReal )
+    {
+        n = ( numReal == 0 ) ? RECONNECT_INITIAL_SIZE : numReal;
+        while( n <= (size_t)hReal )
+        {
+            n *= 2;
+        }
+
+        p = realloc( pReconnect->realToVirtual, n * sizeof( VAR_HANDLE ) );
+        if( p != NULL )
+        {
+            memset( &p[numReal], 0, ( n - numReal ) * sizeof( VAR_HANDLE ) );
+            pReconnect->realToVirtual = p;
+            pReconnect->numReal = n;
+        }
+    }
+
+    if( (size_t)hReal < pReconnect->numReal )
+    {
+        pReconnect->realToVirtual[hReal] = hVar;
+    }
+}
+
+/*============================================================================*/
+/*  add_notify                                                                */
+/*!
+    Remember a notification registered on a connection
+
+    @param[in]
+        pClient
+            pointer to the connection
+
+    @param[in]
+        hVar
+            virtual handle of the variable
+
+    @param[in]
+        type
+            notification type
+
+==============================================================================*/
+static void add_notify( ReconnectClient *pClient,
+                        VAR_HANDLE hVar,
+                        NotificationType type )
+{
+    ReconnectNotify *p;
+    bool found = false;
+    size_t n;
+    size_t i;
+
+    for( i = 0; ( i < pClient->numNotify ) && ( found == false ); i++ )
+    {
+        found = ( pClient->notify[i].hVar == hVar ) &&
+                ( pClient->notify[i].type == type );
+    }
+
+    if( ( found == false ) && ( pClient->numNotify == pClient->maxNotify ) )
+    {
+        n = ( pClient->maxNotify == 0 ) ? RECONNECT_INITIAL_SIZE
+                                        : pClient->maxNotify * 2;
+        p = realloc( pClient->notify, n * sizeof( ReconnectNotify ) );
+        if( p != NULL )
+        {
+            pClient->notify = p;
+            pClient->maxNotify = n;
+        }
+    }
+
+    if( ( found == false ) && ( pClient->numNotify < pClient->maxNotify ) )
+    {
+        pClient->notify[pClient->numNotify].hVar = hVar;
+        pClient->notify[pClient->numNotify].type = type;
+        pClient->numNotify++;
+    }
+}
+
+/*============================================================================*/
+/*  remove_notify                                                             */
+/*!
+    Forget a notification cancelled on a connection
+
+    @param[in]
+        pClient
+            pointer to the connection
+
+    @param[in]
+        hVar
+            virtual handle of the variable
+
+    @param[in]
+        type
+            notification type
+
+==============================================================================*/
+static void remove_notify( ReconnectClient *pClient,
+                           VAR_HANDLE hVar,
+                           NotificationType type )
+{
+    size_t i;
+
+    for( i = 0; i < pClient->numNotify; i++ )
+    {
+        if( ( pClient->notify[i].hVar == hVar ) &&
+            ( pClient->notify[i].type == type ) )
+        {
+            pClient->notify[i] = pClient->notify[--pClient->numNotify];
+            break;
+        }
+    }
+}
+
+/*! @}
+ * end of libluavars group */
@@ -0,0 +1,907 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file record.c
+
+    Recording variable server backend
+
+    The recording backend forwards every operation to another backend
+    and writes one line per operation to a log file:
+
+    <ns> <operation> <arguments> = <result>
+
+    where <ns> is the monotonic time at which the operation completed.
+    The log shows exactly which variable server calls a script makes,
+    in order, with their arguments, values and results.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <varserver/varserver.h>
+#include "backend.h"
+#include "record.h"
+#include "stats.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! maximum length of a formatted value in the log */
+#define RECORD_MAX_VALUE_LEN    ( 256 )
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static VARSERVER_HANDLE rec_open( const LuaVarsBackend *pBackend );
+static int rec_close( VARSERVER_HANDLE hVarServer );
+static int rec_create( VARSERVER_HANDLE hVarServer, VarInfo *pVarInfo );
+static VAR_HANDLE rec_find( VARSERVER_HANDLE hVarServer, char *name );
+static int rec_get( VARSERVER_HANDLE hVarServer,
+                    VAR_HANDLE hVar,
+                    VarObject *obj );
+static int rec_set( VARSERVER_HANDLE hVarServer,
+                    VAR_HANDLE hVar,
+                    VarObject *obj );
+static int rec_setStr( VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       VarType type,
+                       char *str );
+static int rec_getType( VARSERVER_HANDLE hVarServer,
+                        VAR_HANDLE hVar,
+                        VarType *pVarType );
+static int rec_getLength( VARSERVER_HANDLE hVarServer,
+                          VAR_HANDLE hVar,
+                          size_t *len );
+static int rec_getName( VARSERVER_HANDLE hVarServer,
+                        VAR_HANDLE hVar,
+                        char *buf,
+                        size_t len );
+static int rec_notify( VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       NotificationType notificationType );
+static int rec_notifyCancel( VARSERVER_HANDLE hVarServer,
+                             VAR_HANDLE hVar,
+                             NotificationType notificationType );
+static int rec_getValidationRequest( VARSERVER_HANDLE hVarServer,
+                                     uint32_t id,
+                                     VAR_HANDLE *hVar,
+                                     VarObject *obj );
+static int rec_sendValidationResponse( VARSERVER_HANDLE hVarServer,
+                                       uint32_t id,
+                                       int response );
+static int rec_openPrintSession( VARSERVER_HANDLE hVarServer,
+                                 uint32_t id,
+                                 VAR_HANDLE *hVar,
+                                 int *fd );
+static int rec_closePrintSession( VARSERVER_HANDLE hVarServer,
+                                  uint32_t id,
+                                  int fd );
+static int rec_getFirst( VARSERVER_HANDLE hVarServer,
+                         VarQuery *query,
+                         VarObject *obj );
+static int rec_getNext( VARSERVER_HANDLE hVarServer,
+                        VarQuery *query,
+                        VarObject *obj );
+static VAR_HANDLE rec_signalHandle( const LuaVarsBackend *pBackend,
+                                    VAR_HANDLE hVar );
+static const char *format_value( const VarObject *obj, char *buf, size_t len );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! recording backend */
+static const LuaVarsBackend recordBackend = {
+    .name = "record",
+    .open = rec_open,
+    .close = rec_close,
+    .create = rec_create,
+    .find = rec_find,
+    .get = rec_get,
+    .set = rec_set,
+    .setStr = rec_setStr,
+    .getType = rec_getType,
+    .getLength = rec_getLength,
+    .getName = rec_getName,
+    .notify = rec_notify,
+    .notifyCancel = rec_notifyCancel,
+    .getValidationRequest = rec_getValidationRequest,
+    .sendValidationResponse = rec_sendValidationResponse,
+    .openPrintSession = rec_openPrintSession,
+    .closePrintSession = rec_closePrintSession,
+    .getFirst = rec_getFirst,
+    .getNext = rec_getNext,
+    .signalHandle = rec_signalHandle
+};
+
+/*! backend which performs the recorded operations */
+static const LuaVarsBackend *inner = NULL;
+
+/*! recording log */
+static FILE *fp = NULL;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  RECORD_Backend                                                            */
+/*!
+    Get the recording backend
+
+    @param[in]
+        pInner
+            pointer to the backend which performs the operations
+
+    @param[in]
+        path
+            path of the log file to append to, or NULL to log to stderr
+
+    @return pointer to the recording backend, or NULL with errno set
+            if the log file could not be opened
+
+==============================================================================*/
+const LuaVarsBackend *RECORD_Backend( const LuaVarsBackend *pInner,
+                                      const char *path )
+{
+    const LuaVarsBackend *pBackend = NULL;
+
+    if( pInner == NULL )
+    {
+        errno = EINVAL;
+    }
+    else
+    {
+        if( fp == NULL )
+        {
+            fp = ( path != NULL ) ? fopen( path, "a" ) : stderr;
+            if( fp != NULL )
+            {
+                setvbuf( fp, NULL, _IOLBF, 0 );
+            }
+        }
+
+        if( fp != NULL )
+        {
+            inner = pInner;
+            pBackend = &recordBackend;
+        }
+    }
+
+    return pBackend;
+}
+
+/*============================================================================*/
+/*  rec_open                                                                  */
+/*!
+    Record VARSERVER_Open()
+
+    @param[in]
+        pBackend
+            unused, the recording backend has a single instance
+
+    @return handle to the variable server, or NULL
+
+==============================================================================*/
+static VARSERVER_HANDLE rec_open( const LuaVarsBackend *pBackend )
+{
+    VARSERVER_HANDLE hVarServer = inner->open( inner );
+
+    (void)pBackend;
+
+    fprintf( fp, "%" PRIu64 " open %s = %p\n",
+             STATS_Now(),
+             inner->name,
+             hVarServer );
+
+    return hVarServer;
+}
+
+/*============================================================================*/
+/*  rec_close                                                                 */
+/*!
+    Record VARSERVER_Close()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_close( VARSERVER_HANDLE hVarServer )
+{
+    int result = inner->close( hVarServer );
+
+    fprintf( fp, "%" PRIu64 " close = %d\n", STATS_Now(), result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_create                                                                */
+/*!
+    Record VARSERVER_CreateVar()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        pVarInfo
+            pointer to the variable definition
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_create( VARSERVER_HANDLE hVarServer, VarInfo *pVarInfo )
+{
+    int result = inner->create( hVarServer, pVarInfo );
+
+    fprintf( fp, "%" PRIu64 " create %s type=%d = %d\n",
+             STATS_Now(),
+             ( pVarInfo != NULL ) ? pVarInfo->name : "",
+             ( pVarInfo != NULL ) ? (int)pVarInfo->var.type : 0,
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_find                                                                  */
+/*!
+    Record VAR_FindByName()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        name
+            name of the variable to find
+
+    @return handle of the variable, or VAR_INVALID
+
+==============================================================================*/
+static VAR_HANDLE rec_find( VARSERVER_HANDLE hVarServer, char *name )
+{
+    VAR_HANDLE hVar = inner->find( hVarServer, name );
+
+    fprintf( fp, "%" PRIu64 " find %s = %u\n",
+             STATS_Now(),
+             ( name != NULL ) ? name : "",
+             (unsigned int)hVar );
+
+    return hVar;
+}
+
+/*============================================================================*/
+/*  rec_get                                                                   */
+/*!
+    Record VAR_Get()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in,out]
+        obj
+            pointer to the object to receive the value
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_get( VARSERVER_HANDLE hVarServer,
+                    VAR_HANDLE hVar,
+                    VarObject *obj )
+{
+    int result = inner->get( hVarServer, hVar, obj );
+    char buf[RECORD_MAX_VALUE_LEN];
+
+    fprintf( fp, "%" PRIu64 " get %u value=%s = %d\n",
+             STATS_Now(),
+             (unsigned int)hVar,
+             ( result == EOK ) ? format_value( obj, buf, sizeof( buf ) ) : "",
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_set                                                                   */
+/*!
+    Record VAR_Set()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        obj
+            pointer to the value to set
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_set( VARSERVER_HANDLE hVarServer,
+                    VAR_HANDLE hVar,
+                    VarObject *obj )
+{
+    int result = inner->set( hVarServer, hVar, obj );
+    char buf[RECORD_MAX_VALUE_LEN];
+
+    fprintf( fp, "%" PRIu64 " set %u value=%s = %d\n",
+             STATS_Now(),
+             (unsigned int)hVar,
+             format_value( obj, buf, sizeof( buf ) ),
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_setStr                                                                */
+/*!
+    Record VAR_SetStr()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        type
+            type of the variable
+
+    @param[in]
+        str
+            string representation of the value to set
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_setStr( VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       VarType type,
+                       char *str )
+{
+    int result = inner->setStr( hVarServer, hVar, type, str );
+
+    fprintf( fp, "%" PRIu64 " setstr %u type=%d value=%s = %d\n",
+             STATS_Now(),
+             (unsigned int)hVar,
+             (int)type,
+             ( str != NULL ) ? str : "",
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_getType                                                               */
+/*!
+    Record VAR_GetType()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[out]
+        pVarType
+            pointer to the location to store the variable type
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_getType( VARSERVER_HANDLE hVarServer,
+                        VAR_HANDLE hVar,
+                        VarType *pVarType )
+{
+    int result = inner->getType( hVarServer, hVar, pVarType );
+
+    fprintf( fp, "%" PRIu64 " gettype %u type=%d = %d\n",
+             STATS_Now(),
+             (unsigned int)hVar,
+             ( ( result == EOK ) && ( pVarType != NULL ) )
+                ? (int)*pVarType
+                : 0,
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_getLength                                                             */
+/*!
+    Record VAR_GetLength()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[out]
+        len
+            pointer to the location to store the length of the value
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_getLength( VARSERVER_HANDLE hVarServer,
+                          VAR_HANDLE hVar,
+                          size_t *len )
+{
+    int result = inner->getLength( hVarServer, hVar, len );
+
+    fprintf( fp, "%" PRIu64 " getlength %u len=%zu = %d\n",
+             STATS_Now(),
+             (unsigned int)hVar,
+             ( ( result == EOK ) && ( len != NULL ) ) ? *len : 0,
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_getName                                                               */
+/*!
+    Record VAR_GetName()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[out]
+        buf
+            buffer to receive the variable name
+
+    @param[in]
+        len
+            size of the buffer
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_getName( VARSERVER_HANDLE hVarServer,
+                        VAR_HANDLE hVar,
+                        char *buf,
+                        size_t len )
+{
+    int result = inner->getName( hVarServer, hVar, buf, len );
+
+    fprintf( fp, "%" PRIu64 " getname %u %s = %d\n",
+             STATS_Now(),
+             (unsigned int)hVar,
+             ( result == EOK ) ? buf : "",
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_notify                                                                */
+/*!
+    Record VAR_Notify()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        notificationType
+            type of notification requested
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_notify( VARSERVER_HANDLE hVarServer,
+                       VAR_HANDLE hVar,
+                       NotificationType notificationType )
+{
+    int result = inner->notify( hVarServer, hVar, notificationType );
+
+    fprintf( fp, "%" PRIu64 " notify %u type=%d = %d\n",
+             STATS_Now(),
+             (unsigned int)hVar,
+             (int)notificationType,
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_notifyCancel                                                          */
+/*!
+    Record VAR_NotifyCancel()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        hVar
+            handle of the variable
+
+    @param[in]
+        notificationType
+            type of notification to cancel
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_notifyCancel( VARSERVER_HANDLE hVarServer,
+                             VAR_HANDLE hVar,
+                             NotificationType notificationType )
+{
+    int result = inner->notifyCancel( hVarServer, hVar, notificationType );
+
+    fprintf( fp, "%" PRIu64 " unnotify %u type=%d = %d\n",
+             STATS_Now(),
+             (unsigned int)hVar,
+             (int)notificationType,
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_getValidationRequest                                                  */
+/*!
+    Record VAR_GetValidationRequest()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        id
+            validation request identifier
+
+    @param[out]
+        hVar
+            pointer to the location to store the variable handle
+
+    @param[in,out]
+        obj
+            pointer to the object to receive the value to validate
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_getValidationRequest( VARSERVER_HANDLE hVarServer,
+                                     uint32_t id,
+                                     VAR_HANDLE *hVar,
+                                     VarObject *obj )
+{
+    int result = inner->getValidationRequest( hVarServer, id, hVar, obj );
+    char buf[RECORD_MAX_VALUE_LEN];
+
+    fprintf( fp, "%" PRIu64 " validate_request %u handle=%u value=%s = %d\n",
+             STATS_Now(),
+             (unsigned int)id,
+             ( result == EOK ) ? (unsigned int)*hVar : 0,
+             ( result == EOK ) ? format_value( obj, buf, sizeof( buf ) ) : "",
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_sendValidationResponse                                                */
+/*!
+    Record VAR_SendValidationResponse()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        id
+            validation request identifier
+
+    @param[in]
+        response
+            validation response
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_sendValidationResponse( VARSERVER_HANDLE hVarServer,
+                                       uint32_t id,
+                                       int response )
+{
+    int result = inner->sendValidationResponse( hVarServer, id, response );
+
+    fprintf( fp, "%" PRIu64 " validate_response %u response=%d = %d\n",
+             STATS_Now(),
+             (unsigned int)id,
+             response,
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_openPrintSession                                                      */
+/*!
+    Record VAR_OpenPrintSession()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        id
+            print session identifier
+
+    @param[out]
+        hVar
+            pointer to the location to store the variable handle
+
+    @param[out]
+        fd
+            pointer to the location to store the output file descriptor
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_openPrintSession( VARSERVER_HANDLE hVarServer,
+                                 uint32_t id,
+                                 VAR_HANDLE *hVar,
+                                 int *fd )
+{
+    int result = inner->openPrintSession( hVarServer, id, hVar, fd );
+
+    fprintf( fp, "%" PRIu64 " print_open %u handle=%u fd=%d = %d\n",
+             STATS_Now(),
+             (unsigned int)id,
+             ( result == EOK ) ? (unsigned int)*hVar : 0,
+             ( result == EOK ) ? *fd : -1,
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_closePrintSession                                                     */
+/*!
+    Record VAR_ClosePrintSession()
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        id
+            print session identifier
+
+    @param[in]
+        fd
+            output file descriptor of the print session
+
+    @return result of the operation
+
+==============================================================================*/
+static int rec_closePrintSession( VARSERVER_HANDLE hVarServer,
+                                  uint32_t id,
+                                  int fd )
+{
+    int result = inner->closePrintSession( hVarServer, id, fd );
+
+    fprintf( fp, "%" PRIu64 " print_close %u fd=%d = %d\n",
+             STATS_Now(),
+             (unsigned int)id,
+             fd,
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_getFirst                                                              */
+/*!
+    Record a VAR_GetFirst() call
+
+==============================================================================*/
+static int rec_getFirst( VARSERVER_HANDLE hVarServer,
+                         VarQuery *query,
+                         VarObject *obj )
+{
+    int result = inner->getFirst( hVarServer, query, obj );
+
+    fprintf( fp, "%" PRIu64 " query_first %s h=%u = %d\n",
+             STATS_Now(),
+             ( query->match != NULL ) ? query->match : "*",
+             ( result == EOK ) ? (unsigned int)query->hVar : 0,
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_getNext                                                               */
+/*!
+    Record a VAR_GetNext() call
+
+==============================================================================*/
+static int rec_getNext( VARSERVER_HANDLE hVarServer,
+                        VarQuery *query,
+                        VarObject *obj )
+{
+    int result = inner->getNext( hVarServer, query, obj );
+
+    fprintf( fp, "%" PRIu64 " query_next %s h=%u = %d\n",
+             STATS_Now(),
+             ( query->match != NULL ) ? query->match : "*",
+             ( result == EOK ) ? (unsigned int)query->hVar : 0,
+             result );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  rec_signalHandle                                                          */
+/*!
+    Forward a notification signal handle to the wrapped backend
+
+    The mapping is not recorded: the received signals are already
+    logged by the event log.
+
+    @param[in]
+        pBackend
+            unused, the recording backend has a single instance
+
+    @param[in]
+        hVar
+            handle received in a notification signal
+
+    @return the handle used with the wrapped backend
+
+==============================================================================*/
+static VAR_HANDLE rec_signalHandle( const LuaVarsBackend *pBackend,
+                                    VAR_HANDLE hVar )
+{
+    (void)pBackend;
+
+    return ( inner->signalHandle != NULL )
+               ? inner->signalHandle( inner, hVar )
+               : hVar;
+}
+
+/*============================================================================*/
+/*  format_value                                                              */
+/*!
+    Format a variable value for the log
+
+    @param[in]
+        obj
+            pointer to the value to format
+
+    @param[in]
+        buf
+            buffer to format the value into
+
+    @param[in]
+        len
+            size of the buffer
+
+    @return pointer to the formatted value
+
+==============================================================================*/
+static const char *format_value( const VarObject *obj, char *buf, size_t len )
+{
+    buf[0] = '\0';
+
+    if( obj != NULL )
+    {
+        switch( obj->type )
+        {
+            case VARTYPE_STR:
+                snprintf( buf,
+                          len,
+                          "\"%s\"",
+                          ( obj->val.str != NULL ) ? obj->val.str : "" );
+                break;
+
+            case VARTYPE_UINT16:
+                snprintf( buf, len, "%u", (unsigned int)obj->val.ui );
+                break;
+
+            case VARTYPE_INT16:
+                snprintf( buf, len, "%d", (int)obj->val.i );
+                break;
+
+            case VARTYPE_UINT32:
+                snprintf( buf, len, "%u", (unsigned int)obj->val.ul );
+                break;
+
+            case VARTYPE_INT32:
+                snprintf( buf, len, "%d", (int)obj->val.l );
+                break;
+
+            case VARTYPE_UINT64:
+                snprintf( buf, len, "%llu", (unsigned long long)obj->val.ull );
+                break;
+
+            case VARTYPE_INT64:
+                snprintf( buf, len, "%lld", (long long)obj->val.ll );
+                break;
+
+            case VARTYPE_FLOAT:
+                snprintf( buf, len, "%f", (double)obj->val.f );
+                break;
+
+            default:
+                snprintf( buf, len, "<type %d>", (int)obj->type );
+                break;
+        }
+    }
+
+    return buf;
+}
+
+/*! @}
+ * end of libluavars group */
@@ -0,0 +1,1053 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file snapshot.c
+
+    Binary variable snapshots
+
+    A snapshot file holds the names, types and values of a set of
+    variables so that they can be restored later, or compared with
+    another snapshot, without converting the values to and from text.
+
+    The file is a SnapshotHeader, followed by an array of
+    SnapshotEntry sorted by variable name, followed by a table of NUL
+    terminated strings holding the variable names and string values.
+    Values are in the byte order of the host which wrote the file, so
+    the file is mapped and used in place.  The whole file is checked
+    when it is opened, so the entries can then be used without further
+    bounds checks.
+
+    Snapshots are written to a temporary file which is renamed over
+    the destination, so a reader never sees a partial snapshot.
+
+    Since the entries are sorted by name, two snapshots are compared
+    by merging their entries in one pass.  Live values are compared
+    with a snapshot file by building a snapshot of them in memory.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <varserver/varserver.h>
+#include "fetch.h"
+#include "snapshot.h"
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! snapshot mapped from a file or built in memory */
+struct _Snapshot
+{
+    /*! mapped file */
+    void *p;
+
+    /*! size of the mapped file */
+    size_t size;
+
+    /*! file header */
+    const SnapshotHeader *pHeader;
+
+    /*! entries sorted by name */
+    const SnapshotEntry *entries;
+
+    /*! string table */
+    const char *strings;
+
+    /*! set if the contents were allocated rather than mapped */
+    bool allocated;
+};
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static int snapshot_build( FetchEntry *entries,
+                           size_t n,
+                           uint8_t **pp,
+                           size_t *pSize );
+static void snapshot_map( Snapshot *pSnapshot );
+static bool same_value( const VarObject *a, const VarObject *b );
+static int compare_names( const void *a, const void *b );
+static int write_file( const char *path, const void *p, size_t size );
+static int check_snapshot( const Snapshot *pSnapshot );
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  SNAPSHOT_Write                                                            */
+/*!
+    Write a snapshot file
+
+    The entries with a name and a result of EOK are written.  Entries
+    with a type which cannot be stored in a snapshot have their result
+    set to ENOTSUP.  If a name appears more than once, only its first
+    entry is written.
+
+    @param[in]
+        path
+            path of the snapshot file
+
+    @param[in,out]
+        entries
+            variables fetched with FETCH_Get()
+
+    @param[in]
+        n
+            number of entries
+
+    @retval EOK the snapshot was written
+    @retval EINVAL invalid arguments
+    @retval EFBIG the snapshot is too large for the file format
+    @retval ENOMEM out of memory
+    @retval other error from the file system
+
+==============================================================================*/
+int SNAPSHOT_Write( const char *path, FetchEntry *entries, size_t n )
+{
+    int result = EINVAL;
+    uint8_t *p = NULL;
+    size_t size;
+
+    if( path != NULL )
+    {
+        result = snapshot_build( entries, n, &p, &size );
+    }
+
+    if( result == EOK )
+    {
+        result = write_file( path, p, size );
+    }
+
+    free( p );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SNAPSHOT_Create                                                           */
+/*!
+    Create a snapshot in memory
+
+    The snapshot is built from the entries as by SNAPSHOT_Write(), so
+    that live values can be compared with a snapshot file.
+
+    @param[in,out]
+        entries
+            variables fetched with FETCH_Get()
+
+    @param[in]
+        n
+            number of entries
+
+    @param[out]
+        ppSnapshot
+            the snapshot is returned here, to be released with
+            SNAPSHOT_Close()
+
+    @retval EOK the snapshot was created
+    @retval EINVAL invalid arguments
+    @retval EFBIG the snapshot is too large for the file format
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+int SNAPSHOT_Create( FetchEntry *entries, size_t n, Snapshot **ppSnapshot )
+{
+    int result = EINVAL;
+    Snapshot *pSnapshot = NULL;
+    uint8_t *p = NULL;
+    size_t size;
+
+    if( ppSnapshot != NULL )
+    {
+        result = snapshot_build( entries, n, &p, &size );
+    }
+
+    if( result == EOK )
+    {
+        pSnapshot = calloc( 1, sizeof( Snapshot ) );
+        result = ( pSnapshot != NULL ) ? EOK : ENOMEM;
+    }
+
+    if( result == EOK )
+    {
+        pSnapshot->p = p;
+        pSnapshot->size = size;
+        pSnapshot->allocated = true;
+        snapshot_map( pSnapshot );
+        *ppSnapshot = pSnapshot;
+    }
+    else
+    {
+        free( p );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SNAPSHOT_Open                                                             */
+/*!
+    Map a snapshot file into memory
+
+    @param[in]
+        path
+            path of the snapshot file
+
+    @param[out]
+        ppSnapshot
+            the snapshot is returned here, to be released with
+            SNAPSHOT_Close()
+
+    @retval EOK the snapshot was opened
+    @retval EINVAL invalid arguments
+    @retval EILSEQ the file is not a valid snapshot
+    @retval ENOMEM out of memory
+    @retval other error from the file system
+
+==============================================================================*/
+int SNAPSHOT_Open( const char *path, Snapshot **ppSnapshot )
+{
+    int result = EINVAL;
+    Snapshot *pSnapshot = NULL;
+    struct stat sb;
+    int fd = -1;
+
+    if( ( path != NULL ) && ( ppSnapshot != NULL ) )
+    {
+        result = ENOMEM;
+        pSnapshot = calloc( 1, sizeof( Snapshot ) );
+    }
+
+    if( pSnapshot != NULL )
+    {
+        fd = open( path, O_RDONLY );
+        result = ( fd >= 0 ) ? EOK : errno;
+    }
+
+    if( result == EOK )
+    {
+        result = ( fstat( fd, &sb ) == 0 ) ? EOK : errno;
+    }
+
+    if( result == EOK )
+    {
+        if( (size_t)sb.st_size < sizeof( SnapshotHeader ) )
+        {
+            result = EILSEQ;
+        }
+        else
+        {
+            pSnapshot->size = (size_t)sb.st_size;
+            pSnapshot->p = mmap( NULL,
+                                 pSnapshot->size,
+                                 PROT_READ,
+                                 MAP_PRIVATE,
+                                 fd,
+                                 0 );
+            if( pSnapshot->p == MAP_FAILED )
+            {
+                pSnapshot->p = NULL;
+                result = errno;
+            }
+        }
+    }
+
+    if( fd >= 0 )
+    {
+        close( fd );
+    }
+
+    if( result == EOK )
+    {
+        snapshot_map( pSnapshot );
+        result = check_snapshot( pSnapshot );
+    }
+
+    if( result == EOK )
+    {
+        *ppSnapshot = pSnapshot;
+    }
+    else
+    {
+        SNAPSHOT_Close( pSnapshot );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SNAPSHOT_Count                                                            */
+/*!
+    Get the number of variables in a snapshot
+
+    @param[in]
+        pSnapshot
+            pointer to the snapshot
+
+    @return the number of variables
+
+==============================================================================*/
+size_t SNAPSHOT_Count( const Snapshot *pSnapshot )
+{
+    return ( pSnapshot != NULL ) ? pSnapshot->pHeader->count : 0;
+}
+
+/*============================================================================*/
+/*  SNAPSHOT_Name                                                             */
+/*!
+    Get the name of a variable in a snapshot
+
+    The variables are in name order.
+
+    @param[in]
+        pSnapshot
+            pointer to the snapshot
+
+    @param[in]
+        i
+            index of the variable
+
+    @return the name of the variable, or NULL if the index is invalid
+
+==============================================================================*/
+const char *SNAPSHOT_Name( const Snapshot *pSnapshot, size_t i )
+{
+    const char *name = NULL;
+
+    if( i < SNAPSHOT_Count( pSnapshot ) )
+    {
+        name = &pSnapshot->strings[pSnapshot->entries[i].name];
+    }
+
+    return name;
+}
+
+/*============================================================================*/
+/*  SNAPSHOT_Value                                                            */
+/*!
+    Get the value of a variable in a snapshot
+
+    String values point into the snapshot and remain valid until it
+    is closed.
+
+    @param[in]
+        pSnapshot
+            pointer to the snapshot
+
+    @param[in]
+        i
+            index of the variable
+
+    @param[out]
+        obj
+            the value of the variable is returned here
+
+    @retval EOK the value was returned
+    @retval EINVAL invalid arguments
+
+==============================================================================*/
+int SNAPSHOT_Value( const Snapshot *pSnapshot, size_t i, VarObject *obj )
+{
+    int result = EINVAL;
+    const SnapshotEntry *pEntry;
+
+    if( ( obj != NULL ) && ( i < SNAPSHOT_Count( pSnapshot ) ) )
+    {
+        pEntry = &pSnapshot->entries[i];
+
+        if( pEntry->type == VARTYPE_STR )
+        {
+            memset( obj, 0, sizeof( VarObject ) );
+            obj->type = VARTYPE_STR;
+            obj->val.str = (char *)&pSnapshot->strings[pEntry->val];
+            obj->len = strlen( obj->val.str ) + 1;
+            result = EOK;
+        }
+        else
+        {
+            result = SNAPSHOT_Unpack( (VarType)pEntry->type,
+                                      pEntry->val,
+                                      obj );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SNAPSHOT_Diff                                                             */
+/*!
+    Compare two snapshots
+
+    The entries of the snapshots are merged in name order, and the
+    callback is called in name order for each variable which is only
+    in one snapshot, or has a different type or value in each.
+
+    @param[in]
+        pA
+            pointer to the earlier snapshot
+
+    @param[in]
+        pB
+            pointer to the later snapshot
+
+    @param[in]
+        fn
+            function called for each difference
+
+    @param[in]
+        arg
+            argument passed to the callback
+
+    @return the number of differences
+
+==============================================================================*/
+size_t SNAPSHOT_Diff( const Snapshot *pA,
+                      const Snapshot *pB,
+                      SnapshotDiffFn fn,
+                      void *arg )
+{
+    size_t nA = SNAPSHOT_Count( pA );
+    size_t nB = SNAPSHOT_Count( pB );
+    size_t count = 0;
+    size_t i = 0;
+    size_t j = 0;
+    VarObject a;
+    VarObject b;
+    int cmp;
+
+    while( ( i < nA ) || ( j < nB ) )
+    {
+        if( i == nA )
+        {
+            cmp = 1;
+        }
+        else if( j == nB )
+        {
+            cmp = -1;
+        }
+        else
+        {
+            cmp = strcmp( SNAPSHOT_Name( pA, i ), SNAPSHOT_Name( pB, j ) );
+        }
+
+        if( cmp < 0 )
+        {
+            (void)SNAPSHOT_Value( pA, i, &a );
+            fn( arg, SNAPSHOT_Name( pA, i++ ), &a, NULL );
+            count++;
+        }
+        else if( cmp > 0 )
+        {
+            (void)SNAPSHOT_Value( pB, j, &b );
+            fn( arg, SNAPSHOT_Name( pB, j++ ), NULL, &b );
+            count++;
+        }
+        else
+        {
+            (void)SNAPSHOT_Value( pA, i, &a );
+            (void)SNAPSHOT_Value( pB, j, &b );
+            if( same_value( &a, &b ) == false )
+            {
+                fn( arg, SNAPSHOT_Name( pA, i ), &a, &b );
+                count++;
+            }
+
+            i++;
+            j++;
+        }
+    }
+
+    return count;
+}
+
+/*============================================================================*/
+/*  SNAPSHOT_Pack                                                             */
+/*!
+    Convert a value to the 64 bit representation stored in a snapshot
+
+    Signed values are sign extended, and floats are stored as their
+    bits, so two values are equal if their representations are equal.
+
+    @param[in]
+        obj
+            the value to convert
+
+    @param[out]
+        val
+            the stored representation, 0 for strings
+
+    @retval true the type can be stored in a snapshot
+    @retval false the type cannot be stored in a snapshot
+
+==============================================================================*/
+bool SNAPSHOT_Pack( const VarObject *obj, uint64_t *val )
+{
+    bool result = true;
+    uint32_t bits;
+
+    switch( obj->type )
+    {
+        case VARTYPE_STR:
+            *val = 0;
+            result = ( obj->val.str != NULL );
+            break;
+
+        case VARTYPE_UINT16:
+            *val = obj->val.ui;
+            break;
+
+        case VARTYPE_INT16:
+            *val = (uint64_t)(int64_t)obj->val.i;
+            break;
+
+        case VARTYPE_UINT32:
+            *val = obj->val.ul;
+            break;
+
+        case VARTYPE_INT32:
+            *val = (uint64_t)(int64_t)obj->val.l;
+            break;
+
+        case VARTYPE_UINT64:
+            *val = obj->val.ull;
+            break;
+
+        case VARTYPE_INT64:
+            *val = (uint64_t)obj->val.ll;
+            break;
+
+        case VARTYPE_FLOAT:
+            memcpy( &bits, &obj->val.f, sizeof( float ) );
+            *val = bits;
+            break;
+
+        default:
+            result = false;
+            break;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SNAPSHOT_Unpack                                                           */
+/*!
+    Convert a scalar value from the 64 bit representation stored in a
+    snapshot
+
+    @param[in]
+        type
+            type of the value
+
+    @param[in]
+        val
+            stored representation from SNAPSHOT_Pack()
+
+    @param[out]
+        obj
+            the value is returned here
+
+    @retval EOK the value was converted
+    @retval EINVAL the type is not a scalar type stored in a snapshot
+
+==============================================================================*/
+int SNAPSHOT_Unpack( VarType type, uint64_t val, VarObject *obj )
+{
+    int result = EOK;
+    uint32_t bits;
+
+    memset( obj, 0, sizeof( VarObject ) );
+    obj->type = type;
+
+    switch( type )
+    {
+        case VARTYPE_UINT16:
+            obj->val.ui = (uint16_t)val;
+            break;
+
+        case VARTYPE_INT16:
+            obj->val.i = (int16_t)val;
+            break;
+
+        case VARTYPE_UINT32:
+            obj->val.ul = (uint32_t)val;
+            break;
+
+        case VARTYPE_INT32:
+            obj->val.l = (int32_t)val;
+            break;
+
+        case VARTYPE_UINT64:
+            obj->val.ull = val;
+            break;
+
+        case VARTYPE_INT64:
+            obj->val.ll = (int64_t)val;
+            break;
+
+        case VARTYPE_FLOAT:
+            bits = (uint32_t)val;
+            memcpy( &obj->val.f, &bits, sizeof( float ) );
+            break;
+
+        default:
+            result = EINVAL;
+            break;
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  SNAPSHOT_Close                                                            */
+/*!
+    Unmap and release a snapshot
+
+    @param[in]
+        pSnapshot
+            pointer to the snapshot
+
+==============================================================================*/
+void SNAPSHOT_Close( Snapshot *pSnapshot )
+{
+    if( pSnapshot != NULL )
+    {
+        if( pSnapshot->allocated == true )
+        {
+            free( pSnapshot->p );
+        }
+        else if( pSnapshot->p != NULL )
+        {
+            munmap( pSnapshot->p, pSnapshot->size );
+        }
+
+        free( pSnapshot );
+    }
+}
+
+/*============================================================================*/
+/*  snapshot_build                                                            */
+/*!
+    Build the contents of a snapshot file
+
+    The entries with a name and a result of EOK are written.  Entries
+    with a type which cannot be stored in a snapshot have their result
+    set to ENOTSUP.  If a name appears more than once, only its first
+    entry is written.
+
+    @param[in,out]
+        entries
+            variables fetched with FETCH_Get()
+
+    @param[in]
+        n
+            number of entries
+
+    @param[out]
+        pp
+            the allocated contents are returned here
+
+    @param[out]
+        pSize
+            the size of the contents is returned here
+
+    @retval EOK the snapshot was built
+    @retval EINVAL invalid arguments
+    @retval EFBIG the snapshot is too large for the file format
+    @retval ENOMEM out of memory
+
+==============================================================================*/
+static int snapshot_build( FetchEntry *entries,
+                           size_t n,
+                           uint8_t **pp,
+                           size_t *pSize )
+{
+    int result = EINVAL;
+    FetchEntry **sorted = NULL;
+    SnapshotHeader *pHeader;
+    SnapshotEntry *pEntry;
+    char *strings;
+    uint8_t *p = NULL;
+    size_t count = 0;
+    size_t unique;
+    size_t strsize = 0;
+    size_t size = 0;
+    size_t len;
+    uint64_t val;
+    size_t i;
+
+    if( ( pp != NULL ) &&
+        ( pSize != NULL ) &&
+        ( ( entries != NULL ) || ( n == 0 ) ) )
+    {
+        result = ENOMEM;
+        sorted = calloc( n + 1, sizeof( FetchEntry * ) );
+    }
+
+    if( sorted != NULL )
+    {
+        result = EOK;
+
+        for( i = 0; i < n; i++ )
+        {
+            if( ( entries[i].result == EOK ) && ( entries[i].name != NULL ) )
+            {
+                if( SNAPSHOT_Pack( &entries[i].obj, &val ) == true )
+                {
+                    sorted[count++] = &entries[i];
+                }
+                else
+                {
+                    entries[i].result = ENOTSUP;
+                }
+            }
+        }
+
+        qsort( sorted, count, sizeof( FetchEntry * ), compare_names );
+
+        /* drop repeated names so each name has one entry */
+        unique = ( count > 0 ) ? 1 : 0;
+        for( i = 1; i < count; i++ )
+        {
+            if( strcmp( sorted[i]->name, sorted[unique - 1]->name ) != 0 )
+            {
+                sorted[unique++] = sorted[i];
+            }
+        }
+
+        count = unique;
+
+        for( i = 0; i < count; i++ )
+        {
+            strsize += strlen( sorted[i]->name ) + 1;
+            if( sorted[i]->obj.type == VARTYPE_STR )
+            {
+                strsize += strlen( sorted[i]->obj.val.str ) + 1;
+            }
+        }
+
+        if( ( count > UINT32_MAX ) || ( strsize > UINT32_MAX ) )
+        {
+            result = EFBIG;
+        }
+    }
+
+    if( result == EOK )
+    {
+        size = sizeof( SnapshotHeader ) +
+               count * sizeof( SnapshotEntry ) +
+               strsize;
+        p = calloc( 1, size );
+        result = ( p != NULL ) ? EOK : ENOMEM;
+    }
+
+    if( result == EOK )
+    {
+        pHeader = (SnapshotHeader *)p;
+        pHeader->magic = SNAPSHOT_MAGIC;
+        pHeader->version = SNAPSHOT_VERSION;
+        pHeader->count = (uint32_t)count;
+        pHeader->strings = (uint32_t)strsize;
+
+        pEntry = (SnapshotEntry *)&pHeader[1];
+        strings = (char *)&pEntry[count];
+        strsize = 0;
+
+        for( i = 0; i < count; i++ )
+        {
+            len = strlen( sorted[i]->name ) + 1;
+            memcpy( &strings[strsize], sorted[i]->name, len );
+            pEntry[i].name = (uint32_t)strsize;
+            pEntry[i].type = (uint32_t)sorted[i]->obj.type;
+            strsize += len;
+
+            if( sorted[i]->obj.type == VARTYPE_STR )
+            {
+                len = strlen( sorted[i]->obj.val.str ) + 1;
+                memcpy( &strings[strsize], sorted[i]->obj.val.str, len );
+                pEntry[i].val = strsize;
+                strsize += len;
+            }
+            else
+            {
+                (void)SNAPSHOT_Pack( &sorted[i]->obj, &pEntry[i].val );
+            }
+        }
+
+    }
+
+    if( result == EOK )
+    {
+        *pp = p;
+        *pSize = size;
+    }
+    else
+    {
+        free( p );
+    }
+
+    free( sorted );
+
+    return result;
+}
+
+/*============================================================================*/
+/*  snapshot_map                                                              */
+/*!
+    Locate the header, entries and string table of a snapshot
+
+    @param[in,out]
+        pSnapshot
+            pointer to a snapshot with its contents loaded
+
+==============================================================================*/
+static void snapshot_map( Snapshot *pSnapshot )
+{
+    pSnapshot->pHeader = (const SnapshotHeader *)pSnapshot->p;
+    pSnapshot->entries = (const SnapshotEntry *)&pSnapshot->pHeader[1];
+    pSnapshot->strings =
+        (const char *)&pSnapshot->entries[pSnapshot->pHeader->count];
+}
+
+/*============================================================================*/
+/*  same_value                                                                */
+/*!
+    Compare two snapshot values
+
+    @param[in]
+        a
+            first value
+
+    @param[in]
+        b
+            second value
+
+    @retval true the values have the same type and value
+    @retval false the values differ
+
+==============================================================================*/
+static bool same_value( const VarObject *a, const VarObject *b )
+{
+    bool result = false;
+    uint64_t valA;
+    uint64_t valB;
+
+    if( a->type == b->type )
+    {
+        if( a->type == VARTYPE_STR )
+        {
+            result = ( strcmp( a->val.str, b->val.str ) == 0 );
+        }
+        else
+        {
+            /* compare the stored bits so a float NaN equals itself */
+            result = ( SNAPSHOT_Pack( a, &valA ) == true ) &&
+                     ( SNAPSHOT_Pack( b, &valB ) == true ) &&
+                     ( valA == valB );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  compare_names                                                             */
+/*!
+    qsort() comparison of FetchEntry pointers by variable name
+
+==============================================================================*/
+static int compare_names( const void *a, const void *b )
+{
+    const FetchEntry *pA = *(const FetchEntry * const *)a;
+    const FetchEntry *pB = *(const FetchEntry * const *)b;
+
+    return strcmp( pA->name, pB->name );
+}
+
+/*============================================================================*/
+/*  write_file                                                                */
+/*!
+    Replace a file with new contents
+
+    The contents are written to a temporary file in the same directory
+    which is then renamed over the destination.
+
+    @param[in]
+        path
+            path of the file
+
+    @param[in]
+        p
+            contents of the file
+
+    @param[in]
+        size
+            size of the contents
+
+    @retval EOK the file was written
+    @retval ENAMETOOLONG the path is too long
+    @retval other error from the file system
+
+==============================================================================*/
+static int write_file( const char *path, const void *p, size_t size )
+{
+    int result = EOK;
+    char tmp[BUFSIZ];
+    const uint8_t *q = p;
+    ssize_t rc;
+    int fd = -1;
+
+    if( snprintf( tmp, sizeof tmp, "%s.XXXXXX", path ) >= (int)sizeof tmp )
+    {
+        result = ENAMETOOLONG;
+    }
+    else
+    {
+        fd = mkstemp( tmp );
+        result = ( fd >= 0 ) ? EOK : errno;
+    }
+
+    while( ( result == EOK ) && ( size > 0 ) )
+    {
+        rc = write( fd, q, size );
+        if( rc > 0 )
+        {
+            q += rc;
+            size -= (size_t)rc;
+        }
+        else if( ( rc < 0 ) && ( errno != EINTR ) )
+        {
+            result = errno;
+        }
+    }
+
+    if( fd >= 0 )
+    {
+        if( ( close( fd ) != 0 ) && ( result == EOK ) )
+        {
+            result = errno;
+        }
+
+        if( ( result == EOK ) && ( rename( tmp, path ) != 0 ) )
+        {
+            result = errno;
+        }
+
+        if( result != EOK )
+        {
+            (void)unlink( tmp );
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  check_snapshot                                                            */
+/*!
+    Check that a mapped snapshot file is valid
+
+    @param[in]
+        pSnapshot
+            pointer to the mapped snapshot
+
+    @retval EOK the snapshot is valid
+    @retval EILSEQ the file is not a valid snapshot
+
+==============================================================================*/
+static int check_snapshot( const Snapshot *pSnapshot )
+{
+    int result = EILSEQ;
+    const SnapshotHeader *pHeader = pSnapshot->pHeader;
+    const SnapshotEntry *pEntry;
+    uint64_t size;
+    uint64_t val;
+    VarObject obj;
+    bool valid;
+    uint32_t i;
+
+    size = sizeof( SnapshotHeader ) +
+           (uint64_t)pHeader->count * sizeof( SnapshotEntry ) +
+           pHeader->strings;
+
+    if( ( pHeader->magic == SNAPSHOT_MAGIC ) &&
+        ( pHeader->version == SNAPSHOT_VERSION ) &&
+        ( size == pSnapshot->size ) &&
+        ( ( pHeader->strings == 0 ) ||
+          ( pSnapshot->strings[pHeader->strings - 1] == '\0' ) ) )
+    {
+        result = EOK;
+    }
+
+    /* the string table ends with a NUL, so every offset within it
+       refers to a terminated string */
+    for( i = 0; ( result == EOK ) && ( i < pHeader->count ); i++ )
+    {
+        pEntry = &pSnapshot->entries[i];
+        memset( &obj, 0, sizeof( VarObject ) );
+        obj.type = (VarType)pEntry->type;
+
+        valid = ( obj.type == VARTYPE_STR )
+                    ? ( pEntry->val < pHeader->strings )
+                    : SNAPSHOT_Pack( &obj, &val );
+
+        if( ( valid == false ) ||
+            ( pEntry->name >= pHeader->strings ) ||
+            ( ( i > 0 ) &&
+              ( strcmp( &pSnapshot->strings[pEntry[-1].name],
+                        &pSnapshot->strings[pEntry->name] ) >= 0 ) ) )
+        {
+            result = EILSEQ;
+        }
+    }
+
+    return result;
+}
+
+/*! @}
+ * end of libluavars group */
@@ -0,0 +1,109 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <varserver/varserver.h>
+#include "fetch.h"
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! snapshot file identifier, "LVSN" in a little endian file */
+#define SNAPSHOT_MAGIC          ( 0x4e53564cU )
+
+/*! snapshot file format version */
+#define SNAPSHOT_VERSION        ( 1 )
+
+/*==============================================================================
+        Public types
+==============================================================================*/
+
+/*! snapshot file header */
+typedef struct _SnapshotHeader
+{
+    /*! SNAPSHOT_MAGIC */
+    uint32_t magic;
+
+    /*! SNAPSHOT_VERSION */
+    uint32_t version;
+
+    /*! number of entries, which follow the header in name order */
+    uint32_t count;
+
+    /*! size of the string table, which follows the entries */
+    uint32_t strings;
+} SnapshotHeader;
+
+/*! snapshot file entry */
+typedef struct _SnapshotEntry
+{
+    /*! offset of the variable name in the string table */
+    uint32_t name;
+
+    /*! VarType of the value */
+    uint32_t type;
+
+    /*! scalar value, or offset of a string value in the string table */
+    uint64_t val;
+} SnapshotEntry;
+
+/*! snapshot mapped from a file or built in memory */
+typedef struct _Snapshot Snapshot;
+
+/*! called by SNAPSHOT_Diff() for each changed variable, with a or b
+    NULL if the variable is not in that snapshot */
+typedef void (*SnapshotDiffFn)( void *arg,
+                                const char *name,
+                                const VarObject *a,
+                                const VarObject *b );
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+int SNAPSHOT_Write( const char *path, FetchEntry *entries, size_t n );
+int SNAPSHOT_Create( FetchEntry *entries, size_t n, Snapshot **ppSnapshot );
+int SNAPSHOT_Open( const char *path, Snapshot **ppSnapshot );
+size_t SNAPSHOT_Count( const Snapshot *pSnapshot );
+const char *SNAPSHOT_Name( const Snapshot *pSnapshot, size_t i );
+int SNAPSHOT_Value( const Snapshot *pSnapshot, size_t i, VarObject *obj );
+bool SNAPSHOT_Pack( const VarObject *obj, uint64_t *val );
+int SNAPSHOT_Unpack( VarType type, uint64_t val, VarObject *obj );
+size_t SNAPSHOT_Diff( const Snapshot *pA,
+                      const Snapshot *pB,
+                      SnapshotDiffFn fn,
+                      void *arg );
+void SNAPSHOT_Close( Snapshot *pSnapshot );
+
+#endif
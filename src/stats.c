@@ -0,0 +1,1317 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+/*!
+ * @addtogroup libluavars
+ * @{
+ */
+
+/*============================================================================*/
+/*!
+@file stats.c
+
+    libluavars self-metrics
+
+    The stats module maintains counters for the Lua API calls, latency
+    histograms for the varserver IPC operations and the time spent
+    in Lua between var.wait() calls (the notification handlers).
+
+    The statistics can be read from Lua via vars.stats(), or published
+    as varserver variables under /sys/luavars/<pid>/ so they can be
+    read with getvar without attaching to the Lua process.
+
+*/
+/*============================================================================*/
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+#include <lauxlib.h>
+#include "stats.h"
+#include "probes.h"
+#include "alloc.h"
+#include "handlers.h"
+#include "realtime.h"
+#include "gcmode.h"
+#include "mirror.h"
+#include "metacache.h"
+#include "journal.h"
+#include "backend.h"
+
+/*==============================================================================
+        Private definitions
+==============================================================================*/
+
+/*! prefix for the published statistics variables */
+#define STATS_VAR_PREFIX "/sys/luavars"
+
+/*! atomic counter increment */
+#define STATS_INC(x) __atomic_fetch_add( &(x), 1, __ATOMIC_RELAXED )
+
+/*! atomic counter add */
+#define STATS_ADD(x, n) __atomic_fetch_add( &(x), (n), __ATOMIC_RELAXED )
+
+/*==============================================================================
+        Type Definitions
+==============================================================================*/
+
+/*! published statistics variable */
+typedef struct _StatsVar
+{
+    /*! variable name suffix */
+    const char *name;
+
+    /*! variable type */
+    VarType type;
+
+    /*! notification used to render the variable */
+    NotificationType notify;
+
+    /*! handle of the created variable */
+    VAR_HANDLE hVar;
+} StatsVar;
+
+/*! statistics maintained by the library */
+typedef struct _LuaVarsStats
+{
+    /*! number of calls per Lua API function */
+    uint64_t calls[LUAVARS_CALL_MAX];
+
+    /*! number of failed IPC operations */
+    uint64_t ipcErrors[LUAVARS_IPC_MAX];
+
+    /*! IPC latency histograms */
+    LuaVarsHist ipc[LUAVARS_IPC_MAX];
+
+    /*! number of events received per signal */
+    uint64_t events[STATS_NUM_SIGNALS];
+
+    /*! handler duration histograms per signal */
+    LuaVarsHist handler[STATS_NUM_SIGNALS];
+
+    /*! number of notifications pending at the last var.wait() */
+    uint64_t queueDepth;
+
+    /*! largest number of notifications pending at a var.wait() */
+    uint64_t queueDepthMax;
+
+    /*! minor page faults taken by handlers per signal */
+    uint64_t handlerMinorFaults[STATS_NUM_SIGNALS];
+
+    /*! major page faults taken by handlers per signal */
+    uint64_t handlerMajorFaults[STATS_NUM_SIGNALS];
+
+    /*! number of handlers which took a page fault per signal */
+    uint64_t faultedHandlers[STATS_NUM_SIGNALS];
+
+    /*! minor page faults taken outside of handlers */
+    uint64_t waitMinorFaults;
+
+    /*! major page faults taken outside of handlers */
+    uint64_t waitMajorFaults;
+
+    /*! Lua blocks allocated by handlers per signal */
+    uint64_t handlerAllocs[STATS_NUM_SIGNALS];
+
+    /*! Lua bytes allocated by handlers per signal */
+    uint64_t handlerAllocBytes[STATS_NUM_SIGNALS];
+} LuaVarsStats;
+
+/*==============================================================================
+        Private function declarations
+==============================================================================*/
+
+static void print_hist( FILE *fp, const char *name, const LuaVarsHist *pHist );
+static uint64_t total_calls( void );
+static uint64_t total_events( void );
+static uint64_t ipc_percentile( double p );
+
+/*==============================================================================
+        Local/Private variables
+==============================================================================*/
+
+/*! library statistics */
+static LuaVarsStats stats;
+
+/*! signal index of the handler currently executing, or -1 */
+static int handlerSig = STATS_SIGNAL_INVALID;
+
+/*! start time of the handler currently executing */
+static uint64_t handlerStart;
+
+/*! handle of the variable the current handler is servicing */
+static VAR_HANDLE handlerHandle = VAR_INVALID;
+
+/*! Lua allocation counter at the start of the current handler */
+static uint64_t handlerAlloc;
+
+/*! Lua block counter at the start of the current handler */
+static uint64_t handlerAllocCount;
+
+/*! page fault counts at the start of the current handler */
+static uint64_t handlerMinor;
+static uint64_t handlerMajor;
+
+/*! page fault counts at the end of the last handler */
+static bool faultsValid = false;
+static uint64_t waitMinor;
+static uint64_t waitMajor;
+
+/*! names of the Lua API calls */
+static const char *callNames[LUAVARS_CALL_MAX] =
+{
+    "get",
+    "find",
+    "set",
+    "notify",
+    "wait",
+    "validate_start",
+    "validate_end",
+    "open_print_session",
+    "close_print_session",
+    "create",
+    "notify_many",
+    "notify_prefix",
+    "unnotify",
+    "watch",
+    "get_many",
+    "set_many",
+    "snapshot",
+    "restore",
+    "diff",
+    "journal",
+    "bind",
+    "flush",
+    "get_buffer",
+    "info",
+    "name",
+    "flush_errors"
+};
+
+/*! names of the IPC operations */
+static const char *ipcNames[LUAVARS_IPC_MAX] =
+{
+    "find",
+    "get",
+    "set",
+    "get_type",
+    "notify",
+    "validation_request",
+    "validation_response",
+    "open_print_session",
+    "close_print_session",
+    "create",
+    "query",
+    "notify_cancel",
+    "get_length",
+    "get_name"
+};
+
+/*! names of the notification signals */
+static const char *signalNames[STATS_NUM_SIGNALS] =
+{
+    "modified",
+    "calc",
+    "validate",
+    "print"
+};
+
+/*! variables published under /sys/luavars/<pid>/ */
+static StatsVar statsVars[] =
+{
+    { "stats", VARTYPE_STR, NOTIFY_PRINT, VAR_INVALID },
+    { "calls", VARTYPE_UINT64, NOTIFY_CALC, VAR_INVALID },
+    { "events", VARTYPE_UINT64, NOTIFY_CALC, VAR_INVALID },
+    { "ipc_p99_ns", VARTYPE_UINT64, NOTIFY_CALC, VAR_INVALID },
+    { NULL, VARTYPE_INVALID, NOTIFY_NONE, VAR_INVALID }
+};
+
+/*! indicates if the statistics variables have been published */
+static bool published = false;
+
+/*==============================================================================
+        Function definitions
+==============================================================================*/
+
+/*============================================================================*/
+/*  STATS_Now                                                                 */
+/*!
+    Get the current monotonic time
+
+    @return the current monotonic time in nanoseconds
+
+==============================================================================*/
+uint64_t STATS_Now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*============================================================================*/
+/*  HIST_Record                                                               */
+/*!
+    Record a sample in a latency histogram
+
+    Buckets are log-linear: each power of two is split into
+    STATS_HIST_SUB_BUCKETS linear sub-buckets, giving a worst case
+    relative error of 12.5% across the full 64-bit range.
+
+    @param[in]
+        pHist
+            pointer to the histogram to update
+
+    @param[in]
+        ns
+            sample value in nanoseconds
+
+==============================================================================*/
+void HIST_Record( LuaVarsHist *pHist, uint64_t ns )
+{
+    int msb;
+    int idx;
+    uint64_t max;
+
+    if( pHist != NULL )
+    {
+        if( ns < STATS_HIST_SUB_BUCKETS )
+        {
+            idx = (int)ns;
+        }
+        else
+        {
+            msb = 63 - __builtin_clzll( ns );
+            idx = ( msb - 2 ) * STATS_HIST_SUB_BUCKETS
+                + (int)( ( ns >> ( msb - 3 ) )
+                         & ( STATS_HIST_SUB_BUCKETS - 1 ) );
+        }
+
+        if( idx >= STATS_HIST_BUCKETS )
+        {
+            idx = STATS_HIST_BUCKETS - 1;
+        }
+
+        STATS_INC( pHist->buckets[idx] );
+        STATS_INC( pHist->count );
+        STATS_ADD( pHist->total, ns );
+
+        max = __atomic_load_n( &pHist->max, __ATOMIC_RELAXED );
+        while( ( ns > max ) &&
+               !__atomic_compare_exchange_n( &pHist->max,
+                                             &max,
+                                             ns,
+                                             true,
+                                             __ATOMIC_RELAXED,
+                                             __ATOMIC_RELAXED ) )
+        {
+            /* max is reloaded by the failed exchange */
+        }
+    }
+}
+
+/*============================================================================*/
+/*  HIST_Percentile                                                           */
+/*!
+    Get a percentile from a latency histogram
+
+    @param[in]
+        pHist
+            pointer to the histogram to query
+
+    @param[in]
+        p
+            percentile to get in the range 0.0 - 1.0
+
+    @return the lower bound of the bucket containing the percentile,
+            in nanoseconds, or 0 if the histogram is empty
+
+==============================================================================*/
+uint64_t HIST_Percentile( const LuaVarsHist *pHist, double p )
+{
+    uint64_t target;
+    uint64_t sum = 0;
+    uint64_t value = 0;
+    int msb;
+    int idx;
+
+    if( ( pHist != NULL ) && ( pHist->count > 0 ) )
+    {
+        target = (uint64_t)( p * (double)pHist->count );
+        if( target >= pHist->count )
+        {
+            target = pHist->count - 1;
+        }
+
+        for( idx = 0; idx < STATS_HIST_BUCKETS; idx++ )
+        {
+            sum += pHist->buckets[idx];
+            if( sum > target )
+            {
+                break;
+            }
+        }
+
+        if( idx < STATS_HIST_SUB_BUCKETS )
+        {
+            value = (uint64_t)idx;
+        }
+        else
+        {
+            msb = ( idx / STATS_HIST_SUB_BUCKETS ) + 2;
+            value = (uint64_t)( STATS_HIST_SUB_BUCKETS
+                                + ( idx % STATS_HIST_SUB_BUCKETS ) )
+                    << ( msb - 3 );
+        }
+
+        if( value > pHist->max )
+        {
+            value = pHist->max;
+        }
+    }
+
+    return value;
+}
+
+/*============================================================================*/
+/*  HIST_Reset                                                                */
+/*!
+    Clear a latency histogram
+
+    @param[in]
+        pHist
+            pointer to the histogram to clear
+
+==============================================================================*/
+void HIST_Reset( LuaVarsHist *pHist )
+{
+    if( pHist != NULL )
+    {
+        memset( pHist, 0, sizeof( LuaVarsHist ) );
+    }
+}
+
+/*============================================================================*/
+/*  HIST_Merge                                                                */
+/*!
+    Add the samples of one latency histogram to another
+
+    @param[in,out]
+        pDst
+            pointer to the histogram to add the samples to
+
+    @param[in]
+        pSrc
+            pointer to the histogram to add the samples from
+
+==============================================================================*/
+void HIST_Merge( LuaVarsHist *pDst, const LuaVarsHist *pSrc )
+{
+    int i;
+
+    if( ( pDst != NULL ) && ( pSrc != NULL ) )
+    {
+        pDst->count += pSrc->count;
+        pDst->total += pSrc->total;
+        if( pSrc->max > pDst->max )
+        {
+            pDst->max = pSrc->max;
+        }
+
+        for( i = 0; i < STATS_HIST_BUCKETS; i++ )
+        {
+            pDst->buckets[i] += pSrc->buckets[i];
+        }
+    }
+}
+
+/*============================================================================*/
+/*  STATS_Call                                                                */
+/*!
+    Count a Lua API call
+
+    @param[in]
+        call
+            the Lua API function which was called
+
+==============================================================================*/
+void STATS_Call( LuaVarsCall call )
+{
+    if( call < LUAVARS_CALL_MAX )
+    {
+        STATS_INC( stats.calls[call] );
+    }
+}
+
+/*============================================================================*/
+/*  STATS_Ipc                                                                 */
+/*!
+    Record the latency of a varserver IPC operation
+
+    @param[in]
+        ipc
+            the IPC operation which was performed
+
+    @param[in]
+        t0
+            the STATS_Now() time at which the operation started
+
+    @param[in]
+        rc
+            the result of the operation. Non-EOK results are counted
+            as errors.
+
+    Each operation also fires the luavars:ipc USDT probe with the
+    operation, result and latency in nanoseconds.
+
+==============================================================================*/
+void STATS_Ipc( LuaVarsIpc ipc, uint64_t t0, int rc )
+{
+    uint64_t ns;
+
+    if( ipc < LUAVARS_IPC_MAX )
+    {
+        ns = STATS_Now() - t0;
+        LUAVARS_PROBE3( ipc, ipc, rc, ns );
+
+        HIST_Record( &stats.ipc[ipc], ns );
+        if( rc != EOK )
+        {
+            STATS_INC( stats.ipcErrors[ipc] );
+        }
+    }
+}
+
+/*============================================================================*/
+/*  STATS_Calls                                                               */
+/*!
+    Get the number of calls to a Lua API function
+
+    @param[in]
+        call
+            the Lua API function
+
+    @return the number of calls to the function
+
+==============================================================================*/
+uint64_t STATS_Calls( LuaVarsCall call )
+{
+    return ( call < LUAVARS_CALL_MAX )
+            ? __atomic_load_n( &stats.calls[call], __ATOMIC_RELAXED )
+            : 0;
+}
+
+/*============================================================================*/
+/*  STATS_Events                                                              */
+/*!
+    Get the number of notifications received
+
+    @return the total number of notifications received by var.wait()
+
+==============================================================================*/
+uint64_t STATS_Events( void )
+{
+    return total_events();
+}
+
+/*============================================================================*/
+/*  STATS_SignalIndex                                                         */
+/*!
+    Map a varserver notification signal to a statistics index
+
+    @param[in]
+        sig
+            the signal number
+
+    @retval 0 - STATS_NUM_SIGNALS-1 the index of the signal
+    @retval STATS_SIGNAL_INVALID the signal is not a varserver notification
+
+==============================================================================*/
+int STATS_SignalIndex( int sig )
+{
+    int idx = STATS_SIGNAL_INVALID;
+
+    if( sig == SIG_VAR_MODIFIED )
+    {
+        idx = 0;
+    }
+    else if( sig == SIG_VAR_CALC )
+    {
+        idx = 1;
+    }
+    else if( sig == SIG_VAR_VALIDATE )
+    {
+        idx = 2;
+    }
+    else if( sig == SIG_VAR_PRINT )
+    {
+        idx = 3;
+    }
+
+    return idx;
+}
+
+/*============================================================================*/
+/*  STATS_SignalName                                                          */
+/*!
+    Get the name of a notification signal
+
+    @param[in]
+        idx
+            signal index returned by STATS_SignalIndex()
+
+    @return the name of the signal, or "idle" for STATS_SIGNAL_INVALID
+
+==============================================================================*/
+const char *STATS_SignalName( int idx )
+{
+    const char *name = "idle";
+
+    if( ( idx >= 0 ) && ( idx < STATS_NUM_SIGNALS ) )
+    {
+        name = signalNames[idx];
+    }
+
+    return name;
+}
+
+/*============================================================================*/
+/*  STATS_Event                                                               */
+/*!
+    Count a received notification
+
+    @param[in]
+        sig
+            the signal which was received
+
+    @param[in]
+        depth
+            the number of notifications still pending
+
+==============================================================================*/
+void STATS_Event( int sig, int depth )
+{
+    int idx = STATS_SignalIndex( sig );
+
+    if( idx != STATS_SIGNAL_INVALID )
+    {
+        STATS_INC( stats.events[idx] );
+    }
+
+    if( depth >= 0 )
+    {
+        stats.queueDepth = (uint64_t)depth;
+        if( stats.queueDepth > stats.queueDepthMax )
+        {
+            stats.queueDepthMax = stats.queueDepth;
+        }
+    }
+}
+
+/*============================================================================*/
+/*  STATS_HandlerBegin                                                        */
+/*!
+    Mark the start of a Lua notification handler
+
+    The handler is considered to run from the return of var.wait()
+    until the next call to var.wait().
+
+    @param[in]
+        sig
+            the signal being handled
+
+    @param[in]
+        hVar
+            the variable being serviced, or VAR_INVALID if it is not
+            yet known (validation and print sessions)
+
+==============================================================================*/
+void STATS_HandlerBegin( int sig, VAR_HANDLE hVar )
+{
+    if( REALTIME_Faults( &handlerMinor, &handlerMajor ) == true )
+    {
+        if( faultsValid == true )
+        {
+            stats.waitMinorFaults += handlerMinor - waitMinor;
+            stats.waitMajorFaults += handlerMajor - waitMajor;
+        }
+    }
+
+    handlerSig = STATS_SignalIndex( sig );
+    handlerHandle = hVar;
+    handlerAlloc = ALLOC_Bytes();
+    handlerAllocCount = ALLOC_Count();
+    handlerStart = STATS_Now();
+}
+
+/*============================================================================*/
+/*  STATS_HandlerSetHandle                                                    */
+/*!
+    Set the variable serviced by the current handler
+
+    Validation and print notifications carry a request identifier
+    rather than a variable handle.  The handle becomes known once
+    the handler calls var.validate_start() or var.open_print_session().
+
+    @param[in]
+        hVar
+            the variable being serviced
+
+==============================================================================*/
+void STATS_HandlerSetHandle( VAR_HANDLE hVar )
+{
+    if( handlerSig != STATS_SIGNAL_INVALID )
+    {
+        handlerHandle = hVar;
+    }
+}
+
+/*============================================================================*/
+/*  STATS_HandlerContext                                                      */
+/*!
+    Get the notification currently being handled
+
+    @param[out]
+        hVar
+            the variable being serviced, or VAR_INVALID
+
+    @return the signal index of the current handler, or
+            STATS_SIGNAL_INVALID if no handler is running
+
+==============================================================================*/
+int STATS_HandlerContext( VAR_HANDLE *hVar )
+{
+    if( hVar != NULL )
+    {
+        *hVar = handlerHandle;
+    }
+
+    return handlerSig;
+}
+
+/*============================================================================*/
+/*  STATS_HandlerEnd                                                          */
+/*!
+    Mark the end of a Lua notification handler
+
+    The elapsed time since STATS_HandlerBegin() is recorded against
+    the signal which was being handled, and against the (handle, signal)
+    pair along with the number of bytes allocated by Lua.  The number
+    of blocks and bytes allocated are also totalled per signal.  Once
+    realtime
+    settings have been applied the page faults taken by the handler are
+    also recorded against the signal.
+
+==============================================================================*/
+void STATS_HandlerEnd( void )
+{
+    uint64_t ns;
+    uint64_t bytes;
+    uint64_t minor;
+    uint64_t major;
+
+    if( handlerSig != STATS_SIGNAL_INVALID )
+    {
+        ns = STATS_Now() - handlerStart;
+
+        if( REALTIME_Faults( &minor, &major ) == true )
+        {
+            if( faultsValid == true )
+            {
+                stats.handlerMinorFaults[handlerSig] += minor - handlerMinor;
+                stats.handlerMajorFaults[handlerSig] += major - handlerMajor;
+                if( ( minor != handlerMinor ) || ( major != handlerMajor ) )
+                {
+                    stats.faultedHandlers[handlerSig]++;
+                }
+            }
+
+            waitMinor = minor;
+            waitMajor = major;
+            faultsValid = true;
+        }
+
+        HIST_Record( &stats.handler[handlerSig], ns );
+        bytes = ALLOC_Bytes() - handlerAlloc;
+        stats.handlerAllocBytes[handlerSig] += bytes;
+        stats.handlerAllocs[handlerSig] += ALLOC_Count() - handlerAllocCount;
+        HANDLERS_Record( handlerSig, handlerHandle, ns, bytes );
+        handlerSig = STATS_SIGNAL_INVALID;
+        handlerHandle = VAR_INVALID;
+    }
+}
+
+/*============================================================================*/
+/*  STATS_Print                                                               */
+/*!
+    Render the statistics as text
+
+    @param[in]
+        fp
+            output stream to write the statistics to
+
+==============================================================================*/
+void STATS_Print( FILE *fp )
+{
+    int i;
+
+    if( fp != NULL )
+    {
+        fprintf( fp, "pid: %d\n", (int)getpid() );
+
+        fprintf( fp, "calls:\n" );
+        for( i = 0; i < LUAVARS_CALL_MAX; i++ )
+        {
+            fprintf( fp, "  %-20s %llu\n",
+                     callNames[i],
+                     (unsigned long long)stats.calls[i] );
+        }
+
+        fprintf( fp, "ipc latency (ns):\n" );
+        for( i = 0; i < LUAVARS_IPC_MAX; i++ )
+        {
+            print_hist( fp, ipcNames[i], &stats.ipc[i] );
+            if( stats.ipcErrors[i] != 0 )
+            {
+                fprintf( fp, "  %-20s errors=%llu\n",
+                         "",
+                         (unsigned long long)stats.ipcErrors[i] );
+            }
+        }
+
+        fprintf( fp, "events:\n" );
+        for( i = 0; i < STATS_NUM_SIGNALS; i++ )
+        {
+            fprintf( fp, "  %-20s %llu\n",
+                     signalNames[i],
+                     (unsigned long long)stats.events[i] );
+        }
+
+        fprintf( fp, "queue depth: %llu (max %llu)\n",
+                 (unsigned long long)stats.queueDepth,
+                 (unsigned long long)stats.queueDepthMax );
+
+        fprintf( fp, "handler duration (ns):\n" );
+        for( i = 0; i < STATS_NUM_SIGNALS; i++ )
+        {
+            print_hist( fp, signalNames[i], &stats.handler[i] );
+        }
+
+        if( faultsValid == true )
+        {
+            fprintf( fp, "page faults (minor/major):\n" );
+            for( i = 0; i < STATS_NUM_SIGNALS; i++ )
+            {
+                fprintf( fp, "  %-20s %llu/%llu in %llu handlers\n",
+                         signalNames[i],
+                         (unsigned long long)stats.handlerMinorFaults[i],
+                         (unsigned long long)stats.handlerMajorFaults[i],
+                         (unsigned long long)stats.faultedHandlers[i] );
+            }
+
+            fprintf( fp, "  %-20s %llu/%llu\n",
+                     "wait",
+                     (unsigned long long)stats.waitMinorFaults,
+                     (unsigned long long)stats.waitMajorFaults );
+        }
+
+        ALLOC_Print( fp );
+        for( i = 0; i < STATS_NUM_SIGNALS; i++ )
+        {
+            if( stats.handler[i].count != 0 )
+            {
+                fprintf( fp,
+                         "  %-20s allocs=%llu bytes=%llu per dispatch=%.1f\n",
+                         signalNames[i],
+                         (unsigned long long)stats.handlerAllocs[i],
+                         (unsigned long long)stats.handlerAllocBytes[i],
+                         (double)stats.handlerAllocs[i] /
+                         (double)stats.handler[i].count );
+            }
+        }
+
+        GCMODE_Print( fp );
+
+        MIRROR_Print( fp );
+
+        METACACHE_Print( fp );
+
+        JOURNAL_Print( fp );
+    }
+}
+
+/*============================================================================*/
+/*  print_hist                                                                */
+/*!
+    Render a histogram summary as a single line of text
+
+    @param[in]
+        fp
+            output stream
+
+    @param[in]
+        name
+            name of the histogram
+
+    @param[in]
+        pHist
+            pointer to the histogram to render
+
+==============================================================================*/
+static void print_hist( FILE *fp, const char *name, const LuaVarsHist *pHist )
+{
+    if( pHist->count != 0 )
+    {
+        fprintf( fp,
+                 "  %-20s n=%llu mean=%llu p50=%llu p99=%llu p999=%llu "
+                 "max=%llu\n",
+                 name,
+                 (unsigned long long)pHist->count,
+                 (unsigned long long)( pHist->total / pHist->count ),
+                 (unsigned long long)HIST_Percentile( pHist, 0.5 ),
+                 (unsigned long long)HIST_Percentile( pHist, 0.99 ),
+                 (unsigned long long)HIST_Percentile( pHist, 0.999 ),
+                 (unsigned long long)pHist->max );
+    }
+}
+
+/*============================================================================*/
+/*  STATS_PushTable                                                           */
+/*!
+    Push the statistics onto the Lua stack as a table
+
+    @param[in]
+        L
+            pointer to the lua state
+
+==============================================================================*/
+void STATS_PushTable( lua_State *L )
+{
+    int i;
+
+    lua_newtable( L );
+
+    lua_newtable( L );
+    for( i = 0; i < LUAVARS_CALL_MAX; i++ )
+    {
+        lua_pushinteger( L, (lua_Integer)stats.calls[i] );
+        lua_setfield( L, -2, callNames[i] );
+    }
+    lua_setfield( L, -2, "calls" );
+
+    lua_newtable( L );
+    for( i = 0; i < LUAVARS_IPC_MAX; i++ )
+    {
+        HIST_PushTable( L, &stats.ipc[i] );
+        lua_pushinteger( L, (lua_Integer)stats.ipcErrors[i] );
+        lua_setfield( L, -2, "errors" );
+        lua_setfield( L, -2, ipcNames[i] );
+    }
+    lua_setfield( L, -2, "ipc" );
+
+    lua_newtable( L );
+    for( i = 0; i < STATS_NUM_SIGNALS; i++ )
+    {
+        lua_pushinteger( L, (lua_Integer)stats.events[i] );
+        lua_setfield( L, -2, signalNames[i] );
+    }
+    lua_setfield( L, -2, "events" );
+
+    lua_newtable( L );
+    for( i = 0; i < STATS_NUM_SIGNALS; i++ )
+    {
+        HIST_PushTable( L, &stats.handler[i] );
+        lua_setfield( L, -2, signalNames[i] );
+    }
+    lua_setfield( L, -2, "handlers" );
+
+    lua_pushinteger( L, (lua_Integer)stats.queueDepth );
+    lua_setfield( L, -2, "queue_depth" );
+
+    lua_pushinteger( L, (lua_Integer)stats.queueDepthMax );
+    lua_setfield( L, -2, "queue_depth_max" );
+
+    if( faultsValid == true )
+    {
+        lua_newtable( L );
+        for( i = 0; i < STATS_NUM_SIGNALS; i++ )
+        {
+            lua_newtable( L );
+            lua_pushinteger( L, (lua_Integer)stats.handlerMinorFaults[i] );
+            lua_setfield( L, -2, "minor" );
+            lua_pushinteger( L, (lua_Integer)stats.handlerMajorFaults[i] );
+            lua_setfield( L, -2, "major" );
+            lua_pushinteger( L, (lua_Integer)stats.faultedHandlers[i] );
+            lua_setfield( L, -2, "handlers" );
+            lua_setfield( L, -2, signalNames[i] );
+        }
+
+        lua_newtable( L );
+        lua_pushinteger( L, (lua_Integer)stats.waitMinorFaults );
+        lua_setfield( L, -2, "minor" );
+        lua_pushinteger( L, (lua_Integer)stats.waitMajorFaults );
+        lua_setfield( L, -2, "major" );
+        lua_setfield( L, -2, "wait" );
+
+        lua_setfield( L, -2, "faults" );
+    }
+
+    GCMODE_PushTable( L );
+    lua_setfield( L, -2, "gc" );
+
+    MIRROR_PushTable( L );
+    lua_setfield( L, -2, "mirror" );
+
+    METACACHE_PushTable( L );
+    lua_setfield( L, -2, "metacache" );
+
+    JOURNAL_PushTable( L );
+    lua_setfield( L, -2, "journal" );
+
+    ALLOC_PushTable( L );
+    for( i = 0; i < STATS_NUM_SIGNALS; i++ )
+    {
+        lua_newtable( L );
+        lua_pushinteger( L, (lua_Integer)stats.handlerAllocs[i] );
+        lua_setfield( L, -2, "allocs" );
+        lua_pushinteger( L, (lua_Integer)stats.handlerAllocBytes[i] );
+        lua_setfield( L, -2, "bytes" );
+        lua_pushnumber( L,
+                        ( stats.handler[i].count != 0 )
+                            ? (double)stats.handlerAllocs[i] /
+                              (double)stats.handler[i].count
+                            : 0.0 );
+        lua_setfield( L, -2, "per_dispatch" );
+        lua_setfield( L, -2, signalNames[i] );
+    }
+    lua_setfield( L, -2, "alloc" );
+}
+
+/*============================================================================*/
+/*  HIST_PushTable                                                            */
+/*!
+    Push a histogram summary onto the Lua stack as a table
+
+    The table contains the count, total, max, p50, p99 and p999
+    values in nanoseconds.
+
+    @param[in]
+        L
+            pointer to the lua state
+
+    @param[in]
+        pHist
+            pointer to the histogram to summarize
+
+==============================================================================*/
+void HIST_PushTable( lua_State *L, const LuaVarsHist *pHist )
+{
+    lua_newtable( L );
+
+    lua_pushinteger( L, (lua_Integer)pHist->count );
+    lua_setfield( L, -2, "count" );
+
+    lua_pushinteger( L, (lua_Integer)pHist->total );
+    lua_setfield( L, -2, "total" );
+
+    lua_pushinteger( L, (lua_Integer)pHist->max );
+    lua_setfield( L, -2, "max" );
+
+    lua_pushinteger( L, (lua_Integer)HIST_Percentile( pHist, 0.5 ) );
+    lua_setfield( L, -2, "p50" );
+
+    lua_pushinteger( L, (lua_Integer)HIST_Percentile( pHist, 0.99 ) );
+    lua_setfield( L, -2, "p99" );
+
+    lua_pushinteger( L, (lua_Integer)HIST_Percentile( pHist, 0.999 ) );
+    lua_setfield( L, -2, "p999" );
+}
+
+/*============================================================================*/
+/*  STATS_Reset                                                               */
+/*!
+    Clear all of the statistics
+
+==============================================================================*/
+void STATS_Reset( void )
+{
+    memset( &stats, 0, sizeof( LuaVarsStats ) );
+}
+
+/*============================================================================*/
+/*  STATS_Publish                                                             */
+/*!
+    Publish the statistics as varserver variables
+
+    The STATS_Publish function creates the /sys/luavars/<pid>/...
+    variables and requests PRINT and CALC notifications on them.
+    The notifications are serviced inside var.wait() and are never
+    seen by the Lua script.
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @retval EOK the statistics variables were published
+    @retval EINVAL invalid variable server handle
+    @retval other error from the variable server
+
+==============================================================================*/
+int STATS_Publish( VARSERVER_HANDLE hVarServer )
+{
+    const LuaVarsBackend *pBackend = BACKEND_Current();
+    int result = EINVAL;
+    VarInfo info;
+    StatsVar *pVar;
+    char empty[1] = "";
+
+    if( hVarServer != NULL )
+    {
+        result = EOK;
+
+        for( pVar = statsVars; pVar->name != NULL; pVar++ )
+        {
+            memset( &info, 0, sizeof( VarInfo ) );
+            snprintf( info.name,
+                      sizeof( info.name ),
+                      "%s/%d/%s",
+                      STATS_VAR_PREFIX,
+                      (int)getpid(),
+                      pVar->name );
+
+            info.var.type = pVar->type;
+            if( pVar->type == VARTYPE_STR )
+            {
+                info.var.val.str = empty;
+                info.var.len = sizeof( empty );
+            }
+
+            /* the variable may remain from a previous process
+               with the same pid, so ignore creation failures
+               and look it up by name */
+            (void)pBackend->create( hVarServer, &info );
+
+            pVar->hVar = pBackend->find( hVarServer, info.name );
+            if( pVar->hVar == VAR_INVALID )
+            {
+                result = ENOENT;
+            }
+            else if( pBackend->notify( hVarServer,
+                                       pVar->hVar,
+                                       pVar->notify ) != EOK )
+            {
+                result = EIO;
+            }
+        }
+
+        published = ( result == EOK );
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  STATS_IsPublished                                                         */
+/*!
+    Check if the statistics variables have been published
+
+    @retval true the statistics have been published
+    @retval false the statistics have not been published
+
+==============================================================================*/
+bool STATS_IsPublished( void )
+{
+    return published;
+}
+
+/*============================================================================*/
+/*  STATS_Owns                                                                */
+/*!
+    Check if a variable is one of the published statistics variables
+
+    @param[in]
+        hVar
+            handle of the variable to check
+
+    @retval true the variable is a statistics variable
+    @retval false the variable is not a statistics variable
+
+==============================================================================*/
+bool STATS_Owns( VAR_HANDLE hVar )
+{
+    StatsVar *pVar;
+    bool result = false;
+
+    if( published && ( hVar != VAR_INVALID ) )
+    {
+        for( pVar = statsVars; pVar->name != NULL; pVar++ )
+        {
+            if( pVar->hVar == hVar )
+            {
+                result = true;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  STATS_Calc                                                                */
+/*!
+    Service a CALC notification for a statistics variable
+
+    @param[in]
+        hVarServer
+            handle to the variable server
+
+    @param[in]
+        hVar
+            handle of the variable to calculate
+
+    @retval EOK the variable was calculated
+    @retval ENOENT the variable is not a statistics variable
+    @retval other error from the variable server
+
+==============================================================================*/
+int STATS_Calc( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar )
+{
+    int result = ENOENT;
+    VarObject var;
+    StatsVar *pVar;
+
+    if( STATS_Owns( hVar ) )
+    {
+        for( pVar = statsVars; pVar->name != NULL; pVar++ )
+        {
+            if( ( pVar->hVar == hVar ) && ( pVar->notify == NOTIFY_CALC ) )
+            {
+                memset( &var, 0, sizeof( VarObject ) );
+                var.type = VARTYPE_UINT64;
+                var.len = sizeof( uint64_t );
+
+                if( strcmp( pVar->name, "calls" ) == 0 )
+                {
+                    var.val.ull = total_calls();
+                }
+                else if( strcmp( pVar->name, "events" ) == 0 )
+                {
+                    var.val.ull = total_events();
+                }
+                else
+                {
+                    var.val.ull = ipc_percentile( 0.99 );
+                }
+
+                result = BACKEND_Current()->set( hVarServer, hVar, &var );
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+/*============================================================================*/
+/*  total_calls                                                               */
+/*!
+    Get the total number of Lua API calls
+
+    @return the sum of all of the Lua API call counters
+
+==============================================================================*/
+static uint64_t total_calls( void )
+{
+    uint64_t total = 0;
+    int i;
+
+    for( i = 0; i < LUAVARS_CALL_MAX; i++ )
+    {
+        total += stats.calls[i];
+    }
+
+    return total;
+}
+
+/*============================================================================*/
+/*  total_events                                                              */
+/*!
+    Get the total number of notifications received
+
+    @return the sum of all of the notification counters
+
+==============================================================================*/
+static uint64_t total_events( void )
+{
+    uint64_t total = 0;
+    int i;
+
+    for( i = 0; i < STATS_NUM_SIGNALS; i++ )
+    {
+        total += __atomic_load_n( &stats.events[i], __ATOMIC_RELAXED );
+    }
+
+    return total;
+}
+
+/*============================================================================*/
+/*  ipc_percentile                                                            */
+/*!
+    Get a latency percentile across all IPC operations
+
+    @param[in]
+        p
+            the percentile to get in the range 0.0 - 1.0
+
+    @return the latency percentile in nanoseconds
+
+==============================================================================*/
+static uint64_t ipc_percentile( double p )
+{
+    LuaVarsHist all;
+    int i;
+
+    HIST_Reset( &all );
+
+    for( i = 0; i < LUAVARS_IPC_MAX; i++ )
+    {
+        HIST_Merge( &all, &stats.ipc[i] );
+    }
+
+    return HIST_Percentile( &all, p );
+}
+
+/*! @}
+ * end of libluavars group */
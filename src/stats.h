@@ -0,0 +1,159 @@
+/*==============================================================================
+MIT License
+
+Copyright (c) 2023 Trevor Monk
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+==============================================================================*/
+
+#ifndef STATS_H
+#define STATS_H
+
+/*==============================================================================
+        Includes
+==============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <varserver/varserver.h>
+#include <lua.h>
+
+/*==============================================================================
+        Public definitions
+==============================================================================*/
+
+/*! number of histogram sub-buckets per power of two */
+#define STATS_HIST_SUB_BUCKETS  ( 8 )
+
+/*! total number of histogram buckets */
+#define STATS_HIST_BUCKETS      ( 62 * STATS_HIST_SUB_BUCKETS )
+
+/*! number of tracked notification signals */
+#define STATS_NUM_SIGNALS       ( 4 )
+
+/*! signal index used for signals which are not varserver notifications */
+#define STATS_SIGNAL_INVALID    ( -1 )
+
+/*==============================================================================
+        Public types
+==============================================================================*/
+
+/*! Lua API functions which are counted */
+typedef enum _LuaVarsCall
+{
+    LUAVARS_CALL_GET = 0,
+    LUAVARS_CALL_FIND,
+    LUAVARS_CALL_SET,
+    LUAVARS_CALL_NOTIFY,
+    LUAVARS_CALL_WAIT,
+    LUAVARS_CALL_VALIDATE_START,
+    LUAVARS_CALL_VALIDATE_END,
+    LUAVARS_CALL_OPEN_PRINT_SESSION,
+    LUAVARS_CALL_CLOSE_PRINT_SESSION,
+    LUAVARS_CALL_CREATE,
+    LUAVARS_CALL_NOTIFY_MANY,
+    LUAVARS_CALL_NOTIFY_PREFIX,
+    LUAVARS_CALL_UNNOTIFY,
+    LUAVARS_CALL_WATCH,
+    LUAVARS_CALL_GET_MANY,
+    LUAVARS_CALL_SET_MANY,
+    LUAVARS_CALL_SNAPSHOT,
+    LUAVARS_CALL_RESTORE,
+    LUAVARS_CALL_DIFF,
+    LUAVARS_CALL_JOURNAL,
+    LUAVARS_CALL_BIND,
+    LUAVARS_CALL_FLUSH,
+    LUAVARS_CALL_GET_BUFFER,
+    LUAVARS_CALL_INFO,
+    LUAVARS_CALL_NAME,
+    LUAVARS_CALL_FLUSH_ERRORS,
+    LUAVARS_CALL_MAX
+} LuaVarsCall;
+
+/*! varserver IPC operations which are timed */
+typedef enum _LuaVarsIpc
+{
+    LUAVARS_IPC_FIND = 0,
+    LUAVARS_IPC_GET,
+    LUAVARS_IPC_SET,
+    LUAVARS_IPC_GET_TYPE,
+    LUAVARS_IPC_NOTIFY,
+    LUAVARS_IPC_VALIDATION_REQUEST,
+    LUAVARS_IPC_VALIDATION_RESPONSE,
+    LUAVARS_IPC_OPEN_PRINT_SESSION,
+    LUAVARS_IPC_CLOSE_PRINT_SESSION,
+    LUAVARS_IPC_CREATE,
+    LUAVARS_IPC_QUERY,
+    LUAVARS_IPC_NOTIFY_CANCEL,
+    LUAVARS_IPC_GET_LENGTH,
+    LUAVARS_IPC_GET_NAME,
+    LUAVARS_IPC_MAX
+} LuaVarsIpc;
+
+/*! log-linear latency histogram with nanosecond resolution */
+typedef struct _LuaVarsHist
+{
+    /*! number of samples recorded */
+    uint64_t count;
+
+    /*! sum of all samples in nanoseconds */
+    uint64_t total;
+
+    /*! largest sample in nanoseconds */
+    uint64_t max;
+
+    /*! sample counts per bucket */
+    uint64_t buckets[STATS_HIST_BUCKETS];
+} LuaVarsHist;
+
+/*==============================================================================
+        Public function declarations
+==============================================================================*/
+
+uint64_t STATS_Now( void );
+
+void HIST_Record( LuaVarsHist *pHist, uint64_t ns );
+uint64_t HIST_Percentile( const LuaVarsHist *pHist, double p );
+void HIST_Reset( LuaVarsHist *pHist );
+void HIST_Merge( LuaVarsHist *pDst, const LuaVarsHist *pSrc );
+void HIST_PushTable( lua_State *L, const LuaVarsHist *pHist );
+
+void STATS_Call( LuaVarsCall call );
+uint64_t STATS_Calls( LuaVarsCall call );
+void STATS_Ipc( LuaVarsIpc ipc, uint64_t t0, int rc );
+int STATS_SignalIndex( int sig );
+void STATS_Event( int sig, int depth );
+uint64_t STATS_Events( void );
+const char *STATS_SignalName( int idx );
+void STATS_HandlerBegin( int sig, VAR_HANDLE hVar );
+void STATS_HandlerSetHandle( VAR_HANDLE hVar );
+int STATS_HandlerContext( VAR_HANDLE *hVar );
+void STATS_HandlerEnd( void );
+
+void STATS_Print( FILE *fp );
+void STATS_PushTable( lua_State *L );
+void STATS_Reset( void );
+
+int STATS_Publish( VARSERVER_HANDLE hVarServer );
+bool STATS_IsPublished( void );
+bool STATS_Owns( VAR_HANDLE hVar );
+int STATS_Calc( VARSERVER_HANDLE hVarServer, VAR_HANDLE hVar );
+
+#endif
@@ -0,0 +1,65 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- bound table test
+--
+-- Two tables bound to one variable hold separate registrations, so
+-- collecting one must not cancel the other's notification, and a bound
+-- write which fails when vars.wait() flushes it is reported by
+-- vars.flush_errors().
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_bind.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+-- two tables bound to one variable, the first collected
+local hA = assert( vars.create( "/test/bind/a", "uint32", "1" ) )
+local t1 = vars.bind( {}, { x = "/test/bind/a" } )
+local t2 = vars.bind( {}, { x = "/test/bind/a" } )
+assert( ( t1.x == 1 ) and ( t2.x == 1 ) )
+t1 = nil
+collectgarbage()
+collectgarbage()
+vars.set( hA, 7 )
+local sig, id = vars.wait()
+assert( ( sig == SIG_VAR_MODIFIED ) and ( id == hA ),
+        "collecting one bound table cancelled the other's notification" )
+assert( t2.x == 7 )
+
+-- a bound write flushed by vars.wait() which fails is reported
+local hB = assert( vars.create( "/test/bind/b", "str", "abc" ) )
+local t3 = vars.bind( {}, { s = hB } )
+t3.s = string.rep( "x", 300 )
+vars.set( hA, 8 )
+sig, id = vars.wait()
+local errors = vars.flush_errors()
+assert( errors[hB] ~= nil, "the failed bound write was not reported" )
+assert( next( vars.flush_errors() ) == nil )
+
+print( "test_bind: ok" )
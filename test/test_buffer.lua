@@ -0,0 +1,77 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- value buffer test
+--
+-- vars.get_buffer() reads a string variable into a value buffer, reusing
+-- the given buffer when the value fits, and buffers index like strings.
+-- Values longer than BUFSIZ are read in full.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_buffer.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+-- buffer methods follow string.sub() positions
+local s = "hello, buffer"
+local buf = vars.buffer( s )
+assert( ( #buf == #s ) and ( buf:len() == #s ) )
+assert( tostring( buf ) == s )
+for _, p in ipairs( { { 1 }, { 3 }, { -6 }, { 1, 5 }, { 8, -1 }, { -3, -2 },
+                      { 0, 2 }, { 5, 3 }, { 10, 100 }, { -100, 2 } } ) do
+    assert( buf:sub( p[1], p[2] ) == s:sub( p[1], p[2] ),
+            string.format( "sub( %d, %s )", p[1], tostring( p[2] ) ) )
+end
+
+local empty = vars.buffer( 16 )
+assert( ( #empty == 0 ) and ( tostring( empty ) == "" ) )
+
+-- a value which fits is read into the given buffer
+local hS = assert( vars.create( "/test/buffer/short", "str", "short value" ) )
+local b = assert( vars.get_buffer( hS, empty ) )
+assert( rawequal( b, empty ), "a buffer which fits was not reused" )
+assert( tostring( b ) == "short value" )
+
+b = assert( vars.get_buffer( "/test/buffer/short" ) )
+assert( tostring( b ) == "short value" )
+
+-- a value which does not fit is read into a new buffer of its length
+local long = string.rep( "0123456789abcdef", 1024 )
+assert( vars.create( "/test/buffer/long", "str", long ) )
+b = assert( vars.get_buffer( "/test/buffer/long", empty ) )
+assert( not rawequal( b, empty ) )
+assert( ( #b == #long ) and ( tostring( b ) == long ) )
+assert( b:sub( -16 ) == "0123456789abcdef" )
+
+-- vars.get() does not truncate long strings either
+assert( vars.get( "/test/buffer/long" ) == long )
+
+local v, err = vars.get_buffer( "/test/buffer/missing", empty )
+assert( ( v == nil ) and ( err ~= nil ) )
+
+print( "test_buffer: ok" )
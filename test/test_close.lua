@@ -0,0 +1,71 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- lua_close test
+--
+-- Every object the library hands out is left alive when the script
+-- ends, so lua_close() collects them after the library has been
+-- unloaded.  The test passes if the process exits cleanly.  ctest
+-- also runs it with the accounting allocator and the allocation pools.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_close.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+assert( vars.create( "/test/close/a", "uint32", "1" ) )
+local hB = assert( vars.create( "/test/close/b", "str", "hello" ) )
+assert( vars.create( "/test/close/load", "uint32", "0" ) )
+
+-- notifications owned by a watch set, a bound table and the script
+local ws = assert( vars.watch( { "/test/close/a" }, NOTIFY_MODIFIED ) )
+local cfg = assert( vars.bind( {}, { a = "/test/close/a",
+                                     b = "/test/close/b" } ) )
+assert( cfg.a == 1 and cfg.b == "hello" )
+assert( vars.notify( hB, NOTIFY_MODIFIED ) )
+
+-- a buffer, a journal and a running profiler
+local buf = vars.buffer( 4096 )
+assert( buf:len() == 0 )
+assert( vars.journal_start( 64 ) )
+assert( vars.profile_start( 997 ) )
+
+-- a finished and a running load generator
+local done = assert( vars.loadgen{ handles = { "/test/close/load" },
+                                   duration = 10 } )
+while not done:done() do
+end
+local running = assert( vars.loadgen{ handles = { "/test/close/load" } } )
+
+-- keep some garbage for the collector to free at close
+local junk = {}
+for i = 1, 1000 do
+    junk[i] = { i, tostring( i ) }
+end
+
+print( "test_close: ok" )
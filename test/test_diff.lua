@@ -0,0 +1,96 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- snapshot diff test
+--
+-- vars.diff() reports the variables which changed between two snapshots,
+-- or between a snapshot and the live values, with the variables which
+-- are only in one snapshot reported without a from or to value.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_diff.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+local function count( t )
+    local n = 0
+    for _ in pairs( t ) do
+        n = n + 1
+    end
+    return n
+end
+
+assert( vars.create( "/test/diff/a", "uint32", "1" ) )
+assert( vars.create( "/test/diff/b", "str", "same" ) )
+assert( vars.create( "/test/diff/c", "int32", "-3" ) )
+
+local before = os.tmpname()
+local after = os.tmpname()
+
+assert( vars.snapshot( "/test/diff/", before ) == 3 )
+
+-- a changed, b unchanged, c dropped and d added
+vars.set( "/test/diff/a", 2 )
+assert( vars.create( "/test/diff/d", "uint32", "4" ) )
+assert( vars.snapshot( { "/test/diff/a", "/test/diff/b", "/test/diff/d" },
+                       after ) == 3 )
+
+local changes, n = vars.diff( before, after )
+assert( changes ~= nil, n )
+assert( n == 3, "expected 3 changes, got " .. tostring( n ) )
+assert( count( changes ) == n )
+assert( ( changes["/test/diff/a"].from == 1 ) and
+        ( changes["/test/diff/a"].to == 2 ) )
+assert( changes["/test/diff/b"] == nil )
+assert( ( changes["/test/diff/c"].from == -3 ) and
+        ( changes["/test/diff/c"].to == nil ) )
+assert( ( changes["/test/diff/d"].from == nil ) and
+        ( changes["/test/diff/d"].to == 4 ) )
+
+-- a snapshot against the live values only covers its own variables
+vars.set( "/test/diff/b", "drift" )
+changes, n = vars.diff( before )
+assert( changes ~= nil, n )
+assert( n == 2, "expected 2 changes, got " .. tostring( n ) )
+assert( changes["/test/diff/a"].to == 2 )
+assert( ( changes["/test/diff/b"].from == "same" ) and
+        ( changes["/test/diff/b"].to == "drift" ) )
+assert( changes["/test/diff/d"] == nil )
+
+vars.set( "/test/diff/a", 1 )
+vars.set( "/test/diff/b", "same" )
+changes, n = vars.diff( before )
+assert( ( n == 0 ) and ( next( changes ) == nil ) )
+
+-- a snapshot file which does not exist
+os.remove( after )
+changes, n = vars.diff( before, after )
+os.remove( before )
+assert( ( changes == nil ) and ( n ~= nil ), "a missing file was compared" )
+
+print( "test_diff: ok" )
@@ -0,0 +1,68 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- garbage collection accounting test
+--
+-- vars.gc_mode() installs the accounting allocator, so the bytes freed
+-- inside handlers and inside vars.wait() are reported in the gc table
+-- of vars.stats() without LUAVARS_ALLOC.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_gcmode.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+assert( vars.gc_mode( "idle" ) == 1 )
+
+local h = assert( vars.create( "/test/gcmode/a", "uint32", "0" ) )
+assert( vars.notify( h, NOTIFY_MODIFIED ) )
+
+-- each handler leaves garbage to be collected by vars.wait(), and the
+-- last one also collects some itself
+for i = 1, 20 do
+    assert( vars.set( h, tostring( i ) ) == 1 )
+    local sig, id = vars.wait()
+    assert( ( sig == SIG_VAR_MODIFIED ) and ( id == h ) )
+
+    local junk = {}
+    for j = 1, 1000 do
+        junk[j] = { j, tostring( j ) }
+    end
+end
+
+collectgarbage()
+
+assert( vars.set( h, "0" ) == 1 )
+vars.wait()
+
+local gc = vars.stats().gc
+assert( gc.mode == "idle" )
+assert( gc.handlers.freed > 0, "no bytes freed in handlers were counted" )
+assert( gc.idle.freed > 0, "no bytes freed by vars.wait() were counted" )
+
+print( "test_gcmode: ok" )
@@ -0,0 +1,76 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- batched get test
+--
+-- vars.get_many() returns the values of a list of names and handles
+-- keyed by the list entries, whether the batch is fetched by the script
+-- or split between fetch threads, and reports the entries which failed.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_get_many.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+local list = {}
+local expected = {}
+
+for i = 1, 50 do
+    local name = string.format( "/test/get_many/%02d", i )
+    local h = assert( vars.create( name, "uint32", tostring( i ) ) )
+
+    -- alternate names and handles
+    local entry = ( i % 2 == 0 ) and name or h
+    list[#list + 1] = entry
+    expected[entry] = i
+end
+
+local hS = assert( vars.create( "/test/get_many/str", "str", "hello" ) )
+list[#list + 1] = hS
+expected[hS] = "hello"
+list[#list + 1] = "/test/get_many/missing"
+
+-- fetched by the script, then by thread pools of two sizes, the second
+-- call with each size reusing the threads started by the first
+for _, threads in ipairs( { 1, 4, 4, 3 } ) do
+    local values, failed = vars.get_many( list, threads )
+    assert( values ~= nil, failed )
+
+    for entry, v in pairs( expected ) do
+        assert( values[entry] == v,
+                string.format( "%d threads: %s = %s, expected %s",
+                               threads, tostring( entry ),
+                               tostring( values[entry] ), tostring( v ) ) )
+    end
+
+    assert( values["/test/get_many/missing"] == nil )
+    assert( failed["/test/get_many/missing"] ~= nil,
+            "missing name not reported" )
+end
+
+print( "test_get_many: ok" )
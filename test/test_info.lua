@@ -0,0 +1,86 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- variable metadata test
+--
+-- vars.info() and vars.name() report the metadata of a variable, and
+-- only the first lookup of a handle's type or name misses the metadata
+-- cache.  Under the reconnect backend, a reconnection discards the cache.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_info.lua
+--        LUAVARS_BACKEND=reconnect:memory luavars_bench test/test_info.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+local function cache()
+    local m = vars.stats().metacache
+    return m.hits, m.misses, m.invalidations
+end
+
+local hU = assert( vars.create( "/test/info/u32", "uint32", "1" ) )
+local hS = assert( vars.create( "/test/info/str", "str", "hello" ) )
+
+-- the first lookup misses, later ones hit
+local hits, misses = cache()
+local info = assert( vars.info( hU ) )
+assert( ( info.handle == hU ) and ( info.name == "/test/info/u32" ) )
+assert( info.type == "uint32" )
+local hits1, misses1 = cache()
+assert( misses1 > misses, "the first lookup did not miss" )
+
+info = assert( vars.info( "/test/info/u32" ) )
+assert( info.handle == hU )
+assert( vars.name( hU ) == "/test/info/u32" )
+assert( vars.set( hU, 2 ) == 1 )
+local hits2, misses2 = cache()
+assert( ( hits2 > hits1 ) and ( misses2 == misses1 ),
+        "a cached type or name was fetched again" )
+
+-- the length of a string follows its value
+info = assert( vars.info( hS ) )
+assert( ( info.type == "str" ) and ( info.length == #"hello" + 1 ) )
+assert( vars.set( hS, "hi" ) == 1 )
+assert( vars.info( hS ).length == #"hi" + 1 )
+
+-- unknown variables
+local v, err = vars.info( "/test/info/missing" )
+assert( ( v == nil ) and ( err ~= nil ) )
+v, err = vars.name( hS + 1000 )
+assert( ( v == nil ) and ( err ~= nil ) )
+
+-- a reconnection may find the variables recreated with other types
+if vars.reconnect() ~= nil then
+    local _, misses3, invalidations = cache()
+    assert( vars.info( hU ).type == "uint32" )
+    local _, misses4, invalidations4 = cache()
+    assert( invalidations4 > invalidations, "the cache was not discarded" )
+    assert( misses4 > misses3 )
+end
+
+print( "test_info: ok" )
@@ -0,0 +1,95 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- change journal test
+--
+-- The journal keeps the most recent changes in a ring, returns them
+-- oldest first filtered by timestamp, handle or source, and evicts the
+-- least recently used last value when its table is crowded.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_journal.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+-- the ring keeps the latest entries, oldest first
+assert( vars.journal_start( 4 ) == 1 )
+assert( vars.stats().journal.size == 4 )
+
+local hA = assert( vars.create( "/test/journal/a", "uint32", "0" ) )
+for i = 1, 6 do
+    vars.set( hA, i )
+end
+
+local changes, ts = vars.journal()
+assert( #changes == 4, "expected 4 entries, got " .. #changes )
+for i, c in ipairs( changes ) do
+    assert( ( c.handle == hA ) and ( c.source == "set" ) )
+    assert( ( c.from == i + 1 ) and ( c.to == i + 2 ),
+            string.format( "entry %d: %s -> %s", i, tostring( c.from ),
+                           tostring( c.to ) ) )
+    assert( ( i == 1 ) or ( c.ts >= changes[i - 1].ts ) )
+end
+assert( ts == changes[4].ts )
+
+-- only newer entries, and the entries of one handle or source
+local hB = assert( vars.create( "/test/journal/b", "uint32", "0" ) )
+changes = vars.journal( ts )
+assert( #changes == 0 )
+
+vars.set( hB, 1 )
+vars.set( hA, 7 )
+changes = vars.journal( ts )
+assert( #changes == 2 )
+changes = vars.journal( ts, hB )
+assert( ( #changes == 1 ) and ( changes[1].to == 1 ) )
+assert( #vars.journal( 0, "set" ) == 4 )
+assert( #vars.journal( 0, "modified" ) == 0 )
+
+-- a variable used between every other keeps its last value while the
+-- others are evicted from the crowded last value table
+local hHot = assert( vars.create( "/test/journal/hot", "uint32", "0" ) )
+vars.set( hHot, 0 )
+
+for i = 1, 256 do
+    local h = assert( vars.create( string.format( "/test/journal/%03d", i ),
+                                   "uint32", "0" ) )
+    vars.set( h, 1 )
+    vars.set( hHot, i )
+
+    changes = vars.journal( 0, hHot )
+    assert( changes[#changes].from == i - 1,
+            "the most recently used last value was evicted" )
+end
+
+assert( vars.stats().journal.evicted > 0, "no last value was evicted" )
+
+vars.journal_stop()
+assert( vars.stats().journal.started == false )
+
+print( "test_journal: ok" )
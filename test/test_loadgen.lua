@@ -0,0 +1,84 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- load generator completion test
+--
+-- A script may poll lg:done() without calling vars.wait(), and the
+-- completion signal must not kill it.  A script waiting in vars.wait()
+-- is woken by the completion signal.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_loadgen.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+assert( vars.create( "/test/loadgen/a", "uint32", "0" ) )
+
+-- poll for completion
+local lg = assert( vars.loadgen{ handles = { "/test/loadgen/a" },
+                                 duration = 100 } )
+while not lg:done() do
+end
+
+local r = lg:stop()
+assert( r.elapsed > 0 )
+assert( r.writes.threads == 1 and r.writes.errors == 0 )
+assert( r.reads.threads == 1 and r.reads.errors == 0 )
+
+-- the completion signal queued while polling is still pending
+assert( vars.wait() == SIG_LOADGEN_DONE )
+
+-- wait for completion
+lg = assert( vars.loadgen{ handles = { "/test/loadgen/a" },
+                           duration = 100 } )
+assert( vars.wait() == SIG_LOADGEN_DONE )
+assert( lg:done(), "var.wait() returned before the load generator ended" )
+r = lg:stop()
+assert( r.writes.errors == 0 )
+
+-- the subscriptions are cancelled by stop() and by collection.  With
+-- no writers, no notifications are raised
+local hB = assert( vars.create( "/test/loadgen/b", "uint32", "0" ) )
+assert( vars.notify( hB, NOTIFY_MODIFIED ) )
+lg = assert( vars.loadgen{ handles = { hB }, writers = 0,
+                           subscribe = true } )
+lg:stop()
+lg:stop()
+assert( vars.unnotify( hB, NOTIFY_MODIFIED ) == 1 )
+assert( vars.unnotify( hB, NOTIFY_MODIFIED ) == nil,
+        "stop() did not cancel the subscriptions" )
+
+lg = assert( vars.loadgen{ handles = { hB }, writers = 0,
+                           subscribe = true } )
+lg = nil
+collectgarbage()
+collectgarbage()
+assert( vars.unnotify( hB, NOTIFY_MODIFIED ) == nil,
+        "collection did not cancel the subscriptions" )
+
+print( "test_loadgen: ok" )
@@ -0,0 +1,93 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- manifest test
+--
+-- vars.manifest() resolves the names of a manifest table or file,
+-- registers their notifications and reports the names which failed.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_manifest.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+local hA = assert( vars.create( "/test/manifest/a", "uint32", "1" ) )
+local hB = assert( vars.create( "/test/manifest/b", "uint32", "1" ) )
+local hC = assert( vars.create( "/test/manifest/c", "uint32", "1" ) )
+
+-- a manifest table
+local handles, failed = vars.manifest( {
+    "/test/manifest/c",
+    ["/test/manifest/a"] = NOTIFY_MODIFIED,
+    ["/test/manifest/b"] = { NOTIFY_MODIFIED, NOTIFY_CALC },
+    ["/test/manifest/missing"] = NOTIFY_MODIFIED,
+} )
+assert( handles["/test/manifest/a"] == hA )
+assert( handles["/test/manifest/b"] == hB )
+assert( handles["/test/manifest/c"] == hC )
+assert( handles["/test/manifest/missing"] == nil )
+assert( failed["/test/manifest/missing"] ~= nil, "missing name not reported" )
+
+vars.set( hA, 2 )
+local sig, id = vars.wait()
+assert( ( sig == SIG_VAR_MODIFIED ) and ( id == hA ),
+        "manifest notification not registered" )
+
+assert( vars.unnotify( hA, NOTIFY_MODIFIED ) == 1 )
+assert( vars.unnotify( hB, NOTIFY_MODIFIED ) == 1 )
+assert( vars.unnotify( hB, NOTIFY_CALC ) == 1 )
+assert( vars.unnotify( hC, NOTIFY_MODIFIED ) == nil,
+        "a resolve only entry registered a notification" )
+
+-- a manifest file
+local path = os.tmpname()
+local f = assert( io.open( path, "w" ) )
+f:write( "# name              notifications\n" )
+f:write( "/test/manifest/a    modified\n" )
+f:write( "\n" )
+f:write( "/test/manifest/c\n" )
+f:close()
+
+handles, failed = vars.manifest( path )
+assert( handles["/test/manifest/a"] == hA )
+assert( handles["/test/manifest/c"] == hC )
+assert( next( failed ) == nil )
+assert( vars.unnotify( hA, NOTIFY_MODIFIED ) == 1 )
+
+-- an unknown notification name fails the whole file
+f = assert( io.open( path, "w" ) )
+f:write( "/test/manifest/a    changed\n" )
+f:close()
+
+local err
+handles, err = vars.manifest( path )
+os.remove( path )
+assert( ( handles == nil ) and ( err ~= nil ),
+        "a file with an unknown notification was accepted" )
+
+print( "test_manifest: ok" )
@@ -0,0 +1,77 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- memory backend test
+--
+-- Variables of each type created in the memory backend can be found,
+-- got and set by name or handle, and a modified notification raised by
+-- a set is returned by vars.wait().
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_memvars.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+local values = {
+    { "str", "hello", "world" },
+    { "uint16", 1, 65535 },
+    { "int16", -1, -32768 },
+    { "uint32", 1, 4294967295 },
+    { "int32", -1, -2147483648 },
+    { "uint64", 1, 1099511627776 },
+    { "int64", -1, -1099511627776 },
+    { "float", 1.5, -2.25 },
+}
+
+-- create, find, get and set each type
+for i, v in ipairs( values ) do
+    local name = "/test/memvars/" .. v[1]
+    local h = assert( vars.create( name, v[1], tostring( v[2] ) ) )
+    assert( vars.find( name ) == h )
+    assert( vars.get( name ) == v[2], name )
+    assert( vars.set( h, tostring( v[3] ) ) == 1 )
+    assert( vars.get( name ) == v[3], name )
+    assert( vars.set( name, tostring( v[2] ) ) == 1 )
+    assert( vars.get( name ) == v[2], name )
+end
+
+-- unknown variables and values which do not convert
+assert( vars.find( "/test/memvars/none" ) == nil )
+assert( vars.get( "/test/memvars/none" ) == nil )
+assert( vars.set( "/test/memvars/uint16", "x" ) == nil )
+assert( vars.get( "/test/memvars/uint16" ) == 1 )
+
+-- a set raises a modified notification
+local h = vars.find( "/test/memvars/uint32" )
+assert( vars.notify( h, NOTIFY_MODIFIED ) )
+assert( vars.set( h, "5" ) == 1 )
+local sig, id = vars.wait()
+assert( ( sig == SIG_VAR_MODIFIED ) and ( id == h ) )
+assert( vars.unnotify( h, NOTIFY_MODIFIED ) == 1 )
+
+print( "test_memvars: ok" )
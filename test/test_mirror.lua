@@ -0,0 +1,79 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- shared memory mirror overflow test
+--
+-- A value which does not fit its mirror slot must not leave a stale
+-- value in the mirror: vars.get() falls back to the variable server
+-- until the value fits again.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_mirror.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+local segment = "/luavars_test_" .. tostring( os.time() )
+local long = string.rep( "y", 300 )
+
+local hLong = assert( vars.create( "/test/mirror/long", "str", long ) )
+local hTick = assert( vars.create( "/test/mirror/tick", "uint32", "0" ) )
+
+local n, failed = vars.mirror_publish( segment, { "/test/mirror/long" } )
+assert( n == 1, failed and select( 2, next( failed ) ) )
+
+-- the value is too long for the slot, so it is read from the variable
+local m = vars.stats().mirror
+assert( m.invalid == 1 )
+assert( vars.get( "/test/mirror/long" ) == long,
+        "stale or truncated mirror value" )
+assert( vars.stats().mirror.misses > m.misses )
+
+-- a shorter value makes the slot valid again once the publisher has
+-- serviced the modified notification
+vars.set( hLong, "short" )
+assert( vars.notify( hTick, NOTIFY_MODIFIED ) )
+vars.set( hTick, 1 )
+local sig, id = vars.wait()
+assert( ( sig == SIG_VAR_MODIFIED ) and ( id == hTick ) )
+
+m = vars.stats().mirror
+assert( vars.get( "/test/mirror/long" ) == "short" )
+assert( vars.stats().mirror.hits == m.hits + 1 )
+
+-- and a long value invalidates it again
+vars.set( hLong, long )
+vars.set( hTick, 2 )
+sig, id = vars.wait()
+assert( id == hTick )
+assert( vars.get( "/test/mirror/long" ) == long )
+assert( vars.stats().mirror.invalid == 2 )
+assert( vars.stats().mirror.publisher_exited == false )
+
+vars.__unload()
+
+print( "test_mirror: ok" )
@@ -0,0 +1,81 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- notification list and prefix test
+--
+-- vars.notify_many() subscribes names and handles in one call and
+-- reports the entries which failed, and vars.notify_prefix() subscribes
+-- only the variables whose names start with the prefix.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_notify_many.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+-- a list of names and handles, with one name which does not exist
+local hA = assert( vars.create( "/test/many/a", "uint32", "1" ) )
+local hB = assert( vars.create( "/test/many/b", "uint32", "1" ) )
+local n, failed = vars.notify_many( { "/test/many/a", hB,
+                                      "/test/many/missing" },
+                                    NOTIFY_MODIFIED )
+assert( n == 2, "expected 2 registrations, got " .. tostring( n ) )
+assert( failed["/test/many/missing"] ~= nil, "missing name not reported" )
+assert( failed["/test/many/a"] == nil )
+
+vars.set( hB, 2 )
+local sig, id = vars.wait()
+assert( ( sig == SIG_VAR_MODIFIED ) and ( id == hB ),
+        "no notification for a handle entry" )
+
+vars.set( "/test/many/a", 2 )
+sig, id = vars.wait()
+assert( ( sig == SIG_VAR_MODIFIED ) and ( id == hA ),
+        "no notification for a name entry" )
+
+assert( vars.unnotify( hA, NOTIFY_MODIFIED ) == 1 )
+assert( vars.unnotify( hB, NOTIFY_MODIFIED ) == 1 )
+
+-- the prefix must start the name, not just appear in it
+local hX = assert( vars.create( "/test/prefix/x", "uint32", "1" ) )
+local hY = assert( vars.create( "/test/prefix/y", "uint32", "1" ) )
+local hZ = assert( vars.create( "/test/other/test/prefix/z", "uint32", "1" ) )
+n, failed = vars.notify_prefix( "/test/prefix/", NOTIFY_MODIFIED )
+assert( n == 2, "expected 2 registrations, got " .. tostring( n ) )
+assert( next( failed ) == nil )
+
+vars.set( hY, 2 )
+sig, id = vars.wait()
+assert( ( sig == SIG_VAR_MODIFIED ) and ( id == hY ),
+        "no notification for a prefixed variable" )
+
+assert( vars.unnotify( hX, NOTIFY_MODIFIED ) == 1 )
+assert( vars.unnotify( hY, NOTIFY_MODIFIED ) == 1 )
+assert( vars.unnotify( hZ, NOTIFY_MODIFIED ) == nil,
+        "a variable containing the prefix was subscribed" )
+
+print( "test_notify_many: ok" )
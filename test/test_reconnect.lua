@@ -0,0 +1,70 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- reconnect backend test
+--
+-- Under the reconnect backend the script holds virtual handles.  They
+-- must be translated in queries and notifications, and stay valid with
+-- their notifications registered again after vars.reconnect().
+--
+-- usage: LUAVARS_BACKEND=reconnect:memory luavars_bench test/test_reconnect.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=reconnect:memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+local hA = assert( vars.create( "/test/reconnect/a", "uint32", "1" ) )
+local hB = assert( vars.create( "/test/reconnect/b", "uint32", "1" ) )
+assert( vars.find( "/test/reconnect/b" ) == hB )
+
+-- the prefix query walks the wrapped backend's variables
+local n, failed = vars.notify_prefix( "/test/reconnect/", NOTIFY_MODIFIED )
+assert( n == 2, "expected 2 registrations, got " .. tostring( n ) )
+assert( next( failed ) == nil )
+
+vars.set( hB, 2 )
+local sig, id = vars.wait()
+assert( ( sig == SIG_VAR_MODIFIED ) and ( id == hB ),
+        "notification handle was not translated" )
+
+-- handles and notifications survive a reconnection
+local resolved, unresolved = vars.reconnect()
+assert( resolved ~= nil, unresolved )
+assert( resolved >= 2, "expected 2 names resolved, got " ..
+                       tostring( resolved ) )
+assert( unresolved == 0 )
+
+assert( vars.get( "/test/reconnect/b" ) == 2 )
+vars.set( hA, 3 )
+sig, id = vars.wait()
+assert( ( sig == SIG_VAR_MODIFIED ) and ( id == hA ),
+        "notification not registered again after reconnecting" )
+
+assert( vars.unnotify( hA, NOTIFY_MODIFIED ) == 1 )
+assert( vars.unnotify( hB, NOTIFY_MODIFIED ) == 1 )
+
+print( "test_reconnect: ok" )
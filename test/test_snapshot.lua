@@ -0,0 +1,112 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- snapshot and restore test
+--
+-- vars.snapshot() saves a prefix or a list of variables to a file, and
+-- vars.restore() sets each saved value back without text conversion,
+-- whether the batch is handled by the script or by fetch threads.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_snapshot.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+local saved = {
+    { "/test/snapshot/u32", "uint32", 7, 8 },
+    { "/test/snapshot/i32", "int32", -2147483648, 5 },
+    { "/test/snapshot/float", "float", -2.25, 1.5 },
+    { "/test/snapshot/str", "str", "hello", "world" },
+}
+
+for _, v in ipairs( saved ) do
+    assert( vars.create( v[1], v[2], tostring( v[3] ) ) )
+end
+assert( vars.create( "/test/other/u32", "uint32", "1" ) )
+
+local path = os.tmpname()
+
+local function check( field, what )
+    for _, v in ipairs( saved ) do
+        assert( vars.get( v[1] ) == v[field],
+                string.format( "%s: %s = %s", what, v[1],
+                               tostring( vars.get( v[1] ) ) ) )
+    end
+end
+
+local function change()
+    local values = {}
+    for _, v in ipairs( saved ) do
+        values[v[1]] = v[4]
+    end
+
+    local n, failed = vars.set_many( values )
+    assert( n == #saved, failed and next( failed ) )
+    check( 4, "set_many" )
+end
+
+-- a prefix, restored by the script
+local n, failed = vars.snapshot( "/test/snapshot/", path )
+assert( n == #saved, "expected " .. #saved .. " saved, got " ..
+                     tostring( n ) )
+assert( next( failed ) == nil )
+
+change()
+n, failed = vars.restore( path )
+assert( n == #saved, failed )
+assert( next( failed ) == nil )
+check( 3, "restore" )
+
+-- a list of names with one missing, saved and restored by threads
+local names = { "/test/snapshot/missing" }
+for _, v in ipairs( saved ) do
+    names[#names + 1] = v[1]
+end
+
+n, failed = vars.snapshot( names, path, 2 )
+assert( n == #saved )
+assert( failed["/test/snapshot/missing"] ~= nil,
+        "missing name not reported" )
+
+change()
+n, failed = vars.restore( path, 2 )
+assert( n == #saved, failed )
+check( 3, "threaded restore" )
+assert( vars.get( "/test/other/u32" ) == 1 )
+
+-- a file which is not a snapshot
+local f = assert( io.open( path, "w" ) )
+f:write( "not a snapshot\n" )
+f:close()
+
+local err
+n, err = vars.restore( path )
+os.remove( path )
+assert( ( n == nil ) and ( err ~= nil ), "an invalid file was restored" )
+
+print( "test_snapshot: ok" )
@@ -0,0 +1,63 @@
+--------------------------------------------------------------------------------
+--MIT License
+--
+--Copyright (c) 2023 Trevor Monk
+--
+--Permission is hereby granted, free of charge, to any person obtaining a copy
+--of this software and associated documentation files (the "Software"), to deal
+--in the Software without restriction, including without limitation the rights
+--to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+--copies of the Software, and to permit persons to whom the Software is
+--furnished to do so, subject to the following conditions:
+--
+--The above copyright notice and this permission notice shall be included in all
+--copies or substantial portions of the Software.
+--
+--THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+--IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+--FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+--AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+--LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+--OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+--SOFTWARE.
+--------------------------------------------------------------------------------
+
+-- watch set cancellation test
+--
+-- Notifications registered by the script and by watch sets on the same
+-- variable are counted, so releasing one of them must not cancel the
+-- others.
+--
+-- usage: LUAVARS_BACKEND=memory luavars_bench test/test_watch.lua
+
+-- The library is loaded from LUAVARS_LIB when the test is run by a Lua
+-- interpreter, and is already linked in when it is run by luavars_bench.
+-- LUAVARS_BACKEND=memory is set by ctest.
+local lib = os.getenv( "LUAVARS_LIB" )
+local vars = lib and assert( package.loadlib( lib, "luaopen_libluavars" ) )()
+             or require( "libluavars" )
+
+-- a watch set collected while the script holds its own registration
+local hA = assert( vars.create( "/test/watch/a", "uint32", "1" ) )
+assert( vars.notify( hA, NOTIFY_MODIFIED ) )
+local ws = vars.watch( { "/test/watch/a" }, NOTIFY_MODIFIED )
+assert( #ws:handles() == 1 )
+ws = nil
+collectgarbage()
+collectgarbage()
+assert( vars.unnotify( hA, NOTIFY_MODIFIED ) == 1,
+        "the watch set cancelled the script's notification" )
+
+-- cancelling a watch set twice only releases it once
+local hB = assert( vars.create( "/test/watch/b", "uint32", "1" ) )
+local ws1 = vars.watch( { hB }, NOTIFY_MODIFIED )
+local ws2 = vars.watch( { hB }, NOTIFY_MODIFIED )
+assert( ws1:cancel() == 1 )
+assert( ws1:cancel() == 0 )
+vars.set( hB, 2 )
+local sig, id = vars.wait()
+assert( ( sig == SIG_VAR_MODIFIED ) and ( id == hB ),
+        "the second watch set was cancelled with the first" )
+assert( ws2:cancel() == 1 )
+
+print( "test_watch: ok" )